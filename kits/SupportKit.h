@@ -36,6 +36,9 @@
 #include <support/SimpleLocker.h>
 #include <support/Locker.h>
 #include <support/String.h>
+#include <support/Allocator.h>
 #include <support/List.h>
+#include <support/HashMap.h>
 #include <support/StringArray.h>
+#include <support/StringTokenizer.h>
 
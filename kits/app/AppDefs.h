@@ -70,6 +70,8 @@ enum {
 	E_ZOOM					= '_WZM',
 	_QUIT_					= '_QIT',
 	_EVENTS_PENDING_			= '_EVP',
+	_EVENTS_IN_AREA_			= '_EVA',
+	_REMOTE_EVENTS_				= '_EVR',
 	_UPDATE_				= '_UPD',
 	_UPDATE_IF_NEEDED_			= '_UPN',
 	_MENU_EVENT_				= '_MEV'
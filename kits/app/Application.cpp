@@ -47,14 +47,15 @@ BMessenger app_messenger;
 BClipboard clipboard("system");
 const BCursor *B_CURSOR_SYSTEM_DEFAULT = &_B_CURSOR_SYSTEM_DEFAULT;
 
-BList BApplication::sRunnerList;
-bigtime_t BApplication::sRunnerMinimumInterval = B_INT64_CONSTANT(0);
-
 extern BLocker* get_handler_operator_locker();
 extern bool font_init(void);
 extern void font_cancel(void);
 extern bool font_lock(void);
 extern void font_unlock(void);
+extern status_t start_team_port(const char *signature);
+extern void stop_team_port();
+extern status_t start_message_runners();
+extern void stop_message_runners();
 
 void
 BApplication::Init(const char *signature, bool tryInterface)
@@ -81,6 +82,13 @@ BApplication::Init(const char *signature, bool tryInterface)
 
 	hLocker->Unlock();
 
+	// the other teams reach the loopers through this port
+	if (start_team_port(signature) != B_OK)
+		ETK_WARNING("[APP]: %s --- Unable to receive messages from other teams.", __PRETTY_FUNCTION__);
+
+	if (start_message_runners() != B_OK)
+		ETK_WARNING("[APP]: %s --- Unable to run the message runners.", __PRETTY_FUNCTION__);
+
 	clipboard.StartWatching(app_messenger);
 
 	if (tryInterface) InitGraphicsEngine();
@@ -106,6 +114,9 @@ BApplication::~BApplication()
 		ETK_ERROR("[APP]: Task must call \"PostMessage(B_QUIT_REQUESTED)\" instead \"delete\" to quit the application!!!");
 	hLocker->Unlock();
 
+	stop_team_port();
+	stop_message_runners();
+
 	quit_all_loopers(true);
 
 	if (fGraphicsEngine != NULL) {
@@ -170,6 +181,9 @@ BApplication::Instantiate(const BMessage *from)
 }
 
 
+static e_instantiation_entry _e_application_entry("BApplication", BApplication::Instantiate);
+
+
 void*
 BApplication::Run()
 {
@@ -211,49 +225,6 @@ BApplication::Run()
 }
 
 
-void
-BApplication::dispatch_message_runners()
-{
-	BLocker *hLocker = get_handler_operator_locker();
-
-	hLocker->Lock();
-
-	if (sRunnerMinimumInterval == B_INT64_CONSTANT(0)) {
-		hLocker->Unlock();
-		return;
-	}
-
-	sRunnerMinimumInterval = B_INT64_CONSTANT(0);
-	bigtime_t curTime = real_time_clock_usecs();
-	for (int32 i = 0; i < sRunnerList.CountItems(); i++) {
-		BMessageRunner *runner = (BMessageRunner*)sRunnerList.ItemAt(i);
-		if (runner == NULL || runner->IsValid() == false || runner->fCount == 0 || runner->fInterval <= B_INT64_CONSTANT(0) ||
-		        runner->fTarget == NULL || runner->fTarget->IsValid() == false || runner->fMessage == NULL) continue;
-
-		if (runner->fPrevSendTime <B_INT64_CONSTANT(0) || curTime - runner->fPrevSendTime >= runner->fInterval) {
-			// TODO: replyTo
-			runner->fPrevSendTime = curTime;
-			bool send = (runner->fTarget->SendMessage(runner->fMessage, (BHandler*)NULL, B_INT64_CONSTANT(50000)) == B_OK);
-
-			if (sRunnerList.ItemAt(i) != (void*)runner || sRunnerMinimumInterval <B_INT64_CONSTANT(0)) {
-				i = 0;
-				continue;
-			}
-			if (send && runner->fCount > 0) runner->fCount -= 1;
-			if (runner->IsValid() == false || runner->fCount == 0 || runner->fInterval <= B_INT64_CONSTANT(0) ||
-			        runner->fTarget == NULL || runner->fTarget->IsValid() == false || runner->fMessage == NULL) continue;
-			if (sRunnerMinimumInterval == B_INT64_CONSTANT(0) ||
-			        runner->fInterval < sRunnerMinimumInterval) sRunnerMinimumInterval = runner->fInterval;
-		} else if (sRunnerMinimumInterval == B_INT64_CONSTANT(0) ||
-		           runner->fInterval - (curTime - runner->fPrevSendTime) <  sRunnerMinimumInterval) {
-			sRunnerMinimumInterval = runner->fInterval - (curTime - runner->fPrevSendTime);
-		}
-	}
-
-	hLocker->Unlock();
-}
-
-
 bool
 BApplication::QuitRequested()
 {
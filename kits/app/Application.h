@@ -79,7 +79,6 @@ class BApplication : public BLooper
 
 	private:
 		friend class BLooper;
-		friend class BMessageRunner;
 		friend class BWindow;
 		friend class BView;
 		friend class BBitmap;
@@ -92,10 +91,6 @@ class BApplication : public BLooper
 		bigtime_t fPulseRate;
 		BMessageRunner *fPulseRunner;
 
-		static BList sRunnerList;
-		static bigtime_t sRunnerMinimumInterval;
-		static void dispatch_message_runners();
-
 		bool quit_all_loopers(bool force);
 
 		BGraphicsEngine *fGraphicsEngine;
@@ -59,8 +59,15 @@ class _EObserverList
 };
 
 
+#define E_HANDLER_LOCKER_SHARDS	64
+
 static BLocker handler_operator_locker;
-static BTokensDepot handlers_depot(&handler_operator_locker, false);
+static BLocker handlers_depot_locker;
+static BTokensDepot handlers_depot(&handlers_depot_locker, false);
+
+// one of them guards the handler of the token from being deleted and its looper from being changed,
+// the others keep posting to and locking the other loopers, the operator locker goes before them
+static BLocker handler_lockers[E_HANDLER_LOCKER_SHARDS];
 
 _LOCAL BLocker* get_handler_operator_locker()
 {
@@ -68,6 +75,24 @@ _LOCAL BLocker* get_handler_operator_locker()
 }
 
 
+_LOCAL BLocker* get_handler_locker(uint64 token)
+{
+	return &handler_lockers[(uint32)(token ^ (token >> 32)) % E_HANDLER_LOCKER_SHARDS];
+}
+
+
+// gives up the locker held by the current thread, returns how many times to take it back
+static int64 unlock_locker_held(BLocker *locker)
+{
+	if (locker->IsLockedByCurrentThread() == false) return B_INT64_CONSTANT(0);
+
+	int64 locksCount = locker->CountLocks();
+	for (int64 i = B_INT64_CONSTANT(0); i < locksCount; i++) locker->Unlock();
+
+	return locksCount;
+}
+
+
 _LOCAL uint64 get_handler_token(const BHandler *handler)
 {
 	return((handler == NULL || handler->fToken == NULL) ?B_MAXUINT64 : handler->fToken->Token());
@@ -85,35 +110,21 @@ _LOCAL uint64 get_ref_handler_token(const BHandler *handler)
 
 _LOCAL BHandler* get_handler(uint64 token)
 {
-	BHandler *retVal = NULL;
-
-	BToken *aToken = handlers_depot.OpenToken(token);
-	if (aToken != NULL) {
-		retVal = reinterpret_cast<BHandler*>(aToken->Data());
-		delete aToken;
-	}
-
-	return retVal;
+	void *data = NULL;
+	return(handlers_depot.FetchToken(token, &data, NULL) ? reinterpret_cast<BHandler*>(data) : NULL);
 }
 
 
 _LOCAL bigtime_t get_handler_create_time_stamp(uint64 token)
 {
 	bigtime_t retVal = B_MAXINT64;
-
-	BToken *aToken = handlers_depot.OpenToken(token);
-	if (aToken != NULL) {
-		retVal = aToken->TimeStamp();
-		delete aToken;
-	}
-
-	return retVal;
+	return(handlers_depot.FetchToken(token, NULL, &retVal) ? retVal : B_MAXINT64);
 }
 
 
 _LOCAL BLooper* get_handler_looper(uint64 token)
 {
-	BAutolock <BLocker>autolock(handler_operator_locker);
+	BAutolock <BLocker>autolock(get_handler_locker(token));
 
 	BHandler *handler = get_handler(token);
 	return(handler == NULL ? NULL : handler->fLooper);
@@ -132,24 +143,23 @@ _LOCAL uint64 get_ref_looper_token(uint64 token)
 _LOCAL status_t lock_looper_of_handler(uint64 token, bigtime_t timeout)
 {
 	status_t retVal = B_ERROR;
+	BLocker *hLocker = get_handler_locker(token);
 
-	handler_operator_locker.Lock();
+	hLocker->Lock();
 	BLooper *looper = get_handler_looper(token);
 	BLooper *looper_proxy = (looper != NULL ? looper->_Proxy() : NULL);
 	void *locker = ((looper == NULL || looper->fLocker == NULL) ? NULL : clone_locker(looper->fLocker));
-	int64 locksCount = handler_operator_locker.CountLocks();
-	while (handler_operator_locker.CountLocks() >B_INT64_CONSTANT(0)) handler_operator_locker.Unlock();
+	hLocker->Unlock();
+
+	// nothing held by the caller blocks the others while waiting
+	int64 operatorLocksCount = unlock_locker_held(&handler_operator_locker);
+	int64 locksCount = unlock_locker_held(hLocker);
 
 	if (locker) {
 		if ((retVal = lock_locker_etc(locker, B_TIMEOUT, timeout)) == B_OK) {
-			handler_operator_locker.Lock();
-
+			hLocker->Lock();
 			if (looper != get_handler_looper(token) || looper_proxy != looper->_Proxy()) retVal = B_ERROR;
-
-			if (locksCount >B_INT64_CONSTANT(1))
-				locksCount--;
-			else
-				handler_operator_locker.Unlock();
+			hLocker->Unlock();
 
 			if (retVal != B_OK) unlock_locker(locker);
 		}
@@ -157,10 +167,8 @@ _LOCAL status_t lock_looper_of_handler(uint64 token, bigtime_t timeout)
 		delete_locker(locker);
 	}
 
-	while (locksCount >B_INT64_CONSTANT(1)) {
-		handler_operator_locker.Lock();
-		locksCount--;
-	}
+	for (; operatorLocksCount > B_INT64_CONSTANT(0); operatorLocksCount--) handler_operator_locker.Lock();
+	for (; locksCount > B_INT64_CONSTANT(0); locksCount--) hLocker->Lock();
 
 	return retVal;
 }
@@ -212,7 +220,11 @@ BHandler::~BHandler()
 	}
 
 	if (fName != NULL) delete[] fName;
-	if (fToken != NULL) delete fToken;
+	if (fToken != NULL) {
+		BAutolock <BLocker>autolock(handler_operator_locker);
+		BAutolock <BLocker>hAutolock(get_handler_locker(fToken->Token()));
+		delete fToken;
+	}
 	delete fObserverList;
 }
 
@@ -248,6 +260,9 @@ BHandler::Instantiate(const BMessage *from)
 }
 
 
+static e_instantiation_entry _e_handler_entry("BHandler", BHandler::Instantiate);
+
+
 void
 BHandler::SetName(const char *name)
 {
@@ -335,6 +350,7 @@ void
 BHandler::SetLooper(BLooper *looper)
 {
 	BAutolock <BLocker>autolock(handler_operator_locker);
+	BAutolock <BLocker>hAutolock(get_handler_locker(get_handler_token(this)));
 	fLooper = looper;
 }
 
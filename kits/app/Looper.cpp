@@ -44,16 +44,86 @@
 extern BHandler* get_handler(uint64 token);
 extern BLooper* get_handler_looper(uint64 token);
 extern BLocker* get_handler_operator_locker();
-extern bool ref_handler(uint64 token);
-extern void unref_handler(uint64 token);
+extern BLocker* get_handler_locker(uint64 token);
 extern bigtime_t get_handler_create_time_stamp(uint64 token);
 extern status_t lock_looper_of_handler(uint64 token, bigtime_t timeout);
 
 BList BLooper::sLooperList;
 
 
+#define E_LOOPER_DISPATCH_BATCH	32
+#define E_LOOPER_POOL_THREADS	4
+
+
+// the pooled loopers having messages, each one is queued once at most
+static struct {
+	BLocker locker;
+	BLooper *head;
+	BLooper *tail;
+	void *sem;
+	void *threads[E_LOOPER_POOL_THREADS];
+} looper_pool;
+
+
+static void looper_pool_stop()
+{
+	looper_pool.locker.Lock();
+	void *sem = looper_pool.sem;
+	looper_pool.locker.Unlock();
+
+	if (sem == NULL) return;
+
+	// the threads leave when the semaphore is closed
+	close_sem(sem);
+	for (int32 i = 0; i < E_LOOPER_POOL_THREADS; i++) {
+		if (looper_pool.threads[i] == NULL) continue;
+
+		status_t status;
+		wait_for_thread(looper_pool.threads[i], &status);
+		delete_thread(looper_pool.threads[i]);
+		looper_pool.threads[i] = NULL;
+	}
+
+	looper_pool.locker.Lock();
+	delete_sem(looper_pool.sem);
+	looper_pool.sem = NULL;
+	looper_pool.locker.Unlock();
+}
+
+
+static bool looper_pool_is_current_thread()
+{
+	BAutolock <BLocker>autolock(&looper_pool.locker);
+
+	for (int32 i = 0; i < E_LOOPER_POOL_THREADS; i++) {
+		if (looper_pool.threads[i] != NULL && get_thread_id(looper_pool.threads[i]) == get_current_thread_id()) return true;
+	}
+
+	return false;
+}
+
+
+// the quit requests and the input events don't wait behind the bulk messages
+static void looper_set_lanes(BMessageQueue *queue)
+{
+	if (queue == NULL) return;
+
+	queue->SetLane(B_QUIT_REQUESTED, B_URGENT_LANE);
+
+	queue->SetLane(B_KEY_DOWN, B_INPUT_LANE);
+	queue->SetLane(B_KEY_UP, B_INPUT_LANE);
+	queue->SetLane(B_UNMAPPED_KEY_DOWN, B_INPUT_LANE);
+	queue->SetLane(B_UNMAPPED_KEY_UP, B_INPUT_LANE);
+	queue->SetLane(B_MODIFIERS_CHANGED, B_INPUT_LANE);
+	queue->SetLane(B_MOUSE_DOWN, B_INPUT_LANE);
+	queue->SetLane(B_MOUSE_UP, B_INPUT_LANE);
+	queue->SetLane(B_MOUSE_MOVED, B_INPUT_LANE);
+	queue->SetLane(B_MOUSE_WHEEL_CHANGED, B_INPUT_LANE);
+}
+
+
 BLooper::BLooper(const char *name, int32 priority)
-		: BHandler(name), fDeconstructing(false), fProxy(NULL), fPreferredHandler(NULL), fLocker(NULL), fLocksCount(B_INT64_CONSTANT(0)), fThread(NULL), fSem(NULL), fMessageQueue(NULL), fCurrentMessage(NULL), fThreadExited(NULL)
+		: BHandler(name), fDeconstructing(false), fProxy(NULL), fPreferredHandler(NULL), fLocker(NULL), fLocksCount(B_INT64_CONSTANT(0)), fThread(NULL), fSem(NULL), fSemPosters(0), fMessageQueue(NULL), fCurrentMessage(NULL), fDispatchBatch(E_LOOPER_DISPATCH_BATCH), fPooled(false), fPoolPosts(0), fPoolNext(NULL), fPoolThread(0), fPoolQuitSem(NULL), fThreadExited(NULL)
 {
 	BLocker *hLocker = get_handler_operator_locker();
 	BAutolock <BLocker>autolock(hLocker);
@@ -65,6 +135,7 @@ BLooper::BLooper(const char *name, int32 priority)
 
 	fMessageQueue = new BMessageQueue();
 	if (fMessageQueue) fSem = create_sem(B_INT64_CONSTANT(0), NULL);
+	looper_set_lanes(fMessageQueue);
 
 	fThreadPriority = priority;
 
@@ -96,6 +167,22 @@ BLooper::~BLooper()
 	BLocker *hLocker = get_handler_operator_locker();
 	BAutolock <BLocker>autolock(hLocker);
 
+	// the messengers post to the looper with the locker of its token only
+	BAutolock <BLocker>tAutolock(get_handler_locker(get_handler_token(this)));
+
+	if (fPooled) {
+		looper_pool.locker.Lock();
+		BLooper *prev = NULL;
+		for (BLooper *looper = looper_pool.head; looper != NULL; prev = looper, looper = looper->fPoolNext) {
+			if (looper != this) continue;
+			if (prev) prev->fPoolNext = fPoolNext;
+			else looper_pool.head = fPoolNext;
+			if (looper_pool.tail == this) looper_pool.tail = prev;
+			break;
+		}
+		looper_pool.locker.Unlock();
+	}
+
 	if (fMessageQueue) delete fMessageQueue;
 	if (fSem) delete_sem(fSem);
 	if (fCurrentMessage) delete fCurrentMessage;
@@ -113,7 +200,7 @@ BLooper::~BLooper()
 
 
 BLooper::BLooper(const BMessage *from)
-		: BHandler(from), fDeconstructing(false), fProxy(NULL), fThreadPriority(B_NORMAL_PRIORITY), fPreferredHandler(NULL), fLocker(NULL), fLocksCount(B_INT64_CONSTANT(0)), fThread(NULL), fSem(NULL), fMessageQueue(NULL), fCurrentMessage(NULL), fThreadExited(NULL)
+		: BHandler(from), fDeconstructing(false), fProxy(NULL), fThreadPriority(B_NORMAL_PRIORITY), fPreferredHandler(NULL), fLocker(NULL), fLocksCount(B_INT64_CONSTANT(0)), fThread(NULL), fSem(NULL), fSemPosters(0), fMessageQueue(NULL), fCurrentMessage(NULL), fDispatchBatch(E_LOOPER_DISPATCH_BATCH), fPooled(false), fPoolPosts(0), fPoolNext(NULL), fPoolThread(0), fPoolQuitSem(NULL), fThreadExited(NULL)
 {
 	BLocker *hLocker = get_handler_operator_locker();
 	BAutolock <BLocker>autolock(hLocker);
@@ -125,6 +212,7 @@ BLooper::BLooper(const BMessage *from)
 
 	fMessageQueue = new BMessageQueue();
 	if (fMessageQueue) fSem = create_sem(B_INT64_CONSTANT(0), NULL);
+	looper_set_lanes(fMessageQueue);
 
 	sLooperList.AddItem(this);
 }
@@ -153,6 +241,9 @@ BLooper::Instantiate(const BMessage *from)
 }
 
 
+static e_instantiation_entry _e_looper_entry("BLooper", BLooper::Instantiate);
+
+
 void
 BLooper::AddHandler(BHandler *handler)
 {
@@ -339,17 +430,37 @@ BLooper::PostMessage(const BMessage *_message, BHandler *handler, BHandler *repl
 		return B_BAD_VALUE;
 	}
 
+	// the copy shares the fields with "_message"
+	BMessage *aMsg = new BMessage(*_message);
+	if (aMsg == NULL) return B_NO_MEMORY;
+
+	return PostAdoptedMessage(aMsg, handler, reply_to);
+}
+
+
+status_t
+BLooper::PostAdoptedMessage(BMessage *message)
+{
+	return PostAdoptedMessage(message, this, NULL);
+}
+
+
+status_t
+BLooper::PostAdoptedMessage(BMessage *message, BHandler *handler, BHandler *reply_to)
+{
+	if (message == NULL) {
+		ETK_WARNING("[APP]: %s --- Can't post empty message.", __PRETTY_FUNCTION__);
+		return B_BAD_VALUE;
+	}
+
 	uint64 handlerToken = get_handler_token(handler);
 	uint64 replyToken = get_handler_token(reply_to);
 
-	BMessage aMsg(*_message);
-	aMsg.fIsReply = false;
-	if (aMsg.fSource != NULL) {
-		delete_port(aMsg.fSource);
-		aMsg.fSource = NULL;
-	}
+	message->fIsReply = false;
+	message->_ReleaseSource();
+	message->fSourceRequest = 0;
 
-	return _PostMessage(&aMsg, handlerToken, replyToken, B_INFINITE_TIMEOUT);
+	return _PostAdoptedMessage(message, handlerToken, replyToken, B_INFINITE_TIMEOUT);
 }
 
 
@@ -358,43 +469,75 @@ BLooper::_PostMessage(const BMessage *_message, uint64 handlerToken, uint64 repl
 {
 	if (fMessageQueue == NULL || _message == NULL) return B_ERROR;
 
+	BMessage *message = new BMessage(*_message);
+	if (message == NULL) return B_NO_MEMORY;
+	message->fNoticeSource = _message->fNoticeSource;
+
+	return _PostAdoptedMessage(message, handlerToken, replyToken, timeout);
+}
+
+
+status_t
+BLooper::_PostAdoptedMessage(BMessage *message, uint64 handlerToken, uint64 replyToken, bigtime_t timeout)
+{
+	if (message == NULL) return B_ERROR;
+
+	// the source gets noticed only when the message is queued
+	bool noticeSource = message->fNoticeSource;
+	message->fNoticeSource = false;
+
+	if (fMessageQueue == NULL) {
+		delete message;
+		return B_ERROR;
+	}
+
 	uint64 selfToken = get_handler_token(this);
 	bigtime_t handlerTokenTimestamp = get_handler_create_time_stamp(handlerToken);
 	bigtime_t replyTokenTimestamp = get_handler_create_time_stamp(replyToken);
 
-	if (fMessageQueue->LockWithTimeout(timeout) != B_OK) return B_ERROR;
+	message->fTeam = get_current_team_id();
+	message->fTargetToken = handlerToken;
+	message->fTargetTokenTimestamp = handlerTokenTimestamp;
+
+	if (replyToken != B_MAXUINT64) {
+		message->fReplyTeam = message->fTeam;
+		message->fReplyToken = replyToken;
+		message->fReplyTokenTimestamp = replyTokenTimestamp;
+		message->_ReleaseSource(false);
+		message->fSourceRequest = 0;
+	}
 
 	status_t retVal = B_ERROR;
 
-	if (fSem != NULL) {
-		if (_message->what == _EVENTS_PENDING_ && handlerToken == selfToken) {
-			retVal = (_message->fNoticeSource ?B_ERROR :B_OK);
-		} else {
-			BMessage *message = new BMessage(*_message);
-
-			message->fTeam = get_current_team_id();
-			message->fTargetToken = handlerToken;
-			message->fTargetTokenTimestamp = handlerTokenTimestamp;
-
-			if (replyToken != B_MAXUINT64) {
-				message->fReplyToken = replyToken;
-				message->fReplyTokenTimestamp = replyTokenTimestamp;
-				if (message->fSource) {
-					delete_port(message->fSource);
-					message->fSource = NULL;
-				}
-			}
+	// the queue takes the message without locking, fSem only gets
+	// replaced after the posters using it are gone, see _ReplaceSem()
+	__sync_add_and_fetch(&fSemPosters, 1);
 
-			if (fMessageQueue->AddMessage(message)) {
-				message->fNoticeSource = _message->fNoticeSource;
-				retVal = B_OK;
-			}
+	void *sem = fSem;
+	if (sem != NULL) {
+		if (message->what == _EVENTS_PENDING_ && handlerToken == selfToken) {
+			retVal = (noticeSource ?B_ERROR :B_OK);
+		} else {
+			message->fNoticeSource = noticeSource;
+			if (fMessageQueue->AddMessage(message)) retVal = B_OK;
+			message = NULL;
 		}
 
-		release_sem(fSem);
+		release_sem(sem);
+	} else if (fPooled) {
+		if (message->what == _EVENTS_PENDING_ && handlerToken == selfToken) {
+			retVal = (noticeSource ?B_ERROR :B_OK);
+		} else {
+			message->fNoticeSource = noticeSource;
+			if (fMessageQueue->AddMessage(message)) retVal = B_OK;
+			message = NULL;
+			_PoolSchedule();
+		}
 	}
 
-	fMessageQueue->Unlock();
+	__sync_sub_and_fetch(&fSemPosters, 1);
+
+	if (message != NULL) delete message;
 
 	return retVal;
 }
@@ -427,6 +570,7 @@ BLooper::IsRunning() const
 	BAutolock <BLocker>autolock(hLocker);
 
 	if (fProxy != NULL) return _Proxy()->IsRunning();
+	if (fPooled) return true;
 	if (fThread == NULL || get_thread_run_state(fThread) == ETK_THREAD_READY) return false;
 
 	return true;
@@ -442,6 +586,9 @@ BLooper::Run()
 	if (fProxy) {
 		ETK_WARNING("[APP]: %s --- The Looper has proxy, run aborted.", __PRETTY_FUNCTION__);
 		return NULL;
+	} else if (fPooled) {
+		ETK_WARNING("[APP]: %s --- The Looper runs in the pool, run aborted.", __PRETTY_FUNCTION__);
+		return NULL;
 	}
 
 	if (!fThread) {
@@ -458,6 +605,178 @@ BLooper::Run()
 }
 
 
+bool
+BLooper::RunPooled()
+{
+	if (dynamic_cast<BApplication*>(this) != NULL) {
+		ETK_WARNING("[APP]: %s --- Application can't run in the pool.", __PRETTY_FUNCTION__);
+		return false;
+	}
+
+	BLocker *hLocker = get_handler_operator_locker();
+	BAutolock <BLocker>autolock(hLocker);
+
+	if (fPooled) return true;
+	if (fProxy || fClients.CountItems() > 0 || fThread || fMessageQueue == NULL) {
+		ETK_WARNING("[APP]: %s --- The looper has a thread or a proxy, run aborted.", __PRETTY_FUNCTION__);
+		return false;
+	}
+
+	looper_pool.locker.Lock();
+	if (looper_pool.sem == NULL) {
+		if ((looper_pool.sem = create_sem(B_INT64_CONSTANT(0), NULL)) == NULL) {
+			looper_pool.locker.Unlock();
+			return false;
+		}
+		atexit(looper_pool_stop);
+	}
+	for (int32 i = 0; i < E_LOOPER_POOL_THREADS; i++) {
+		if (looper_pool.threads[i] != NULL) continue;
+		if ((looper_pool.threads[i] = create_thread(_PoolTask, B_NORMAL_PRIORITY, NULL, NULL)) == NULL ||
+		        resume_thread(looper_pool.threads[i]) != B_OK) {
+			if (looper_pool.threads[i]) delete_thread(looper_pool.threads[i]);
+			looper_pool.threads[i] = NULL;
+			if (i == 0) {
+				looper_pool.locker.Unlock();
+				ETK_WARNING("[APP]: %s --- Unable to create thread!", __PRETTY_FUNCTION__);
+				return false;
+			}
+			break;
+		}
+	}
+	looper_pool.locker.Unlock();
+
+	// the posters see the looper pooled once the semaphore is gone
+	fPooled = true;
+	__sync_synchronize();
+
+	// the messages queued before the switch get checked under the queue lock
+	fMessageQueue->Lock();
+	_ReplaceSem(NULL);
+	if (fMessageQueue->CountMessages() > 0) _PoolSchedule();
+	fMessageQueue->Unlock();
+
+	return true;
+}
+
+
+void
+BLooper::_PoolSchedule()
+{
+	// only the first post since the pool took the looper queues it,
+	// the pool thread queues it again when more came in meanwhile
+	if (__sync_fetch_and_add(&fPoolPosts, 1) == 0) _PoolQueue();
+}
+
+
+void
+BLooper::_PoolQueue()
+{
+	looper_pool.locker.Lock();
+
+	fPoolNext = NULL;
+	if (looper_pool.tail) looper_pool.tail->fPoolNext = this;
+	else looper_pool.head = this;
+	looper_pool.tail = this;
+
+	looper_pool.locker.Unlock();
+
+	release_sem(looper_pool.sem);
+}
+
+
+status_t
+BLooper::_PoolTask(void *arg)
+{
+	while (acquire_sem(looper_pool.sem) == B_OK) {
+		looper_pool.locker.Lock();
+
+		BLooper *looper = looper_pool.head;
+		if (looper == NULL) { // removed by the destructor
+			looper_pool.locker.Unlock();
+			continue;
+		}
+
+		if ((looper_pool.head = looper->fPoolNext) == NULL) looper_pool.tail = NULL;
+		looper->fPoolNext = NULL;
+
+		uint64 token = get_handler_token(looper);
+		int32 posts = __sync_add_and_fetch(&looper->fPoolPosts, 0);
+
+		looper_pool.locker.Unlock();
+
+		// the looper might be deleted before getting the lock, the token tells
+		if (lock_looper_of_handler(token, B_INFINITE_TIMEOUT) != B_OK) continue;
+		looper->fLocksCount++;
+
+		_PoolDispatch(looper, posts);
+	}
+
+	return B_OK;
+}
+
+
+// called with the looper locked, it's unlocked or deleted when returned
+void
+BLooper::_PoolDispatch(BLooper *looper, int32 posts)
+{
+	BMessageQueue *queue = looper->fMessageQueue;
+	int32 batch = looper->fDispatchBatch;
+	bool more = false;
+
+	looper->fPoolThread = get_current_thread_id();
+
+	while (true) {
+		BMessage *aMsg = NULL;
+
+		queue->Lock();
+		if (queue->IsEmpty() == false) {
+			aMsg = queue->FindMessage((int32)0);
+			if (aMsg != NULL && aMsg->what == _QUIT_) {
+				queue->Unlock();
+
+				void *done = looper->fPoolQuitSem;
+				if (looper->fDeconstructing == false) {
+					looper->fDeconstructing = true;
+					looper->Quit();
+				}
+				delete looper;
+
+				if (done) release_sem(done);
+				return;
+			}
+			aMsg = queue->NextMessage();
+		}
+		queue->Unlock();
+
+		if (aMsg == NULL) break;
+
+		bool preferred = false;
+		BHandler *handler = looper->_MessageTarget(aMsg, &preferred);
+		if (handler == NULL && !preferred) {
+			delete aMsg;
+			continue;
+		}
+
+		looper->_FilterAndDispatchMessage(aMsg, handler);
+
+		// the other pooled loopers get their turn
+		if (--batch <= 0) {
+			more = true;
+			break;
+		}
+	}
+
+	looper->fPoolThread = 0;
+
+	// still locked, so the looper can't be deleted while queued again
+	if (more || __sync_sub_and_fetch(&looper->fPoolPosts, posts) > 0) looper->_PoolQueue();
+
+	looper->fLocksCount--;
+	unlock_locker(looper->fLocker);
+}
+
+
 bool
 BLooper::QuitRequested()
 {
@@ -475,7 +794,7 @@ BLooper::Quit()
 
 	BLocker *hLocker = get_handler_operator_locker();
 	hLocker->Lock();
-	if (get_thread_id(fThread) == get_current_thread_id())
+	if (get_thread_id(fThread) == get_current_thread_id() || (fPooled && fPoolThread == get_current_thread_id()))
 		ETK_ERROR("\n\
 		          **************************************************************************\n\
 		          *                           [APP]: BLooper                               *\n\
@@ -506,6 +825,24 @@ BLooper::Quit()
 		if (get_thread_run_state(thread) != ETK_THREAD_EXITED)
 			if (lock_looper_of_handler(token, B_INFINITE_TIMEOUT) == B_OK) delete this;
 		delete_thread(thread);
+	} else if (fPooled && !looper_pool_is_current_thread()) {
+		// the pool dispatches the messages before "_QUIT_" and deletes the looper,
+		// a pool thread deletes it at once instead since waiting could hold up the pool
+		fDeconstructing = true;
+
+		void *done = create_sem(B_INT64_CONSTANT(0), NULL);
+		if (done == NULL)
+			ETK_ERROR("[APP]: %s --- Unable to create semaphore!", __PRETTY_FUNCTION__);
+		fPoolQuitSem = done;
+
+		if (PostMessage(_QUIT_) != B_OK)
+			ETK_ERROR("[APP]: %s --- Send \"_QUIT_\" to looper error!", __PRETTY_FUNCTION__);
+		fLocksCount = B_INT64_CONSTANT(0);
+		int64 locksCount = count_locker_locks(fLocker);
+		while ((locksCount--) >B_INT64_CONSTANT(0)) unlock_locker(fLocker);
+
+		acquire_sem(done);
+		delete_sem(done);
 	} else {
 		delete this;
 	}
@@ -536,10 +873,10 @@ BLooper::_MessageTarget(const BMessage *msg, bool *preferred)
 {
 	if (msg == NULL || msg->fTeam != get_current_team_id()) return NULL;
 	BHandler *handler = NULL;
-	if (ref_handler(msg->fTargetToken)) {
+	if (msg->fTargetToken != B_MAXUINT64) {
+		BAutolock <BLocker>autolock(get_handler_locker(msg->fTargetToken));
 		if (get_handler_create_time_stamp(msg->fTargetToken) == msg->fTargetTokenTimestamp &&
 		        get_handler_looper(msg->fTargetToken) == this) handler = get_handler(msg->fTargetToken);
-		unref_handler(msg->fTargetToken);
 	}
 	if (preferred) *preferred = (msg->fTargetToken == B_MAXUINT64);
 	return handler;
@@ -628,17 +965,22 @@ BLooper::_taskLooper(BLooper *self, void *sem)
 
 		self->Lock();
 		queue = self->fMessageQueue;
+
+		// "looper" stays locked from one message to the next until the batch is done
+		int32 batch = self->fDispatchBatch;
+		bool locked = false;
+
 		while (looper != NULL && queue != NULL) {
 			BMessage *aMsg = NULL;
 
 			queue->Lock();
 			if (queue->IsEmpty() == false) {
 				aMsg = queue->FindMessage((int32)0);
-				if (aMsg->what == _QUIT_) {
+				if (aMsg != NULL && aMsg->what == _QUIT_) {
 					queue->Unlock();
 					flags = (looper == self ? 2 : 1);
 
-					looper->Lock();
+					if (!locked) looper->Lock();
 					if (looper->fDeconstructing == false) {
 						looper->fDeconstructing = true;
 						looper->Quit();
@@ -659,17 +1001,22 @@ BLooper::_taskLooper(BLooper *self, void *sem)
 					continue;
 				}
 
-				looper->Lock();
+				if (!locked) locked = looper->Lock();
 				looper->_FilterAndDispatchMessage(aMsg, handler);
-				bool isClient = (looper->Proxy() == self ? true : false);
-				looper->Unlock();
+				bool isClient = (looper->_Proxy() == self ? true : false);
 
-				if (isClient) continue;
+				if (isClient && --batch > 0) continue;
 
+				if (locked) looper->Unlock();
 				flags = 1;
 				break;
 			}
 
+			if (locked) {
+				looper->Unlock();
+				locked = false;
+			}
+
 			looper = self->_GetNextClient(looper);
 			queue = (looper == NULL ? NULL : looper->fMessageQueue);
 		}
@@ -686,6 +1033,9 @@ BLooper::_taskLooper(BLooper *self, void *sem)
 		if (acquire_sem(sem) != B_OK || get_sem_info(sem, &sem_info) != B_OK) sem_info.closed = true;
 
 		if (sem_info.closed) break;
+
+		// every message posted counts the semaphore up once, the next pass looks at all of them
+		if (sem_info.count > 0) acquire_sem_etc(sem, sem_info.count, B_TIMEOUT, B_INT64_CONSTANT(0));
 	}
 
 	return B_OK;
@@ -721,20 +1071,23 @@ BLooper::NextLooperMessage(bigtime_t timeout)
 
 		proxy->Lock();
 		queue = proxy->fMessageQueue;
-		while (looper != NULL && queue != NULL) {
-			if (proxy == app) BApplication::dispatch_message_runners();
 
+		int32 batch = proxy->fDispatchBatch;
+		bool locked = false;
+
+		while (looper != NULL && queue != NULL) {
 			BMessage *aMsg = NULL;
 
 			queue->Lock();
 			if (queue->IsEmpty() == false) {
 				aMsg = queue->FindMessage((int32)0);
-				if (aMsg->what == _QUIT_) {
+				if (aMsg != NULL && aMsg->what == _QUIT_) {
 					queue->Unlock();
 					flags = ((looper == proxy || looper == this) ? 2 : 1);
 
 					if (flags == 1) {
-						looper->Lock();
+						if (!locked) looper->Lock();
+						locked = false;
 						if (looper->fLocksCount == B_INT64_CONSTANT(1)) {
 							if (looper->fDeconstructing == false) {
 								looper->fDeconstructing = true;
@@ -747,6 +1100,8 @@ BLooper::NextLooperMessage(bigtime_t timeout)
 							queue = (looper == NULL ? NULL : looper->fMessageQueue);
 							continue;
 						}
+					} else if (locked) {
+						looper->Unlock();
 					}
 
 					break;
@@ -769,17 +1124,22 @@ BLooper::NextLooperMessage(bigtime_t timeout)
 					break;
 				}
 
-				looper->Lock();
+				if (!locked) locked = looper->Lock();
 				looper->_FilterAndDispatchMessage(aMsg, handler);
 				bool isClient = (looper->Proxy() == proxy ? true : false);
-				looper->Unlock();
 
-				if (isClient && Proxy() == proxy) continue;
+				if (isClient && Proxy() == proxy && --batch > 0) continue;
 
+				if (locked) looper->Unlock();
 				flags = 1;
 				break;
 			}
 
+			if (locked) {
+				looper->Unlock();
+				locked = false;
+			}
+
 			looper = proxy->_GetNextClient(looper);
 			queue = (looper == NULL ? NULL : looper->fMessageQueue);
 		}
@@ -797,22 +1157,13 @@ BLooper::NextLooperMessage(bigtime_t timeout)
 
 		sem_info sem_info;
 		status_t status = B_ERROR;
-		bigtime_t waitTime = timeout;
-		if (timeout >= B_INT64_CONSTANT(0)) {
-			if (proxy == app) {
-				hLocker->Lock();
-				waitTime = min_c(timeout, (BApplication::sRunnerMinimumInterval == B_INT64_CONSTANT(0) ?
-				                           B_INFINITE_TIMEOUT :
-				                           max_c(BApplication::sRunnerMinimumInterval, B_INT64_CONSTANT(50000))));
-				hLocker->Unlock();
-			}
-
-			status = acquire_sem_etc(sem, B_INT64_CONSTANT(1), B_TIMEOUT, waitTime);
-		}
+		if (timeout >= B_INT64_CONSTANT(0)) status = acquire_sem_etc(sem, B_INT64_CONSTANT(1), B_TIMEOUT, timeout);
 		if (get_sem_info(sem, &sem_info) != B_OK) sem_info.closed = true;
 
 		if (sem_info.closed || !(status == B_OK || status == B_TIMED_OUT)) break;
-		if (status == B_TIMED_OUT && waitTime == timeout) break;
+		if (status == B_TIMED_OUT) break;
+
+		if (status == B_OK && sem_info.count > 0) acquire_sem_etc(sem, sem_info.count, B_TIMEOUT, B_INT64_CONSTANT(0));
 		if (timeout != B_INFINITE_TIMEOUT) {
 			bigtime_t curTime = real_time_clock_usecs();
 			timeout -= (curTime - prevTime);
@@ -915,6 +1266,7 @@ BLooper::MessageQueue() const
 int64
 BLooper::Thread() const
 {
+	if (fPooled) return fPoolThread;
 	return get_thread_id(Proxy()->fThread);
 }
 
@@ -968,9 +1320,12 @@ BLooper::ProxyBy(BLooper *proxy)
 
 	if (proxy == NULL ? (_Proxy() == this) : (_Proxy() == proxy->_Proxy())) return true;
 
-	if (fThread) {
+	if (fThread || fPooled) {
 		ETK_WARNING("[APP]: %s --- The looper already run, proxy aborted.", __PRETTY_FUNCTION__);
 		return false;
+	} else if (proxy != NULL && proxy->_Proxy()->fPooled) {
+		ETK_WARNING("[APP]: %s --- The proxy runs in the pool, proxy aborted.", __PRETTY_FUNCTION__);
+		return false;
 	} else if (!(proxy == NULL || proxy->IsLockedByCurrentThread())) {
 		ETK_ERROR("[APP]: %s --- Proxy must LOCKED before this call!", __PRETTY_FUNCTION__);
 	}
@@ -992,8 +1347,7 @@ BLooper::_ProxyBy(BLooper *proxy)
 		fProxy = NULL;
 
 		fMessageQueue->Lock();
-		if (fSem) delete_sem(fSem);
-		fSem = create_sem((int64)fMessageQueue->CountMessages(), NULL);
+		_ReplaceSem(create_sem(B_INT64_CONSTANT(0), NULL));
 		fMessageQueue->Unlock();
 
 		void *newLocker = NULL;
@@ -1014,10 +1368,7 @@ BLooper::_ProxyBy(BLooper *proxy)
 		fProxy = proxy;
 
 		fMessageQueue->Lock();
-		if (fSem) delete_sem(fSem);
-		fSem = clone_sem_by_source(proxy->fSem);
-		if (fMessageQueue->CountMessages() > 0)
-			release_sem_etc(fSem, (int64)fMessageQueue->CountMessages(), 0);
+		_ReplaceSem(clone_sem_by_source(proxy->fSem));
 		fMessageQueue->Unlock();
 
 		void *newLocker = NULL;
@@ -1041,6 +1392,19 @@ BLooper::_ProxyBy(BLooper *proxy)
 }
 
 
+void
+BLooper::_ReplaceSem(void *sem)
+{
+	void *oldSem = __sync_lock_test_and_set(&fSem, sem);
+	while (__sync_add_and_fetch(&fSemPosters, 0) > 0) snooze(1);
+	if (oldSem) delete_sem(oldSem);
+
+	// counts the messages posted while the old one was taken too
+	int32 count = fMessageQueue->CountMessages();
+	if (sem != NULL && count > 0) release_sem_etc(sem, (int64)count, 0);
+}
+
+
 BLooper*
 BLooper::LooperForThread(e_thread_id tid)
 {
@@ -1055,12 +1419,27 @@ BLooper::LooperForThread(e_thread_id tid)
 	for (int32 i = 0; i < sLooperList.CountItems(); i++) {
 		BLooper *looper = (BLooper*)sLooperList.ItemAt(i);
 		if (get_thread_id(looper->fThread) == tid) return looper;
+		if (looper->fPooled && looper->fPoolThread == tid) return looper;
 	}
 
 	return NULL;
 }
 
 
+void
+BLooper::SetDispatchBatch(int32 count)
+{
+	fDispatchBatch = max_c(count, 1);
+}
+
+
+int32
+BLooper::DispatchBatch() const
+{
+	return fDispatchBatch;
+}
+
+
 bool
 BLooper::AddCommonFilter(BMessageFilter *filter)
 {
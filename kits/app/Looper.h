@@ -71,6 +71,12 @@ class BLooper : public BHandler
 		BLooper*	Proxy() const;
 		bool		ProxyBy(BLooper *proxy);
 
+		// RunPooled():
+		// 	Runs the looper without a thread of its own, the threads shared by the pooled
+		// 	loopers dispatch its messages in order while it has any, so an idle looper
+		// 	costs no thread. A pooled looper can't proxy nor be proxied.
+		bool		RunPooled();
+
 		e_thread_id	Thread() const;
 
 		bool		Lock();
@@ -99,6 +105,13 @@ class BLooper : public BHandler
 		                     BHandler *handler,
 		                     BHandler *reply_to = NULL);
 
+		// PostAdoptedMessage():
+		// 	The looper takes "message" itself instead of a copy, it's deleted when failed.
+		status_t	PostAdoptedMessage(BMessage *message);
+		status_t	PostAdoptedMessage(BMessage *message,
+		                            BHandler *handler,
+		                            BHandler *reply_to = NULL);
+
 		virtual bool	AddCommonFilter(BMessageFilter *filter);
 		virtual bool	RemoveCommonFilter(BMessageFilter *filter);
 		virtual bool	SetCommonFilterList(const BList *filterList);
@@ -106,6 +119,12 @@ class BLooper : public BHandler
 
 		static BLooper	*LooperForThread(e_thread_id tid);
 
+		// SetDispatchBatch():
+		// 	The looper's thread dispatches up to "count" messages while holding the lock,
+		// 	then unlocks it to let other threads in. 1 unlocks after every message.
+		void		SetDispatchBatch(int32 count);
+		int32		DispatchBatch() const;
+
 	protected:
 		// NextLooperMessage & DispatchLooperMessage: called from task of looper, like below
 		//	while(true)
@@ -148,9 +167,17 @@ class BLooper : public BHandler
 
 		void *fThread;
 		void *fSem;
+		int32 fSemPosters; // posting threads still using fSem
 
 		BMessageQueue *fMessageQueue;
 		BMessage *fCurrentMessage;
+		int32 fDispatchBatch;
+
+		bool fPooled;
+		int32 fPoolPosts; // posts since the pool took the looper last, > 0 while queued or dispatched
+		BLooper *fPoolNext;
+		e_thread_id fPoolThread; // the pool thread dispatching the looper
+		void *fPoolQuitSem;
 
 		static status_t _task(void*);
 		static status_t _taskLooper(BLooper*, void*);
@@ -158,11 +185,18 @@ class BLooper : public BHandler
 
 		static BList sLooperList;
 
+		void _PoolSchedule();
+		void _PoolQueue();
+		static status_t _PoolTask(void*);
+		static void _PoolDispatch(BLooper *looper, int32 posts);
+
 		BHandler *_MessageTarget(const BMessage *msg, bool *preferred);
 		status_t _PostMessage(const BMessage *msg, uint64 handlerToken, uint64 replyToken, bigtime_t timeout);
+		status_t _PostAdoptedMessage(BMessage *msg, uint64 handlerToken, uint64 replyToken, bigtime_t timeout);
 
 		BLooper *_Proxy() const;
 		bool _ProxyBy(BLooper *proxy);
+		void _ReplaceSem(void *sem);
 		BLooper *_GetNextClient(BLooper *client) const;
 
 		bool *fThreadExited;
@@ -30,8 +30,14 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#ifndef _MSC_VER
+#include <pthread.h>
+#endif
 
 #include <kernel/Kernel.h>
+#include <support/HashMap.h>
+#include <support/SimpleLocker.h>
+#include <support/Autolock.h>
 #include <private/Token.h>
 
 #include "Message.h"
@@ -39,31 +45,372 @@
 #include "Handler.h"
 
 
+#define E_MESSAGE_SMALL_VALUE		16	// values up to this size take a slot instead of malloc()
+#define E_MESSAGE_INDEX_THRESHOLD	8	// fields beyond this get found by the hash index
+
+// size, what, team, target token + timestamp, reply token + timestamp, source, is reply, record count
+#define E_MESSAGE_HEADER_SIZE		(sizeof(size_t) + sizeof(uint32) + sizeof(int64) + 2 * (sizeof(uint64) + sizeof(bigtime_t)) + \
+					 sizeof(address_t) + sizeof(bool) + sizeof(uint64))
+
+#define FIELD_ITEMS(field)		((field)->items != NULL ? (field)->items : &((field)->item))
+
+typedef union _e_value_slot_t {
+	union _e_value_slot_t *next;
+	uint8 data[E_MESSAGE_SMALL_VALUE];
+	int64 alignInt64;
+	double alignDouble;
+	void *alignPointer;
+} _e_value_slot_t;
+
+typedef struct _e_value_block_t {
+	struct _e_value_block_t *next;
+	int32 count;
+	int32 used;
+	_e_value_slot_t slots[1];
+} _e_value_block_t;
+
+
+// freed instances and storage of messages are recycled instead of going back to malloc(),
+// every thread keeps a few chunks of each kind and trades batches of them with the depot
+enum {
+	E_MESSAGE_CHUNK_OBJECT = 0,	// instances of BMessage
+	E_MESSAGE_CHUNK_FIELDS,		// field tables of E_MESSAGE_POOLED_FIELDS fields
+	E_MESSAGE_CHUNK_VALUES,		// value blocks of E_MESSAGE_POOLED_VALUES slots
+	E_MESSAGE_CHUNK_BUFFER,		// flattened forms up to E_MESSAGE_POOLED_BUFFER bytes
+	E_MESSAGE_CHUNK_KINDS
+};
+
+#define E_MESSAGE_POOLED_FIELDS		8
+#define E_MESSAGE_POOLED_VALUES		16
+#define E_MESSAGE_POOLED_BUFFER		1024
+#define E_MESSAGE_CACHE_SIZE		64	// chunks of one kind kept by a thread
+#define E_MESSAGE_CACHE_BATCH		32	// chunks given to the depot at once
+#define E_MESSAGE_DEPOT_BATCHES		64	// batches of one kind kept by the depot
+
+#ifdef _MSC_VER
+#define E_MESSAGE_THREAD_LOCAL		__declspec(thread)
+#else
+#define E_MESSAGE_THREAD_LOCAL		__thread
+#endif
+
+typedef struct _e_message_chunk_t {
+	struct _e_message_chunk_t *next;
+	struct _e_message_chunk_t *nextBatch; // valid for the first chunk of a batch in the depot
+} _e_message_chunk_t;
+
+enum {
+	E_MESSAGE_CACHE_UNUSED = 0,
+	E_MESSAGE_CACHE_ACTIVE,
+	E_MESSAGE_CACHE_FLUSHED // the thread is exiting, or can't flush on exit
+};
+
+typedef struct _e_message_cache_t {
+	void *chunks[E_MESSAGE_CHUNK_KINDS][E_MESSAGE_CACHE_SIZE];
+	int32 count[E_MESSAGE_CHUNK_KINDS];
+	int32 state;
+} _e_message_cache_t;
+
+static E_MESSAGE_THREAD_LOCAL _e_message_cache_t message_cache;
+
+static _e_message_chunk_t *message_depot[E_MESSAGE_CHUNK_KINDS];
+static int32 message_depot_count[E_MESSAGE_CHUNK_KINDS];
+
+
+static BSimpleLocker* e_message_depot_locker()
+{
+	// messages get freed by static destructors too
+	static BSimpleLocker locker(true);
+	return &locker;
+}
+
+
+static void e_message_depot_put(int32 kind, void **chunks, int32 count)
+{
+	if (count <= 0) return;
+
+	for (int32 i = 0; i < count - 1; i++) ((_e_message_chunk_t*)chunks[i])->next = (_e_message_chunk_t*)chunks[i + 1];
+	((_e_message_chunk_t*)chunks[count - 1])->next = NULL;
+
+	_e_message_chunk_t *batch = (_e_message_chunk_t*)chunks[0];
+
+	e_message_depot_locker()->Lock();
+	if (message_depot_count[kind] < E_MESSAGE_DEPOT_BATCHES) {
+		batch->nextBatch = message_depot[kind];
+		message_depot[kind] = batch;
+		message_depot_count[kind]++;
+		batch = NULL;
+	}
+	e_message_depot_locker()->Unlock();
+
+	while (batch != NULL) {
+		_e_message_chunk_t *chunk = batch;
+		batch = chunk->next;
+		free(chunk);
+	}
+}
+
+
+static int32 e_message_depot_get(int32 kind, void **chunks)
+{
+	// a stale look only costs a malloc() or a lock
+	if (message_depot[kind] == NULL) return 0;
+
+	e_message_depot_locker()->Lock();
+	_e_message_chunk_t *batch = message_depot[kind];
+	if (batch != NULL) {
+		message_depot[kind] = batch->nextBatch;
+		message_depot_count[kind]--;
+	}
+	e_message_depot_locker()->Unlock();
+
+	int32 count = 0;
+	for (; batch != NULL; batch = batch->next) chunks[count++] = batch;
+	return count;
+}
+
+
+static void e_message_cache_flush(void*)
+{
+	_e_message_cache_t *cache = &message_cache;
+
+	for (int32 kind = 0; kind < E_MESSAGE_CHUNK_KINDS; kind++) {
+		e_message_depot_put(kind, cache->chunks[kind], cache->count[kind]);
+		cache->count[kind] = 0;
+	}
+
+	cache->state = E_MESSAGE_CACHE_FLUSHED;
+}
+
+
+#ifndef _MSC_VER
+static pthread_key_t message_cache_key;
+static pthread_once_t message_cache_once = PTHREAD_ONCE_INIT;
+static bool message_cache_keyed = false;
+
+
+static void e_message_cache_key_init()
+{
+	message_cache_keyed = (pthread_key_create(&message_cache_key, e_message_cache_flush) == 0);
+}
+#endif
+
+
+// flushes the cache of the calling thread on its exit, false when that can't be done
+static bool e_message_cache_hook()
+{
+#ifndef _MSC_VER
+	// the key works for the threads not spawned by us as well (thread pools, std::thread)
+	pthread_once(&message_cache_once, e_message_cache_key_init);
+	return(message_cache_keyed && pthread_setspecific(message_cache_key, &message_cache) == 0);
+#else
+	void *thread = open_thread(get_current_thread_id());
+	if (thread == NULL) return false;
+	delete_thread(thread);
+	return(on_exit_thread(e_message_cache_flush, NULL) == B_OK);
+#endif
+}
+
+
+// the cache of the calling thread, NULL when it mustn't keep any chunk
+static _e_message_cache_t* e_message_cache()
+{
+	_e_message_cache_t *cache = &message_cache;
+
+	// a thread unable to give its chunks back on exit would leak them
+	if (cache->state == E_MESSAGE_CACHE_UNUSED)
+		cache->state = (e_message_cache_hook() ? E_MESSAGE_CACHE_ACTIVE : E_MESSAGE_CACHE_FLUSHED);
+
+	return(cache->state == E_MESSAGE_CACHE_ACTIVE ? cache : NULL);
+}
+
+
+static void* e_message_chunk_alloc(int32 kind, size_t size)
+{
+	_e_message_cache_t *cache = e_message_cache();
+
+	if (cache != NULL) {
+		if (cache->count[kind] == 0) cache->count[kind] = e_message_depot_get(kind, cache->chunks[kind]);
+		if (cache->count[kind] > 0) return cache->chunks[kind][--cache->count[kind]];
+	}
+
+	return malloc(max_c(size, sizeof(_e_message_chunk_t)));
+}
+
+
+static void e_message_chunk_free(int32 kind, void *chunk)
+{
+	if (chunk == NULL) return;
+
+	_e_message_cache_t *cache = e_message_cache();
+
+	if (cache == NULL) {
+		free(chunk);
+		return;
+	}
+
+	if (cache->count[kind] == E_MESSAGE_CACHE_SIZE) {
+		cache->count[kind] -= E_MESSAGE_CACHE_BATCH;
+		e_message_depot_put(kind, &(cache->chunks[kind][cache->count[kind]]), E_MESSAGE_CACHE_BATCH);
+	}
+
+	cache->chunks[kind][cache->count[kind]++] = chunk;
+}
+
+
+typedef struct _e_message_atom_t {
+	char *name;
+	size_t nameLength;
+	uint32 hash;
+} _e_message_atom_t;
+
+#define E_MESSAGE_ATOM_CHUNK_BITS	8
+#define E_MESSAGE_ATOM_CHUNKS		256
+
+// the chunks never move, so reading an atom needs no lock
+static _e_message_atom_t *message_atoms[E_MESSAGE_ATOM_CHUNKS];
+static uint32 message_atoms_count = 0;
+static BHashMap<BString, uint32> *message_atoms_map = NULL;
+
+
+static BSimpleLocker* e_message_atoms_locker()
+{
+	// atoms are mostly static objects, the locker has to exist before the first of them
+	static BSimpleLocker locker(true);
+	return &locker;
+}
+
+
+static uint32 e_message_atom_intern(const char *name)
+{
+	if (name == NULL) return 0;
+
+	BAutolock<BSimpleLocker> autolock(e_message_atoms_locker());
+
+	if (message_atoms_map == NULL && (message_atoms_map = new BHashMap<BString, uint32>()) == NULL) return 0;
+
+	uint32 *found = message_atoms_map->Lookup(name);
+	if (found != NULL) return *found;
+
+	uint32 chunk = message_atoms_count >> E_MESSAGE_ATOM_CHUNK_BITS;
+	if (chunk >= E_MESSAGE_ATOM_CHUNKS) return 0;
+	if (message_atoms[chunk] == NULL) {
+		message_atoms[chunk] = (_e_message_atom_t*)malloc(sizeof(_e_message_atom_t) << E_MESSAGE_ATOM_CHUNK_BITS);
+		if (message_atoms[chunk] == NULL) return 0;
+	}
+
+	_e_message_atom_t *atom = &message_atoms[chunk][message_atoms_count & ((1 << E_MESSAGE_ATOM_CHUNK_BITS) - 1)];
+	atom->nameLength = strlen(name);
+	if ((atom->name = (char*)malloc(atom->nameLength + 1)) == NULL) return 0;
+	memcpy(atom->name, name, atom->nameLength + 1);
+	atom->hash = e_hash_data(name, atom->nameLength);
+
+	uint32 id = message_atoms_count + 1;
+	if (message_atoms_map->Put(name, id) != B_OK) {
+		free(atom->name);
+		return 0;
+	}
+	message_atoms_count++;
+
+	return id;
+}
+
+
+static inline const _e_message_atom_t* e_message_atom_at(uint32 id)
+{
+	if (id == 0) return NULL;
+	id--;
+	return &message_atoms[id >> E_MESSAGE_ATOM_CHUNK_BITS][id & ((1 << E_MESSAGE_ATOM_CHUNK_BITS) - 1)];
+}
+
+
+BMessageAtom::BMessageAtom()
+	: fId(0)
+{
+}
+
+
+BMessageAtom::BMessageAtom(const char *name)
+	: fId(e_message_atom_intern(name))
+{
+}
+
+
+bool
+BMessageAtom::IsValid() const
+{
+	return(fId != 0);
+}
+
+
+const char*
+BMessageAtom::Name() const
+{
+	const _e_message_atom_t *atom = e_message_atom_at(fId);
+	return(atom ? atom->name : NULL);
+}
+
+
+bool
+BMessageAtom::operator==(const BMessageAtom &atom) const
+{
+	return(fId == atom.fId);
+}
+
+
+bool
+BMessageAtom::operator!=(const BMessageAtom &atom) const
+{
+	return(fId != atom.fId);
+}
+
+
 BMessage::BMessage()
 		: what(0),
+		fFields(NULL), fFieldsCount(0), fFieldsCapacity(0),
+		fFieldsIndex(NULL), fFieldsIndexMask(0),
+		fValueBlocks(NULL), fFreeValues(NULL),
+		fFlattened(NULL), fFlattenedSize(0), fFlattenedCount(0),
+		fFlattenedPending(false), fFlattenedCurrent(false), fFlattenedPooled(false), fFlattenedArea(NULL),
+		fShared(NULL), fSharedRefs(0),
 		fTargetToken(B_MAXUINT64), fTargetTokenTimestamp(B_INT64_CONSTANT(0)),
-		fReplyToken(B_MAXUINT64), fReplyTokenTimestamp(B_INT64_CONSTANT(0)),
-		fNoticeSource(false), fSource(NULL), fIsReply(false)
+		fReplyToken(B_MAXUINT64), fReplyTokenTimestamp(B_INT64_CONSTANT(0)), fReplyTeam(B_INT64_CONSTANT(0)),
+		fNoticeSource(false), fSource(NULL), fSourceRequest(0), fIsReply(false),
+		fQueueNext(NULL), fLane(B_DEFAULT_LANE)
 {
-	fTeam = get_current_team_id();
+	fTeam = fReplyTeam = get_current_team_id();
 }
 
 
 BMessage::BMessage(uint32 what)
-		: fTargetToken(B_MAXUINT64), fTargetTokenTimestamp(B_INT64_CONSTANT(0)),
-		fReplyToken(B_MAXUINT64), fReplyTokenTimestamp(B_INT64_CONSTANT(0)),
-		fNoticeSource(false), fSource(NULL), fIsReply(false)
+		: fFields(NULL), fFieldsCount(0), fFieldsCapacity(0),
+		fFieldsIndex(NULL), fFieldsIndexMask(0),
+		fValueBlocks(NULL), fFreeValues(NULL),
+		fFlattened(NULL), fFlattenedSize(0), fFlattenedCount(0),
+		fFlattenedPending(false), fFlattenedCurrent(false), fFlattenedPooled(false), fFlattenedArea(NULL),
+		fShared(NULL), fSharedRefs(0),
+		fTargetToken(B_MAXUINT64), fTargetTokenTimestamp(B_INT64_CONSTANT(0)),
+		fReplyToken(B_MAXUINT64), fReplyTokenTimestamp(B_INT64_CONSTANT(0)), fReplyTeam(B_INT64_CONSTANT(0)),
+		fNoticeSource(false), fSource(NULL), fSourceRequest(0), fIsReply(false),
+		fQueueNext(NULL), fLane(B_DEFAULT_LANE)
 {
 	BMessage::what = what;
-	fTeam = get_current_team_id();
+	fTeam = fReplyTeam = get_current_team_id();
 }
 
 
 BMessage::BMessage(const BMessage &msg)
-		: what(0), fTeam(B_INT64_CONSTANT(0)),
+		: what(0),
+		fFields(NULL), fFieldsCount(0), fFieldsCapacity(0),
+		fFieldsIndex(NULL), fFieldsIndexMask(0),
+		fValueBlocks(NULL), fFreeValues(NULL),
+		fFlattened(NULL), fFlattenedSize(0), fFlattenedCount(0),
+		fFlattenedPending(false), fFlattenedCurrent(false), fFlattenedPooled(false), fFlattenedArea(NULL),
+		fShared(NULL), fSharedRefs(0),
+		fTeam(B_INT64_CONSTANT(0)),
 		fTargetToken(B_MAXUINT64), fTargetTokenTimestamp(B_INT64_CONSTANT(0)),
-		fReplyToken(B_MAXUINT64), fReplyTokenTimestamp(B_INT64_CONSTANT(0)),
-		fNoticeSource(false), fSource(NULL), fIsReply(false)
+		fReplyToken(B_MAXUINT64), fReplyTokenTimestamp(B_INT64_CONSTANT(0)), fReplyTeam(B_INT64_CONSTANT(0)),
+		fNoticeSource(false), fSource(NULL), fSourceRequest(0), fIsReply(false),
+		fQueueNext(NULL), fLane(B_DEFAULT_LANE)
 {
 	operator=(msg);
 }
@@ -72,33 +419,53 @@ BMessage::BMessage(const BMessage &msg)
 BMessage&
 BMessage::operator=(const BMessage &msg)
 {
+	if (&msg == this) return *this;
+
 	what = msg.what;
 
 	MakeEmpty();
 
-	for (int32 k = 0; k < msg.fObjectsList.CountItems(); k++) {
-		list_data *ldata = (list_data*)msg.fObjectsList.ItemAt(k);
-		if (!ldata) continue;
-
-		for (int32 j = 0; j < ldata->list.CountItems(); j++) {
-			type_list_data *tldata = (type_list_data*)ldata->list.ItemAt(j);
-			if (!tldata) continue;
-
-			for (int32 i = 0; i < tldata->list.CountItems(); i++) {
-				_object_t *Object = (_object_t*)tldata->list.ItemAt(i);
-				if (!Object) continue;
+	if (msg.fFlattenedPending) {
+		// a copy of the buffer is cheaper than decoding it twice
+		if ((fFlattened = _AllocFlattened(msg.fFlattenedSize)) != NULL) {
+			memcpy(fFlattened, msg.fFlattened, msg.fFlattenedSize);
+			fFlattenedSize = msg.fFlattenedSize;
+			fFlattenedCount = msg.fFlattenedCount;
+			fFlattenedPending = true;
+			fFlattenedCurrent = true;
+			fFlattenedPooled = true;
+		} else {
+			msg._DecodeFlattened();
+		}
+	}
 
-				AddData(ldata->name, tldata->type, Object->data, Object->bytes, Object->fixed_size);
+	if (msg.fFieldsCount > 0) {
+		// the copies of "msg" share a hidden copy of its fields, made by the first one and published
+		// by compare-and-swap, the fields of "msg" stay untouched for its readers;
+		// an unchanged message from a port keeps its flattened form instead
+		BMessage *shared = msg.fShared;
+		if (shared == NULL && msg.fFlattenedCurrent == false && (shared = new BMessage()) != NULL) {
+			shared->_CopyFields(&msg);
+			shared->fSharedRefs = 1; // of "msg"
+			if (__sync_bool_compare_and_swap(&msg.fShared, (BMessage*)NULL, shared) == false) {
+				delete shared;
+				shared = msg.fShared;
 			}
 		}
-	}
 
-	if (fSource != NULL) {
-		if (fNoticeSource) close_port(fSource);
-		delete_port(fSource);
-		fSource = NULL;
+		if (shared != NULL) {
+			__sync_add_and_fetch(&shared->fSharedRefs, 1);
+			_FreeFields();
+			fShared = shared;
+			_AliasStorage(shared);
+		} else {
+			_CopyFields(&msg);
+		}
 	}
 
+	_ReleaseSource();
+	fSourceRequest = 0;
+
 	fTargetToken = B_MAXUINT64;
 	fTargetTokenTimestamp = B_MAXINT64;
 	fReplyToken = B_MAXUINT64;
@@ -109,16 +476,20 @@ BMessage::operator=(const BMessage &msg)
 		fTargetTokenTimestamp = msg.fTargetTokenTimestamp;
 	}
 
+	fReplyTeam = get_current_team_id();
+
 	if (msg.fSource == NULL) {
 		fReplyToken = msg.fReplyToken;
 		fReplyTokenTimestamp = msg.fReplyTokenTimestamp;
+		fReplyTeam = msg.fReplyTeam;
 	} else if (msg.fTeam == get_current_team_id()) {
-		fSource = open_port_by_source(msg.fSource);
+		if ((fSource = open_port_by_source(msg.fSource)) != NULL) fSourceRequest = msg.fSourceRequest;
 	}
 
 	fTeam = msg.fTeam;
 	fIsReply = msg.fIsReply;
 	fNoticeSource = false;
+	fLane = msg.fLane;
 
 	return *this;
 }
@@ -127,35 +498,21 @@ BMessage::operator=(const BMessage &msg)
 size_t
 BMessage::FlattenedSize() const
 {
-	size_t size = sizeof(size_t) + sizeof(uint32) + sizeof(uint64); // FlattenSize + msg->what + recordCount
-
-	size += sizeof(int64); // fTeam
-	size += sizeof(uint64) + sizeof(bigtime_t); // fTargetToken + fTargetTokenTimestamp
-	size += sizeof(uint64) + sizeof(bigtime_t); // fReplyToken + fReplyTokenTimestamp
-	size += sizeof(address_t); // fSource
-	size += sizeof(bool); // fIsReply
+	if (fFlattenedCurrent) return fFlattenedSize;
 
-	for (int32 k = 0; k < fObjectsList.CountItems(); k++) {
-		list_data *ldata = (list_data*)fObjectsList.ItemAt(k);
-		if (!ldata) continue;
+	size_t size = E_MESSAGE_HEADER_SIZE;
 
-		size_t nameLen = (size_t)(ldata->name ? strlen(ldata->name) : 0);
+	for (int32 k = 0; k < fFieldsCount; k++) {
+		const _field_t *field = &fFields[k];
+		const _item_t *items = FIELD_ITEMS(field);
 
-		for (int32 j = 0; j < ldata->list.CountItems(); j++) {
-			type_list_data *tldata = (type_list_data*)ldata->list.ItemAt(j);
-			if (!tldata) continue;
+		for (int32 i = 0; i < field->count; i++) {
+			// msg->_item_t
+			size_t objectSize = sizeof(size_t) + field->nameLength + sizeof(type_code) + sizeof(bool) + sizeof(size_t);
+			size_t dataLen = items[i].fixed_size ? items[i].bytes : sizeof(address_t);
+			objectSize += dataLen;
 
-			for (int32 i = 0; i < tldata->list.CountItems(); i++) {
-				_object_t *Object = (_object_t*)tldata->list.ItemAt(i);
-				if (!Object) continue;
-
-				// msg->_object_t
-				size_t objectSize = sizeof(size_t) + nameLen + sizeof(type_code) + sizeof(bool) + sizeof(size_t);
-				size_t dataLen = Object->fixed_size ? Object->bytes : sizeof(address_t);
-				objectSize += dataLen;
-
-				size += objectSize;
-			}
+			size += objectSize;
 		}
 	}
 
@@ -163,20 +520,15 @@ BMessage::FlattenedSize() const
 }
 
 
-bool
-BMessage::Flatten(char *buffer, size_t bufferSize) const
+void
+BMessage::_FlattenHeader(char *buffer, size_t size, uint64 count) const
 {
-	if (buffer == NULL ||
-	        bufferSize < sizeof(size_t) + sizeof(uint32) + sizeof(uint64) +
-	        sizeof(int64) + 2 * (sizeof(uint64) + sizeof(bigtime_t)) + sizeof(address_t) + sizeof(bool)) return false;
+	char *dst = buffer;
 
-	size_t size = 0;
+	memcpy(dst, &size, sizeof(size_t));
+	dst += sizeof(size_t);
 
 	// msg->what
-	size += sizeof(size_t) + sizeof(uint32) + sizeof(uint64) +
-	        sizeof(int64) + 2 * (sizeof(uint64) + sizeof(bigtime_t)) + sizeof(address_t) + sizeof(bool);
-	char *dst = buffer;
-	dst += sizeof(size_t);
 	memcpy(dst, &what, sizeof(uint32));
 	dst += sizeof(uint32);
 
@@ -206,251 +558,289 @@ BMessage::Flatten(char *buffer, size_t bufferSize) const
 	dst += sizeof(bool);
 
 	// recordCount
-	char *countDst = dst;
-	dst += sizeof(uint64);
-	uint64 count = (uint64)B_INT64_CONSTANT(0);
+	memcpy(dst, &count, sizeof(uint64));
+}
+
+
+bool
+BMessage::Flatten(char *buffer, size_t bufferSize) const
+{
+	if (buffer == NULL || bufferSize < E_MESSAGE_HEADER_SIZE) return false;
+
+	if (fFlattenedCurrent) {
+		// the records are still the ones of the adopted buffer
+		if (bufferSize < fFlattenedSize) return false;
+
+		memcpy(buffer + E_MESSAGE_HEADER_SIZE, fFlattened + E_MESSAGE_HEADER_SIZE, fFlattenedSize - E_MESSAGE_HEADER_SIZE);
+		_FlattenHeader(buffer, fFlattenedSize, fFlattenedCount);
 
-	for (int32 k = 0; k < fObjectsList.CountItems(); k++) {
-		list_data *ldata = (list_data*)fObjectsList.ItemAt(k);
-		if (!ldata) continue;
+		return true;
+	}
 
-		size_t nameLen = (size_t)(ldata->name ? strlen(ldata->name) : 0);
+	size_t size = E_MESSAGE_HEADER_SIZE;
+	char *dst = buffer + E_MESSAGE_HEADER_SIZE;
+	uint64 count = (uint64)B_INT64_CONSTANT(0);
 
-		for (int32 j = 0; j < ldata->list.CountItems(); j++) {
-			type_list_data *tldata = (type_list_data*)ldata->list.ItemAt(j);
-			if (!tldata) continue;
+	for (int32 k = 0; k < fFieldsCount; k++) {
+		const _field_t *field = &fFields[k];
+		const _item_t *items = FIELD_ITEMS(field);
+		size_t nameLen = field->nameLength;
 
-			for (int32 i = 0; i < tldata->list.CountItems(); i++) {
-				_object_t *Object = (_object_t*)tldata->list.ItemAt(i);
-				if (!Object) continue;
+		for (int32 i = 0; i < field->count; i++) {
+			const _item_t *Object = &items[i];
 
-				// msg->_object_t
-				size_t dataLen = Object->fixed_size ? Object->bytes : sizeof(address_t);
-				size_t objectSize = sizeof(size_t) + nameLen + sizeof(type_code) + sizeof(bool) + sizeof(size_t) + dataLen;
-				size += objectSize;
+			// msg->_item_t
+			size_t dataLen = Object->fixed_size ? Object->bytes : sizeof(address_t);
+			size_t objectSize = sizeof(size_t) + nameLen + sizeof(type_code) + sizeof(bool) + sizeof(size_t) + dataLen;
+			size += objectSize;
 
-				if (bufferSize < size) return false;
+			if (bufferSize < size) return false;
 
-				memcpy(dst, &nameLen, sizeof(size_t));
-				dst += sizeof(size_t);
-				if (nameLen > 0) {
-					memcpy(dst, ldata->name, nameLen);
-					dst += nameLen;
-				}
-				memcpy(dst, &(tldata->type), sizeof(type_code));
-				dst += sizeof(type_code);
-				memcpy(dst, &(Object->fixed_size), sizeof(bool));
-				dst += sizeof(bool);
-				memcpy(dst, &dataLen, sizeof(size_t));
-				dst += sizeof(size_t);
-				if (dataLen > 0) {
-					if (Object->fixed_size) {
-						memcpy(dst, Object->data, dataLen);
-					} else {
-						address_t address = reinterpret_cast<address_t>(Object->data);
-						memcpy(dst, &address, dataLen);
-					}
-
-					dst += dataLen;
+			memcpy(dst, &nameLen, sizeof(size_t));
+			dst += sizeof(size_t);
+			if (nameLen > 0) {
+				memcpy(dst, field->name, nameLen);
+				dst += nameLen;
+			}
+			memcpy(dst, &(field->type), sizeof(type_code));
+			dst += sizeof(type_code);
+			memcpy(dst, &(Object->fixed_size), sizeof(bool));
+			dst += sizeof(bool);
+			memcpy(dst, &dataLen, sizeof(size_t));
+			dst += sizeof(size_t);
+			if (dataLen > 0) {
+				if (Object->fixed_size) {
+					memcpy(dst, Object->data, dataLen);
+				} else {
+					address_t address = reinterpret_cast<address_t>(Object->data);
+					memcpy(dst, &address, dataLen);
 				}
 
-				count++;
+				dst += dataLen;
 			}
+
+			count++;
 		}
 	}
 
-	// recordCount
-	memcpy(countDst, &count, sizeof(uint64));
-
-	memcpy(buffer, &size, sizeof(size_t));
+	_FlattenHeader(buffer, size, count);
 
 	return true;
 }
 
 
-bool
-BMessage::Unflatten(const char *buffer, size_t bufferSize)
+const char*
+BMessage::FlattenedData(size_t *size) const
 {
-	if (buffer == NULL ||
-	        bufferSize < sizeof(size_t) + sizeof(uint32) + sizeof(uint64) +
-	        sizeof(int64) + 2 * (sizeof(uint64) + sizeof(bigtime_t)) + sizeof(address_t) + sizeof(bool)) return false;
-
-	const char *src = buffer;
-	BMessage msg;
-	uint64 recordCount = 0;
-	size_t _bufferSize = 0;
-
-	memcpy(&_bufferSize, src, sizeof(size_t));
-	if (bufferSize < _bufferSize) return false;
-	src += sizeof(size_t);
-	bufferSize -= sizeof(size_t);
-
-	// msg->what
-	memcpy(&msg.what, src, sizeof(uint32));
-	src += sizeof(uint32);
-	bufferSize -= sizeof(uint32);
-
-	// fTeam
-	memcpy(&msg.fTeam, src, sizeof(int64));
-	src += sizeof(int64);
-	bufferSize -= sizeof(int64);
+	if (!fFlattenedCurrent) return NULL;
 
-	// fTargetToken + fTargetTokenTimestamp
-	memcpy(&msg.fTargetToken, src, sizeof(uint64));
-	src += sizeof(uint64);
-	bufferSize -= sizeof(uint64);
-	memcpy(&msg.fTargetTokenTimestamp, src, sizeof(bigtime_t));
-	src += sizeof(bigtime_t);
-	bufferSize -= sizeof(bigtime_t);
+	// the header follows the tokens of the message, the records are left alone
+	_FlattenHeader(fFlattened, fFlattenedSize, fFlattenedCount);
 
-	// fReplyToken + fReplyTokenTimestamp
-	memcpy(&msg.fReplyToken, src, sizeof(uint64));
-	src += sizeof(uint64);
-	bufferSize -= sizeof(uint64);
-	memcpy(&msg.fReplyTokenTimestamp, src, sizeof(bigtime_t));
-	src += sizeof(bigtime_t);
-	bufferSize -= sizeof(bigtime_t);
+	if (size) *size = fFlattenedSize;
+	return fFlattened;
+}
 
-	// fSource
-	address_t source_address;
-	memcpy(&source_address, src, sizeof(address_t));
-	src += sizeof(address_t);
-	bufferSize -= sizeof(address_t);
 
-	// fIsReply
-	memcpy(&msg.fIsReply, src, sizeof(bool));
-	src += sizeof(bool);
-	bufferSize -= sizeof(bool);
+bool
+BMessage::_UnflattenFields(BMessage *msg, const char *buffer, size_t bufferSize, uint64 recordCount, bool borrow)
+{
+	// "msg" is NULL when only checking the bounds of the records
+	const char *src = buffer;
 
-	// recordCount
-	memcpy(&recordCount, src, sizeof(uint64));
-	src += sizeof(uint64);
-	bufferSize -= sizeof(uint64);
+	char nameBuffer[64];
+	char *name = nameBuffer;
+	size_t nameBufferSize = sizeof(nameBuffer);
 
-	for (uint64 i = (uint64)B_INT64_CONSTANT(0); i < recordCount; i++) {
+	uint64 i;
+	for (i = (uint64)B_INT64_CONSTANT(0); i < recordCount; i++) {
 		// Object->name
-		if (bufferSize < sizeof(size_t)) return false;
+		if (bufferSize < sizeof(size_t)) break;
 		size_t nameLen;
 		memcpy(&nameLen, src, sizeof(size_t));
 		src += sizeof(size_t);
 		bufferSize -= sizeof(size_t);
 
-		char *name = NULL;
-		if (nameLen > 0) {
-			name = (char*)malloc(nameLen + 1);
-			if (!name) return false;
-			bzero(name, nameLen + 1);
-
-			if (bufferSize < nameLen) {
-				free(name);
-				return false;
-			}
-			memcpy(name, src, nameLen);
-			src += nameLen;
-			bufferSize -= nameLen;
-		}
+		if (bufferSize < nameLen) break;
+		const char *nameSrc = src;
+		src += nameLen;
+		bufferSize -= nameLen;
 
 		// Object->type
-		if (bufferSize < sizeof(type_code)) {
-			if (name) free(name);
-			return false;
-		}
+		if (bufferSize < sizeof(type_code)) break;
 		type_code type;
 		memcpy(&type, src, sizeof(type_code));
 		src += sizeof(type_code);
 		bufferSize -= sizeof(type_code);
 
 		// Object->fixed_size
-		if (bufferSize < sizeof(bool)) {
-			if (name) free(name);
-			return false;
-		}
+		if (bufferSize < sizeof(bool)) break;
 		bool fixed_size;
 		memcpy(&fixed_size, src, sizeof(bool));
 		src += sizeof(bool);
 		bufferSize -= sizeof(bool);
 
 		// Object->bytes
-		if (bufferSize < sizeof(size_t)) {
-			if (name) free(name);
-			return false;
-		}
+		if (bufferSize < sizeof(size_t)) break;
 		size_t bytes;
 		memcpy(&bytes, src, sizeof(size_t));
 		src += sizeof(size_t);
 		bufferSize -= sizeof(size_t);
 
-		// Object->data
-		void *data = NULL;
+		// Object->data, copied by AddData() right from the buffer
+		const void *data = NULL;
 
 		if (bytes > 0) {
+			if (bufferSize < bytes) break;
+
 			if (!fixed_size) {
-				size_t dataLen = sizeof(address_t);
-				if (bytes != dataLen || bufferSize < dataLen) {
-					if (name) free(name);
-					return false;
-				}
+				if (bytes != sizeof(address_t)) break;
 
 				address_t address = 0;
-				memcpy(&address, src, dataLen);
+				memcpy(&address, src, sizeof(address_t));
 				data = reinterpret_cast<void*>(address);
 			} else {
-				data = malloc(bytes);
-				if (!data) {
-					if (name) free(name);
-					return false;
-				}
-				bzero(data, bytes);
-
-				if (bufferSize < bytes) {
-					if (name) free(name);
-					free(data);
-					return false;
-				}
-				memcpy(data, src, bytes);
+				data = src;
 			}
 
 			src += bytes;
 			bufferSize -= bytes;
+		} else if (!fixed_size) {
+			break;
 		}
 
-		// add to message
-		if (msg.AddData(name ? name : "", type, data, bytes, fixed_size) == false) {
-			if (name) free(name);
-			if (data && fixed_size) free(data);
-			return false;
+		if (msg == NULL) continue;
+
+		if (nameLen >= nameBufferSize) {
+			char *newName = (char*)realloc(name == nameBuffer ? NULL : name, nameLen + 1);
+			if (newName == NULL) break;
+			name = newName;
+			nameBufferSize = nameLen + 1;
 		}
+		if (nameLen > 0) memcpy(name, nameSrc, nameLen);
+		name[nameLen] = 0;
+
+		// add to message, strings and aligned values may stay in the buffer
+		bool borrowData = (borrow && fixed_size && bytes > E_MESSAGE_SMALL_VALUE &&
+		                   (type == B_STRING_TYPE || (reinterpret_cast<address_t>(data) & (sizeof(address_t) - 1)) == 0));
 
-		if (name) free(name);
-		if (data && fixed_size) free(data);
+		_field_t *field = msg->_FindField(name);
+		if (field) {
+			if (field->type != type) break;
+			if (msg->_AddItem(field, data, bytes, fixed_size, borrowData) == false) break;
+		} else {
+			if ((field = msg->_AddField(name, type)) == NULL) break;
+			if (msg->_AddItem(field, data, bytes, fixed_size, borrowData) == false) {
+				msg->_RemoveField(msg->fFieldsCount - 1);
+				break;
+			}
+		}
 	}
 
-	what = msg.what;
-	MakeEmpty();
-	fObjectsList = msg.fObjectsList;
-	msg.fObjectsList.MakeEmpty();
+	if (name != nameBuffer) free(name);
 
-	if (fSource != NULL) {
-		if (fNoticeSource) close_port(fSource);
-		delete_port(fSource);
-		fSource = NULL;
-	}
+	return(i == recordCount);
+}
 
-	fTargetToken = B_MAXUINT64;
-	fTargetTokenTimestamp = B_MAXINT64;
-	fReplyToken = B_MAXUINT64;
-	fReplyTokenTimestamp = B_MAXINT64;
 
-	if (msg.fTeam == get_current_team_id()) {
-		fTargetToken = msg.fTargetToken;
-		fTargetTokenTimestamp = msg.fTargetTokenTimestamp;
-	}
+bool
+BMessage::Unflatten(const char *buffer, size_t bufferSize)
+{
+	return _Unflatten(buffer, bufferSize, false);
+}
 
-	void *source = (msg.fTeam != get_current_team_id() ? (void*)NULL : reinterpret_cast<void*>(source_address));
-	if (source == NULL) {
-		if (msg.fTeam == get_current_team_id()) {
-			fReplyToken = msg.fReplyToken;
-			fReplyTokenTimestamp = msg.fReplyTokenTimestamp;
+
+bool
+BMessage::AdoptFlattened(char *buffer, size_t bufferSize)
+{
+	return _Unflatten(buffer, bufferSize, true);
+}
+
+
+bool
+BMessage::_Unflatten(const char *buffer, size_t bufferSize, bool adopt, bool pooled)
+{
+	if (buffer == NULL || bufferSize < E_MESSAGE_HEADER_SIZE) return false;
+
+	const char *src = buffer;
+	BMessage msg;
+	uint64 recordCount = 0;
+	size_t _bufferSize = 0;
+
+	memcpy(&_bufferSize, src, sizeof(size_t));
+	if (bufferSize < _bufferSize || _bufferSize < E_MESSAGE_HEADER_SIZE) return false;
+	src += sizeof(size_t);
+
+	// msg->what
+	memcpy(&msg.what, src, sizeof(uint32));
+	src += sizeof(uint32);
+
+	// fTeam
+	memcpy(&msg.fTeam, src, sizeof(int64));
+	src += sizeof(int64);
+
+	// fTargetToken + fTargetTokenTimestamp
+	memcpy(&msg.fTargetToken, src, sizeof(uint64));
+	src += sizeof(uint64);
+	memcpy(&msg.fTargetTokenTimestamp, src, sizeof(bigtime_t));
+	src += sizeof(bigtime_t);
+
+	// fReplyToken + fReplyTokenTimestamp
+	memcpy(&msg.fReplyToken, src, sizeof(uint64));
+	src += sizeof(uint64);
+	memcpy(&msg.fReplyTokenTimestamp, src, sizeof(bigtime_t));
+	src += sizeof(bigtime_t);
+
+	// fSource
+	address_t source_address;
+	memcpy(&source_address, src, sizeof(address_t));
+	src += sizeof(address_t);
+
+	// fIsReply
+	memcpy(&msg.fIsReply, src, sizeof(bool));
+	src += sizeof(bool);
+
+	// recordCount
+	memcpy(&recordCount, src, sizeof(uint64));
+	src += sizeof(uint64);
+
+	if (_UnflattenFields(adopt ? NULL : &msg, src, _bufferSize - E_MESSAGE_HEADER_SIZE, recordCount, false) == false) return false;
+
+	what = msg.what;
+	MakeEmpty();
+
+	if (adopt) {
+		fFlattened = (char*)buffer;
+		fFlattenedSize = _bufferSize;
+		fFlattenedPooled = pooled;
+		fFlattenedCount = recordCount;
+		fFlattenedPending = true;
+		fFlattenedCurrent = true;
+	} else {
+		// takes the fields of "msg", it gets this empty storage
+		_SwapStorage(&msg);
+	}
+
+	_ReleaseSource();
+	fSourceRequest = 0;
+
+	fTargetToken = B_MAXUINT64;
+	fTargetTokenTimestamp = B_MAXINT64;
+	fReplyToken = B_MAXUINT64;
+	fReplyTokenTimestamp = B_MAXINT64;
+
+	if (msg.fTeam == get_current_team_id()) {
+		fTargetToken = msg.fTargetToken;
+		fTargetTokenTimestamp = msg.fTargetTokenTimestamp;
+	}
+
+	fReplyTeam = get_current_team_id();
+
+	void *source = (msg.fTeam != get_current_team_id() ? (void*)NULL : reinterpret_cast<void*>(source_address));
+	if (source == NULL) {
+		if (msg.fTeam == get_current_team_id()) {
+			fReplyToken = msg.fReplyToken;
+			fReplyTokenTimestamp = msg.fReplyTokenTimestamp;
 		}
 	} else {
 		// TODO: not safe
@@ -467,9 +857,25 @@ BMessage::Unflatten(const char *buffer, size_t bufferSize)
 }
 
 
+void
+BMessage::_DecodeFlattened() const
+{
+	BMessage *self = const_cast<BMessage*>(this);
+	self->fFlattenedPending = false;
+
+	if (_UnflattenFields(self, fFlattened + E_MESSAGE_HEADER_SIZE,
+	                     fFlattenedSize - E_MESSAGE_HEADER_SIZE, fFlattenedCount, true) == false) {
+		// the bounds were checked by AdoptFlattened(), out of memory
+		while (self->fFieldsCount > 0) self->_RemoveField(self->fFieldsCount - 1);
+		self->fFlattenedCurrent = false;
+	}
+}
+
+
 void
 BMessage::PrintToStream() const
 {
+	if (fFlattenedPending) _DecodeFlattened();
 	ETK_OUTPUT("what = '%c%c%c%c'\t\tteam = %I64i\n",
 #ifdef ETK_BIG_ENDIAN
 	           what & 0xff, (what >> 8) & 0xff, (what >> 16) & 0xff, (what >> 24) & 0xff,
@@ -487,110 +893,94 @@ BMessage::PrintToStream() const
 		ETK_OUTPUT("No Reply token\n");
 	ETK_OUTPUT("%s\t\t%s\n", (fIsReply ? "Reply message" : "Not reply message"), (fSource ? "Has source" : "No source"));
 
-	for (int32 k = 0; k < fObjectsList.CountItems(); k++) {
-		list_data *ldata = (list_data*)fObjectsList.ItemAt(k);
-		if (!ldata) {
-			ETK_WARNING("Message::(%I32i) is NULL!", k);
-			continue;
-		}
+	for (int32 k = 0; k < fFieldsCount; k++) {
+		const _field_t *field = &fFields[k];
+		const _item_t *items = FIELD_ITEMS(field);
 
-		const char *name = ldata->name ? (strlen(ldata->name) > 0 ? (const char*)ldata->name : "NULL") : "ERROR-NULL";
+		const char *name = field->nameLength > 0 ? (const char*)field->name : "NULL";
 		uint64 count = (uint64)B_INT64_CONSTANT(0);
 
-		for (int32 j = 0; j < ldata->list.CountItems(); j++) {
-			type_list_data *tldata = (type_list_data*)ldata->list.ItemAt(j);
-			if (!tldata) {
-				ETK_WARNING("Message::(%I32i - %I32i) is NULL!", k, j);
+		for (int32 i = 0; i < field->count; i++) {
+			const _item_t *Object = &items[i];
+
+			count++;
+			ETK_OUTPUT("%s[%I64u]:", name, count);
+			if (Object->data == NULL) {
+				ETK_OUTPUT("\tWARNING: *** NO DATA ***\n");
 				continue;
 			}
 
-			for (int32 i = 0; i < tldata->list.CountItems(); i++) {
-				_object_t *Object = (_object_t*)tldata->list.ItemAt(i);
+			switch (field->type) {
+				case B_STRING_TYPE:
+					ETK_OUTPUT("\tSTRING\t\"%s\"\n", (char*)Object->data);
+					break;
 
-				if (!Object) {
-					ETK_WARNING("Message::(%I32i - %I32i - %I32i) is NULL!",
-					            k, j, i);
-					continue;
-				} else {
-					count++;
-					ETK_OUTPUT("%s[%I64u]:", name, count);
-					if (Object->data == NULL) {
-						ETK_OUTPUT("\tWARNING: *** NO DATA ***\n");
-					} else {
-						switch (tldata->type) {
-							case B_STRING_TYPE:
-								ETK_OUTPUT("\tSTRING\t\"%s\"\n", (char*)Object->data);
-								break;
-
-							case B_INT8_TYPE:
-								ETK_OUTPUT("\tINT8\t%I8i\n", *((int8*)Object->data));
-								break;
-
-							case B_INT16_TYPE:
-								ETK_OUTPUT("\tINT16\t%I16i\n", *((int16*)Object->data));
-								break;
-
-							case B_INT32_TYPE:
-								ETK_OUTPUT("\tINT32\t%I32i\n", *((int32*)Object->data));
-								break;
-
-							case B_INT64_TYPE:
-								ETK_OUTPUT("\tINT64\t%I64i\n", *((int64*)Object->data));
-								break;
-
-							case B_BOOL_TYPE:
-								ETK_OUTPUT("\tBOOL\t%s\n", (*((bool*)Object->data) ? "true" : "false"));
-								break;
-
-							case B_FLOAT_TYPE:
-								ETK_OUTPUT("\tFLOAT\t%g\n", *((float*)Object->data));
-								break;
-
-							case B_DOUBLE_TYPE:
-								ETK_OUTPUT("\tDOUBLE\t%g\n", *((double*)Object->data));
-								break;
-
-							case B_POINT_TYPE: {
-								struct point_t {
-									float x;
-									float y;
-								} *pt;
-
-								pt = (struct point_t *)Object->data;
-
-								ETK_OUTPUT("\tPOINT\t(%g,%g)\n", pt->x, pt->y);
-							}
-							break;
-
-							case B_RECT_TYPE: {
-								struct rect_t {
-									float l;
-									float t;
-									float r;
-									float b;
-								} *r;
-
-								r = (struct rect_t *)Object->data;
-
-								ETK_OUTPUT("\tRECT\t(%g,%g,%g,%g)\n", r->l, r->t, r->r, r->b);
-							}
-							break;
-
-							default:
-								ETK_OUTPUT("\t'%c%c%c%c'\tbytes[%lu]  fixed_size[%s]  address[%p]\n",
+				case B_INT8_TYPE:
+					ETK_OUTPUT("\tINT8\t%I8i\n", *((int8*)Object->data));
+					break;
+
+				case B_INT16_TYPE:
+					ETK_OUTPUT("\tINT16\t%I16i\n", *((int16*)Object->data));
+					break;
+
+				case B_INT32_TYPE:
+					ETK_OUTPUT("\tINT32\t%I32i\n", *((int32*)Object->data));
+					break;
+
+				case B_INT64_TYPE:
+					ETK_OUTPUT("\tINT64\t%I64i\n", *((int64*)Object->data));
+					break;
+
+				case B_BOOL_TYPE:
+					ETK_OUTPUT("\tBOOL\t%s\n", (*((bool*)Object->data) ? "true" : "false"));
+					break;
+
+				case B_FLOAT_TYPE:
+					ETK_OUTPUT("\tFLOAT\t%g\n", *((float*)Object->data));
+					break;
+
+				case B_DOUBLE_TYPE:
+					ETK_OUTPUT("\tDOUBLE\t%g\n", *((double*)Object->data));
+					break;
+
+				case B_POINT_TYPE: {
+					struct point_t {
+						float x;
+						float y;
+					} *pt;
+
+					pt = (struct point_t *)Object->data;
+
+					ETK_OUTPUT("\tPOINT\t(%g,%g)\n", pt->x, pt->y);
+				}
+				break;
+
+				case B_RECT_TYPE: {
+					struct rect_t {
+						float l;
+						float t;
+						float r;
+						float b;
+					} *r;
+
+					r = (struct rect_t *)Object->data;
+
+					ETK_OUTPUT("\tRECT\t(%g,%g,%g,%g)\n", r->l, r->t, r->r, r->b);
+				}
+				break;
+
+				default:
+					ETK_OUTPUT("\t'%c%c%c%c'\tbytes[%lu]  fixed_size[%s]  address[%p]\n",
 #ifdef ETK_BIG_ENDIAN
-								           tldata->type & 0xff, (tldata->type >> 8) & 0xff,
-								           (tldata->type >> 16) & 0xff, (tldata->type >> 24) & 0xff,
+					           field->type & 0xff, (field->type >> 8) & 0xff,
+					           (field->type >> 16) & 0xff, (field->type >> 24) & 0xff,
 #else
-								           (tldata->type >> 24) & 0xff, (tldata->type >> 16) & 0xff,
-								           (tldata->type >> 8) & 0xff, tldata->type & 0xff,
+					           (field->type >> 24) & 0xff, (field->type >> 16) & 0xff,
+					           (field->type >> 8) & 0xff, field->type & 0xff,
 #endif
-								           Object->bytes,
-								           (Object->fixed_size ? "true" : "false"),
-								           Object->data);
-						}
-					}
-				}
+					           Object->bytes,
+					           (Object->fixed_size ? "true" : "false"),
+					           Object->data);
 			}
 		}
 	}
@@ -600,325 +990,729 @@ BMessage::PrintToStream() const
 BMessage::~BMessage()
 {
 	MakeEmpty();
+	_FreeFields();
 
-	if (fSource != NULL) {
-		if (fNoticeSource) close_port(fSource);
-		delete_port(fSource);
-	}
+	_ReleaseSource();
 }
 
 
-BMessage::list_data*
-BMessage::_find_list(const BList *list, const char *name, int32 *index)
+void*
+BMessage::_AllocValue()
 {
-	if (!list || !name) return NULL;
+	_e_value_slot_t *slot = (_e_value_slot_t*)fFreeValues;
+	if (slot != NULL) {
+		fFreeValues = slot->next;
+		return slot;
+	}
 
-	for (int32 i = 0; i < list->CountItems(); i++) {
-		list_data *data = (list_data*)list->ItemAt(i);
-		if (!data || !data->name) continue;
-		if (strcmp(data->name, name) == 0 && strlen(data->name) == strlen(name)) {
-			if (index) *index = i;
-			return data;
-		}
+	_e_value_block_t *block = (_e_value_block_t*)fValueBlocks;
+	if (block == NULL || block->used >= block->count) {
+		_e_value_block_t *newBlock = (_e_value_block_t*)e_message_chunk_alloc(E_MESSAGE_CHUNK_VALUES,
+				sizeof(_e_value_block_t) + sizeof(_e_value_slot_t) * (E_MESSAGE_POOLED_VALUES - 1));
+		if (newBlock == NULL) return NULL;
+
+		newBlock->next = block;
+		newBlock->count = E_MESSAGE_POOLED_VALUES;
+		newBlock->used = 0;
+		fValueBlocks = block = newBlock;
 	}
 
-	return NULL;
+	return &(block->slots[block->used++]);
 }
 
 
-BMessage::type_list_data*
-BMessage::_find_type_list(const BList *list, type_code type)
+void
+BMessage::_FreeValue(void *value)
 {
-	if (!list) return NULL;
+	_e_value_slot_t *slot = (_e_value_slot_t*)value;
+	slot->next = (_e_value_slot_t*)fFreeValues;
+	fFreeValues = slot;
+}
 
-	for (int32 i = 0; i < list->CountItems(); i++) {
-		type_list_data *data = (type_list_data*)list->ItemAt(i);
-		if (!data) continue;
-		if (data->type == type) return data;
-	}
 
-	return NULL;
+char*
+BMessage::_AllocName(size_t nameLength)
+{
+	// short names take a slot as the small values
+	return (char*)(nameLength < E_MESSAGE_SMALL_VALUE ? _AllocValue() : malloc(nameLength + 1));
 }
 
 
-int32
-BMessage::CountItems(const char *name, type_code type) const
+void
+BMessage::_FreeName(_field_t *field)
 {
-	if (!name) return -1;
+	if (field->atom != 0) return;
+
+	if (field->nameLength < E_MESSAGE_SMALL_VALUE)
+		_FreeValue(field->name);
+	else
+		free(field->name);
+}
+
 
-	list_data *ldata = _find_list(&fObjectsList, name);
-	if (!ldata) return -1;
+void
+BMessage::_FreeFields()
+{
+	if (fFields == NULL) return;
 
-	type_list_data *tldata = _find_type_list(&(ldata->list), type);
-	if (!tldata) return -1;
+	if (fFieldsCapacity == E_MESSAGE_POOLED_FIELDS)
+		e_message_chunk_free(E_MESSAGE_CHUNK_FIELDS, fFields);
+	else
+		free(fFields);
 
-	return tldata->list.CountItems();
+	fFields = NULL;
+	fFieldsCapacity = 0;
 }
 
 
-int32
-BMessage::CountItems(int32 nameIndex, int32 typeIndex, type_code *type) const
+char*
+BMessage::_AllocFlattened(size_t size)
 {
-	list_data *ldata = (list_data*)fObjectsList.ItemAt(nameIndex);
-	if (!ldata) return -1;
+	if (size <= E_MESSAGE_POOLED_BUFFER) return (char*)e_message_chunk_alloc(E_MESSAGE_CHUNK_BUFFER, E_MESSAGE_POOLED_BUFFER);
+	return (char*)malloc(size);
+}
 
-	type_list_data *tldata = (type_list_data*)ldata->list.ItemAt(typeIndex);
-	if (!tldata) return -1;
 
-	if (type) *type = tldata->type;
-	return tldata->list.CountItems();
+void
+BMessage::_FreeFlattened(char *buffer, size_t size)
+{
+	if (size <= E_MESSAGE_POOLED_BUFFER)
+		e_message_chunk_free(E_MESSAGE_CHUNK_BUFFER, buffer);
+	else
+		free(buffer);
 }
 
 
-bool
-BMessage::TypeAt(const char *name, int32 typeIndex, type_code *type) const
+void
+BMessage::_Unshare(bool keepFields)
 {
-	if (!name || !type) return false;
-
-	list_data *ldata = _find_list(&fObjectsList, name);
-	if (!ldata) return false;
+	BMessage *shared = fShared;
+	if (shared == NULL) return;
 
-	type_list_data *tldata = (type_list_data*)ldata->list.ItemAt(typeIndex);
-	if (!tldata) return false;
+	fShared = NULL;
 
-	*type = tldata->type;
+	if (fFields != shared->fFields) {
+		// the fields are our own, the hidden message holds a copy of them for the copies of this one
+		if (__sync_sub_and_fetch(&shared->fSharedRefs, 1) == 0) delete shared;
+		return;
+	}
 
-	return true;
-}
+	// the storage belongs to the hidden message
+	fFields = NULL;
+	fFieldsCount = 0;
+	fFieldsCapacity = 0;
+	fFieldsIndex = NULL;
+	fFieldsIndexMask = 0;
+
+	if (keepFields) {
+		if (__sync_add_and_fetch(&shared->fSharedRefs, 0) == 1) {
+			// nobody else could get it again
+			_SwapStorage(shared);
+			delete shared;
+			return;
+		}
 
+		_CopyFields(shared);
+	}
 
-bool
-BMessage::TypeAt(int32 nameIndex, int32 typeIndex, type_code *type) const
-{
-	if (!type) return false;
+	if (__sync_sub_and_fetch(&shared->fSharedRefs, 1) == 0) delete shared;
+}
 
-	list_data *ldata = (list_data*)fObjectsList.ItemAt(nameIndex);
-	if (!ldata) return false;
 
-	type_list_data *tldata = (type_list_data*)ldata->list.ItemAt(typeIndex);
-	if (!tldata) return false;
+void
+BMessage::_SwapStorage(BMessage *msg)
+{
+	_field_t *fields = fFields;
+	int32 fieldsCount = fFieldsCount;
+	int32 fieldsCapacity = fFieldsCapacity;
+	int32 *fieldsIndex = fFieldsIndex;
+	uint32 fieldsIndexMask = fFieldsIndexMask;
+	void *valueBlocks = fValueBlocks;
+	void *freeValues = fFreeValues;
+	char *flattened = fFlattened;
+	size_t flattenedSize = fFlattenedSize;
+	uint64 flattenedCount = fFlattenedCount;
+	bool flattenedPending = fFlattenedPending;
+	bool flattenedCurrent = fFlattenedCurrent;
+	bool flattenedPooled = fFlattenedPooled;
+	void *flattenedArea = fFlattenedArea;
+
+	fFields = msg->fFields;
+	fFieldsCount = msg->fFieldsCount;
+	fFieldsCapacity = msg->fFieldsCapacity;
+	fFieldsIndex = msg->fFieldsIndex;
+	fFieldsIndexMask = msg->fFieldsIndexMask;
+	fValueBlocks = msg->fValueBlocks;
+	fFreeValues = msg->fFreeValues;
+	fFlattened = msg->fFlattened;
+	fFlattenedSize = msg->fFlattenedSize;
+	fFlattenedCount = msg->fFlattenedCount;
+	fFlattenedPending = msg->fFlattenedPending;
+	fFlattenedCurrent = msg->fFlattenedCurrent;
+	fFlattenedPooled = msg->fFlattenedPooled;
+	fFlattenedArea = msg->fFlattenedArea;
+
+	msg->fFields = fields;
+	msg->fFieldsCount = fieldsCount;
+	msg->fFieldsCapacity = fieldsCapacity;
+	msg->fFieldsIndex = fieldsIndex;
+	msg->fFieldsIndexMask = fieldsIndexMask;
+	msg->fValueBlocks = valueBlocks;
+	msg->fFreeValues = freeValues;
+	msg->fFlattened = flattened;
+	msg->fFlattenedSize = flattenedSize;
+	msg->fFlattenedCount = flattenedCount;
+	msg->fFlattenedPending = flattenedPending;
+	msg->fFlattenedCurrent = flattenedCurrent;
+	msg->fFlattenedPooled = flattenedPooled;
+	msg->fFlattenedArea = flattenedArea;
+}
 
-	*type = tldata->type;
 
-	return true;
+void
+BMessage::_AliasStorage(const BMessage *msg)
+{
+	// only for reading, _Unshare() comes before any change
+	fFields = msg->fFields;
+	fFieldsCount = msg->fFieldsCount;
+	fFieldsCapacity = msg->fFieldsCapacity;
+	fFieldsIndex = msg->fFieldsIndex;
+	fFieldsIndexMask = msg->fFieldsIndexMask;
 }
 
 
-int32
-BMessage::CountTypesByName(const char *name) const
+void
+BMessage::_CopyFields(const BMessage *msg)
 {
-	if (!name) return -1;
+	for (int32 k = 0; k < msg->fFieldsCount; k++) {
+		const _field_t *field = &msg->fFields[k];
+		const _item_t *items = FIELD_ITEMS(field);
 
-	list_data *ldata = _find_list(&fObjectsList, name);
-	if (!ldata) return -1;
+		_field_t *newField = _AddField(field->name, field->nameLength, field->hash, field->atom, field->type);
+		if (newField == NULL) break;
+
+		for (int32 i = 0; i < field->count; i++) {
+			if (_AddItem(newField, items[i].data, items[i].bytes, items[i].fixed_size) == false) break;
+		}
 
-	return ldata->list.CountItems();
+		if (newField->count == 0) _RemoveField(fFieldsCount - 1);
+	}
 }
 
 
-int32
-BMessage::CountTypesByName(int32 nameIndex) const
+#ifndef ETK_BUILD_WITH_MEMORY_TRACING
+void*
+BMessage::operator new(size_t size)
 {
-	list_data *ldata = (list_data*)fObjectsList.ItemAt(nameIndex);
-	if (!ldata) return -1;
-
-	return ldata->list.CountItems();
+	// the classes derived from BMessage have other sizes
+	if (size != sizeof(BMessage)) return malloc(size);
+	return e_message_chunk_alloc(E_MESSAGE_CHUNK_OBJECT, size);
 }
 
 
-int32
-BMessage::CountNames(type_code type, bool count_all_names_when_any_type) const
+void
+BMessage::operator delete(void *ptr, size_t size)
 {
-	if (type == B_ANY_TYPE && count_all_names_when_any_type) return fObjectsList.CountItems();
+	if (size != sizeof(BMessage))
+		free(ptr);
+	else
+		e_message_chunk_free(E_MESSAGE_CHUNK_OBJECT, ptr);
+}
+#endif
 
-	int32 retVal = 0;
 
-	for (int32 i = 0; i < fObjectsList.CountItems(); i++) {
-		list_data *ldata = (list_data*)fObjectsList.ItemAt(i);
-		if (ldata == NULL) continue;
+bool
+BMessage::_SetItem(_item_t *item, const void *data, size_t numBytes, bool is_fixed_size, bool borrow)
+{
+	item->bytes = is_fixed_size ? numBytes : sizeof(void*);
+	item->fixed_size = is_fixed_size;
+	item->borrowed = (borrow && is_fixed_size && numBytes > 0);
+	item->data = (void*)data;
+
+	if (is_fixed_size && numBytes > 0 && !borrow) {
+		void *value = (numBytes <= E_MESSAGE_SMALL_VALUE ? _AllocValue() : malloc(numBytes));
+		if (value == NULL) return false;
 
-		for (int32 k = 0; k < ldata->list.CountItems(); k++) {
-			type_list_data *tldata = (type_list_data*)ldata->list.ItemAt(i);
-			if (tldata == NULL) continue;
-			if (tldata->type == type) {
-				retVal++;
-				break;
-			}
-		}
+		memcpy(value, data, numBytes);
+		item->data = value;
 	}
 
-	return retVal;
+	return true;
 }
 
 
-int32
-BMessage::FindName(const char *name) const
+void
+BMessage::_FreeItem(_item_t *item)
 {
-	int32 index = -1;
-	_find_list(&fObjectsList, name, &index);
-	return index;
+	if (!item->fixed_size || item->borrowed || item->bytes == 0 || item->data == NULL) return;
+
+	if (item->bytes <= E_MESSAGE_SMALL_VALUE)
+		_FreeValue(item->data);
+	else
+		free(item->data);
 }
 
 
-const char*
-BMessage::NameAt(int32 nameIndex) const
+bool
+BMessage::_AddItem(_field_t *field, const void *data, size_t numBytes, bool is_fixed_size, bool borrow)
 {
-	list_data *data = (list_data*)fObjectsList.ItemAt(nameIndex);
-	return(data ? data->name : NULL);
-}
+	if (field->count >= field->capacity) {
+		int32 capacity = max_c(field->capacity * 2, 4);
+		_item_t *items = (_item_t*)realloc(field->items, sizeof(_item_t) * (size_t)capacity);
+		if (items == NULL) return false;
 
+		if (field->items == NULL && field->count > 0) items[0] = field->item;
+		field->items = items;
+		field->capacity = capacity;
+	}
 
-void
-BMessage::MakeEmpty()
-{
-	for (int32 k = 0; k < fObjectsList.CountItems(); k++) {
-		list_data *ldata = (list_data*)fObjectsList.ItemAt(k);
-		if (!ldata) continue;
+	_item_t *item = FIELD_ITEMS(field) + field->count;
+	if (_SetItem(item, data, numBytes, is_fixed_size, borrow) == false) return false;
 
-		for (int32 j = 0; j < ldata->list.CountItems(); j++) {
-			type_list_data *tldata = (type_list_data*)ldata->list.ItemAt(j);
-			if (!tldata) continue;
+	field->count++;
+	return true;
+}
 
-			for (int32 i = 0; i < tldata->list.CountItems(); i++) {
-				_object_t *Object = (_object_t*)tldata->list.ItemAt(i);
-				if (!Object) continue;
 
-				if (Object->fixed_size && Object->data) free(Object->data);
-				delete Object;
-			}
+void
+BMessage::_RebuildIndex()
+{
+	if (fFieldsCount <= E_MESSAGE_INDEX_THRESHOLD) {
+		if (fFieldsIndex) free(fFieldsIndex);
+		fFieldsIndex = NULL;
+		fFieldsIndexMask = 0;
+		return;
+	}
 
-			delete tldata;
+	// at most half full
+	uint32 capacity = 32;
+	while (capacity < (uint32)fFieldsCount * 2) capacity <<= 1;
+
+	if (fFieldsIndex == NULL || fFieldsIndexMask + 1 != capacity) {
+		int32 *index = (int32*)realloc(fFieldsIndex, sizeof(int32) * capacity);
+		if (index == NULL) {
+			// the linear search still works
+			if (fFieldsIndex) free(fFieldsIndex);
+			fFieldsIndex = NULL;
+			fFieldsIndexMask = 0;
+			return;
 		}
 
-		delete[] ldata->name;
-		delete ldata;
+		fFieldsIndex = index;
+		fFieldsIndexMask = capacity - 1;
 	}
 
+	memset(fFieldsIndex, 0xff, sizeof(int32) * capacity);
 
-	fObjectsList.MakeEmpty();
+	for (int32 k = 0; k < fFieldsCount; k++) {
+		uint32 slot = fFields[k].hash & fFieldsIndexMask;
+		while (fFieldsIndex[slot] >= 0) slot = (slot + 1) & fFieldsIndexMask;
+		fFieldsIndex[slot] = k;
+	}
 }
 
 
-bool
-BMessage::IsEmpty() const
+BMessage::_field_t*
+BMessage::_FindField(const char *name, int32 *index) const
 {
-	return fObjectsList.IsEmpty();
-}
+	if (fFlattenedPending) _DecodeFlattened();
+	if (name == NULL || fFieldsCount == 0) return NULL;
 
+	size_t nameLength = strlen(name);
 
-bool
-BMessage::Rename(const char *old_entry, const char *new_entry)
-{
-	if (!old_entry || !new_entry) return false;
-	if (strcmp(old_entry, new_entry) == 0 && strlen(old_entry) == strlen(new_entry)) return true;
+	if (fFieldsIndex != NULL) {
+		uint32 hash = e_hash_data(name, nameLength);
 
-	list_data *ldata = _find_list(&fObjectsList, new_entry);
-	if (ldata) return false;
+		for (uint32 slot = hash & fFieldsIndexMask; fFieldsIndex[slot] >= 0; slot = (slot + 1) & fFieldsIndexMask) {
+			_field_t *field = &fFields[fFieldsIndex[slot]];
+			if (field->hash != hash || field->nameLength != nameLength) continue;
+			if (memcmp(field->name, name, nameLength) != 0) continue;
 
-	ldata = _find_list(&fObjectsList, old_entry);
-	if (!ldata) return false;
+			if (index) *index = fFieldsIndex[slot];
+			return field;
+		}
 
-	char *newName = EStrdup(new_entry);
-	if (!newName) return false;
+		return NULL;
+	}
 
-	delete[] ldata->name;
-	ldata->name = newName;
+	for (int32 k = 0; k < fFieldsCount; k++) {
+		_field_t *field = &fFields[k];
+		if (field->nameLength != nameLength || memcmp(field->name, name, nameLength) != 0) continue;
 
-	return true;
+		if (index) *index = k;
+		return field;
+	}
+
+	return NULL;
 }
 
 
-bool
-BMessage::AddData(const char *name, type_code type, const void *data, size_t numBytes, bool is_fixed_size)
+BMessage::_field_t*
+BMessage::_FindField(const BMessageAtom &atom, int32 *index) const
 {
-	if (!name) return false;
-	if (!data && (!is_fixed_size || numBytes != 0)) return false;
+	if (fFlattenedPending) _DecodeFlattened();
 
-	list_data *ldata = _find_list(&fObjectsList, name);
+	const _e_message_atom_t *entry = e_message_atom_at(atom.fId);
+	if (entry == NULL || fFieldsCount == 0) return NULL;
 
-	_object_t *Object = new _object_t;
-	if (!Object) return false;
+	// fields added by the name are compared as before, atoms are only compared by id
+	if (fFieldsIndex != NULL) {
+		for (uint32 slot = entry->hash & fFieldsIndexMask; fFieldsIndex[slot] >= 0; slot = (slot + 1) & fFieldsIndexMask) {
+			_field_t *field = &fFields[fFieldsIndex[slot]];
+			if (field->atom != atom.fId) {
+				if (field->atom != 0 || field->hash != entry->hash || field->nameLength != entry->nameLength) continue;
+				if (memcmp(field->name, entry->name, entry->nameLength) != 0) continue;
+			}
 
-	Object->bytes = is_fixed_size ? numBytes : sizeof(void*);
-	Object->fixed_size = is_fixed_size;
-	Object->data = NULL;
-	if (is_fixed_size && numBytes > 0) {
-		if ((Object->data = malloc(numBytes)) == NULL) {
-			delete Object;
-			return false;
+			if (index) *index = fFieldsIndex[slot];
+			return field;
 		}
 
-		bzero(Object->data, numBytes);
+		return NULL;
+	}
 
-		if (memcpy(Object->data, data, numBytes) == NULL) {
-			free(Object->data);
-			delete Object;
-			return false;
+	for (int32 k = 0; k < fFieldsCount; k++) {
+		_field_t *field = &fFields[k];
+		if (field->atom != atom.fId) {
+			if (field->atom != 0 || field->hash != entry->hash || field->nameLength != entry->nameLength) continue;
+			if (memcmp(field->name, entry->name, entry->nameLength) != 0) continue;
 		}
-	} else {
-		Object->data = (void*)data;
+
+		if (index) *index = k;
+		return field;
 	}
 
-	if (!ldata) { // data not exist
-		type_list_data *tldata = NULL;
+	return NULL;
+}
+
 
-		if ((ldata = new list_data) != NULL)
-			if ((ldata->name = EStrdup(name)) != NULL)
-				if ((tldata = new type_list_data) != NULL) {
-					tldata->type = type;
-					if (tldata->list.AddItem((void*)Object))
-						if (ldata->list.AddItem((void*)tldata))
-							if (fObjectsList.AddItem((void*)ldata)) return true;
-				}
+BMessage::_field_t*
+BMessage::_AddField(const char *name, type_code type)
+{
+	size_t nameLength = strlen(name);
+	return _AddField(name, nameLength, e_hash_data(name, nameLength), 0, type);
+}
 
-		if (Object->fixed_size && Object->data) free(Object->data);
-		delete Object;
 
-		if (tldata) delete tldata;
+BMessage::_field_t*
+BMessage::_AddField(const char *name, size_t nameLength, uint32 hash, uint32 atom, type_code type)
+{
+	if (fFieldsCount >= fFieldsCapacity) {
+		// the first table comes from the pool, the larger ones from malloc()
+		_field_t *fields;
+		int32 capacity = max_c(fFieldsCapacity * 2, E_MESSAGE_POOLED_FIELDS);
 
-		if (ldata) {
-			if (ldata->name) delete[] ldata->name;
-			delete ldata;
+		if (fFieldsCapacity == 0) {
+			fields = (_field_t*)e_message_chunk_alloc(E_MESSAGE_CHUNK_FIELDS, sizeof(_field_t) * (size_t)capacity);
+		} else if (fFieldsCapacity == E_MESSAGE_POOLED_FIELDS) {
+			if ((fields = (_field_t*)malloc(sizeof(_field_t) * (size_t)capacity)) != NULL) {
+				memcpy(fields, fFields, sizeof(_field_t) * (size_t)fFieldsCount);
+				e_message_chunk_free(E_MESSAGE_CHUNK_FIELDS, fFields);
+			}
+		} else {
+			fields = (_field_t*)realloc(fFields, sizeof(_field_t) * (size_t)capacity);
 		}
-	} else {
-		type_list_data *tldata = _find_type_list(&(ldata->list), type);
+		if (fields == NULL) return NULL;
+
+		fFields = fields;
+		fFieldsCapacity = capacity;
+	}
+
+	_field_t *field = &fFields[fFieldsCount];
 
-		if (tldata) if (tldata->list.AddItem((void*)Object)) return true;
+	// the atoms keep their names until the process exits
+	if (atom != 0) {
+		field->name = (char*)name;
+	} else {
+		if ((field->name = _AllocName(nameLength)) == NULL) return NULL;
+		memcpy(field->name, name, nameLength);
+		field->name[nameLength] = 0;
+	}
 
-		if (Object->fixed_size && Object->data) free(Object->data);
-		delete Object;
+	field->nameLength = nameLength;
+	field->hash = hash;
+	field->atom = atom;
+	field->type = type;
+	field->count = 0;
+	field->capacity = 1;
+	field->items = NULL;
+
+	fFieldsCount++;
+
+	if (fFieldsIndex != NULL && (uint32)fFieldsCount * 2 <= fFieldsIndexMask + 1) {
+		uint32 slot = field->hash & fFieldsIndexMask;
+		while (fFieldsIndex[slot] >= 0) slot = (slot + 1) & fFieldsIndexMask;
+		fFieldsIndex[slot] = fFieldsCount - 1;
+	} else if (fFieldsCount > E_MESSAGE_INDEX_THRESHOLD) {
+		_RebuildIndex();
 	}
 
-	return false;
+	return field;
 }
 
 
-bool
-BMessage::AddString(const char *name, const char *aString)
+void
+BMessage::_RemoveField(int32 index)
 {
-	if (!name || !aString) return false;
+	_field_t *field = &fFields[index];
+	_item_t *items = FIELD_ITEMS(field);
 
-	return AddData(name, B_STRING_TYPE, (const void*)aString, (size_t)(strlen(aString) + 1), true);
-}
+	for (int32 i = 0; i < field->count; i++) _FreeItem(&items[i]);
+	if (field->items) free(field->items);
+	_FreeName(field);
 
+	// the order of the names stays, NameAt() depends on it
+	if (index < fFieldsCount - 1)
+		memmove(field, field + 1, sizeof(_field_t) * (size_t)(fFieldsCount - index - 1));
+	fFieldsCount--;
 
-bool
-BMessage::AddString(const char *name, const BString &aString)
-{
-	return AddString(name, aString.String());
+	if (fFieldsIndex != NULL) _RebuildIndex();
 }
 
 
-bool
-BMessage::AddInt8(const char *name, int8 val)
+int32
+BMessage::CountItems(const char *name, type_code type) const
 {
-	if (!name) return false;
-	return AddData(name, B_INT8_TYPE, (const void*)&val, sizeof(int8), true);
+	if (!name) return -1;
+
+	_field_t *field = _FindField(name);
+	if (!field || field->type != type) return -1;
+
+	return field->count;
 }
 
 
-bool
-BMessage::AddInt16(const char *name, int16 val)
+int32
+BMessage::CountItems(int32 nameIndex, int32 typeIndex, type_code *type) const
+{
+	if (fFlattenedPending) _DecodeFlattened();
+	if (nameIndex < 0 || nameIndex >= fFieldsCount || typeIndex != 0) return -1;
+
+	if (type) *type = fFields[nameIndex].type;
+	return fFields[nameIndex].count;
+}
+
+
+bool
+BMessage::TypeAt(const char *name, int32 typeIndex, type_code *type) const
+{
+	if (!name || !type || typeIndex != 0) return false;
+
+	_field_t *field = _FindField(name);
+	if (!field) return false;
+
+	*type = field->type;
+
+	return true;
+}
+
+
+bool
+BMessage::TypeAt(int32 nameIndex, int32 typeIndex, type_code *type) const
+{
+	if (fFlattenedPending) _DecodeFlattened();
+	if (!type || nameIndex < 0 || nameIndex >= fFieldsCount || typeIndex != 0) return false;
+
+	*type = fFields[nameIndex].type;
+
+	return true;
+}
+
+
+int32
+BMessage::CountTypesByName(const char *name) const
+{
+	if (!name) return -1;
+
+	return(_FindField(name) ? 1 : -1);
+}
+
+
+int32
+BMessage::CountTypesByName(int32 nameIndex) const
+{
+	if (fFlattenedPending) _DecodeFlattened();
+	return((nameIndex < 0 || nameIndex >= fFieldsCount) ? -1 : 1);
+}
+
+
+int32
+BMessage::CountNames(type_code type, bool count_all_names_when_any_type) const
+{
+	if (fFlattenedPending) _DecodeFlattened();
+	if (type == B_ANY_TYPE && count_all_names_when_any_type) return fFieldsCount;
+
+	int32 retVal = 0;
+
+	for (int32 i = 0; i < fFieldsCount; i++) {
+		if (fFields[i].type == type) retVal++;
+	}
+
+	return retVal;
+}
+
+
+int32
+BMessage::FindName(const char *name) const
+{
+	int32 index = -1;
+	_FindField(name, &index);
+	return index;
+}
+
+
+const char*
+BMessage::NameAt(int32 nameIndex) const
+{
+	if (fFlattenedPending) _DecodeFlattened();
+	return((nameIndex < 0 || nameIndex >= fFieldsCount) ? NULL : fFields[nameIndex].name);
+}
+
+
+void
+BMessage::MakeEmpty()
+{
+	_Unshare(false);
+
+	for (int32 k = 0; k < fFieldsCount; k++) {
+		_field_t *field = &fFields[k];
+		_item_t *items = FIELD_ITEMS(field);
+
+		// the small values and short names go away with their blocks
+		for (int32 i = 0; i < field->count; i++) {
+			if (items[i].fixed_size && !items[i].borrowed &&
+			    items[i].bytes > E_MESSAGE_SMALL_VALUE && items[i].data) free(items[i].data);
+		}
+
+		if (field->items) free(field->items);
+		if (field->atom == 0 && field->nameLength >= E_MESSAGE_SMALL_VALUE) free(field->name);
+	}
+
+	fFieldsCount = 0;
+
+	if (fFieldsIndex) free(fFieldsIndex);
+	fFieldsIndex = NULL;
+	fFieldsIndexMask = 0;
+
+	while (fValueBlocks != NULL) {
+		_e_value_block_t *block = (_e_value_block_t*)fValueBlocks;
+		fValueBlocks = block->next;
+		e_message_chunk_free(E_MESSAGE_CHUNK_VALUES, block);
+	}
+	fFreeValues = NULL;
+
+	if (fFlattenedArea) {
+		// the sender left the area to the receiver, unlinked on mapping
+		delete_area(fFlattenedArea);
+	} else if (fFlattened) {
+		if (fFlattenedPooled)
+			_FreeFlattened(fFlattened, fFlattenedSize);
+		else
+			free(fFlattened);
+	}
+	fFlattened = NULL;
+	fFlattenedSize = 0;
+	fFlattenedCount = 0;
+	fFlattenedPending = false;
+	fFlattenedCurrent = false;
+	fFlattenedPooled = false;
+	fFlattenedArea = NULL;
+}
+
+
+bool
+BMessage::IsEmpty() const
+{
+	if (fFlattenedPending) _DecodeFlattened();
+	return(fFieldsCount == 0);
+}
+
+
+bool
+BMessage::Rename(const char *old_entry, const char *new_entry)
+{
+	if (!old_entry || !new_entry) return false;
+	if (strcmp(old_entry, new_entry) == 0) return true;
+
+	if (_FindField(new_entry)) return false;
+
+	_field_t *field = _FindField(old_entry);
+	if (!field) return false;
+
+	fFlattenedCurrent = false;
+
+	if (fShared != NULL) {
+		_Unshare(true);
+		if ((field = _FindField(old_entry)) == NULL) return false;
+	}
+
+	size_t nameLength = strlen(new_entry);
+	char *newName = _AllocName(nameLength);
+	if (!newName) return false;
+	memcpy(newName, new_entry, nameLength + 1);
+
+	_FreeName(field);
+	field->name = newName;
+	field->nameLength = nameLength;
+	field->atom = 0;
+	field->hash = e_hash_data(new_entry, nameLength);
+
+	if (fFieldsIndex != NULL) _RebuildIndex();
+
+	return true;
+}
+
+
+bool
+BMessage::AddData(const char *name, type_code type, const void *data, size_t numBytes, bool is_fixed_size)
+{
+	if (!name) return false;
+	if (!data && (!is_fixed_size || numBytes != 0)) return false;
+
+	_Unshare(true);
+	fFlattenedCurrent = false;
+
+	_field_t *field = _FindField(name);
+	if (field) {
+		// one type for a name
+		if (field->type != type) return false;
+		return _AddItem(field, data, numBytes, is_fixed_size);
+	}
+
+	if ((field = _AddField(name, type)) == NULL) return false;
+	if (_AddItem(field, data, numBytes, is_fixed_size)) return true;
+
+	_RemoveField(fFieldsCount - 1);
+	return false;
+}
+
+
+bool
+BMessage::AddString(const char *name, const char *aString)
+{
+	if (!name || !aString) return false;
+
+	return AddData(name, B_STRING_TYPE, (const void*)aString, (size_t)(strlen(aString) + 1), true);
+}
+
+
+bool
+BMessage::AddString(const char *name, const BString &aString)
+{
+	return AddString(name, aString.String());
+}
+
+
+bool
+BMessage::AddInt8(const char *name, int8 val)
+{
+	if (!name) return false;
+	return AddData(name, B_INT8_TYPE, (const void*)&val, sizeof(int8), true);
+}
+
+
+bool
+BMessage::AddInt16(const char *name, int16 val)
 {
 	if (!name) return false;
 	return AddData(name, B_INT16_TYPE, (const void*)&val, sizeof(int16), true);
@@ -1079,14 +1873,10 @@ BMessage::FindData(const char *name, type_code type, int32 index, const void **d
 {
 	if (!name) return false;
 
-	list_data *ldata = _find_list(&fObjectsList, name);
-	if (!ldata) return false;
-
-	type_list_data *tldata = _find_type_list(&(ldata->list), type);
-	if (!tldata) return false;
+	_field_t *field = _FindField(name);
+	if (!field || field->type != type || index < 0 || index >= field->count) return false;
 
-	_object_t *Object = (_object_t*)tldata->list.ItemAt(index);
-	if (!Object) return false;
+	const _item_t *Object = FIELD_ITEMS(field) + index;
 
 	if (data) *data = Object->data;
 	if (numBytes) {
@@ -1103,14 +1893,13 @@ BMessage::FindData(const char *name, type_code type, int32 index, const void **d
 bool
 BMessage::FindData(int32 nameIndex, int32 typeIndex, int32 index, const void **data, ssize_t *numBytes) const
 {
-	list_data *ldata = (list_data*)fObjectsList.ItemAt(nameIndex);
-	if (!ldata) return false;
+	if (fFlattenedPending) _DecodeFlattened();
+	if (nameIndex < 0 || nameIndex >= fFieldsCount || typeIndex != 0) return false;
 
-	type_list_data *tldata = (type_list_data*)ldata->list.ItemAt(typeIndex);
-	if (!tldata) return false;
+	const _field_t *field = &fFields[nameIndex];
+	if (index < 0 || index >= field->count) return false;
 
-	_object_t *Object = (_object_t*)tldata->list.ItemAt(index);
-	if (!Object) return false;
+	const _item_t *Object = FIELD_ITEMS(field) + index;
 
 	if (data) *data = Object->data;
 	if (numBytes) {
@@ -1190,684 +1979,1292 @@ BMessage::FindInt16(const char *name, int32 index, int16 *val) const
 
 
 bool
-BMessage::FindInt32(const char *name, int32 *val) const
+BMessage::FindInt32(const char *name, int32 *val) const
+{
+	return FindInt32(name, 0, val);
+}
+
+
+bool
+BMessage::FindInt32(const char *name, int32 index, int32 *val) const
+{
+	const int32 *value = NULL;
+	if (!FindData(name, B_INT32_TYPE, index, (const void**)&value, NULL)) return false;
+	if (val) *val = *value;
+	return true;
+}
+
+
+bool
+BMessage::FindInt64(const char *name, int64 *val) const
+{
+	return FindInt64(name, 0, val);
+}
+
+
+bool
+BMessage::FindInt64(const char *name, int32 index, int64 *val) const
+{
+	const int64 *value = NULL;
+	if (!FindData(name, B_INT64_TYPE, index, (const void**)&value, NULL)) return false;
+	if (val) *val = *value;
+	return true;
+}
+
+
+bool
+BMessage::FindBool(const char *name, bool *aBoolean) const
+{
+	return FindBool(name, 0, aBoolean);
+}
+
+
+bool
+BMessage::FindBool(const char *name, int32 index, bool *aBoolean) const
+{
+	const bool *value = NULL;
+	if (!FindData(name, B_BOOL_TYPE, index, (const void**)&value, NULL)) return false;
+	if (aBoolean) *aBoolean = *value;
+	return true;
+}
+
+
+bool
+BMessage::FindFloat(const char *name, float *f) const
+{
+	return FindFloat(name, 0, f);
+}
+
+
+bool
+BMessage::FindFloat(const char *name, int32 index, float *f) const
+{
+	const float *value = NULL;
+	if (!FindData(name, B_FLOAT_TYPE, index, (const void**)&value, NULL)) return false;
+	if (f) *f = *value;
+	return true;
+}
+
+
+bool
+BMessage::FindDouble(const char *name, double *d) const
+{
+	return FindDouble(name, 0, d);
+}
+
+
+bool
+BMessage::FindDouble(const char *name, int32 index, double *d) const
+{
+	const double *value = NULL;
+	if (!FindData(name, B_DOUBLE_TYPE, index, (const void**)&value, NULL)) return false;
+	if (d) *d = *value;
+	return true;
+}
+
+
+bool
+BMessage::FindPoint(const char *name, BPoint *pt) const
+{
+	return FindPoint(name, 0, pt);
+}
+
+
+bool
+BMessage::FindPoint(const char *name, int32 index, BPoint *pt) const
+{
+	struct point_t {
+		float x;
+		float y;
+	};
+
+	const struct point_t *apt = NULL;
+
+	if (!FindData(name, B_POINT_TYPE, index, (const void**)&apt, NULL)) return false;
+	if (pt) pt->Set(apt->x, apt->y);
+	return true;
+}
+
+
+bool
+BMessage::FindRect(const char *name, BRect *r) const
+{
+	return FindRect(name, 0, r);
+}
+
+
+bool
+BMessage::FindRect(const char *name, int32 index, BRect *r) const
+{
+	struct rect_t {
+		float left;
+		float top;
+		float right;
+		float bottom;
+	};
+
+	const struct rect_t *ar = NULL;
+
+	if (!FindData(name, B_RECT_TYPE, index, (const void**)&ar, NULL)) return false;
+	if (r) r->Set(ar->left, ar->top, ar->right, ar->bottom);
+	return true;
+}
+
+
+bool
+BMessage::FindPointer(const char *name, void **ptr) const
+{
+	return FindPointer(name, 0, ptr);
+}
+
+
+bool
+BMessage::FindPointer(const char *name, int32 index, void **ptr) const
+{
+	return FindData(name, B_POINTER_TYPE, index, (const void**)ptr, NULL);
+}
+
+
+bool
+BMessage::FindMessage(const char *name, BMessage *msg) const
+{
+	return FindMessage(name, 0, msg);
+}
+
+
+bool
+BMessage::FindMessage(const char *name, int32 index, BMessage *msg) const
+{
+	const char *buffer = NULL;
+	if (!FindData(name, B_MESSAGE_TYPE, index, (const void**)&buffer, NULL)) return false;
+
+	if (!buffer) return false;
+
+	if (msg) {
+		size_t bufferSize = 0;
+		memcpy(&bufferSize, buffer, sizeof(size_t));
+		if (msg->Unflatten(buffer, bufferSize) == false) return false;
+	}
+
+	return true;
+}
+
+
+bool
+BMessage::FindMessenger(const char *name, BMessenger *msgr) const
+{
+	return FindMessenger(name, 0, msgr);
+}
+
+
+bool
+BMessage::FindMessenger(const char *name, int32 index, BMessenger *msgr) const
+{
+	const char *buffer = NULL;
+	if (!FindData(name, B_MESSENGER_TYPE, index, (const void**)&buffer, NULL)) return false;
+
+	if (!buffer) return false;
+
+	if (msgr) {
+		size_t bufferSize = 0;
+		memcpy(&bufferSize, buffer, sizeof(size_t));
+		if (msgr->Unflatten(buffer + sizeof(size_t), bufferSize) == false) return false;
+	}
+
+	return true;
+}
+
+
+bool
+BMessage::HasData(const char *name, type_code type, int32 index) const
+{
+	return FindData(name, type, index, NULL, NULL);
+}
+
+
+bool
+BMessage::HasString(const char *name, int32 index) const
+{
+	return FindString(name, index, (const char**)NULL);
+}
+
+
+bool
+BMessage::HasInt8(const char *name, int32 index) const
+{
+	return FindInt8(name, index, NULL);
+}
+
+
+bool
+BMessage::HasInt16(const char *name, int32 index) const
+{
+	return FindInt16(name, index, NULL);
+}
+
+
+bool
+BMessage::HasInt32(const char *name, int32 index) const
+{
+	return FindInt32(name, index, NULL);
+}
+
+
+bool
+BMessage::HasInt64(const char *name, int32 index) const
+{
+	return FindInt64(name, index, NULL);
+}
+
+
+bool
+BMessage::HasBool(const char *name, int32 index) const
+{
+	return FindBool(name, index, NULL);
+}
+
+
+bool
+BMessage::HasFloat(const char *name, int32 index) const
+{
+	return FindFloat(name, index, NULL);
+}
+
+
+bool
+BMessage::HasDouble(const char *name, int32 index) const
+{
+	return FindDouble(name, index, NULL);
+}
+
+
+bool
+BMessage::HasPoint(const char *name, int32 index) const
+{
+	return FindPoint(name, index, NULL);
+}
+
+
+bool
+BMessage::HasRect(const char *name, int32 index) const
+{
+	return FindRect(name, index, NULL);
+}
+
+
+bool
+BMessage::HasPointer(const char *name, int32 index) const
+{
+	return FindPointer(name, index, NULL);
+}
+
+
+bool
+BMessage::HasMessage(const char *name, int32 index) const
+{
+	return FindMessage(name, index, NULL);
+}
+
+
+bool
+BMessage::HasMessenger(const char *name, int32 index) const
+{
+	return FindMessenger(name, index, NULL);
+}
+
+
+bool
+BMessage::RemoveData(const char *name, type_code type, int32 index)
+{
+	if (!name) return false;
+
+	int32 fieldIndex = -1;
+	_field_t *field = _FindField(name, &fieldIndex);
+	if (!field || field->type != type || index < 0 || index >= field->count) return false;
+
+	fFlattenedCurrent = false;
+
+	if (fShared != NULL) {
+		_Unshare(true);
+		if ((field = _FindField(name, &fieldIndex)) == NULL) return false;
+	}
+
+	if (field->count == 1) {
+		_RemoveField(fieldIndex);
+		return true;
+	}
+
+	_item_t *items = FIELD_ITEMS(field);
+	_FreeItem(&items[index]);
+
+	if (index < field->count - 1)
+		memmove(&items[index], &items[index + 1], sizeof(_item_t) * (size_t)(field->count - index - 1));
+	field->count--;
+
+	return true;
+}
+
+
+bool
+BMessage::RemoveData(const char *name, type_code type)
+{
+	if (!name) return false;
+
+	int32 fieldIndex = -1;
+	_field_t *field = _FindField(name, &fieldIndex);
+	if (!field || field->type != type) return false;
+
+	fFlattenedCurrent = false;
+
+	if (fShared != NULL) {
+		_Unshare(true);
+		if ((field = _FindField(name, &fieldIndex)) == NULL) return false;
+	}
+
+	_RemoveField(fieldIndex);
+
+	return true;
+}
+
+
+bool
+BMessage::RemoveData(const char *name)
+{
+	if (!name) return false;
+
+	int32 fieldIndex = -1;
+	if (!_FindField(name, &fieldIndex)) return false;
+
+	fFlattenedCurrent = false;
+
+	if (fShared != NULL) {
+		_Unshare(true);
+		if (!_FindField(name, &fieldIndex)) return false;
+	}
+
+	_RemoveField(fieldIndex);
+
+	return true;
+}
+
+
+
+bool
+BMessage::RemoveString(const char *name, int32 index)
+{
+	return RemoveData(name, B_STRING_TYPE, index);
+}
+
+
+bool
+BMessage::RemoveInt8(const char *name, int32 index)
+{
+	return RemoveData(name, B_INT8_TYPE, index);
+}
+
+
+bool
+BMessage::RemoveInt16(const char *name, int32 index)
+{
+	return RemoveData(name, B_INT16_TYPE, index);
+}
+
+
+bool
+BMessage::RemoveInt32(const char *name, int32 index)
+{
+	return RemoveData(name, B_INT32_TYPE, index);
+}
+
+
+bool
+BMessage::RemoveInt64(const char *name, int32 index)
+{
+	return RemoveData(name, B_INT64_TYPE, index);
+}
+
+
+bool
+BMessage::RemoveBool(const char *name, int32 index)
+{
+	return RemoveData(name, B_BOOL_TYPE, index);
+}
+
+
+bool
+BMessage::RemoveFloat(const char *name, int32 index)
+{
+	return RemoveData(name, B_FLOAT_TYPE, index);
+}
+
+
+bool
+BMessage::RemoveDouble(const char *name, int32 index)
+{
+	return RemoveData(name, B_DOUBLE_TYPE, index);
+}
+
+
+bool
+BMessage::RemovePoint(const char *name, int32 index)
+{
+	return RemoveData(name, B_POINT_TYPE, index);
+}
+
+
+bool
+BMessage::RemoveRect(const char *name, int32 index)
+{
+	return RemoveData(name, B_RECT_TYPE, index);
+}
+
+
+bool
+BMessage::RemovePointer(const char *name, int32 index)
+{
+	return RemoveData(name, B_POINTER_TYPE, index);
+}
+
+
+bool
+BMessage::RemoveMessage(const char *name, int32 index)
+{
+	return RemoveData(name, B_MESSAGE_TYPE, index);
+}
+
+
+bool
+BMessage::RemoveMessenger(const char *name, int32 index)
+{
+	return RemoveData(name, B_MESSENGER_TYPE, index);
+}
+
+
+bool
+BMessage::ReplaceData(const char *name, type_code type, int32 index, const void *data, size_t numBytes, bool is_fixed_size)
+{
+	if (!name) return false;
+	if (!data && (!is_fixed_size || numBytes != 0)) return false;
+
+	_field_t *field = _FindField(name);
+	if (!field || field->type != type || index < 0 || index >= field->count) return false;
+
+	fFlattenedCurrent = false;
+
+	if (fShared != NULL) {
+		_Unshare(true);
+		if ((field = _FindField(name)) == NULL) return false;
+	}
+
+	_item_t *Object = FIELD_ITEMS(field) + index;
+
+	// the same slot serves the new value when both are small
+	if (is_fixed_size && Object->fixed_size && numBytes > 0 &&
+	    numBytes <= E_MESSAGE_SMALL_VALUE && Object->bytes > 0 && Object->bytes <= E_MESSAGE_SMALL_VALUE) {
+		memcpy(Object->data, data, numBytes);
+		Object->bytes = numBytes;
+		return true;
+	}
+
+	_item_t newObject;
+	if (_SetItem(&newObject, data, numBytes, is_fixed_size) == false) return false;
+
+	_FreeItem(Object);
+	*Object = newObject;
+
+	return true;
+}
+
+
+bool
+BMessage::ReplaceData(const char *name, type_code type, const void *data, size_t numBytes, bool is_fixed_size)
+{
+	return ReplaceData(name, type, 0, data, numBytes, is_fixed_size);
+}
+
+
+bool
+BMessage::ReplaceString(const char *name, int32 index, const char *aString)
+{
+	if (!name || !aString) return false;
+	return ReplaceData(name, B_STRING_TYPE, index, (const void*)aString, (size_t)(strlen(aString) + 1), true);
+}
+
+
+bool
+BMessage::ReplaceString(const char *name, const char *aString)
+{
+	return ReplaceString(name, 0, aString);
+}
+
+
+bool
+BMessage::ReplaceString(const char *name, int32 index, const BString &aString)
+{
+	return ReplaceString(name, index, aString.String());
+}
+
+
+bool
+BMessage::ReplaceString(const char *name, const BString &aString)
+{
+	return ReplaceString(name, 0, aString);
+}
+
+
+bool
+BMessage::ReplaceInt8(const char *name, int32 index, int8 val)
+{
+	if (!name) return false;
+	return ReplaceData(name, B_INT8_TYPE, index, (const void*)&val, sizeof(int8), true);
+}
+
+
+bool
+BMessage::ReplaceInt8(const char *name, int8 val)
+{
+	return ReplaceInt8(name, 0, val);
+}
+
+
+bool
+BMessage::ReplaceInt16(const char *name, int32 index, int16 val)
+{
+	if (!name) return false;
+	return ReplaceData(name, B_INT16_TYPE, index, (const void*)&val, sizeof(int16), true);
+}
+
+
+bool
+BMessage::ReplaceInt16(const char *name, int16 val)
 {
-	return FindInt32(name, 0, val);
+	return ReplaceInt16(name, 0, val);
 }
 
 
 bool
-BMessage::FindInt32(const char *name, int32 index, int32 *val) const
+BMessage::ReplaceInt32(const char *name, int32 index, int32 val)
 {
-	const int32 *value = NULL;
-	if (!FindData(name, B_INT32_TYPE, index, (const void**)&value, NULL)) return false;
-	if (val) *val = *value;
-	return true;
+	if (!name) return false;
+	return ReplaceData(name, B_INT32_TYPE, index, (const void*)&val, sizeof(int32), true);
 }
 
 
 bool
-BMessage::FindInt64(const char *name, int64 *val) const
+BMessage::ReplaceInt32(const char *name, int32 val)
 {
-	return FindInt64(name, 0, val);
+	return ReplaceInt32(name, 0, val);
 }
 
 
 bool
-BMessage::FindInt64(const char *name, int32 index, int64 *val) const
+BMessage::ReplaceInt64(const char *name, int32 index, int64 val)
 {
-	const int64 *value = NULL;
-	if (!FindData(name, B_INT64_TYPE, index, (const void**)&value, NULL)) return false;
-	if (val) *val = *value;
-	return true;
+	if (!name) return false;
+	return ReplaceData(name, B_INT64_TYPE, index, (const void*)&val, sizeof(int64), true);
 }
 
 
 bool
-BMessage::FindBool(const char *name, bool *aBoolean) const
+BMessage::ReplaceInt64(const char *name, int64 val)
 {
-	return FindBool(name, 0, aBoolean);
+	return ReplaceInt64(name, 0, val);
 }
 
 
 bool
-BMessage::FindBool(const char *name, int32 index, bool *aBoolean) const
+BMessage::ReplaceBool(const char *name, int32 index, bool aBoolean)
 {
-	const bool *value = NULL;
-	if (!FindData(name, B_BOOL_TYPE, index, (const void**)&value, NULL)) return false;
-	if (aBoolean) *aBoolean = *value;
-	return true;
+	if (!name) return false;
+	return ReplaceData(name, B_BOOL_TYPE, index, (const void*)&aBoolean, sizeof(bool), true);
 }
 
 
 bool
-BMessage::FindFloat(const char *name, float *f) const
+BMessage::ReplaceBool(const char *name, bool aBoolean)
 {
-	return FindFloat(name, 0, f);
+	return ReplaceBool(name, 0, aBoolean);
 }
 
 
 bool
-BMessage::FindFloat(const char *name, int32 index, float *f) const
+BMessage::ReplaceFloat(const char *name, int32 index, float f)
 {
-	const float *value = NULL;
-	if (!FindData(name, B_FLOAT_TYPE, index, (const void**)&value, NULL)) return false;
-	if (f) *f = *value;
-	return true;
+	if (!name) return false;
+	return ReplaceData(name, B_FLOAT_TYPE, index, (const void*)&f, sizeof(float), true);
 }
 
 
 bool
-BMessage::FindDouble(const char *name, double *d) const
+BMessage::ReplaceFloat(const char *name, float f)
 {
-	return FindDouble(name, 0, d);
+	return ReplaceFloat(name, 0, f);
 }
 
 
 bool
-BMessage::FindDouble(const char *name, int32 index, double *d) const
+BMessage::ReplaceDouble(const char *name, int32 index, double d)
 {
-	const double *value = NULL;
-	if (!FindData(name, B_DOUBLE_TYPE, index, (const void**)&value, NULL)) return false;
-	if (d) *d = *value;
-	return true;
+	if (!name) return false;
+	return ReplaceData(name, B_DOUBLE_TYPE, index, (const void*)&d, sizeof(double), true);
 }
 
 
 bool
-BMessage::FindPoint(const char *name, BPoint *pt) const
+BMessage::ReplaceDouble(const char *name, double d)
 {
-	return FindPoint(name, 0, pt);
+	return ReplaceDouble(name, 0, d);
 }
 
 
 bool
-BMessage::FindPoint(const char *name, int32 index, BPoint *pt) const
+BMessage::ReplacePoint(const char *name, int32 index, BPoint pt)
 {
+	if (!name) return false;
+
 	struct point_t {
 		float x;
 		float y;
-	};
+	} apt;
 
-	const struct point_t *apt = NULL;
+	apt.x = pt.x;
+	apt.y = pt.y;
 
-	if (!FindData(name, B_POINT_TYPE, index, (const void**)&apt, NULL)) return false;
-	if (pt) pt->Set(apt->x, apt->y);
-	return true;
+	return ReplaceData(name, B_POINT_TYPE, index, (const void*)&apt, sizeof(struct point_t), true);
 }
 
 
 bool
-BMessage::FindRect(const char *name, BRect *r) const
+BMessage::ReplacePoint(const char *name, BPoint pt)
 {
-	return FindRect(name, 0, r);
+	return ReplacePoint(name, 0, pt);
 }
 
 
 bool
-BMessage::FindRect(const char *name, int32 index, BRect *r) const
+BMessage::ReplaceRect(const char *name, int32 index, BRect r)
 {
+	if (!name) return false;
+
 	struct rect_t {
 		float left;
 		float top;
 		float right;
 		float bottom;
-	};
+	} ar;
 
-	const struct rect_t *ar = NULL;
+	ar.left = r.left;
+	ar.top = r.top;
+	ar.right = r.right;
+	ar.bottom = r.bottom;
 
-	if (!FindData(name, B_RECT_TYPE, index, (const void**)&ar, NULL)) return false;
-	if (r) r->Set(ar->left, ar->top, ar->right, ar->bottom);
-	return true;
+	return ReplaceData(name, B_RECT_TYPE, index, (const void*)&ar, sizeof(struct rect_t), true);
 }
 
 
 bool
-BMessage::FindPointer(const char *name, void **ptr) const
+BMessage::ReplaceRect(const char *name, BRect r)
 {
-	return FindPointer(name, 0, ptr);
+	return ReplaceRect(name, 0, r);
 }
 
 
 bool
-BMessage::FindPointer(const char *name, int32 index, void **ptr) const
+BMessage::ReplacePointer(const char *name, int32 index, const void *ptr)
 {
-	return FindData(name, B_POINTER_TYPE, index, (const void**)ptr, NULL);
+	if (!name || !ptr) return false;
+	return ReplaceData(name, B_POINTER_TYPE, index, ptr, 0, false);
 }
 
 
 bool
-BMessage::FindMessage(const char *name, BMessage *msg) const
+BMessage::ReplacePointer(const char *name, const void *ptr)
 {
-	return FindMessage(name, 0, msg);
+	return ReplacePointer(name, 0, ptr);
 }
 
 
 bool
-BMessage::FindMessage(const char *name, int32 index, BMessage *msg) const
+BMessage::ReplaceMessage(const char *name, int32 index, const BMessage *msg)
 {
-	const char *buffer = NULL;
-	if (!FindData(name, B_MESSAGE_TYPE, index, (const void**)&buffer, NULL)) return false;
+	if (!name || !msg) return false;
+
+	size_t flattenedSize = msg->FlattenedSize();
+	if (flattenedSize <= 0) return false;
 
+	char *buffer = (char*)malloc(flattenedSize);
 	if (!buffer) return false;
 
-	if (msg) {
-		size_t bufferSize = 0;
-		memcpy(&bufferSize, buffer, sizeof(size_t));
-		if (msg->Unflatten(buffer, bufferSize) == false) return false;
+	if (msg->Flatten(buffer, flattenedSize) == false) {
+		free(buffer);
+		return false;
 	}
 
-	return true;
+	bool retval = ReplaceData(name, B_MESSAGE_TYPE, index, buffer, flattenedSize, true);
+
+	free(buffer);
+
+	return retval;
 }
 
 
 bool
-BMessage::FindMessenger(const char *name, BMessenger *msgr) const
+BMessage::ReplaceMessage(const char *name, const BMessage *msg)
 {
-	return FindMessenger(name, 0, msgr);
+	return ReplaceMessage(name, 0, msg);
 }
 
 
 bool
-BMessage::FindMessenger(const char *name, int32 index, BMessenger *msgr) const
+BMessage::ReplaceMessenger(const char *name, int32 index, const BMessenger *msgr)
 {
-	const char *buffer = NULL;
-	if (!FindData(name, B_MESSENGER_TYPE, index, (const void**)&buffer, NULL)) return false;
+	if (!name || !msgr) return false;
 
+	size_t flattenedSize = msgr->FlattenedSize();
+	if (flattenedSize <= 0) return false;
+
+	char *buffer = (char*)malloc(flattenedSize + sizeof(size_t));
 	if (!buffer) return false;
 
-	if (msgr) {
-		size_t bufferSize = 0;
-		memcpy(&bufferSize, buffer, sizeof(size_t));
-		if (msgr->Unflatten(buffer + sizeof(size_t), bufferSize) == false) return false;
+	memcpy(buffer, &flattenedSize, sizeof(size_t));
+	if (msgr->Flatten(buffer + sizeof(size_t), flattenedSize) == false) {
+		free(buffer);
+		return false;
 	}
 
-	return true;
+	bool retval = ReplaceData(name, B_MESSENGER_TYPE, index, buffer, flattenedSize + sizeof(size_t), true);
+
+	free(buffer);
+
+	return retval;
 }
 
 
 bool
-BMessage::HasData(const char *name, type_code type, int32 index) const
+BMessage::ReplaceMessenger(const char *name, const BMessenger *msgr)
 {
-	return FindData(name, type, index, NULL, NULL);
+	return ReplaceMessenger(name, 0, msgr);
 }
 
 
 bool
-BMessage::HasString(const char *name, int32 index) const
+BMessage::ReplaceMessenger(const char *name, const BMessenger &msgr)
 {
-	return FindString(name, index, (const char**)NULL);
+	return ReplaceMessenger(name, 0, &msgr);
 }
 
 
 bool
-BMessage::HasInt8(const char *name, int32 index) const
+BMessage::ReplaceMessenger(const char *name, int32 index, const BMessenger &msgr)
 {
-	return FindInt8(name, index, NULL);
+	return ReplaceMessenger(name, index, &msgr);
 }
 
 
 bool
-BMessage::HasInt16(const char *name, int32 index) const
+BMessage::AddData(const BMessageAtom &atom, type_code type, const void *data, size_t numBytes, bool is_fixed_size)
 {
-	return FindInt16(name, index, NULL);
+	const _e_message_atom_t *entry = e_message_atom_at(atom.fId);
+	if (!entry) return false;
+	if (!data && (!is_fixed_size || numBytes != 0)) return false;
+
+	_Unshare(true);
+	fFlattenedCurrent = false;
+
+	_field_t *field = _FindField(atom);
+	if (field) {
+		// one type for a name
+		if (field->type != type) return false;
+		return _AddItem(field, data, numBytes, is_fixed_size);
+	}
+
+	if ((field = _AddField(entry->name, entry->nameLength, entry->hash, atom.fId, type)) == NULL) return false;
+	if (_AddItem(field, data, numBytes, is_fixed_size)) return true;
+
+	_RemoveField(fFieldsCount - 1);
+	return false;
 }
 
 
 bool
-BMessage::HasInt32(const char *name, int32 index) const
+BMessage::FindData(const BMessageAtom &atom, type_code type, const void **data, ssize_t *numBytes) const
 {
-	return FindInt32(name, index, NULL);
+	return FindData(atom, type, 0, data, numBytes);
 }
 
 
 bool
-BMessage::HasInt64(const char *name, int32 index) const
+BMessage::FindData(const BMessageAtom &atom, type_code type, int32 index, const void **data, ssize_t *numBytes) const
 {
-	return FindInt64(name, index, NULL);
+	_field_t *field = _FindField(atom);
+	if (!field || field->type != type || index < 0 || index >= field->count) return false;
+
+	const _item_t *Object = FIELD_ITEMS(field) + index;
+
+	if (data) *data = Object->data;
+	if (numBytes) {
+		if (Object->fixed_size)
+			*numBytes = (ssize_t)Object->bytes;
+		else
+			*numBytes = -1;
+	}
+
+	return true;
 }
 
 
 bool
-BMessage::HasBool(const char *name, int32 index) const
+BMessage::ReplaceData(const BMessageAtom &atom, type_code type, int32 index, const void *data, size_t numBytes, bool is_fixed_size)
 {
-	return FindBool(name, index, NULL);
+	if (!data && (!is_fixed_size || numBytes != 0)) return false;
+
+	_field_t *field = _FindField(atom);
+	if (!field || field->type != type || index < 0 || index >= field->count) return false;
+
+	fFlattenedCurrent = false;
+
+	if (fShared != NULL) {
+		_Unshare(true);
+		if ((field = _FindField(atom)) == NULL) return false;
+	}
+
+	_item_t *Object = FIELD_ITEMS(field) + index;
+
+	// the same slot serves the new value when both are small
+	if (is_fixed_size && Object->fixed_size && numBytes > 0 &&
+	    numBytes <= E_MESSAGE_SMALL_VALUE && Object->bytes > 0 && Object->bytes <= E_MESSAGE_SMALL_VALUE) {
+		memcpy(Object->data, data, numBytes);
+		Object->bytes = numBytes;
+		return true;
+	}
+
+	_item_t newObject;
+	if (_SetItem(&newObject, data, numBytes, is_fixed_size) == false) return false;
+
+	_FreeItem(Object);
+	*Object = newObject;
+
+	return true;
 }
 
 
 bool
-BMessage::HasFloat(const char *name, int32 index) const
+BMessage::ReplaceData(const BMessageAtom &atom, type_code type, const void *data, size_t numBytes, bool is_fixed_size)
 {
-	return FindFloat(name, index, NULL);
+	return ReplaceData(atom, type, 0, data, numBytes, is_fixed_size);
 }
 
 
 bool
-BMessage::HasDouble(const char *name, int32 index) const
+BMessage::AddString(const BMessageAtom &atom, const char *aString)
 {
-	return FindDouble(name, index, NULL);
+	if (!aString) return false;
+	return AddData(atom, B_STRING_TYPE, (const void*)aString, (size_t)(strlen(aString) + 1), true);
 }
 
 
 bool
-BMessage::HasPoint(const char *name, int32 index) const
+BMessage::AddInt8(const BMessageAtom &atom, int8 val)
 {
-	return FindPoint(name, index, NULL);
+	return AddData(atom, B_INT8_TYPE, (const void*)&val, sizeof(int8), true);
 }
 
 
 bool
-BMessage::HasRect(const char *name, int32 index) const
+BMessage::AddInt16(const BMessageAtom &atom, int16 val)
 {
-	return FindRect(name, index, NULL);
+	return AddData(atom, B_INT16_TYPE, (const void*)&val, sizeof(int16), true);
 }
 
 
 bool
-BMessage::HasPointer(const char *name, int32 index) const
+BMessage::AddInt32(const BMessageAtom &atom, int32 val)
 {
-	return FindPointer(name, index, NULL);
+	return AddData(atom, B_INT32_TYPE, (const void*)&val, sizeof(int32), true);
 }
 
 
 bool
-BMessage::HasMessage(const char *name, int32 index) const
+BMessage::AddInt64(const BMessageAtom &atom, int64 val)
 {
-	return FindMessage(name, index, NULL);
+	return AddData(atom, B_INT64_TYPE, (const void*)&val, sizeof(int64), true);
 }
 
 
 bool
-BMessage::HasMessenger(const char *name, int32 index) const
+BMessage::AddBool(const BMessageAtom &atom, bool aBoolean)
 {
-	return FindMessenger(name, index, NULL);
+	return AddData(atom, B_BOOL_TYPE, (const void*)&aBoolean, sizeof(bool), true);
 }
 
 
 bool
-BMessage::RemoveData(const char *name, type_code type, int32 index)
+BMessage::AddFloat(const BMessageAtom &atom, float aFloat)
 {
-	if (!name) return false;
-
-	list_data *ldata = _find_list(&fObjectsList, name);
-	if (!ldata) return false;
+	return AddData(atom, B_FLOAT_TYPE, (const void*)&aFloat, sizeof(float), true);
+}
 
-	type_list_data *tldata = _find_type_list(&(ldata->list), type);
-	if (!tldata) return false;
 
-	_object_t *Object = (_object_t*)tldata->list.RemoveItem(index);
-	if (!Object) return false;
+bool
+BMessage::AddDouble(const BMessageAtom &atom, double aDouble)
+{
+	return AddData(atom, B_DOUBLE_TYPE, (const void*)&aDouble, sizeof(double), true);
+}
 
-	if (Object->fixed_size && Object->data) free(Object->data);
-	delete Object;
 
-	if (tldata->list.IsEmpty()) {
-		ldata->list.RemoveItem(tldata);
-		delete tldata;
-	}
+bool
+BMessage::AddPoint(const BMessageAtom &atom, BPoint pt)
+{
+	struct point_t {
+		float x;
+		float y;
+	} apt;
 
-	if (ldata->list.IsEmpty()) {
-		fObjectsList.RemoveItem(ldata);
-		delete[] ldata->name;
-		delete ldata;
-	}
+	apt.x = pt.x;
+	apt.y = pt.y;
 
-	return true;
+	return AddData(atom, B_POINT_TYPE, (const void*)&apt, sizeof(struct point_t), true);
 }
 
 
 bool
-BMessage::RemoveData(const char *name, type_code type)
+BMessage::AddRect(const BMessageAtom &atom, BRect r)
 {
-	if (!name) return false;
-
-	list_data *ldata = _find_list(&fObjectsList, name);
-	if (!ldata) return false;
-
-	type_list_data *tldata = _find_type_list(&(ldata->list), type);
-	if (!tldata) return false;
-
-	for (int32 i = 0; i < tldata->list.CountItems(); i++) {
-		_object_t *Object = (_object_t*)tldata->list.ItemAt(i);
-		if (!Object) continue;
+	struct rect_t {
+		float left;
+		float top;
+		float right;
+		float bottom;
+	} ar;
 
-		if (Object->fixed_size && Object->data) free(Object->data);
-		delete Object;
-	}
+	ar.left = r.left;
+	ar.top = r.top;
+	ar.right = r.right;
+	ar.bottom = r.bottom;
 
-	ldata->list.RemoveItem(tldata);
-	delete tldata;
+	return AddData(atom, B_RECT_TYPE, (const void*)&ar, sizeof(struct rect_t), true);
+}
 
-	if (ldata->list.IsEmpty()) {
-		fObjectsList.RemoveItem(ldata);
-		delete[] ldata->name;
-		delete ldata;
-	}
 
-	return true;
+bool
+BMessage::AddPointer(const BMessageAtom &atom, const void *ptr)
+{
+	if (!ptr) return false;
+	return AddData(atom, B_POINTER_TYPE, ptr, 0, false);
 }
 
 
 bool
-BMessage::RemoveData(const char *name)
+BMessage::FindString(const BMessageAtom &atom, const char **str) const
 {
-	if (!name) return false;
-
-	list_data *ldata = _find_list(&fObjectsList, name);
-	if (!ldata) return false;
+	return FindString(atom, 0, str);
+}
 
-	for (int32 j = 0; j < ldata->list.CountItems(); j++) {
-		type_list_data *tldata = (type_list_data*)ldata->list.ItemAt(j);
-		if (!tldata) continue;
 
-		for (int32 i = 0; i < tldata->list.CountItems(); i++) {
-			_object_t *Object = (_object_t*)tldata->list.ItemAt(i);
-			if (!Object) continue;
+bool
+BMessage::FindString(const BMessageAtom &atom, int32 index, const char **str) const
+{
+	return FindData(atom, B_STRING_TYPE, index, (const void**)str, NULL);
+}
 
-			if (Object->fixed_size && Object->data) free(Object->data);
-			delete Object;
-		}
 
-		delete tldata;
-	}
+bool
+BMessage::FindInt8(const BMessageAtom &atom, int8 *val) const
+{
+	return FindInt8(atom, 0, val);
+}
 
-	fObjectsList.RemoveItem(ldata);
-	delete[] ldata->name;
-	delete ldata;
 
+bool
+BMessage::FindInt8(const BMessageAtom &atom, int32 index, int8 *val) const
+{
+	const int8 *value = NULL;
+	if (!FindData(atom, B_INT8_TYPE, index, (const void**)&value, NULL)) return false;
+	if (val) *val = *value;
 	return true;
 }
 
 
-
 bool
-BMessage::RemoveString(const char *name, int32 index)
+BMessage::FindInt16(const BMessageAtom &atom, int16 *val) const
 {
-	return RemoveData(name, B_STRING_TYPE, index);
+	return FindInt16(atom, 0, val);
 }
 
 
 bool
-BMessage::RemoveInt8(const char *name, int32 index)
+BMessage::FindInt16(const BMessageAtom &atom, int32 index, int16 *val) const
 {
-	return RemoveData(name, B_INT8_TYPE, index);
+	const int16 *value = NULL;
+	if (!FindData(atom, B_INT16_TYPE, index, (const void**)&value, NULL)) return false;
+	if (val) *val = *value;
+	return true;
 }
 
 
 bool
-BMessage::RemoveInt16(const char *name, int32 index)
+BMessage::FindInt32(const BMessageAtom &atom, int32 *val) const
 {
-	return RemoveData(name, B_INT16_TYPE, index);
+	return FindInt32(atom, 0, val);
 }
 
 
 bool
-BMessage::RemoveInt32(const char *name, int32 index)
+BMessage::FindInt32(const BMessageAtom &atom, int32 index, int32 *val) const
 {
-	return RemoveData(name, B_INT32_TYPE, index);
+	const int32 *value = NULL;
+	if (!FindData(atom, B_INT32_TYPE, index, (const void**)&value, NULL)) return false;
+	if (val) *val = *value;
+	return true;
 }
 
 
 bool
-BMessage::RemoveInt64(const char *name, int32 index)
+BMessage::FindInt64(const BMessageAtom &atom, int64 *val) const
 {
-	return RemoveData(name, B_INT64_TYPE, index);
+	return FindInt64(atom, 0, val);
 }
 
 
 bool
-BMessage::RemoveBool(const char *name, int32 index)
+BMessage::FindInt64(const BMessageAtom &atom, int32 index, int64 *val) const
 {
-	return RemoveData(name, B_BOOL_TYPE, index);
+	const int64 *value = NULL;
+	if (!FindData(atom, B_INT64_TYPE, index, (const void**)&value, NULL)) return false;
+	if (val) *val = *value;
+	return true;
 }
 
 
 bool
-BMessage::RemoveFloat(const char *name, int32 index)
+BMessage::FindBool(const BMessageAtom &atom, bool *aBoolean) const
 {
-	return RemoveData(name, B_FLOAT_TYPE, index);
+	return FindBool(atom, 0, aBoolean);
 }
 
 
 bool
-BMessage::RemoveDouble(const char *name, int32 index)
+BMessage::FindBool(const BMessageAtom &atom, int32 index, bool *aBoolean) const
 {
-	return RemoveData(name, B_DOUBLE_TYPE, index);
+	const bool *value = NULL;
+	if (!FindData(atom, B_BOOL_TYPE, index, (const void**)&value, NULL)) return false;
+	if (aBoolean) *aBoolean = *value;
+	return true;
 }
 
 
 bool
-BMessage::RemovePoint(const char *name, int32 index)
+BMessage::FindFloat(const BMessageAtom &atom, float *f) const
 {
-	return RemoveData(name, B_POINT_TYPE, index);
+	return FindFloat(atom, 0, f);
 }
 
 
 bool
-BMessage::RemoveRect(const char *name, int32 index)
+BMessage::FindFloat(const BMessageAtom &atom, int32 index, float *f) const
 {
-	return RemoveData(name, B_RECT_TYPE, index);
+	const float *value = NULL;
+	if (!FindData(atom, B_FLOAT_TYPE, index, (const void**)&value, NULL)) return false;
+	if (f) *f = *value;
+	return true;
 }
 
 
 bool
-BMessage::RemovePointer(const char *name, int32 index)
+BMessage::FindDouble(const BMessageAtom &atom, double *d) const
 {
-	return RemoveData(name, B_POINTER_TYPE, index);
+	return FindDouble(atom, 0, d);
 }
 
 
 bool
-BMessage::RemoveMessage(const char *name, int32 index)
+BMessage::FindDouble(const BMessageAtom &atom, int32 index, double *d) const
 {
-	return RemoveData(name, B_MESSAGE_TYPE, index);
+	const double *value = NULL;
+	if (!FindData(atom, B_DOUBLE_TYPE, index, (const void**)&value, NULL)) return false;
+	if (d) *d = *value;
+	return true;
 }
 
 
 bool
-BMessage::RemoveMessenger(const char *name, int32 index)
+BMessage::FindPoint(const BMessageAtom &atom, BPoint *pt) const
 {
-	return RemoveData(name, B_MESSENGER_TYPE, index);
+	return FindPoint(atom, 0, pt);
 }
 
 
 bool
-BMessage::ReplaceData(const char *name, type_code type, int32 index, const void *data, size_t numBytes, bool is_fixed_size)
+BMessage::FindPoint(const BMessageAtom &atom, int32 index, BPoint *pt) const
 {
-	if (!name) return false;
-	if (!data && (!is_fixed_size || numBytes != 0)) return false;
-
-	list_data *ldata = _find_list(&fObjectsList, name);
-	if (!ldata) return false;
-
-	type_list_data *tldata = _find_type_list(&(ldata->list), type);
-	if (!tldata) return false;
-
-	_object_t *Object = new _object_t;
-	if (!Object) return false;
-
-	Object->bytes = is_fixed_size ? numBytes : sizeof(void*);
-	Object->fixed_size = is_fixed_size;
-	Object->data = NULL;
-	if (is_fixed_size && numBytes > 0) {
-		if ((Object->data = malloc(numBytes + 1)) == NULL) {
-			delete Object;
-			return false;
-		}
-
-		bzero(Object->data, numBytes);
-
-		if (memcpy(Object->data, data, numBytes) == NULL) {
-			free(Object->data);
-			delete Object;
-			return false;
-		}
-	} else {
-		Object->data = (void*)data;
-	}
-
-	_object_t *oldObject = NULL;
-	if (tldata->list.ReplaceItem(index, (void*)Object, (void**)&oldObject) == false) {
-		if (Object->fixed_size && Object->data) free(Object->data);
-		delete Object;
-		return false;
-	}
+	struct point_t {
+		float x;
+		float y;
+	};
 
-	if (oldObject) {
-		if (oldObject->fixed_size && oldObject->data) free(oldObject->data);
-		delete oldObject;
-	}
+	const struct point_t *apt = NULL;
 
+	if (!FindData(atom, B_POINT_TYPE, index, (const void**)&apt, NULL)) return false;
+	if (pt) pt->Set(apt->x, apt->y);
 	return true;
 }
 
 
 bool
-BMessage::ReplaceData(const char *name, type_code type, const void *data, size_t numBytes, bool is_fixed_size)
+BMessage::FindRect(const BMessageAtom &atom, BRect *r) const
 {
-	return ReplaceData(name, type, 0, data, numBytes, is_fixed_size);
+	return FindRect(atom, 0, r);
 }
 
 
 bool
-BMessage::ReplaceString(const char *name, int32 index, const char *aString)
+BMessage::FindRect(const BMessageAtom &atom, int32 index, BRect *r) const
 {
-	if (!name || !aString) return false;
-	return ReplaceData(name, B_STRING_TYPE, index, (const void*)aString, (size_t)(strlen(aString) + 1), true);
+	struct rect_t {
+		float left;
+		float top;
+		float right;
+		float bottom;
+	};
+
+	const struct rect_t *ar = NULL;
+
+	if (!FindData(atom, B_RECT_TYPE, index, (const void**)&ar, NULL)) return false;
+	if (r) r->Set(ar->left, ar->top, ar->right, ar->bottom);
+	return true;
 }
 
 
 bool
-BMessage::ReplaceString(const char *name, const char *aString)
+BMessage::FindPointer(const BMessageAtom &atom, void **ptr) const
 {
-	return ReplaceString(name, 0, aString);
+	return FindPointer(atom, 0, ptr);
 }
 
 
 bool
-BMessage::ReplaceString(const char *name, int32 index, const BString &aString)
+BMessage::FindPointer(const BMessageAtom &atom, int32 index, void **ptr) const
 {
-	return ReplaceString(name, index, aString.String());
+	return FindData(atom, B_POINTER_TYPE, index, (const void**)ptr, NULL);
 }
 
 
 bool
-BMessage::ReplaceString(const char *name, const BString &aString)
+BMessage::ReplaceString(const BMessageAtom &atom, int32 index, const char *aString)
 {
-	return ReplaceString(name, 0, aString);
+	if (!aString) return false;
+	return ReplaceData(atom, B_STRING_TYPE, index, (const void*)aString, (size_t)(strlen(aString) + 1), true);
 }
 
 
 bool
-BMessage::ReplaceInt8(const char *name, int32 index, int8 val)
+BMessage::ReplaceString(const BMessageAtom &atom, const char *aString)
 {
-	if (!name) return false;
-	return ReplaceData(name, B_INT8_TYPE, index, (const void*)&val, sizeof(int8), true);
+	return ReplaceString(atom, 0, aString);
 }
 
 
 bool
-BMessage::ReplaceInt8(const char *name, int8 val)
+BMessage::ReplaceInt8(const BMessageAtom &atom, int32 index, int8 val)
 {
-	return ReplaceInt8(name, 0, val);
+	return ReplaceData(atom, B_INT8_TYPE, index, (const void*)&val, sizeof(int8), true);
 }
 
 
 bool
-BMessage::ReplaceInt16(const char *name, int32 index, int16 val)
+BMessage::ReplaceInt8(const BMessageAtom &atom, int8 val)
 {
-	if (!name) return false;
-	return ReplaceData(name, B_INT16_TYPE, index, (const void*)&val, sizeof(int16), true);
+	return ReplaceInt8(atom, 0, val);
 }
 
 
 bool
-BMessage::ReplaceInt16(const char *name, int16 val)
+BMessage::ReplaceInt16(const BMessageAtom &atom, int32 index, int16 val)
 {
-	return ReplaceInt16(name, 0, val);
+	return ReplaceData(atom, B_INT16_TYPE, index, (const void*)&val, sizeof(int16), true);
 }
 
 
 bool
-BMessage::ReplaceInt32(const char *name, int32 index, int32 val)
+BMessage::ReplaceInt16(const BMessageAtom &atom, int16 val)
 {
-	if (!name) return false;
-	return ReplaceData(name, B_INT32_TYPE, index, (const void*)&val, sizeof(int32), true);
+	return ReplaceInt16(atom, 0, val);
 }
 
 
 bool
-BMessage::ReplaceInt32(const char *name, int32 val)
+BMessage::ReplaceInt32(const BMessageAtom &atom, int32 index, int32 val)
 {
-	return ReplaceInt32(name, 0, val);
+	return ReplaceData(atom, B_INT32_TYPE, index, (const void*)&val, sizeof(int32), true);
 }
 
 
 bool
-BMessage::ReplaceInt64(const char *name, int32 index, int64 val)
+BMessage::ReplaceInt32(const BMessageAtom &atom, int32 val)
 {
-	if (!name) return false;
-	return ReplaceData(name, B_INT64_TYPE, index, (const void*)&val, sizeof(int64), true);
+	return ReplaceInt32(atom, 0, val);
 }
 
 
 bool
-BMessage::ReplaceInt64(const char *name, int64 val)
+BMessage::ReplaceInt64(const BMessageAtom &atom, int32 index, int64 val)
 {
-	return ReplaceInt64(name, 0, val);
+	return ReplaceData(atom, B_INT64_TYPE, index, (const void*)&val, sizeof(int64), true);
 }
 
 
 bool
-BMessage::ReplaceBool(const char *name, int32 index, bool aBoolean)
+BMessage::ReplaceInt64(const BMessageAtom &atom, int64 val)
 {
-	if (!name) return false;
-	return ReplaceData(name, B_BOOL_TYPE, index, (const void*)&aBoolean, sizeof(bool), true);
+	return ReplaceInt64(atom, 0, val);
 }
 
 
 bool
-BMessage::ReplaceBool(const char *name, bool aBoolean)
+BMessage::ReplaceBool(const BMessageAtom &atom, int32 index, bool aBoolean)
 {
-	return ReplaceBool(name, 0, aBoolean);
+	return ReplaceData(atom, B_BOOL_TYPE, index, (const void*)&aBoolean, sizeof(bool), true);
 }
 
 
 bool
-BMessage::ReplaceFloat(const char *name, int32 index, float f)
+BMessage::ReplaceBool(const BMessageAtom &atom, bool aBoolean)
 {
-	if (!name) return false;
-	return ReplaceData(name, B_FLOAT_TYPE, index, (const void*)&f, sizeof(float), true);
+	return ReplaceBool(atom, 0, aBoolean);
 }
 
 
 bool
-BMessage::ReplaceFloat(const char *name, float f)
+BMessage::ReplaceFloat(const BMessageAtom &atom, int32 index, float f)
 {
-	return ReplaceFloat(name, 0, f);
+	return ReplaceData(atom, B_FLOAT_TYPE, index, (const void*)&f, sizeof(float), true);
 }
 
 
 bool
-BMessage::ReplaceDouble(const char *name, int32 index, double d)
+BMessage::ReplaceFloat(const BMessageAtom &atom, float f)
 {
-	if (!name) return false;
-	return ReplaceData(name, B_DOUBLE_TYPE, index, (const void*)&d, sizeof(double), true);
+	return ReplaceFloat(atom, 0, f);
 }
 
 
 bool
-BMessage::ReplaceDouble(const char *name, double d)
+BMessage::ReplaceDouble(const BMessageAtom &atom, int32 index, double d)
 {
-	return ReplaceDouble(name, 0, d);
+	return ReplaceData(atom, B_DOUBLE_TYPE, index, (const void*)&d, sizeof(double), true);
 }
 
 
 bool
-BMessage::ReplacePoint(const char *name, int32 index, BPoint pt)
+BMessage::ReplaceDouble(const BMessageAtom &atom, double d)
 {
-	if (!name) return false;
+	return ReplaceDouble(atom, 0, d);
+}
+
 
+bool
+BMessage::ReplacePoint(const BMessageAtom &atom, int32 index, BPoint pt)
+{
 	struct point_t {
 		float x;
 		float y;
@@ -1876,22 +3273,20 @@ BMessage::ReplacePoint(const char *name, int32 index, BPoint pt)
 	apt.x = pt.x;
 	apt.y = pt.y;
 
-	return ReplaceData(name, B_POINT_TYPE, index, (const void*)&apt, sizeof(struct point_t), true);
+	return ReplaceData(atom, B_POINT_TYPE, index, (const void*)&apt, sizeof(struct point_t), true);
 }
 
 
 bool
-BMessage::ReplacePoint(const char *name, BPoint pt)
+BMessage::ReplacePoint(const BMessageAtom &atom, BPoint pt)
 {
-	return ReplacePoint(name, 0, pt);
+	return ReplacePoint(atom, 0, pt);
 }
 
 
 bool
-BMessage::ReplaceRect(const char *name, int32 index, BRect r)
+BMessage::ReplaceRect(const BMessageAtom &atom, int32 index, BRect r)
 {
-	if (!name) return false;
-
 	struct rect_t {
 		float left;
 		float top;
@@ -1904,131 +3299,82 @@ BMessage::ReplaceRect(const char *name, int32 index, BRect r)
 	ar.right = r.right;
 	ar.bottom = r.bottom;
 
-	return ReplaceData(name, B_RECT_TYPE, index, (const void*)&ar, sizeof(struct rect_t), true);
+	return ReplaceData(atom, B_RECT_TYPE, index, (const void*)&ar, sizeof(struct rect_t), true);
 }
 
 
 bool
-BMessage::ReplaceRect(const char *name, BRect r)
+BMessage::ReplaceRect(const BMessageAtom &atom, BRect r)
 {
-	return ReplaceRect(name, 0, r);
+	return ReplaceRect(atom, 0, r);
 }
 
 
 bool
-BMessage::ReplacePointer(const char *name, int32 index, const void *ptr)
+BMessage::ReplacePointer(const BMessageAtom &atom, int32 index, const void *ptr)
 {
-	if (!name || !ptr) return false;
-	return ReplaceData(name, B_POINTER_TYPE, index, ptr, 0, false);
+	if (!ptr) return false;
+	return ReplaceData(atom, B_POINTER_TYPE, index, ptr, 0, false);
 }
 
 
 bool
-BMessage::ReplacePointer(const char *name, const void *ptr)
+BMessage::ReplacePointer(const BMessageAtom &atom, const void *ptr)
 {
-	return ReplacePointer(name, 0, ptr);
+	return ReplacePointer(atom, 0, ptr);
 }
 
 
 bool
-BMessage::ReplaceMessage(const char *name, int32 index, const BMessage *msg)
+BMessage::WasDelivered() const
 {
-	if (!name || !msg) return false;
-
-	size_t flattenedSize = msg->FlattenedSize();
-	if (flattenedSize <= 0) return false;
-
-	char *buffer = (char*)malloc(flattenedSize);
-	if (!buffer) return false;
-
-	if (msg->Flatten(buffer, flattenedSize) == false) {
-		free(buffer);
-		return false;
-	}
-
-	bool retval = ReplaceData(name, B_MESSAGE_TYPE, index, buffer, flattenedSize, true);
-
-	free(buffer);
-
-	return retval;
+	return(fReplyToken != B_MAXUINT64 || fSource != NULL);
 }
 
 
 bool
-BMessage::ReplaceMessage(const char *name, const BMessage *msg)
+BMessage::IsReply() const
 {
-	return ReplaceMessage(name, 0, msg);
+	return fIsReply;
 }
 
 
-bool
-BMessage::ReplaceMessenger(const char *name, int32 index, const BMessenger *msgr)
+void
+BMessage::_ReleaseSource(bool notice)
 {
-	if (!name || !msgr) return false;
-
-	size_t flattenedSize = msgr->FlattenedSize();
-	if (flattenedSize <= 0) return false;
-
-	char *buffer = (char*)malloc(flattenedSize + sizeof(size_t));
-	if (!buffer) return false;
-
-	memcpy(buffer, &flattenedSize, sizeof(size_t));
-	if (msgr->Flatten(buffer + sizeof(size_t), flattenedSize) == false) {
-		free(buffer);
-		return false;
+	if (fSource != NULL) {
+		// the waiting thread gets B_NO_REPLY at once
+		if (fNoticeSource && notice) BMessenger::_SendMessageToPort(fSource, NULL, fSourceRequest, B_TIMEOUT, B_INT64_CONSTANT(0));
+		delete_port(fSource);
+		fSource = NULL;
 	}
 
-	bool retval = ReplaceData(name, B_MESSENGER_TYPE, index, buffer, flattenedSize + sizeof(size_t), true);
-
-	free(buffer);
-
-	return retval;
-}
-
-
-bool
-BMessage::ReplaceMessenger(const char *name, const BMessenger *msgr)
-{
-	return ReplaceMessenger(name, 0, msgr);
-}
-
-
-bool
-BMessage::ReplaceMessenger(const char *name, const BMessenger &msgr)
-{
-	return ReplaceMessenger(name, 0, &msgr);
-}
-
-
-bool
-BMessage::ReplaceMessenger(const char *name, int32 index, const BMessenger &msgr)
-{
-	return ReplaceMessenger(name, index, &msgr);
+	fNoticeSource = false;
 }
 
 
 bool
-BMessage::WasDelivered() const
+BMessage::IsSourceWaiting() const
 {
-	return(fReplyToken != B_MAXUINT64 || fSource != NULL);
+	if (fSource == NULL) return false;
+	void *tmpPort = open_port_by_source(fSource);
+	if (tmpPort == NULL) return false;
+	delete_port(tmpPort);
+	return true;
 }
 
 
-bool
-BMessage::IsReply() const
+void
+BMessage::SetLane(e_message_lane lane)
 {
-	return fIsReply;
+	fLane = ((int32)lane < 0 || (int32)lane >= B_MESSAGE_LANES ? (int32)B_DEFAULT_LANE : (int32)lane);
 }
 
 
-bool
-BMessage::IsSourceWaiting() const
+e_message_lane
+BMessage::Lane() const
 {
-	if (fSource == NULL) return false;
-	void *tmpPort = open_port_by_source(fSource);
-	if (tmpPort == NULL) return false;
-	delete_port(tmpPort);
-	return true;
+	return (e_message_lane)fLane;
 }
 
 
@@ -2062,15 +3408,15 @@ BMessage::SendReply(const BMessage *message, BHandler *replyHandler, bigtime_t s
 			msg.fTargetTokenTimestamp = B_MAXINT64;
 			msg.fReplyToken = replyToken;
 			msg.fReplyTokenTimestamp = replyTokenTimeStamp;
-			if (msg.fSource != NULL) {
-				delete_port(msg.fSource);
-				msg.fSource = NULL;
-			}
+			msg._ReleaseSource(false);
 
-			retVal = (port_count(fSource) > 0 ?
-			          B_DUPLICATE_REPLY : BMessenger::_SendMessageToPort(fSource, message, B_TIMEOUT, sendTimeout));
+			// the port stays with the thread waiting on it, one reply only
+			retVal = BMessenger::_SendMessageToPort(fSource, &msg, fSourceRequest, B_TIMEOUT, sendTimeout);
+			if (retVal == B_OK) const_cast<BMessage*>(this)->_ReleaseSource(false);
+		} else if (fSourceRequest != 0) {
+			retVal = B_DUPLICATE_REPLY;
 		} else {
-			BMessenger msgr(fTeam, fReplyToken, fReplyTokenTimestamp, &retVal);
+			BMessenger msgr(fReplyTeam, fReplyToken, fReplyTokenTimestamp, &retVal);
 			if (retVal == B_OK) {
 				BMessage msg(*message);
 
@@ -43,18 +43,59 @@
 class BMessenger;
 class BHandler;
 
+// BMessageAtom: a field name interned once for the whole process, fields added or found through it
+// skip hashing and comparing the name. The atoms stay until the process exits, up to 65536 of them.
+// 	static const BMessageAtom atomWhere("where");
+// 	msg->FindPoint(atomWhere, &where);
+class BMessageAtom
+{
+	public:
+		BMessageAtom();
+		explicit BMessageAtom(const char *name);
+
+		bool		IsValid() const;
+		const char	*Name() const;
+
+		bool		operator==(const BMessageAtom &atom) const;
+		bool		operator!=(const BMessageAtom &atom) const;
+
+	private:
+		friend class BMessage;
+
+		uint32 fId;
+};
+
+
+// the lanes of the looper queue in the order they get dispatched
+typedef enum e_message_lane {
+	B_DEFAULT_LANE = -1, // the lane set for the message code
+	B_URGENT_LANE = 0,
+	B_INPUT_LANE,
+	B_NORMAL_LANE,
+	B_BACKGROUND_LANE
+} e_message_lane;
+
+#define B_MESSAGE_LANES		4
+
+
 class BMessage
 {
 	public:
 		BMessage();
 		BMessage(uint32 what);
-		BMessage(const BMessage &msg);
+		BMessage(const BMessage &msg); // shares the fields until one of the messages changes
 		virtual ~BMessage();
 
 		uint32		what;
 
 		BMessage	&operator=(const BMessage &msg);
 
+#ifndef ETK_BUILD_WITH_MEMORY_TRACING
+		// instances and their storage are recycled by per-thread pools
+		static void	*operator new(size_t size);
+		static void	operator delete(void *ptr, size_t size);
+#endif
+
 		int32		CountTypesByName(const char *name) const;
 		int32		CountTypesByName(int32 nameIndex) const;
 		bool		TypeAt(const char *name, int32 typeIndex, type_code *type) const;
@@ -210,16 +251,95 @@ class BMessage
 		bool		ReplaceData(const char *name, type_code type, const void *data, size_t numBytes, bool is_fixed_size);
 		bool		ReplaceData(const char *name, type_code type, int32 index, const void *data, size_t numBytes, bool is_fixed_size);
 
+		// the same with atoms, see BMessageAtom
+		bool		AddString(const BMessageAtom &atom, const char *aString);
+		bool		AddInt8(const BMessageAtom &atom, int8 val);
+		bool		AddInt16(const BMessageAtom &atom, int16 val);
+		bool		AddInt32(const BMessageAtom &atom, int32 val);
+		bool		AddInt64(const BMessageAtom &atom, int64 val);
+		bool		AddBool(const BMessageAtom &atom, bool aBoolean);
+		bool		AddFloat(const BMessageAtom &atom, float aFloat);
+		bool		AddDouble(const BMessageAtom &atom, double aDouble);
+		bool		AddPoint(const BMessageAtom &atom, BPoint pt);
+		bool		AddRect(const BMessageAtom &atom, BRect r);
+		bool		AddPointer(const BMessageAtom &atom, const void *ptr);
+		bool		AddData(const BMessageAtom &atom, type_code type, const void *data, size_t numBytes, bool is_fixed_size = true);
+
+		bool		FindString(const BMessageAtom &atom, const char **str) const;
+		bool		FindString(const BMessageAtom &atom, int32 index, const char **str) const;
+		bool		FindInt8(const BMessageAtom &atom, int8 *val) const;
+		bool		FindInt8(const BMessageAtom &atom, int32 index, int8 *val) const;
+		bool		FindInt16(const BMessageAtom &atom, int16 *val) const;
+		bool		FindInt16(const BMessageAtom &atom, int32 index, int16 *val) const;
+		bool		FindInt32(const BMessageAtom &atom, int32 *val) const;
+		bool		FindInt32(const BMessageAtom &atom, int32 index, int32 *val) const;
+		bool		FindInt64(const BMessageAtom &atom, int64 *val) const;
+		bool		FindInt64(const BMessageAtom &atom, int32 index, int64 *val) const;
+		bool		FindBool(const BMessageAtom &atom, bool *aBoolean) const;
+		bool		FindBool(const BMessageAtom &atom, int32 index, bool *aBoolean) const;
+		bool		FindFloat(const BMessageAtom &atom, float *f) const;
+		bool		FindFloat(const BMessageAtom &atom, int32 index, float *f) const;
+		bool		FindDouble(const BMessageAtom &atom, double *d) const;
+		bool		FindDouble(const BMessageAtom &atom, int32 index, double *d) const;
+		bool		FindPoint(const BMessageAtom &atom, BPoint *pt) const;
+		bool		FindPoint(const BMessageAtom &atom, int32 index, BPoint *pt) const;
+		bool		FindRect(const BMessageAtom &atom, BRect *r) const;
+		bool		FindRect(const BMessageAtom &atom, int32 index, BRect *r) const;
+		bool		FindPointer(const BMessageAtom &atom, void **ptr) const;
+		bool		FindPointer(const BMessageAtom &atom, int32 index, void **ptr) const;
+		bool		FindData(const BMessageAtom &atom, type_code type, const void **data, ssize_t *numBytes) const;
+		bool		FindData(const BMessageAtom &atom, type_code type, int32 index, const void **data, ssize_t *numBytes) const;
+
+		bool		ReplaceString(const BMessageAtom &atom, const char *aString);
+		bool		ReplaceString(const BMessageAtom &atom, int32 index, const char *aString);
+		bool		ReplaceInt8(const BMessageAtom &atom, int8 val);
+		bool		ReplaceInt8(const BMessageAtom &atom, int32 index, int8 val);
+		bool		ReplaceInt16(const BMessageAtom &atom, int16 val);
+		bool		ReplaceInt16(const BMessageAtom &atom, int32 index, int16 val);
+		bool		ReplaceInt32(const BMessageAtom &atom, int32 val);
+		bool		ReplaceInt32(const BMessageAtom &atom, int32 index, int32 val);
+		bool		ReplaceInt64(const BMessageAtom &atom, int64 val);
+		bool		ReplaceInt64(const BMessageAtom &atom, int32 index, int64 val);
+		bool		ReplaceBool(const BMessageAtom &atom, bool aBoolean);
+		bool		ReplaceBool(const BMessageAtom &atom, int32 index, bool aBoolean);
+		bool		ReplaceFloat(const BMessageAtom &atom, float f);
+		bool		ReplaceFloat(const BMessageAtom &atom, int32 index, float f);
+		bool		ReplaceDouble(const BMessageAtom &atom, double d);
+		bool		ReplaceDouble(const BMessageAtom &atom, int32 index, double d);
+		bool		ReplacePoint(const BMessageAtom &atom, BPoint pt);
+		bool		ReplacePoint(const BMessageAtom &atom, int32 index, BPoint pt);
+		bool		ReplaceRect(const BMessageAtom &atom, BRect r);
+		bool		ReplaceRect(const BMessageAtom &atom, int32 index, BRect r);
+		bool		ReplacePointer(const BMessageAtom &atom, const void *ptr);
+		bool		ReplacePointer(const BMessageAtom &atom, int32 index, const void *ptr);
+		bool		ReplaceData(const BMessageAtom &atom, type_code type, const void *data, size_t numBytes, bool is_fixed_size);
+		bool		ReplaceData(const BMessageAtom &atom, type_code type, int32 index, const void *data, size_t numBytes, bool is_fixed_size);
+
 		void		PrintToStream() const;
 
 		size_t		FlattenedSize() const;
 		bool		Flatten(char *buffer, size_t bufferSize) const;
 		bool		Unflatten(const char *buffer, size_t bufferSize);
 
+		// AdoptFlattened():
+		// 	Takes the buffer (allocated by malloc()) which holds a flattened message instead of copying it,
+		// 	only the bounds get checked here, the fields are decoded on the first access.
+		// 	The caller still owns the buffer when it returns false.
+		// FlattenedData():
+		// 	Returns the flattened form kept by the message, NULL when it was changed since AdoptFlattened().
+		bool		AdoptFlattened(char *buffer, size_t bufferSize);
+		const char	*FlattenedData(size_t *size) const;
+
 		bool		WasDelivered() const;
 		bool		IsReply() const;
 		bool		IsSourceWaiting() const;
 
+		// SetLane():
+		// 	The lane of the looper queue the message goes to when posted,
+		// 	B_DEFAULT_LANE leaves it to BMessageQueue::SetLane() of the message code.
+		void		SetLane(e_message_lane lane);
+		e_message_lane	Lane() const;
+
 		status_t	SendReply(uint32 command, BHandler *replyHandler = NULL) const;
 		status_t	SendReply(const BMessage *message,
 		                   BHandler *replyHandler = NULL,
@@ -236,27 +356,83 @@ class BMessage
 	private:
 		friend class BLooper;
 		friend class BMessenger;
+		friend class BMessageQueue;
 
-		typedef struct list_data {
-			char 		*name;
-			BList		list;
-		} list_data;
-
-		typedef struct type_list_data {
-			type_code	type;
-			BList		list;
-		} type_list_data;
-
-		typedef struct _object_t {
+		typedef struct _item_t {
+			void		*data;
 			size_t		bytes;
 			bool		fixed_size;
-			void		*data;
-		} _object_t;
-
-		BList fObjectsList;
-
-		static list_data *_find_list(const BList *list, const char *name, int32 *index = NULL);
-		static type_list_data *_find_type_list(const BList *list, type_code type);
+			bool		borrowed; // points into fFlattened
+		} _item_t;
+
+		// one name holds one type of items
+		typedef struct _field_t {
+			char		*name;
+			size_t		nameLength;
+			uint32		hash;
+			uint32		atom; // the name is the one of the atom when not 0
+			type_code	type;
+			int32		count;
+			int32		capacity;
+			_item_t		*items; // NULL when the only item is "item"
+			_item_t		item;
+		} _field_t;
+
+		_field_t *fFields;
+		int32 fFieldsCount;
+		int32 fFieldsCapacity;
+
+		// hash index on the names for messages with many fields, -1 marks an empty slot
+		int32 *fFieldsIndex;
+		uint32 fFieldsIndexMask;
+
+		// values up to 16 bytes are kept in slots of blocks owned by the message
+		void *fValueBlocks;
+		void *fFreeValues;
+
+		_field_t	*_FindField(const char *name, int32 *index = NULL) const;
+		_field_t	*_FindField(const BMessageAtom &atom, int32 *index = NULL) const;
+		_field_t	*_AddField(const char *name, type_code type);
+		_field_t	*_AddField(const char *name, size_t nameLength, uint32 hash, uint32 atom, type_code type);
+		void		_RemoveField(int32 index);
+		void		_RebuildIndex();
+
+		bool		_AddItem(_field_t *field, const void *data, size_t numBytes, bool is_fixed_size, bool borrow = false);
+		bool		_SetItem(_item_t *item, const void *data, size_t numBytes, bool is_fixed_size, bool borrow = false);
+		void		_FreeItem(_item_t *item);
+
+		void		*_AllocValue();
+		void		_FreeValue(void *value);
+
+		char		*_AllocName(size_t nameLength);
+		void		_FreeName(_field_t *field);
+		void		_FreeFields();
+
+		// the flattened form from AdoptFlattened(), large values of the fields may stay in it
+		char *fFlattened;
+		size_t fFlattenedSize;
+		uint64 fFlattenedCount;
+		bool fFlattenedPending; // fields not decoded yet
+		bool fFlattenedCurrent; // fields not changed since
+		bool fFlattenedPooled; // from _AllocFlattened(fFlattenedSize)
+		void *fFlattenedArea; // fFlattened is the mapping of this area
+
+		bool		_Unflatten(const char *buffer, size_t bufferSize, bool adopt, bool pooled = false);
+		static char	*_AllocFlattened(size_t size);
+		static void	_FreeFlattened(char *buffer, size_t size);
+
+		// the copies share the fields of a hidden message until one of them changes,
+		// the fields of the message they were copied from stay its own
+		mutable BMessage *fShared;
+		int32 fSharedRefs; // of the hidden message
+
+		void		_Unshare(bool keepFields);
+		void		_SwapStorage(BMessage *msg);
+		void		_AliasStorage(const BMessage *msg);
+		void		_CopyFields(const BMessage *msg);
+		void		_FlattenHeader(char *buffer, size_t size, uint64 count) const;
+		void		_DecodeFlattened() const;
+		static bool	_UnflattenFields(BMessage *msg, const char *buffer, size_t bufferSize, uint64 count, bool borrow);
 
 		int64 fTeam;
 
@@ -264,11 +440,19 @@ class BMessage
 		bigtime_t fTargetTokenTimestamp;
 		uint64 fReplyToken;
 		bigtime_t fReplyTokenTimestamp;
+		int64 fReplyTeam; // of fReplyToken
 
 		bool fNoticeSource;
 		void *fSource;
+		uint32 fSourceRequest; // request waiting on fSource, the replies carry it
+
+		void		_ReleaseSource(bool notice = true);
 
 		bool fIsReply;
+
+		// link of the pending messages of BMessageQueue
+		BMessage *fQueueNext;
+		int32 fLane;
 };
 
 
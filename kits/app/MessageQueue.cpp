@@ -34,9 +34,23 @@
 
 extern BLocker* get_handler_operator_locker();
 
+
+#define E_MESSAGE_LANE_MAX_PASSES	16
+
+
+static inline BMessage *e_message_queue_load(BMessage **ptr)
+{
+	BMessage *retVal = *((BMessage* volatile*)ptr);
+	__sync_synchronize();
+	return retVal;
+}
+
+
 BMessageQueue::BMessageQueue()
-		: fLocker(NULL)
+		: fLocker(NULL), fHead(&fStub), fTail(&fStub), fCount(0)
 {
+	for (int32 i = 0; i < B_MESSAGE_LANES; i++) fFirst[i] = fPassed[i] = 0;
+
 	if ((fLocker = create_locker()) == NULL)
 		ETK_ERROR("[APP]: %s --- Unable to create locker for looper.", __PRETTY_FUNCTION__);
 }
@@ -44,12 +58,17 @@ BMessageQueue::BMessageQueue()
 
 BMessageQueue::~BMessageQueue()
 {
-	for (int32 i = 0; i < fMessagesList.CountItems(); i++) {
-		BMessage *msg = (BMessage*)fMessagesList.ItemAt(i);
-		if (msg) delete msg;
+	_Collect();
+
+	for (int32 lane = 0; lane < B_MESSAGE_LANES; lane++) {
+		for (int32 i = fFirst[lane]; i < fLanes[lane].CountItems(); i++) {
+			BMessage *msg = (BMessage*)fLanes[lane].ItemAt(i);
+			if (msg) delete msg;
+		}
+		fLanes[lane].MakeEmpty();
 	}
 
-	fMessagesList.MakeEmpty();
+	for (int32 i = 0; i < fWhats.CountItems(); i++) delete (_what_t*)fWhats.ItemAt(i);
 
 	if (fLocker) {
 		close_locker(fLocker);
@@ -65,6 +84,10 @@ BMessageQueue::LockWithTimeout(bigtime_t timeout)
 
 	BLocker *hLocker = get_handler_operator_locker();
 
+	// nothing to give up when the handler operator locker isn't held
+	if (hLocker->IsLockedByCurrentThread() == false)
+		return lock_locker_etc(fLocker, B_TIMEOUT, timeout);
+
 	hLocker->Lock();
 	void *locker = clone_locker(fLocker);
 	int64 locksCount = hLocker->CountLocks();
@@ -101,17 +124,268 @@ BMessageQueue::Unlock()
 }
 
 
+void
+BMessageQueue::_Push(BMessage *msg)
+{
+	msg->fQueueNext = NULL;
+	__sync_synchronize();
+
+	BMessage *prev = __sync_lock_test_and_set(&fTail, msg);
+
+	// the consumer sees "msg" from here on
+	*((BMessage* volatile*)&prev->fQueueNext) = msg;
+}
+
+
+BMessage*
+BMessageQueue::_Pop()
+{
+	BMessage *head = fHead;
+	BMessage *next = e_message_queue_load(&head->fQueueNext);
+
+	if (head == &fStub) {
+		if (next == NULL) return NULL;
+		fHead = head = next;
+		next = e_message_queue_load(&head->fQueueNext);
+	}
+
+	if (next == NULL) {
+		// a producer is still linking in the one after "head"
+		if (head != e_message_queue_load(&fTail)) return NULL;
+
+		_Push(&fStub);
+		if ((next = e_message_queue_load(&head->fQueueNext)) == NULL) return NULL;
+	}
+
+	fHead = next;
+	head->fQueueNext = NULL;
+	return head;
+}
+
+
+void
+BMessageQueue::_Collect()
+{
+	BMessage *msg;
+	while ((msg = _Pop()) != NULL) {
+		_what_t *item = (fWhats.CountItems() > 0 ? _What(msg->what, false) : NULL);
+
+		int32 lane = msg->fLane;
+		if (lane < 0) {
+			if (item != NULL && item->lane >= 0) lane = item->lane;
+			else lane = (msg->fIsReply ? B_URGENT_LANE : B_NORMAL_LANE);
+		}
+
+		if (fWhats.CountItems() > 0 && _Coalesce(msg, item, lane)) {
+			__sync_sub_and_fetch(&fCount, 1);
+			continue;
+		}
+		fLanes[lane].AddItem((void*)msg);
+	}
+}
+
+
+bool
+BMessageQueue::_CanCollect()
+{
+	// only the holder of the locker takes the pending messages out
+	if (count_locker_locks(fLocker) > B_INT64_CONSTANT(0)) return true;
+
+	ETK_WARNING("[APP]: %s -- MessageQueue wasn't locked by current thread.", __PRETTY_FUNCTION__);
+	return false;
+}
+
+
+int32
+BMessageQueue::_CountCollected() const
+{
+	int32 count = 0;
+	for (int32 lane = 0; lane < B_MESSAGE_LANES; lane++) count += fLanes[lane].CountItems() - fFirst[lane];
+	return count;
+}
+
+
+void
+BMessageQueue::_LaneOrder(int32 *lanes) const
+{
+	int32 passed = -1;
+	for (int32 lane = 0; lane < B_MESSAGE_LANES; lane++) {
+		if (fPassed[lane] < E_MESSAGE_LANE_MAX_PASSES || fLanes[lane].CountItems() == fFirst[lane]) continue;
+		passed = lane;
+		break;
+	}
+
+	int32 k = 0;
+	if (passed >= 0) lanes[k++] = passed;
+	for (int32 lane = 0; lane < B_MESSAGE_LANES; lane++) {
+		if (lane != passed) lanes[k++] = lane;
+	}
+}
+
+
+void
+BMessageQueue::_Take(int32 lane, int32 index)
+{
+	BList &list = fLanes[lane];
+
+	__sync_sub_and_fetch(&fCount, 1);
+
+	if (index > fFirst[lane]) {
+		list.RemoveItem(index);
+		return;
+	}
+
+	list.ReplaceItem(fFirst[lane]++, NULL);
+
+	if (fFirst[lane] == list.CountItems()) {
+		list.MakeEmpty();
+		fFirst[lane] = 0;
+	} else if (fFirst[lane] >= 32 && fFirst[lane] >= list.CountItems() / 2) {
+		list.RemoveItems(0, fFirst[lane]);
+		fFirst[lane] = 0;
+	}
+}
+
+
+BMessageQueue::_what_t*
+BMessageQueue::_What(uint32 what, bool create)
+{
+	for (int32 i = 0; i < fWhats.CountItems(); i++) {
+		_what_t *item = (_what_t*)fWhats.ItemAt(i);
+		if (item->what == what) return item;
+	}
+
+	if (create == false) return NULL;
+
+	_what_t *item = new _what_t;
+	if (item == NULL) return NULL;
+	if (fWhats.AddItem((void*)item) == false) {
+		delete item;
+		return NULL;
+	}
+
+	item->what = what;
+	item->lane = B_DEFAULT_LANE;
+	item->coalescing = false;
+	item->merge = NULL;
+	item->last = NULL;
+	item->lastLane = B_DEFAULT_LANE;
+
+	return item;
+}
+
+
+bool
+BMessageQueue::_Coalesce(BMessage *msg, _what_t *item, int32 lane)
+{
+	if (item == NULL || item->coalescing == false) {
+		// nothing moves across the other messages for the same handler
+		for (int32 i = 0; i < fWhats.CountItems(); i++) {
+			_what_t *aItem = (_what_t*)fWhats.ItemAt(i);
+			if (aItem->last != NULL && aItem->last->fTargetToken == msg->fTargetToken) aItem->last = NULL;
+		}
+		return false;
+	}
+
+	BMessage *pending = item->last;
+	int32 pendingLane = item->lastLane;
+	item->last = NULL;
+
+	if (msg->fNoticeSource || msg->fSource != NULL) return false;
+	item->last = msg;
+	item->lastLane = lane;
+
+	if (pending == NULL || pendingLane != lane || pending->fTargetToken != msg->fTargetToken) return false;
+
+	if (item->merge != NULL) {
+		if (!item->merge(pending, msg)) return false;
+
+		item->last = pending;
+		delete msg;
+		return true;
+	}
+
+	// the pending one is usually near the end
+	for (int32 i = fLanes[lane].CountItems() - 1; i >= fFirst[lane]; i--) {
+		if (fLanes[lane].ItemAt(i) != (void*)pending) continue;
+		_Take(lane, i);
+		delete pending;
+		break;
+	}
+
+	return false;
+}
+
+
+void
+BMessageQueue::_Detach(BMessage *msg)
+{
+	for (int32 i = 0; i < fWhats.CountItems(); i++) {
+		_what_t *item = (_what_t*)fWhats.ItemAt(i);
+		if (item->last == msg) item->last = NULL;
+	}
+}
+
+
+bool
+BMessageQueue::SetLane(uint32 what, e_message_lane lane)
+{
+	if ((int32)lane >= B_MESSAGE_LANES) return false;
+	if (Lock() == false) return false;
+
+	_what_t *item = _What(what, true);
+	if (item != NULL) item->lane = ((int32)lane < 0 ? (int32)B_DEFAULT_LANE : (int32)lane);
+
+	Unlock();
+
+	return(item != NULL);
+}
+
+
+bool
+BMessageQueue::SetCoalescing(uint32 what, e_message_merge_hook merge)
+{
+	if (Lock() == false) return false;
+
+	_what_t *item = _What(what, true);
+	if (item != NULL) {
+		item->coalescing = true;
+		item->merge = merge;
+	}
+
+	Unlock();
+
+	return(item != NULL);
+}
+
+
+void
+BMessageQueue::UnsetCoalescing(uint32 what)
+{
+	if (Lock() == false) return;
+
+	_what_t *item = _What(what, false);
+	if (item != NULL) {
+		item->coalescing = false;
+		item->merge = NULL;
+		item->last = NULL;
+	}
+
+	Unlock();
+}
+
+
 int32
 BMessageQueue::CountMessages() const
 {
-	return fMessagesList.CountItems();
+	return *((const volatile int32*)&fCount);
 }
 
 
 bool
 BMessageQueue::IsEmpty() const
 {
-	return fMessagesList.IsEmpty();
+	return(CountMessages() == 0);
 }
 
 
@@ -120,10 +394,11 @@ BMessageQueue::AddMessage(BMessage *an_event)
 {
 	if (!an_event) return false;
 
-	if (fMessagesList.AddItem((void*)an_event)) return true;
+	// counted before it's linked in to be taken, FindMessage() might not see it yet
+	__sync_add_and_fetch(&fCount, 1);
 
-	delete an_event;
-	return false;
+	_Push(an_event);
+	return true;
 }
 
 
@@ -132,36 +407,68 @@ BMessageQueue::RemoveMessage(BMessage *an_event)
 {
 	if (!an_event) return false;
 
-	if (!fMessagesList.RemoveItem((void*)an_event)) return false;
+	_Collect();
 
-	delete an_event;
+	for (int32 lane = 0; lane < B_MESSAGE_LANES; lane++) {
+		int32 index = fLanes[lane].IndexOf((void*)an_event);
+		if (index < fFirst[lane]) continue;
 
-	return true;
+		_Detach(an_event);
+		_Take(lane, index);
+		delete an_event;
+
+		return true;
+	}
+
+	return false;
 }
 
 
 BMessage*
 BMessageQueue::NextMessage()
 {
-	return((BMessage*)fMessagesList.RemoveItem(0));
-}
+	// FindMessage(0) stays the message taken here as long as some are collected
+	if (_CountCollected() == 0) _Collect();
 
+	int32 lanes[B_MESSAGE_LANES];
+	_LaneOrder(lanes);
 
-BMessage*
-BMessageQueue::FindMessage(int32 index) const
-{
-	return((BMessage*)fMessagesList.ItemAt(index));
+	for (int32 k = 0; k < B_MESSAGE_LANES; k++) {
+		int32 lane = lanes[k];
+		if (fLanes[lane].CountItems() == fFirst[lane]) continue;
+
+		BMessage *msg = (BMessage*)fLanes[lane].ItemAt(fFirst[lane]);
+		_Take(lane, fFirst[lane]);
+		_Detach(msg);
+
+		fPassed[lane] = 0;
+		for (int32 lower = lane + 1; lower < B_MESSAGE_LANES; lower++) {
+			if (fLanes[lower].CountItems() > fFirst[lower]) fPassed[lower]++;
+			else fPassed[lower] = 0;
+		}
+
+		return msg;
+	}
+
+	return NULL;
 }
 
 
 BMessage*
-BMessageQueue::FindMessage(uint32 what, int32 fromIndex) const
+BMessageQueue::FindMessage(int32 index)
 {
-	for (int32 i = fromIndex; i < fMessagesList.CountItems(); i++) {
-		BMessage *msg = (BMessage*)fMessagesList.ItemAt(i);
+	if (index < 0) return NULL;
+
+	// the lanes get the messages added since, NextMessage() takes the one found at 0
+	if (_CanCollect()) _Collect();
 
-		if (msg)
-			if (msg->what == what) return msg;
+	int32 lanes[B_MESSAGE_LANES];
+	_LaneOrder(lanes);
+
+	for (int32 k = 0; k < B_MESSAGE_LANES; k++) {
+		int32 count = fLanes[lanes[k]].CountItems() - fFirst[lanes[k]];
+		if (index < count) return((BMessage*)fLanes[lanes[k]].ItemAt(fFirst[lanes[k]] + index));
+		index -= count;
 	}
 
 	return NULL;
@@ -169,13 +476,31 @@ BMessageQueue::FindMessage(uint32 what, int32 fromIndex) const
 
 
 BMessage*
-BMessageQueue::FindMessage(uint32 what, int32 fromIndex, int32 count) const
+BMessageQueue::FindMessage(uint32 what, int32 fromIndex)
 {
-	for (int32 i = fromIndex, j = 0; i < fMessagesList.CountItems() && j < count; i++, j++) {
-		BMessage *msg = (BMessage*)fMessagesList.ItemAt(i);
+	return FindMessage(what, fromIndex, B_MAXINT32);
+}
+
 
-		if (msg)
-			if (msg->what == what) return msg;
+BMessage*
+BMessageQueue::FindMessage(uint32 what, int32 fromIndex, int32 count)
+{
+	if (_CanCollect()) _Collect();
+
+	int32 lanes[B_MESSAGE_LANES];
+	_LaneOrder(lanes);
+
+	int32 index = 0;
+	for (int32 k = 0; k < B_MESSAGE_LANES && count > 0; k++) {
+		const BList &list = fLanes[lanes[k]];
+		for (int32 i = fFirst[lanes[k]]; i < list.CountItems() && count > 0; i++, index++) {
+			if (index < fromIndex) continue;
+			count--;
+
+			BMessage *msg = (BMessage*)list.ItemAt(i);
+			if (msg)
+				if (msg->what == what) return msg;
+		}
 	}
 
 	return NULL;
@@ -183,8 +508,21 @@ BMessageQueue::FindMessage(uint32 what, int32 fromIndex, int32 count) const
 
 
 int32
-BMessageQueue::IndexOfMessage(BMessage *an_event) const
+BMessageQueue::IndexOfMessage(BMessage *an_event)
 {
-	return fMessagesList.IndexOf((void*)an_event);
+	if (_CanCollect()) _Collect();
+
+	int32 lanes[B_MESSAGE_LANES];
+	_LaneOrder(lanes);
+
+	for (int32 k = 0, base = 0; k < B_MESSAGE_LANES; k++) {
+		const BList &list = fLanes[lanes[k]];
+		for (int32 i = fFirst[lanes[k]]; i < list.CountItems(); i++) {
+			if (list.ItemAt(i) == (void*)an_event) return(base + i - fFirst[lanes[k]]);
+		}
+		base += list.CountItems() - fFirst[lanes[k]];
+	}
+
+	return -1;
 }
 
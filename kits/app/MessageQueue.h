@@ -36,13 +36,17 @@
 
 #ifdef __cplusplus /* Just for C++ */
 
+// folds "message" into "pending", return false to queue it as usual
+typedef bool (*e_message_merge_hook)(BMessage *pending, const BMessage *message);
+
 class BMessageQueue
 {
 	public:
 		BMessageQueue();
 		virtual ~BMessageQueue();
 
-		// add "an_event" to the queue and delete it automatically when FAILED
+		// add "an_event" to the queue and delete it automatically when FAILED,
+		// it doesn't need the queue locked
 		bool		AddMessage(BMessage *an_event);
 
 		// remove "an_event" from the queue and delete it automatically when FOUNDED
@@ -51,11 +55,15 @@ class BMessageQueue
 		// return the FIRST message and detach from the queue, you should "delete" by yourself
 		BMessage	*NextMessage();
 
-		BMessage	*FindMessage(int32 index) const;
-		BMessage	*FindMessage(uint32 what, int32 fromIndex = 0) const;
-		BMessage	*FindMessage(uint32 what, int32 fromIndex, int32 count) const;
-		int32		IndexOfMessage(BMessage *an_event) const;
+		// the messages are indexed in the order NextMessage() takes them,
+		// the queue must be locked to see the messages added since the last call
+		BMessage	*FindMessage(int32 index);
+		BMessage	*FindMessage(uint32 what, int32 fromIndex = 0);
+		BMessage	*FindMessage(uint32 what, int32 fromIndex, int32 count);
+		int32		IndexOfMessage(BMessage *an_event);
 
+		// it doesn't need the queue locked, FindMessage() might not see the messages
+		// still being added by other threads
 		int32		CountMessages() const;
 		bool		IsEmpty() const;
 
@@ -63,9 +71,62 @@ class BMessageQueue
 		void		Unlock();
 		status_t	LockWithTimeout(bigtime_t microseconds_timeout);
 
+		// SetLane():
+		// 	The lane of the messages of "what" without one of their own, see BMessage::SetLane().
+		// 	Replies default to B_URGENT_LANE and anything else to B_NORMAL_LANE.
+		// 	NextMessage() takes from the highest lane holding messages, but a lane
+		// 	passed over 16 times in a row gets the next turn.
+		bool		SetLane(uint32 what, e_message_lane lane);
+
+		// SetCoalescing():
+		// 	A message of "what" coming after a pending one for the same handler,
+		// 	with no message for that handler in between except coalesced ones,
+		// 	replaces the pending one, or gets folded into it when "merge"
+		// 	returns true. Messages waited for a reply are never coalesced.
+		bool		SetCoalescing(uint32 what, e_message_merge_hook merge = NULL);
+		void		UnsetCoalescing(uint32 what);
+
 	private:
-		BList fMessagesList;
+		// messages moved out of the pending list into their lanes, the calls
+		// above work on them and must be made with the queue locked
+		BList fLanes[B_MESSAGE_LANES];
+		int32 fFirst[B_MESSAGE_LANES];
+		int32 fPassed[B_MESSAGE_LANES]; // times a lane holding messages was passed over
 		void *fLocker;
+
+		// pending messages, AddMessage() links them in with one atomic exchange
+		// and without the locker, only the holder of the locker takes them out
+		BMessage fStub;
+		BMessage *fHead;
+		BMessage *fTail;
+		int32 fCount; // of the pending and the collected messages
+
+		bool		_CanCollect();
+
+		void		_Push(BMessage *msg);
+		BMessage	*_Pop();
+		void		_Collect();
+
+		int32		_CountCollected() const;
+		void		_LaneOrder(int32 *lanes) const;
+		void		_Take(int32 lane, int32 index);
+
+		// the settings of a message code, "last" is the newest collected
+		// message of "what" that may still be coalesced
+		typedef struct _what_t {
+			uint32			what;
+			int32			lane;
+			bool			coalescing;
+			e_message_merge_hook	merge;
+			BMessage		*last;
+			int32			lastLane;
+		} _what_t;
+
+		BList fWhats;
+
+		_what_t		*_What(uint32 what, bool create);
+		bool		_Coalesce(BMessage *msg, _what_t *item, int32 lane);
+		void		_Detach(BMessage *msg);
 };
 
 #endif /* __cplusplus */
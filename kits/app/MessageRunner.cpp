@@ -29,15 +29,254 @@
 
 #include <kernel/Kernel.h>
 #include <app/Application.h>
+#include <support/List.h>
 #include <support/Locker.h>
 #include <support/Autolock.h>
 
 #include "MessageRunner.h"
 
-extern BLocker* get_handler_operator_locker();
+// the kernel waits on the wall clock, the task looks at the time again at least that often
+#define E_RUNNER_MAX_WAIT	B_INT64_CONSTANT(1000000)
+
+
+// the scheduled runners in a heap ordered by their deadlines,
+// the task sleeps until the earliest one or until it gets an earlier one
+static struct {
+	BLocker locker;
+	BList heap;
+	void *sem;
+	void *thread;
+	bool quit;
+	bigtime_t wakeup; // -1 while the task is awake
+} runners;
+
+
+_LOCAL status_t start_message_runners()
+{
+	BAutolock <BLocker>autolock(&runners.locker);
+
+	if (runners.thread != NULL) return B_OK;
+
+	if ((runners.sem = create_sem(B_INT64_CONSTANT(0), NULL)) == NULL) return B_NO_MORE_SEMS;
+
+	runners.quit = false;
+	runners.wakeup = B_INT64_CONSTANT(-1);
+
+	if ((runners.thread = create_thread(BMessageRunner::_TimerTask, B_URGENT_DISPLAY_PRIORITY, NULL, NULL)) == NULL ||
+	        resume_thread(runners.thread) != B_OK) {
+		if (runners.thread) delete_thread(runners.thread);
+		delete_sem(runners.sem);
+		runners.sem = runners.thread = NULL;
+		return B_ERROR;
+	}
+
+	return B_OK;
+}
+
+
+_LOCAL void stop_message_runners()
+{
+	runners.locker.Lock();
+
+	void *thread = runners.thread;
+	if (thread == NULL) {
+		runners.locker.Unlock();
+		return;
+	}
+
+	runners.quit = true;
+	release_sem(runners.sem);
+
+	runners.locker.Unlock();
+
+	status_t status;
+	wait_for_thread(thread, &status);
+	delete_thread(thread);
+
+	runners.locker.Lock();
+	delete_sem(runners.sem);
+	runners.sem = runners.thread = NULL;
+	runners.locker.Unlock();
+}
+
+
+status_t
+BMessageRunner::_TimerTask(void *arg)
+{
+	runners.locker.Lock();
+
+	BList due;
+
+	while (runners.quit == false) {
+		runners.wakeup = B_INT64_CONSTANT(-1);
+
+		bigtime_t curTime = system_time();
+		BMessageRunner *runner;
+
+		while ((runner = (BMessageRunner*)runners.heap.FirstItem()) != NULL && runner->fDeadline <= curTime) {
+			runner->fPrevSendTime = runner->fDeadline;
+
+			// keep the phase, the ticks missed while late get dropped
+			bigtime_t deadline = runner->fDeadline + runner->fInterval;
+			if (deadline <= curTime) deadline += ((curTime - deadline) / runner->fInterval + 1) * runner->fInterval;
+			runner->_Schedule(deadline);
+
+			runner->fSending = true;
+			due.AddItem(runner);
+		}
+
+		if (due.CountItems() > 0) {
+			// the runners stay as they are until sent, see _WaitForSending()
+			runners.locker.Unlock();
+
+			for (int32 i = 0; i < due.CountItems(); i++) {
+				runner = (BMessageRunner*)due.ItemAt(i);
+
+				// TODO: replyTo
+				// a full queue misses the message instead of holding up the other runners
+				bool sent = (runner->fTarget->SendMessage(runner->fMessage, (BHandler*)NULL, B_INT64_CONSTANT(0)) == B_OK);
+
+				runners.locker.Lock();
+				if (sent && runner->fCount > 0 && --(runner->fCount) == 0) runner->_Unschedule();
+				runner->fSending = false;
+				runners.locker.Unlock();
+			}
+
+			due.MakeEmpty();
+			runners.locker.Lock();
+			continue;
+		}
+
+		bigtime_t timeout = B_INFINITE_TIMEOUT;
+		if (runner != NULL) {
+			runners.wakeup = runner->fDeadline;
+			timeout = min_c(runner->fDeadline - system_time(), E_RUNNER_MAX_WAIT);
+		} else {
+			runners.wakeup = B_MAXINT64;
+		}
+
+		runners.locker.Unlock();
+		if (timeout > B_INT64_CONSTANT(0)) acquire_sem_etc(runners.sem, B_INT64_CONSTANT(1), B_TIMEOUT, timeout);
+		runners.locker.Lock();
+	}
+
+	runners.locker.Unlock();
+
+	return B_OK;
+}
+
+
+void
+BMessageRunner::_SiftUp(int32 index)
+{
+	BMessageRunner **items = (BMessageRunner**)runners.heap.Items();
+	BMessageRunner *runner = items[index];
+
+	while (index > 0) {
+		int32 parent = (index - 1) / 2;
+		if (items[parent]->fDeadline <= runner->fDeadline) break;
+		items[index] = items[parent];
+		items[index]->fIndex = index;
+		index = parent;
+	}
+
+	items[index] = runner;
+	runner->fIndex = index;
+}
+
+
+void
+BMessageRunner::_SiftDown(int32 index)
+{
+	BMessageRunner **items = (BMessageRunner**)runners.heap.Items();
+	BMessageRunner *runner = items[index];
+	int32 count = runners.heap.CountItems();
+
+	while (true) {
+		int32 child = index * 2 + 1;
+		if (child >= count) break;
+		if (child + 1 < count && items[child + 1]->fDeadline < items[child]->fDeadline) child++;
+		if (runner->fDeadline <= items[child]->fDeadline) break;
+		items[index] = items[child];
+		items[index]->fIndex = index;
+		index = child;
+	}
+
+	items[index] = runner;
+	runner->fIndex = index;
+}
+
+
+// the caller must hold the locker of runners
+void
+BMessageRunner::_Schedule(bigtime_t deadline)
+{
+	if (fCount == 0 || fInterval <= B_INT64_CONSTANT(0) ||
+	        fTarget == NULL || fTarget->IsValid() == false || fMessage == NULL) {
+		_Unschedule();
+		return;
+	}
+
+	bigtime_t oldDeadline = fDeadline;
+	fDeadline = deadline;
+
+	if (fIndex < 0) {
+		if (runners.heap.AddItem(this) == false) return;
+		_SiftUp(runners.heap.CountItems() - 1);
+	} else if (deadline < oldDeadline) {
+		_SiftUp(fIndex);
+	} else {
+		_SiftDown(fIndex);
+	}
+
+	if (fIndex == 0 && fDeadline < runners.wakeup && runners.sem != NULL) {
+		runners.wakeup = fDeadline;
+		release_sem(runners.sem);
+	}
+}
+
+
+// the caller must hold the locker of runners
+bigtime_t
+BMessageRunner::_NextSendTime() const
+{
+	return(fPrevSendTime < B_INT64_CONSTANT(0) ? system_time() : fPrevSendTime + fInterval);
+}
+
+
+// the caller must hold the locker of runners, it's given up while the timer task sends
+void
+BMessageRunner::_WaitForSending()
+{
+	while (fSending) {
+		runners.locker.Unlock();
+		snooze(1);
+		runners.locker.Lock();
+	}
+}
+
+
+// the caller must hold the locker of runners
+void
+BMessageRunner::_Unschedule()
+{
+	if (fIndex < 0) return;
+
+	int32 index = fIndex;
+	BMessageRunner *last = (BMessageRunner*)runners.heap.RemoveItem(runners.heap.CountItems() - 1);
+	fIndex = -1;
+
+	if (last != this) {
+		runners.heap.ReplaceItem(index, last);
+		_SiftUp(index);
+		_SiftDown(last->fIndex);
+	}
+}
+
 
 BMessageRunner::BMessageRunner(const BMessenger &target, const BMessage *msg, bigtime_t interval, int32 count)
-		: fToken(-1), fTarget(NULL), fReplyTo(NULL), fMessage(NULL), fPrevSendTime(B_INT64_CONSTANT(-1))
+		: fValid(false), fTarget(NULL), fReplyTo(NULL), fMessage(NULL), fIndex(-1), fDeadline(B_INT64_CONSTANT(0)),
+		fPrevSendTime(B_INT64_CONSTANT(-1)), fSending(false)
 {
 	if (!(msg == NULL || (fMessage = new BMessage(*msg)) != NULL)) return;
 	if (target.IsValid()) {
@@ -46,29 +285,16 @@ BMessageRunner::BMessageRunner(const BMessenger &target, const BMessage *msg, bi
 	}
 	fInterval = interval;
 	fCount = count;
+	fValid = true;
 
-	BLocker *hLocker = get_handler_operator_locker();
-	BAutolock <BLocker>autolock(hLocker);
-
-	int32 token = BApplication::sRunnerList.IndexOf(NULL);
-	if (token >= 0) {
-		if (BApplication::sRunnerList.ReplaceItem(token, this) == false) return;
-		fToken = token;
-	} else {
-		if (BApplication::sRunnerList.AddItem(this) == false) return;
-		fToken = BApplication::sRunnerList.CountItems() - 1;
-	}
-
-	if (fCount != 0 && fInterval >B_INT64_CONSTANT(0) &&
-	        !(fTarget == NULL || fTarget->IsValid() == false) && fMessage != NULL && app != NULL) {
-		BApplication::sRunnerMinimumInterval = B_INT64_CONSTANT(-1);
-		app->PostMessage(_EVENTS_PENDING_, app);
-	}
+	BAutolock <BLocker>autolock(&runners.locker);
+	_Schedule(system_time());
 }
 
 
 BMessageRunner::BMessageRunner(const BMessenger &target, const BMessage *msg, bigtime_t interval, int32 count, const BMessenger &replyTo)
-		: fToken(-1), fTarget(NULL), fReplyTo(NULL), fMessage(NULL), fPrevSendTime(B_INT64_CONSTANT(-1))
+		: fValid(false), fTarget(NULL), fReplyTo(NULL), fMessage(NULL), fIndex(-1), fDeadline(B_INT64_CONSTANT(0)),
+		fPrevSendTime(B_INT64_CONSTANT(-1)), fSending(false)
 {
 	if (!(msg == NULL || (fMessage = new BMessage(*msg)) != NULL)) return;
 	if (target.IsValid()) {
@@ -81,40 +307,20 @@ BMessageRunner::BMessageRunner(const BMessenger &target, const BMessage *msg, bi
 	}
 	fInterval = interval;
 	fCount = count;
+	fValid = true;
 
-	BLocker *hLocker = get_handler_operator_locker();
-	BAutolock <BLocker>autolock(hLocker);
-
-	int32 token = BApplication::sRunnerList.IndexOf(NULL);
-	if (token >= 0) {
-		if (BApplication::sRunnerList.ReplaceItem(token, this) == false) return;
-		fToken = token;
-	} else {
-		if (BApplication::sRunnerList.AddItem(this) == false) return;
-		fToken = BApplication::sRunnerList.CountItems() - 1;
-	}
-
-	if (fCount != 0 && fInterval >B_INT64_CONSTANT(0) &&
-	        !(fTarget == NULL || fTarget->IsValid() == false) && fMessage != NULL && app != NULL) {
-		BApplication::sRunnerMinimumInterval = B_INT64_CONSTANT(-1);
-		app->PostMessage(_EVENTS_PENDING_, app);
-	}
+	BAutolock <BLocker>autolock(&runners.locker);
+	_Schedule(system_time());
 }
 
 
 BMessageRunner::~BMessageRunner()
 {
-	BLocker *hLocker = get_handler_operator_locker();
-	BAutolock <BLocker>autolock(hLocker);
-
-	if (fToken >= 0) {
-		void *oldItem = NULL;
-		bool removed = (fToken == BApplication::sRunnerList.CountItems() - 1 ?
-		                (BApplication::sRunnerList.RemoveItem(fToken) == (void*)this) :
-		                !(BApplication::sRunnerList.ReplaceItem(fToken, NULL, &oldItem) == false || oldItem != (void*)this));
-		if (!removed)
-			ETK_ERROR("[APP]: %s --- Unable to remove runner, it must something error.", __PRETTY_FUNCTION__);
-	}
+	runners.locker.Lock();
+	_WaitForSending();
+	_Unschedule();
+	runners.locker.Unlock();
+
 	if (fTarget) delete fTarget;
 	if (fReplyTo) delete fReplyTo;
 	if (fMessage) delete fMessage;
@@ -124,17 +330,17 @@ BMessageRunner::~BMessageRunner()
 bool
 BMessageRunner::IsValid() const
 {
-	return(fToken >= 0);
+	return fValid;
 }
 
 
 status_t
 BMessageRunner::SetTarget(const BMessenger &target)
 {
-	if (fToken < 0) return B_ERROR;
+	if (!fValid) return B_ERROR;
 
-	BLocker *hLocker = get_handler_operator_locker();
-	BAutolock <BLocker>autolock(hLocker);
+	BAutolock <BLocker>autolock(&runners.locker);
+	_WaitForSending();
 
 	if (target.IsValid()) {
 		BMessenger *msgr = new BMessenger(target);
@@ -149,13 +355,8 @@ BMessageRunner::SetTarget(const BMessenger &target)
 		fTarget = NULL;
 	}
 
-	fPrevSendTime = B_INT64_CONSTANT(-1);
-
-	if (fCount != 0 && fInterval >B_INT64_CONSTANT(0) &&
-	        !(fTarget == NULL || fTarget->IsValid() == false) && fMessage != NULL && app != NULL) {
-		BApplication::sRunnerMinimumInterval = B_INT64_CONSTANT(-1);
-		app->PostMessage(_EVENTS_PENDING_, app);
-	}
+	// the runner keeps its time, it only starts when it couldn't send before
+	_Schedule(fIndex >= 0 ? fDeadline : _NextSendTime());
 
 	return B_OK;
 }
@@ -164,10 +365,10 @@ BMessageRunner::SetTarget(const BMessenger &target)
 status_t
 BMessageRunner::SetReplyTo(const BMessenger &replyTo)
 {
-	if (fToken < 0) return B_ERROR;
+	if (!fValid) return B_ERROR;
 
-	BLocker *hLocker = get_handler_operator_locker();
-	BAutolock <BLocker>autolock(hLocker);
+	BAutolock <BLocker>autolock(&runners.locker);
+	_WaitForSending();
 
 	if (replyTo.IsValid()) {
 		BMessenger *msgr = new BMessenger(replyTo);
@@ -182,7 +383,7 @@ BMessageRunner::SetReplyTo(const BMessenger &replyTo)
 		fReplyTo = NULL;
 	}
 
-	fPrevSendTime = B_INT64_CONSTANT(-1);
+	_Schedule(fIndex >= 0 ? fDeadline : _NextSendTime());
 
 	return B_OK;
 }
@@ -192,21 +393,16 @@ status_t
 BMessageRunner::SetMessage(const BMessage *msg)
 {
 	BMessage *aMsg = NULL;
-	if (fToken < 0 || !(msg == NULL || (aMsg = new BMessage(*msg)) != NULL)) return B_ERROR;
+	if (!fValid || !(msg == NULL || (aMsg = new BMessage(*msg)) != NULL)) return B_ERROR;
 
-	BLocker *hLocker = get_handler_operator_locker();
-	BAutolock <BLocker>autolock(hLocker);
+	BAutolock <BLocker>autolock(&runners.locker);
+	_WaitForSending();
 
 	if (fMessage) delete fMessage;
 	fMessage = aMsg;
 
-	fPrevSendTime = B_INT64_CONSTANT(-1);
-
-	if (fCount != 0 && fInterval >B_INT64_CONSTANT(0) &&
-	        !(fTarget == NULL || fTarget->IsValid() == false) && fMessage != NULL && app != NULL) {
-		BApplication::sRunnerMinimumInterval = B_INT64_CONSTANT(-1);
-		app->PostMessage(_EVENTS_PENDING_, app);
-	}
+	// the runner keeps its time, it only starts when it couldn't send before
+	_Schedule(fIndex >= 0 ? fDeadline : _NextSendTime());
 
 	return B_OK;
 }
@@ -215,19 +411,15 @@ BMessageRunner::SetMessage(const BMessage *msg)
 status_t
 BMessageRunner::SetInterval(bigtime_t interval)
 {
-	if (fToken < 0) return B_ERROR;
+	if (!fValid) return B_ERROR;
 
-	BLocker *hLocker = get_handler_operator_locker();
-	BAutolock <BLocker>autolock(hLocker);
+	BAutolock <BLocker>autolock(&runners.locker);
 
-	fInterval = interval;
-	fPrevSendTime = B_INT64_CONSTANT(-1);
+	_WaitForSending();
 
-	if (fCount != 0 && fInterval >B_INT64_CONSTANT(0) &&
-	        !(fTarget == NULL || fTarget->IsValid() == false) && fMessage != NULL && app != NULL) {
-		BApplication::sRunnerMinimumInterval = B_INT64_CONSTANT(-1);
-		app->PostMessage(_EVENTS_PENDING_, app);
-	}
+	// the next one comes the new interval after the last one
+	fInterval = interval;
+	_Schedule(fPrevSendTime >= B_INT64_CONSTANT(0) || fIndex < 0 ? _NextSendTime() : fDeadline);
 
 	return B_OK;
 }
@@ -236,19 +428,14 @@ BMessageRunner::SetInterval(bigtime_t interval)
 status_t
 BMessageRunner::SetCount(int32 count)
 {
-	if (fToken < 0) return B_ERROR;
+	if (!fValid) return B_ERROR;
 
-	BLocker *hLocker = get_handler_operator_locker();
-	BAutolock <BLocker>autolock(hLocker);
+	BAutolock <BLocker>autolock(&runners.locker);
 
-	fCount = count;
-	fPrevSendTime = B_INT64_CONSTANT(-1);
+	_WaitForSending();
 
-	if (fCount != 0 && fInterval >B_INT64_CONSTANT(0) &&
-	        !(fTarget == NULL || fTarget->IsValid() == false) && fMessage != NULL && app != NULL) {
-		BApplication::sRunnerMinimumInterval = B_INT64_CONSTANT(-1);
-		app->PostMessage(_EVENTS_PENDING_, app);
-	}
+	fCount = count;
+	_Schedule(fPrevSendTime >= B_INT64_CONSTANT(0) || fIndex < 0 ? _NextSendTime() : fDeadline);
 
 	return B_OK;
 }
@@ -257,10 +444,9 @@ BMessageRunner::SetCount(int32 count)
 status_t
 BMessageRunner::GetInfo(bigtime_t *interval, int32 *count) const
 {
-	if (fToken < 0 || (!interval && !count)) return B_ERROR;
+	if (!fValid || (!interval && !count)) return B_ERROR;
 
-	BLocker *hLocker = get_handler_operator_locker();
-	BAutolock <BLocker>autolock(hLocker);
+	BAutolock <BLocker>autolock(&runners.locker);
 
 	if (interval) *interval = fInterval;
 	if (count) *count = fCount;
@@ -272,10 +458,9 @@ BMessageRunner::GetInfo(bigtime_t *interval, int32 *count) const
 status_t
 BMessageRunner::GetInfo(BMessenger *target, BMessage *msg, bigtime_t *interval, int32 *count, BMessenger *replyTo) const
 {
-	if (fToken < 0 || (!target && !msg && interval && !count && !replyTo)) return B_ERROR;
+	if (!fValid || (!target && !msg && interval && !count && !replyTo)) return B_ERROR;
 
-	BLocker *hLocker = get_handler_operator_locker();
-	BAutolock <BLocker>autolock(hLocker);
+	BAutolock <BLocker>autolock(&runners.locker);
 
 	if (target) *target = (fTarget ? *fTarget : BMessenger());
 	if (replyTo) *replyTo = (fReplyTo ? *fReplyTo : BMessenger());
@@ -289,4 +474,3 @@ BMessageRunner::GetInfo(BMessenger *target, BMessage *msg, bigtime_t *interval,
 
 	return B_OK;
 }
-
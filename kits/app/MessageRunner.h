@@ -63,16 +63,29 @@ class BMessageRunner
 		                 BMessenger *replyTo = NULL) const;
 
 	private:
-		friend class BApplication;
-
-		int32 fToken;
+		bool fValid;
 
 		BMessenger *fTarget;
 		BMessenger *fReplyTo;
 		BMessage *fMessage;
 		bigtime_t fInterval;
-		bigtime_t fPrevSendTime;
 		int32 fCount;
+
+		// the slot in the timer heap, -1 when the runner isn't scheduled
+		int32 fIndex;
+		bigtime_t fDeadline;
+		bigtime_t fPrevSendTime; // the deadline of the last send, -1 before
+		bool fSending; // by the timer task without the locker
+
+		void _Schedule(bigtime_t deadline);
+		void _Unschedule();
+		bigtime_t _NextSendTime() const;
+		void _WaitForSending();
+		static void _SiftUp(int32 index);
+		static void _SiftDown(int32 index);
+
+		friend status_t start_message_runners();
+		static status_t _TimerTask(void *arg);
 };
 
 #endif /* __cplusplus */
@@ -32,8 +32,11 @@
 #include <kernel/Kernel.h>
 #include <support/ClassInfo.h>
 #include <support/Locker.h>
+#include <support/SimpleLocker.h>
 #include <support/Autolock.h>
 
+#include "AppDefs.h"
+#include "Application.h"
 #include "Messenger.h"
 
 extern BHandler* get_handler(uint64 token);
@@ -44,23 +47,374 @@ extern bool is_current_at_looper_thread(uint64 token);
 extern uint64 get_ref_handler_token(const BHandler *handler);
 extern bigtime_t get_handler_create_time_stamp(uint64 token);
 extern BLocker* get_handler_operator_locker();
+extern BLocker* get_handler_locker(uint64 token);
 extern uint64 get_ref_looper_token(uint64 token);
 
 
+// a message too big for a port is flattened into an area,
+// the sender leaves the area to the receiver
+typedef struct _e_area_ref_t {
+	char		name[B_OS_NAME_LENGTH + 1];
+	size_t		size;
+} _e_area_ref_t;
+
+// written to the port of the target team in front of the flattened message
+typedef struct _e_remote_header_t {
+	uint64		handlerToken;
+	bigtime_t	handlerTimestamp;
+	uint64		looperToken;
+	bigtime_t	looperTimestamp;
+
+	int64		replyTeam;
+	uint64		replyToken;
+	bigtime_t	replyTimestamp;
+	char		replyPort[B_OS_NAME_LENGTH + 1]; // empty unless the sender waits for the reply
+	uint32		replyRequest;
+
+	_e_area_ref_t	area; // empty name when the message follows the header
+} _e_remote_header_t;
+
+// the application publishes its team in an area named by its signature
+typedef struct _e_app_signature_t {
+	int64		team;
+	char		signature[256];
+} _e_app_signature_t;
+
+// written to a reply port in front of the flattened reply or the area of it,
+// the header alone tells that the message got deleted without a reply
+typedef struct _e_reply_header_t {
+	uint32		request;
+	uint32		reserved;
+} _e_reply_header_t;
+
+#define E_TEAM_PORT_QUEUE_LENGTH	64
+#define E_REPLY_PORT_QUEUE_LENGTH	4
+
+#ifdef _MSC_VER
+#define E_MESSENGER_THREAD_LOCAL	__declspec(thread)
+#else
+#define E_MESSENGER_THREAD_LOCAL	__thread
+#endif
+
+
+static char* team_port_name(int64 team)
+{
+	return b_strdup_printf("etk:t:%I64x", team);
+}
+
+
+static char* unique_ipc_name(const char *prefix)
+{
+	static int32 count = 0;
+	return b_strdup_printf("etk:%s:%I64x:%I32x", prefix, get_current_team_id(), __sync_add_and_fetch(&count, 1));
+}
+
+
+static char* app_signature_area_name(const char *signature)
+{
+	uint32 hash = 2166136261UL;
+	for (const char *c = signature; *c != 0; c++) hash = (hash ^ (uint8)(*c)) * 16777619UL;
+	return b_strdup_printf("etk:s:%I32x", hash);
+}
+
+
+// returns the area when the flattened "msg" went into it, the area gets deleted without
+// unlinking its name after the receiver got the reference, the receiver unlinks it on mapping
+static void* flatten_to_area(const BMessage *msg, _e_area_ref_t *ref)
+{
+	size_t size = 0;
+	const char *data = msg->FlattenedData(&size);
+	if (data == NULL) size = msg->FlattenedSize();
+
+	char *name = unique_ipc_name("a");
+	if (name == NULL) return NULL;
+
+	void *addr = NULL;
+	void *area = create_area(name, &addr, size, B_READ_AREA | B_WRITE_AREA, ETK_AREA_USER_DOMAIN, ETK_AREA_ACCESS_OWNER);
+	if (area != NULL) {
+		if (data != NULL) {
+			memcpy(addr, data, size);
+		} else if (msg->Flatten((char*)addr, size) == false) {
+			delete_area(area);
+			area = NULL;
+		}
+	}
+
+	if (area != NULL) {
+		bzero(ref->name, sizeof(ref->name));
+		strcpy(ref->name, name);
+		ref->size = size;
+	}
+
+	free(name);
+	return area;
+}
+
+
+static struct {
+	BLocker locker;
+	void *port;
+	void *thread;
+	void *signatureArea;
+} team_port;
+
+
+_LOCAL status_t start_team_port(const char *signature)
+{
+	BAutolock <BLocker>autolock(&team_port.locker);
+
+	if (team_port.port != NULL) return B_OK;
+
+	char *name = team_port_name(get_current_team_id());
+	if (name == NULL) return B_NO_MEMORY;
+	team_port.port = create_port(E_TEAM_PORT_QUEUE_LENGTH, name, ETK_AREA_ACCESS_OWNER);
+	free(name);
+
+	if (team_port.port == NULL) return B_NO_MORE_PORTS;
+
+	if ((team_port.thread = create_thread(BMessenger::_TeamPortTask, B_NORMAL_PRIORITY, team_port.port, NULL)) == NULL ||
+	        resume_thread(team_port.thread) != B_OK) {
+		if (team_port.thread) delete_thread(team_port.thread);
+		delete_port(team_port.port);
+		team_port.port = team_port.thread = NULL;
+		return B_ERROR;
+	}
+
+	if (signature != NULL && *signature != 0 && strlen(signature) < sizeof(((_e_app_signature_t*)NULL)->signature)) {
+		_e_app_signature_t *info = NULL;
+		if ((name = app_signature_area_name(signature)) != NULL) {
+			team_port.signatureArea = create_area(name, (void**)&info, sizeof(_e_app_signature_t),
+							      B_READ_AREA | B_WRITE_AREA, ETK_AREA_USER_DOMAIN, ETK_AREA_ACCESS_OWNER);
+			free(name);
+		}
+
+		if (info != NULL) {
+			bzero(info, sizeof(_e_app_signature_t));
+			info->team = get_current_team_id();
+			strcpy(info->signature, signature);
+		}
+	}
+
+	return B_OK;
+}
+
+
+_LOCAL void stop_team_port()
+{
+	BAutolock <BLocker>autolock(&team_port.locker);
+
+	if (team_port.port == NULL) return;
+
+	// the task leaves when the port is closed and empty
+	status_t status;
+	close_port(team_port.port);
+	wait_for_thread(team_port.thread, &status);
+	delete_thread(team_port.thread);
+	delete_port(team_port.port);
+
+	if (team_port.signatureArea) delete_area(team_port.signatureArea);
+
+	team_port.port = team_port.thread = team_port.signatureArea = NULL;
+}
+
+
+// the port a thread waits on for the replies of its synchronous requests,
+// the replies carry the request so the ones of timed out requests get skipped
+typedef struct _e_reply_port_t {
+	void *port;
+	char *name; // for the replies from the other teams
+	uint32 request;
+
+	struct _e_reply_port_t *prev;
+	struct _e_reply_port_t *next;
+} _e_reply_port_t;
+
+enum {
+	E_REPLY_PORTS_UNUSED = 0,
+	E_REPLY_PORTS_ACTIVE,
+	E_REPLY_PORTS_RELEASED // the thread is exiting
+};
+
+static E_MESSENGER_THREAD_LOCAL _e_reply_port_t *reply_ports[2];
+static E_MESSENGER_THREAD_LOCAL int32 reply_ports_state;
+
+// the named ports left by the threads not spawned by us get deleted at exit
+static _e_reply_port_t *named_reply_ports = NULL;
+
+
+static BSimpleLocker* named_reply_ports_locker()
+{
+	static BSimpleLocker locker(true);
+	return &locker;
+}
+
+
+// the areas of the replies nobody read any more would stay after the port
+static void delete_reply_port_areas(void *port)
+{
+	char buffer[ETK_MAX_PORT_BUFFER_SIZE];
+
+	while (true) {
+		ssize_t bufferSize = port_buffer_size_etc(port, B_TIMEOUT, B_INT64_CONSTANT(0));
+		if (bufferSize < 0) break;
+
+		int32 code;
+		if (read_port_etc(port, &code, buffer, sizeof(buffer), B_TIMEOUT, B_INT64_CONSTANT(0)) != B_OK) break;
+		if (code != _EVENTS_IN_AREA_ || (size_t)bufferSize != sizeof(_e_reply_header_t) + sizeof(_e_area_ref_t)) continue;
+
+		_e_area_ref_t ref;
+		memcpy(&ref, buffer + sizeof(_e_reply_header_t), sizeof(_e_area_ref_t));
+		ref.name[B_OS_NAME_LENGTH] = 0;
+
+		void *area = clone_area(ref.name, NULL, B_READ_AREA | B_WRITE_AREA, ETK_AREA_USER_DOMAIN);
+		if (area != NULL) delete_area_etc(area, true);
+	}
+}
+
+
+static void delete_reply_port(_e_reply_port_t *replyPort)
+{
+	if (replyPort->name != NULL) {
+		named_reply_ports_locker()->Lock();
+		if (replyPort->prev != NULL) replyPort->prev->next = replyPort->next;
+		else if (named_reply_ports == replyPort) named_reply_ports = replyPort->next;
+		if (replyPort->next != NULL) replyPort->next->prev = replyPort->prev;
+		named_reply_ports_locker()->Unlock();
+
+		free(replyPort->name);
+	}
+
+	delete_reply_port_areas(replyPort->port);
+	delete_port(replyPort->port);
+	delete replyPort;
+}
+
+
+static void release_reply_ports(void*)
+{
+	for (int32 i = 0; i < 2; i++) {
+		if (reply_ports[i] != NULL) delete_reply_port(reply_ports[i]);
+		reply_ports[i] = NULL;
+	}
+
+	reply_ports_state = E_REPLY_PORTS_RELEASED;
+}
+
+
+static void delete_named_reply_ports()
+{
+	named_reply_ports_locker()->Lock();
+	_e_reply_port_t *replyPort = named_reply_ports;
+	named_reply_ports = NULL;
+	named_reply_ports_locker()->Unlock();
+
+	// the process is exiting, the threads owning them don't wait any more
+	while (replyPort != NULL) {
+		_e_reply_port_t *next = replyPort->next;
+		replyPort->prev = replyPort->next = NULL;
+		free(replyPort->name);
+		replyPort->name = NULL;
+		delete_reply_port_areas(replyPort->port);
+		delete_port(replyPort->port);
+		replyPort->port = NULL;
+		replyPort = next;
+	}
+}
+
+
+static _e_reply_port_t* get_reply_port(bool named)
+{
+	_e_reply_port_t *replyPort = reply_ports[named ? 1 : 0];
+	if (replyPort != NULL) return(replyPort->port != NULL ? replyPort : NULL);
+	if (reply_ports_state == E_REPLY_PORTS_RELEASED) return NULL;
+
+	if ((replyPort = new _e_reply_port_t) == NULL) return NULL;
+	bzero(replyPort, sizeof(_e_reply_port_t));
+
+	if ((named && (replyPort->name = unique_ipc_name("r")) == NULL) ||
+	        (replyPort->port = create_port(E_REPLY_PORT_QUEUE_LENGTH, replyPort->name, ETK_AREA_ACCESS_OWNER)) == NULL) {
+		if (replyPort->name) free(replyPort->name);
+		delete replyPort;
+		return NULL;
+	}
+
+	if (reply_ports_state == E_REPLY_PORTS_UNUSED) {
+		void *thread = open_thread(get_current_thread_id());
+		if (thread != NULL) {
+			delete_thread(thread);
+			on_exit_thread(release_reply_ports, NULL);
+		}
+		reply_ports_state = E_REPLY_PORTS_ACTIVE;
+	}
+
+	if (named) {
+		static bool atExit = false;
+
+		named_reply_ports_locker()->Lock();
+		if (atExit == false) atExit = (atexit(delete_named_reply_ports) == 0);
+		if ((replyPort->next = named_reply_ports) != NULL) named_reply_ports->prev = replyPort;
+		named_reply_ports = replyPort;
+		named_reply_ports_locker()->Unlock();
+	}
+
+	reply_ports[named ? 1 : 0] = replyPort;
+	return replyPort;
+}
+
+
+// the request timed out, the replier finds the port closed instead of a source waiting,
+// the next request gets a new one
+static void drop_reply_port(_e_reply_port_t *replyPort)
+{
+	for (int32 i = 0; i < 2; i++) {
+		if (reply_ports[i] == replyPort) reply_ports[i] = NULL;
+	}
+
+	close_port(replyPort->port);
+	delete_reply_port(replyPort);
+}
+
+
 BMessenger::BMessenger()
 		: fHandlerToken(B_MAXUINT64), fLooperToken(B_MAXUINT64),
-		fPort(NULL), fSem(NULL), fTargetTeam(B_INT64_CONSTANT(0))
+		fPort(NULL), fHandlerTimestamp(B_MAXINT64), fLooperTimestamp(B_MAXINT64),
+		fTargetTeam(B_INT64_CONSTANT(0))
 {
 }
 
 
 BMessenger::BMessenger(const char *signature, int64 team, status_t *perr)
 		: fHandlerToken(B_MAXUINT64), fLooperToken(B_MAXUINT64),
-		fPort(NULL), fSem(NULL), fTargetTeam(B_INT64_CONSTANT(0))
+		fPort(NULL), fHandlerTimestamp(B_MAXINT64), fLooperTimestamp(B_MAXINT64),
+		fTargetTeam(B_INT64_CONSTANT(0))
 {
-	// TODO
-	ETK_WARNING("[APP]: %s --- Remote target unsupported yet.", __PRETTY_FUNCTION__);
-	if (perr) *perr = B_ERROR;
+	if (perr) *perr = B_BAD_VALUE;
+	if (signature == NULL || *signature == 0) return;
+
+	if (team == B_INT64_CONSTANT(0)) {
+		char *name = app_signature_area_name(signature);
+		if (name == NULL) return;
+
+		_e_app_signature_t *info = NULL;
+		void *area = clone_area(name, (void**)&info, B_READ_AREA, ETK_AREA_USER_DOMAIN);
+		free(name);
+		if (area == NULL) return;
+
+		if (info != NULL && strncmp(info->signature, signature, sizeof(info->signature)) == 0) team = info->team;
+		delete_area(area);
+
+		if (team == B_INT64_CONSTANT(0)) return;
+	}
+
+	if (team == get_current_team_id()) {
+		const char *appSignature = (app == NULL ? NULL : app->Signature());
+		if (appSignature != NULL && strcmp(appSignature, signature) == 0) InitData(NULL, app, perr);
+		return;
+	}
+
+	// no tokens for the application of the remote team
+	status_t status = _SetRemoteTarget(team, B_MAXUINT64, B_MAXINT64, B_MAXUINT64, B_MAXINT64);
+	if (perr) *perr = status;
 }
 
 
@@ -68,7 +422,8 @@ BMessenger::BMessenger(const BHandler *handler,
                        const BLooper *looper,
                        status_t *perr)
 		: fHandlerToken(B_MAXUINT64), fLooperToken(B_MAXUINT64),
-		fPort(NULL), fSem(NULL), fTargetTeam(B_INT64_CONSTANT(0))
+		fPort(NULL), fHandlerTimestamp(B_MAXINT64), fLooperTimestamp(B_MAXINT64),
+		fTargetTeam(B_INT64_CONSTANT(0))
 {
 	InitData(handler, looper, perr);
 }
@@ -76,11 +431,12 @@ BMessenger::BMessenger(const BHandler *handler,
 
 BMessenger::BMessenger(int64 targetTeam, uint64 targetToken, bigtime_t timestamp, status_t *perr)
 		: fHandlerToken(B_MAXUINT64), fLooperToken(B_MAXUINT64),
-		fPort(NULL), fSem(NULL), fTargetTeam(B_INT64_CONSTANT(0))
+		fPort(NULL), fHandlerTimestamp(B_MAXINT64), fLooperTimestamp(B_MAXINT64),
+		fTargetTeam(B_INT64_CONSTANT(0))
 {
 	if (targetTeam != get_current_team_id()) {
-		ETK_WARNING("[APP]: %s --- Remote target unsupported yet.", __PRETTY_FUNCTION__);
-		if (perr) *perr = B_ERROR;
+		status_t status = _SetRemoteTarget(targetTeam, targetToken, timestamp, B_MAXUINT64, B_MAXINT64);
+		if (perr) *perr = status;
 		return;
 	}
 
@@ -109,17 +465,19 @@ BMessenger::BMessenger(int64 targetTeam, uint64 targetToken, bigtime_t timestamp
 void
 BMessenger::InitData(const BHandler *handler, const BLooper *looper, status_t *perr)
 {
-	if (fHandlerToken != B_MAXUINT64) unref_handler(fHandlerToken);
-	if (fLooperToken != B_MAXUINT64) unref_handler(fLooperToken);
+	if (fPort != NULL) {
+		delete_port(fPort);
+	} else {
+		if (fHandlerToken != B_MAXUINT64) unref_handler(fHandlerToken);
+		if (fLooperToken != B_MAXUINT64) unref_handler(fLooperToken);
+	}
 
 	fHandlerToken = B_MAXUINT64;
 	fLooperToken = B_MAXUINT64;
 
-	if (fSem) delete_sem(fSem);
-	if (fPort) delete_port(fPort);
-
-	fSem = NULL;
 	fPort = NULL;
+	fHandlerTimestamp = B_MAXINT64;
+	fLooperTimestamp = B_MAXINT64;
 	fTargetTeam = B_INT64_CONSTANT(0);
 
 	if (perr) *perr = B_BAD_HANDLER;
@@ -152,9 +510,33 @@ BMessenger::InitData(const BHandler *handler, const BLooper *looper, status_t *p
 }
 
 
+status_t
+BMessenger::_SetRemoteTarget(int64 team, uint64 handlerToken, bigtime_t handlerTimestamp,
+			     uint64 looperToken, bigtime_t looperTimestamp)
+{
+	InitData(NULL, NULL, NULL);
+
+	char *name = team_port_name(team);
+	if (name == NULL) return B_NO_MEMORY;
+	fPort = open_port(name);
+	free(name);
+
+	if (fPort == NULL) return B_BAD_TEAM_ID;
+
+	fTargetTeam = team;
+	fHandlerToken = handlerToken;
+	fHandlerTimestamp = handlerTimestamp;
+	fLooperToken = looperToken;
+	fLooperTimestamp = looperTimestamp;
+
+	return B_OK;
+}
+
+
 BMessenger::BMessenger(const BMessenger &from)
 		: fHandlerToken(B_MAXUINT64), fLooperToken(B_MAXUINT64),
-		fPort(NULL), fSem(NULL), fTargetTeam(B_INT64_CONSTANT(0))
+		fPort(NULL), fHandlerTimestamp(B_MAXINT64), fLooperTimestamp(B_MAXINT64),
+		fTargetTeam(B_INT64_CONSTANT(0))
 {
 	*this = from;
 }
@@ -163,23 +545,15 @@ BMessenger::BMessenger(const BMessenger &from)
 BMessenger&
 BMessenger::operator=(const BMessenger &from)
 {
-	if (fHandlerToken != B_MAXUINT64) unref_handler(fHandlerToken);
-	if (fLooperToken != B_MAXUINT64) unref_handler(fLooperToken);
+	if (&from == this) return *this;
 
-	fHandlerToken = B_MAXUINT64;
-	fLooperToken = B_MAXUINT64;
-
-	if (fSem) delete_sem(fSem);
-	if (fPort) delete_port(fPort);
-
-	fSem = NULL;
-	fPort = NULL;
-	fTargetTeam = B_INT64_CONSTANT(0);
+	InitData(NULL, NULL, NULL);
 
 	if (!from.IsValid()) return *this;
 
 	if (!from.IsTargetLocal()) {
-		// TODO
+		_SetRemoteTarget(from.fTargetTeam, from.fHandlerToken, from.fHandlerTimestamp,
+				 from.fLooperToken, from.fLooperTimestamp);
 		return *this;
 	}
 
@@ -263,8 +637,7 @@ BMessenger::LockTargetWithTimeout(bigtime_t timeout) const
 {
 	if (!IsTargetLocal()) return B_ERROR;
 
-	BLocker *hLocker = get_handler_operator_locker();
-	BAutolock <BLocker>autolock(hLocker);
+	BAutolock <BLocker>autolock(get_handler_locker(fLooperToken));
 	BLooper *looper = get_handler_looper(fLooperToken);
 
 	return(looper ? looper->LockWithTimeout(timeout) :B_ERROR);
@@ -275,7 +648,7 @@ bool
 BMessenger::IsValid() const
 {
 	if (IsTargetLocal()) return(fLooperToken != B_MAXUINT64);
-	else return(fPort != NULL && fSem != NULL);
+	else return(fPort != NULL);
 }
 
 
@@ -297,16 +670,31 @@ BMessenger::SendMessage(const BMessage *a_message,
 		return B_BAD_VALUE;
 	}
 
-	uint64 replyToken = get_handler_token(reply_to);
+	// the copy shares the fields with "a_message"
+	BMessage *aMsg = new BMessage(*a_message);
+	if (aMsg == NULL) return B_NO_MEMORY;
 
-	BMessage aMsg(*a_message);
-	aMsg.fIsReply = false;
-	if (aMsg.fSource != NULL) {
-		delete_port(aMsg.fSource);
-		aMsg.fSource = NULL;
+	return SendAdoptedMessage(aMsg, reply_to, timeout);
+}
+
+
+status_t
+BMessenger::SendAdoptedMessage(BMessage *a_message,
+                               BHandler *reply_to,
+                               bigtime_t timeout) const
+{
+	if (a_message == NULL) {
+		ETK_WARNING("[APP]: %s --- Can't post empty message.", __PRETTY_FUNCTION__);
+		return B_BAD_VALUE;
 	}
 
-	return _SendMessage(&aMsg, replyToken, timeout);
+	uint64 replyToken = get_handler_token(reply_to);
+
+	a_message->fIsReply = false;
+	a_message->_ReleaseSource();
+	a_message->fSourceRequest = 0;
+
+	return _SendAdoptedMessage(a_message, replyToken, timeout);
 }
 
 
@@ -318,30 +706,53 @@ BMessenger::SendMessage(const BMessage *a_message, BMessage *reply_message, bigt
 		return B_BAD_VALUE;
 	}
 
-	void *port = create_port(1, NULL, ETK_AREA_ACCESS_OWNER);
-	if (port == NULL) return B_NO_MORE_PORTS;
+	if (!IsValid()) return B_ERROR;
+
+	// the reply from another team needs a port it can open by name
+	_e_reply_port_t *replyPort = get_reply_port(!IsTargetLocal());
+	if (replyPort == NULL) return B_NO_MORE_PORTS;
+
+	// skip the replies the previous requests got after they timed out
+	uint32 request = ++(replyPort->request);
+	if (request == 0) request = ++(replyPort->request);
+
+	status_t status;
+	BMessage *reply = NULL;
+
+	while ((reply = _GetMessageFromPort(replyPort->port, 0, B_TIMEOUT, B_INT64_CONSTANT(0), &status)) != NULL) delete reply;
+
+	if (replyPort->name != NULL) {
+		status = _SendRemoteMessage(a_message, B_MAXUINT64, replyPort->name, request, sendTimeout);
+	} else {
+		BMessage *aMsg = new BMessage(*a_message);
+		if (aMsg == NULL) return B_NO_MEMORY;
+
+		aMsg->_ReleaseSource(false);
+		aMsg->fTeam = get_current_team_id();
+		aMsg->fIsReply = false;
+		aMsg->fReplyToken = B_MAXUINT64;
+		aMsg->fReplyTokenTimestamp = B_MAXINT64;
+		if ((aMsg->fSource = open_port_by_source(replyPort->port)) == NULL) {
+			delete aMsg;
+			return B_NO_MORE_PORTS;
+		}
+		aMsg->fSourceRequest = request;
+		aMsg->fNoticeSource = true; // no reply when deleted
+
+		status = _SendAdoptedMessage(aMsg, B_MAXUINT64, sendTimeout);
+	}
 
-	BMessage *aMsg = new BMessage(*a_message);
-	if (aMsg->fSource != NULL) delete_port(aMsg->fSource);
-	aMsg->fTeam = get_current_team_id();
-	aMsg->fIsReply = false;
-	aMsg->fReplyToken = B_MAXUINT64;
-	aMsg->fReplyTokenTimestamp = B_MAXINT64;
-	aMsg->fNoticeSource = true; // auto close the port when deleted
-	aMsg->fSource = port; // auto delete the port when deleted
-
-	status_t status = _SendMessage(aMsg, B_MAXUINT64, sendTimeout);
 	if (status == B_OK) {
-		BMessage *reply = _GetMessageFromPort(port, B_TIMEOUT, replyTimeout, &status);
+		reply = _GetMessageFromPort(replyPort->port, request, B_TIMEOUT, replyTimeout, &status);
 		if (reply != NULL) {
 			*reply_message = *reply;
 			delete reply;
 		} else {
 			reply_message->what = B_NO_REPLY;
+			if (status == B_TIMED_OUT || status == B_WOULD_BLOCK) drop_reply_port(replyPort);
 		}
 	}
 
-	delete aMsg;
 	return status;
 }
 
@@ -354,15 +765,12 @@ BMessenger::_SendMessage(const BMessage *a_message,
 	if (a_message == NULL) return B_BAD_VALUE;
 	if (!IsValid()) return B_ERROR;
 
-	if (!IsTargetLocal()) {
-		// TODO
-		return B_ERROR;
-	}
+	if (!IsTargetLocal()) return _SendRemoteMessage(a_message, replyToken, NULL, 0, timeout);
 
 	status_t retVal = B_ERROR;
 
-	BLocker *hLocker = get_handler_operator_locker();
-	BAutolock <BLocker>autolock(hLocker);
+	// the looper can't be deleted while its token is locked
+	BAutolock <BLocker>autolock(get_handler_locker(fLooperToken));
 
 	BLooper *looper = cast_as(get_handler(fLooperToken), BLooper);
 	if (looper) retVal = looper->_PostMessage(a_message, fHandlerToken, replyToken, timeout);
@@ -372,33 +780,94 @@ BMessenger::_SendMessage(const BMessage *a_message,
 
 
 status_t
-BMessenger::_SendMessageToPort(void *port, const BMessage *msg, uint32 flags, bigtime_t timeout)
+BMessenger::_SendAdoptedMessage(BMessage *a_message,
+                                uint64 replyToken,
+                                bigtime_t timeout) const
 {
-	if (!port || !msg) return B_ERROR;
+	if (a_message == NULL) return B_BAD_VALUE;
 
-	size_t flattenedSize = msg->FlattenedSize();
-	if (flattenedSize <= 0) {
-		ETK_WARNING("[APP]: Faltten size little than 1. (%s:%d)", __FILE__, __LINE__);
+	if (!IsValid()) {
+		delete a_message;
 		return B_ERROR;
 	}
 
-	char *buffer = (char*)malloc(flattenedSize);
-	if (!buffer) {
-		ETK_WARNING("[APP]: Buffer malloc failed. (%s:%d)", __FILE__, __LINE__);
-		return B_NO_MEMORY;
+	if (!IsTargetLocal()) {
+		status_t status = _SendRemoteMessage(a_message, replyToken, NULL, 0, timeout);
+		delete a_message;
+		return status;
 	}
 
-	if (msg->Flatten(buffer, flattenedSize) == false) {
-		free(buffer);
-		ETK_WARNING("[APP]: Flatten message failed. (%s:%d)", __FILE__, __LINE__);
+	BAutolock <BLocker>autolock(get_handler_locker(fLooperToken));
+
+	BLooper *looper = cast_as(get_handler(fLooperToken), BLooper);
+	if (looper == NULL) {
+		delete a_message;
 		return B_ERROR;
 	}
 
-	status_t status;
-	if ((status = write_port_etc(port, _EVENTS_PENDING_, buffer, flattenedSize, flags, timeout)) != B_OK) {
-		free(buffer);
-		ETK_WARNING("[APP]: write port %s. (%s:%d)", status == B_TIMEOUT ? "time out" : "failed", __FILE__, __LINE__);
-		return status;
+	return looper->_PostAdoptedMessage(a_message, fHandlerToken, replyToken, timeout);
+}
+
+
+status_t
+BMessenger::_SendRemoteMessage(const BMessage *a_message,
+                               uint64 replyToken,
+                               const char *replyPort,
+                               uint32 replyRequest,
+                               bigtime_t timeout) const
+{
+	char buffer[ETK_MAX_PORT_BUFFER_SIZE];
+	_e_remote_header_t *header = (_e_remote_header_t*)buffer;
+
+	bzero(header, sizeof(_e_remote_header_t));
+	header->handlerToken = fHandlerToken;
+	header->handlerTimestamp = fHandlerTimestamp;
+	header->looperToken = fLooperToken;
+	header->looperTimestamp = fLooperTimestamp;
+	header->replyTeam = get_current_team_id();
+	header->replyToken = replyToken;
+	header->replyTimestamp = get_handler_create_time_stamp(replyToken);
+	if (replyPort != NULL) strncpy(header->replyPort, replyPort, B_OS_NAME_LENGTH);
+	header->replyRequest = replyRequest;
+
+	size_t size = 0;
+	const char *data = a_message->FlattenedData(&size);
+	if (data == NULL) size = a_message->FlattenedSize();
+
+	void *area = NULL;
+	if (size <= sizeof(buffer) - sizeof(_e_remote_header_t)) {
+		if (data != NULL)
+			memcpy(buffer + sizeof(_e_remote_header_t), data, size);
+		else if (a_message->Flatten(buffer + sizeof(_e_remote_header_t), size) == false)
+			return B_ERROR;
+	} else {
+		// the receiver maps the area instead of reading the message through the port
+		if ((area = flatten_to_area(a_message, &header->area)) == NULL) return B_NO_MEMORY;
+		size = 0;
+	}
+
+	status_t status = write_port_etc(fPort, _REMOTE_EVENTS_, buffer, sizeof(_e_remote_header_t) + size, B_TIMEOUT, timeout);
+	if (area != NULL) delete_area_etc(area, status != B_OK);
+
+	return status;
+}
+
+
+status_t
+BMessenger::_TeamPortTask(void *port)
+{
+	char *buffer = (char*)malloc(ETK_MAX_PORT_BUFFER_SIZE);
+	if (buffer == NULL) return B_NO_MEMORY;
+
+	while (true) {
+		ssize_t size = port_buffer_size_etc(port, B_TIMEOUT, B_INFINITE_TIMEOUT);
+		if (size < 0) break;
+
+		int32 code;
+		if (read_port_etc(port, &code, buffer, (size_t)size, B_TIMEOUT, B_INT64_CONSTANT(0)) != B_OK) break;
+		if (code != _REMOTE_EVENTS_ || (size_t)size < sizeof(_e_remote_header_t)) continue;
+
+		_DeliverRemoteMessage(buffer, (size_t)size);
 	}
 
 	free(buffer);
@@ -407,72 +876,236 @@ BMessenger::_SendMessageToPort(void *port, const BMessage *msg, uint32 flags, bi
 }
 
 
+void
+BMessenger::_DeliverRemoteMessage(const char *buffer, size_t size)
+{
+	_e_remote_header_t header;
+	memcpy(&header, buffer, sizeof(_e_remote_header_t));
+	buffer += sizeof(_e_remote_header_t);
+	size -= sizeof(_e_remote_header_t);
+
+	BMessage *msg = NULL;
+
+	if (header.area.name[0] != 0) {
+		header.area.name[B_OS_NAME_LENGTH] = 0;
+		msg = _MessageFromArea(header.area.name, header.area.size);
+	} else if (size > 0) {
+		char *flattened = BMessage::_AllocFlattened(size);
+		if (flattened != NULL) {
+			memcpy(flattened, buffer, size);
+			if ((msg = new BMessage()) != NULL && msg->_Unflatten(flattened, size, true, true) == false) {
+				delete msg;
+				msg = NULL;
+			}
+			if (msg == NULL) BMessage::_FreeFlattened(flattened, size);
+		}
+	}
+
+	if (msg == NULL) {
+		ETK_WARNING("[APP]: %s --- Invalid message from team %I64i.", __PRETTY_FUNCTION__, header.replyTeam);
+		return;
+	}
+
+	// the replies go back to the sending team
+	msg->fReplyTeam = header.replyTeam;
+	msg->fReplyToken = header.replyToken;
+	msg->fReplyTokenTimestamp = header.replyTimestamp;
+	if (header.replyPort[0] != 0) {
+		header.replyPort[B_OS_NAME_LENGTH] = 0;
+		msg->fSource = open_port(header.replyPort);
+		msg->fSourceRequest = header.replyRequest;
+		msg->fNoticeSource = (msg->fSource != NULL); // no reply when deleted
+	}
+
+	uint64 handlerToken = header.handlerToken;
+	if (handlerToken == B_MAXUINT64 && header.looperToken == B_MAXUINT64) {
+		// messenger made by the signature, the application handles the message itself
+		handlerToken = get_handler_token(app);
+	}
+
+	// the looper can't be deleted while the token of the target is locked,
+	// neither can the handler leave it
+	BAutolock <BLocker>autolock(get_handler_locker(handlerToken != B_MAXUINT64 ? handlerToken : header.looperToken));
+
+	BLooper *looper = NULL;
+	if (header.handlerToken != B_MAXUINT64) {
+		if (get_handler_create_time_stamp(header.handlerToken) == header.handlerTimestamp)
+			looper = get_handler_looper(header.handlerToken);
+	} else if (header.looperToken != B_MAXUINT64) {
+		if (get_handler_create_time_stamp(header.looperToken) == header.looperTimestamp)
+			looper = cast_as(get_handler(header.looperToken), BLooper);
+	} else if (handlerToken != B_MAXUINT64) {
+		looper = cast_as(get_handler(handlerToken), BLooper);
+	}
+
+	if (looper == NULL) {
+		delete msg;
+		return;
+	}
+
+	looper->_PostAdoptedMessage(msg, handlerToken, B_MAXUINT64, B_INFINITE_TIMEOUT);
+}
+
+
 BMessage*
-BMessenger::_GetMessageFromPort(void *port, uint32 flags, bigtime_t timeout, status_t *err)
+BMessenger::_MessageFromArea(const char *name, size_t size)
+{
+	void *addr = NULL;
+	void *area = clone_area(name, &addr, B_READ_AREA | B_WRITE_AREA, ETK_AREA_USER_DOMAIN);
+	if (area == NULL) return NULL;
+
+	// only the mapping keeps it from here on, nothing is left behind when this team quits
+	unlink_area(area);
+
+	// the message decodes its fields from the mapping, the large values stay there
+	area_info info;
+	BMessage *msg = NULL;
+	if (get_area_info(area, &info) != B_OK || size > info.size ||
+	    (msg = new BMessage()) == NULL || msg->_Unflatten((const char*)addr, size, true, false) == false) {
+		if (msg) delete msg;
+		delete_area(area);
+		return NULL;
+	}
+	msg->fFlattenedArea = area;
+
+	return msg;
+}
+
+
+status_t
+BMessenger::_SendMessageToPort(void *port, const BMessage *msg, uint32 request, uint32 flags, bigtime_t timeout)
+{
+	if (!port) return B_ERROR;
+
+	char buffer[ETK_MAX_PORT_BUFFER_SIZE];
+	_e_reply_header_t *header = (_e_reply_header_t*)buffer;
+	bzero(header, sizeof(_e_reply_header_t));
+	header->request = request;
+
+	// without message, the header tells the thread waiting there is no reply
+	size_t flattenedSize = 0;
+	const char *data = NULL;
+	int32 code = _EVENTS_PENDING_;
+	void *area = NULL;
+
+	if (msg != NULL) {
+		// an unchanged message from a port gets passed on as it is
+		if ((data = msg->FlattenedData(&flattenedSize)) == NULL) flattenedSize = msg->FlattenedSize();
+		if (flattenedSize <= 0) {
+			ETK_WARNING("[APP]: Faltten size little than 1. (%s:%d)", __FILE__, __LINE__);
+			return B_ERROR;
+		}
+
+		if (flattenedSize > sizeof(buffer) - sizeof(_e_reply_header_t)) {
+			// too big for the port, the reader maps the area
+			_e_area_ref_t ref;
+			if ((area = flatten_to_area(msg, &ref)) == NULL) {
+				ETK_WARNING("[APP]: Flatten message to area failed. (%s:%d)", __FILE__, __LINE__);
+				return B_NO_MEMORY;
+			}
+
+			memcpy(buffer + sizeof(_e_reply_header_t), &ref, sizeof(ref));
+			flattenedSize = sizeof(ref);
+			code = _EVENTS_IN_AREA_;
+		} else if (data != NULL) {
+			memcpy(buffer + sizeof(_e_reply_header_t), data, flattenedSize);
+		} else if (msg->Flatten(buffer + sizeof(_e_reply_header_t), flattenedSize) == false) {
+			ETK_WARNING("[APP]: Flatten message failed. (%s:%d)", __FILE__, __LINE__);
+			return B_ERROR;
+		}
+	}
+
+	status_t status = write_port_etc(port, code, buffer, sizeof(_e_reply_header_t) + flattenedSize, flags, timeout);
+	if (area != NULL) delete_area_etc(area, status != B_OK);
+
+	if (status != B_OK && msg != NULL)
+		ETK_WARNING("[APP]: write port %s. (%s:%d)", status == B_TIMEOUT ? "time out" : "failed", __FILE__, __LINE__);
+
+	return status;
+}
+
+
+BMessage*
+BMessenger::_GetMessageFromPort(void *port, uint32 request, uint32 flags, bigtime_t timeout, status_t *err)
 {
 	status_t retErr = B_OK;
 	BMessage* retMsg = NULL;
 
-	do {
-		ssize_t bufferSize = port_buffer_size_etc(port, flags, timeout);
-		if (bufferSize == 0) {
-			int32 code;
-			retErr = read_port_etc(port, &code, NULL, 0, B_TIMEOUT, B_INT64_CONSTANT(0));
-//			if(retErr != B_OK) ETK_DEBUG("[APP]: Port read failed(0x%x). (%s:%d)", retErr, __FILE__, __LINE__);
-			break;
-		} else if (bufferSize < 0) {
-			retErr = bufferSize;
-//			if(!(retErr == B_WOULD_BLOCK || retErr == B_TIMED_OUT))
-//				ETK_DEBUG("[APP]: Port read failed(0x%x). (%s:%d)", retErr, __FILE__, __LINE__);
-			break;
+	// the replies of the requests timed out before get skipped within the same time
+	if (flags != B_ABSOLUTE_TIMEOUT && timeout != B_INFINITE_TIMEOUT && timeout >= B_INT64_CONSTANT(0)) {
+		bigtime_t currentTime = real_time_clock_usecs();
+		if (timeout < B_MAXINT64 - currentTime) {
+			timeout += currentTime;
+			flags = B_ABSOLUTE_TIMEOUT;
 		}
+	}
 
-		char *buffer = (char*)malloc((size_t)bufferSize);
-		if (!buffer) {
-			retErr = B_NO_MEMORY;
-			ETK_WARNING("[APP]: Memory alloc failed. (%s:%d)", __FILE__, __LINE__);
+	char buffer[ETK_MAX_PORT_BUFFER_SIZE];
+
+	while (true) {
+		ssize_t bufferSize = port_buffer_size_etc(port, flags, timeout);
+		if (bufferSize < 0) {
+			retErr = bufferSize;
 			break;
 		}
-		bzero(buffer, (size_t)bufferSize);
 
 		int32 code;
-		if ((retErr = read_port_etc(port, &code, buffer, bufferSize, B_TIMEOUT, B_INT64_CONSTANT(0))) != B_OK) {
-//			ETK_DEBUG("[APP]: Port read failed(0x%x). (%s:%d)", retErr, __FILE__, __LINE__);
-			free(buffer);
-			break;
-		}
-		if (code != _EVENTS_PENDING_ || (size_t)bufferSize < sizeof(size_t)) {
-			ETK_WARNING("[APP]: Message is invalid. (%s:%d)", __FILE__, __LINE__);
-			free(buffer);
-			retErr = B_ERROR;
+		if ((retErr = read_port_etc(port, &code, buffer, sizeof(buffer), B_TIMEOUT, B_INT64_CONSTANT(0))) != B_OK) break;
+		if ((size_t)bufferSize < sizeof(_e_reply_header_t) || (size_t)bufferSize > sizeof(buffer)) continue;
+
+		_e_reply_header_t header;
+		memcpy(&header, buffer, sizeof(_e_reply_header_t));
+		const char *data = buffer + sizeof(_e_reply_header_t);
+		size_t msgBufferSize = (size_t)bufferSize - sizeof(_e_reply_header_t);
+
+		if (code == _EVENTS_IN_AREA_ && msgBufferSize == sizeof(_e_area_ref_t)) {
+			_e_area_ref_t ref;
+			memcpy(&ref, data, sizeof(_e_area_ref_t));
+
+			// mapping the area of a late reply frees it as well
+			ref.name[B_OS_NAME_LENGTH] = 0;
+			if ((retMsg = _MessageFromArea(ref.name, ref.size)) == NULL) {
+				if (header.request != request) continue;
+				ETK_WARNING("[APP]: Message from area is invalid. (%s:%d)", __FILE__, __LINE__);
+				retErr = B_ERROR;
+			} else if (header.request != request) {
+				delete retMsg;
+				retMsg = NULL;
+				continue;
+			}
 			break;
 		}
 
-		size_t msgBufferSize = 0;
-		memcpy(&msgBufferSize, buffer, sizeof(size_t));
-		if (bufferSize != (ssize_t)msgBufferSize) { /* the first "size_t" == FlattenedSize() */
-			ETK_WARNING("[APP]: Message length is invalid. (%s:%d)", __FILE__, __LINE__);
-			free(buffer);
+		if (header.request != request) continue;
+		if (msgBufferSize == 0) break; // deleted without reply
+
+		size_t flattenedSize = 0;
+		if (code == _EVENTS_PENDING_ && msgBufferSize >= sizeof(size_t)) memcpy(&flattenedSize, data, sizeof(size_t));
+		if (flattenedSize != msgBufferSize) { /* the first "size_t" == FlattenedSize() */
+			ETK_WARNING("[APP]: Message is invalid. (%s:%d)", __FILE__, __LINE__);
 			retErr = B_ERROR;
 			break;
 		}
 
-		if ((retMsg = new BMessage()) == NULL) {
+		char *flattened = BMessage::_AllocFlattened(msgBufferSize);
+		if (flattened == NULL || (retMsg = new BMessage()) == NULL) {
 			ETK_WARNING("[APP]: Memory alloc failed. (%s:%d)", __FILE__, __LINE__);
-			free(buffer);
+			if (flattened) BMessage::_FreeFlattened(flattened, msgBufferSize);
 			retErr = B_NO_MEMORY;
 			break;
 		}
 
-		if (retMsg->Unflatten(buffer, msgBufferSize) == false) {
+		// the message keeps the buffer, the fields get decoded when accessed
+		memcpy(flattened, data, msgBufferSize);
+		if (retMsg->_Unflatten(flattened, msgBufferSize, true, true) == false) {
 			ETK_WARNING("[APP]: Message unflatten failed. (%s:%d)", __FILE__, __LINE__);
 			delete retMsg;
 			retMsg = NULL;
 			retErr = B_ERROR;
+			BMessage::_FreeFlattened(flattened, msgBufferSize);
 		}
-
-		free(buffer);
-	} while (false);
+		break;
+	}
 
 	if (err) *err = retErr;
 	return retMsg;
@@ -491,8 +1124,13 @@ BMessenger::Flatten(char *buffer, size_t bufferSize) const
 {
 	if (buffer == NULL || bufferSize < FlattenedSize()) return false;
 
-	bigtime_t handler_stamp = get_handler_create_time_stamp(fHandlerToken);
-	bigtime_t looper_stamp = get_handler_create_time_stamp(fLooperToken);
+	bigtime_t handler_stamp = fHandlerTimestamp;
+	bigtime_t looper_stamp = fLooperTimestamp;
+
+	if (IsTargetLocal()) {
+		handler_stamp = get_handler_create_time_stamp(fHandlerToken);
+		looper_stamp = get_handler_create_time_stamp(fLooperToken);
+	}
 
 	memcpy(buffer, &fTargetTeam, sizeof(int64));
 	buffer += sizeof(int64);
@@ -530,23 +1168,14 @@ BMessenger::Unflatten(const char *buffer, size_t bufferSize)
 	buffer += sizeof(uint64);
 	memcpy(&looper_stamp, buffer, sizeof(bigtime_t));
 
-	if (fHandlerToken != B_MAXUINT64) unref_handler(fHandlerToken);
-	if (fLooperToken != B_MAXUINT64) unref_handler(fLooperToken);
-
-	fHandlerToken = B_MAXUINT64;
-	fLooperToken = B_MAXUINT64;
-
-	if (fSem) delete_sem(fSem);
-	if (fPort) delete_port(fPort);
-
-	fSem = NULL;
-	fPort = NULL;
-	fTargetTeam = B_INT64_CONSTANT(0);
+	InitData(NULL, NULL, NULL);
 
 	do {
+		if (target_team == B_INT64_CONSTANT(0)) break;
+
 		if (target_team != get_current_team_id()) {
-			// TODO
-			ETK_DEBUG("[APP]: %s --- Remote target unsupported.", __PRETTY_FUNCTION__);
+			if (_SetRemoteTarget(target_team, handler_token, handler_stamp, looper_token, looper_stamp) != B_OK)
+				ETK_DEBUG("[APP]: %s --- Invalid remote target.", __PRETTY_FUNCTION__);
 			break;
 		}
 
@@ -587,10 +1216,10 @@ BMessenger::PrintToStream() const
 
 	ETK_OUTPUT("\tToken of target looper: ");
 	if (fLooperToken == B_MAXUINT64) ETK_OUTPUT("B_MAXUINT64\n");
-	else ETK_OUTPUT("%I64u - %p\n", fLooperToken, get_handler(fLooperToken));
+	else if (IsTargetLocal()) ETK_OUTPUT("%I64u - %p\n", fLooperToken, get_handler(fLooperToken));
+	else ETK_OUTPUT("%I64u\n", fLooperToken);
 
-	if (fPort == NULL) ETK_OUTPUT("\tPort invalid.\n");
-	if (fSem == NULL) ETK_OUTPUT("\tSemaphore invalid.\n");
+	if (!IsTargetLocal()) ETK_OUTPUT("\tPort of target team %s.\n", fPort == NULL ? "invalid" : "opened");
 
 	ETK_OUTPUT("*******************************************\n");
 }
@@ -39,6 +39,10 @@ class BMessenger
 {
 	public:
 		BMessenger();
+		// BMessenger(signature, team):
+		// 	Targets the application of "team", 0 looks for the team running "signature".
+		// 	The messages to other teams go through the port the application opens for them,
+		// 	the large ones through an area the target maps.
 		BMessenger(const char *signature, int64 team = 0, status_t *perr = NULL);
 		BMessenger(const BHandler *handler, const BLooper *looper = NULL, status_t *perr = NULL);
 
@@ -59,6 +63,11 @@ class BMessenger
 		                     bigtime_t sendTimeout = B_INFINITE_TIMEOUT,
 		                     bigtime_t replyTimeout = B_INFINITE_TIMEOUT) const;
 
+		// SendAdoptedMessage():
+		// 	The target takes "a_message" itself instead of a copy, it's deleted when failed.
+		status_t	SendAdoptedMessage(BMessage *a_message, BHandler *reply_to = NULL,
+		                            bigtime_t timeout = B_INFINITE_TIMEOUT) const;
+
 		bool		IsValid() const;
 
 		BMessenger	&operator=(const BMessenger &from);
@@ -74,23 +83,38 @@ class BMessenger
 	private:
 		friend class BMessage;
 		friend class BInvoker;
+		friend status_t start_team_port(const char *signature);
 
 		BMessenger(int64 targetTeam, uint64 targetToken, bigtime_t timestamp, status_t *perr);
 
 		uint64 fHandlerToken;
 		uint64 fLooperToken;
 
+		// a remote target gets the messages through the port of its team,
+		// the tokens belong to that team then
 		void *fPort;
-		void *fSem;
+		bigtime_t fHandlerTimestamp;
+		bigtime_t fLooperTimestamp;
 
 		int64 fTargetTeam;
 
 		void InitData(const BHandler *handler, const BLooper *looper, status_t *perr);
+		status_t _SetRemoteTarget(int64 team, uint64 handlerToken, bigtime_t handlerTimestamp,
+					  uint64 looperToken, bigtime_t looperTimestamp);
 
-		static status_t _SendMessageToPort(void *port, const BMessage *msg, uint32 flags, bigtime_t timeout);
-		static BMessage* _GetMessageFromPort(void *port, uint32 flags, bigtime_t timeout, status_t *err);
+		static status_t _SendMessageToPort(void *port, const BMessage *msg, uint32 request,
+						   uint32 flags, bigtime_t timeout);
+		static BMessage* _GetMessageFromPort(void *port, uint32 request,
+						     uint32 flags, bigtime_t timeout, status_t *err);
+		static BMessage* _MessageFromArea(const char *name, size_t size);
 
 		status_t _SendMessage(const BMessage *a_message, uint64 replyToken, bigtime_t timeout) const;
+		status_t _SendAdoptedMessage(BMessage *a_message, uint64 replyToken, bigtime_t timeout) const;
+		status_t _SendRemoteMessage(const BMessage *a_message, uint64 replyToken,
+					    const char *replyPort, uint32 replyRequest, bigtime_t timeout) const;
+
+		static status_t _TeamPortTask(void *port);
+		static void _DeliverRemoteMessage(const char *buffer, size_t size);
 };
 
 #endif /* __cplusplus */
@@ -175,11 +175,13 @@ BView::MessageReceived(BMessage *msg)
 		case B_MOUSE_DOWN:
 		case B_MOUSE_UP:
 		case B_MOUSE_MOVED: {
+			static const BMessageAtom atomWhere("where");
+
 			BWindow *win = Window();
 			if (win == NULL) break;
 
 			BPoint where;
-			if (msg->FindPoint("where", &where) == false) break;
+			if (msg->FindPoint(atomWhere, &where) == false) break;
 
 			for (BView *child = ChildAt(0); child != NULL; child = child->NextSibling()) {
 				BPoint pt = child->fLayout->ConvertFromContainer(where);
@@ -187,7 +189,7 @@ BView::MessageReceived(BMessage *msg)
 				if (child->fLayout->VisibleRegion()->Contains(pt) == false) continue;
 				if (!(child->EventMask() &B_POINTER_EVENTS)) {
 					BMessage aMsg(*msg);
-					aMsg.ReplacePoint("where", pt);
+					aMsg.ReplacePoint(atomWhere, pt);
 					win->PostMessage(&aMsg, child);
 				}
 
@@ -2488,8 +2490,10 @@ BView::QueryCurrentMouse(bool pushed, int32 buttons, bool btnsAlone, int32 *clic
 	if (pushed && msg->what != B_MOUSE_DOWN) return false;
 	if (pushed == false && msg->what != B_MOUSE_UP) return false;
 
+	static const BMessageAtom atomButtons("buttons");
+
 	int32 btns;
-	if (msg->FindInt32("buttons", &btns) == false) return false;
+	if (msg->FindInt32(atomButtons, &btns) == false) return false;
 
 	if (clicks) {
 		if (msg->FindInt32("clicks", clicks) == false) *clicks = 1;
@@ -149,6 +149,33 @@ BWindowLayoutContainer::Invalidate(BRect rect)
 }
 
 
+// the exposed or invalidated frames of pending updates add up
+static bool window_merge_update(BMessage *pending, const BMessage *msg)
+{
+	BRect r1, r2;
+	bool expose1 = false, expose2 = false;
+
+	pending->FindBool("etk:expose", &expose1);
+	msg->FindBool("etk:expose", &expose2);
+	if (expose1 != expose2) return false;
+
+	if (pending->FindRect("etk:frame", &r1) == false || msg->FindRect("etk:frame", &r2) == false) return false;
+
+	return pending->ReplaceRect("etk:frame", r1 | r2);
+}
+
+
+static bool window_merge_update_if_needed(BMessage *pending, const BMessage *msg)
+{
+	bigtime_t when;
+	if (msg->FindInt64("when", &when)) {
+		if (pending->ReplaceInt64("when", when) == false) pending->AddInt64("when", when);
+	}
+
+	return true;
+}
+
+
 void
 BWindow::InitSelf(BRect frame, const char *title, window_look look, window_feel feel, uint32 flags, uint32 workspace)
 {
@@ -209,6 +236,11 @@ BWindow::InitSelf(BRect frame, const char *title, window_look look, window_feel
 	fBrokeOnExpose = false;
 	fWindowWorkspaces = 0;
 
+	// a fast pointer or a busy redraw mustn't pile up stale messages
+	MessageQueue()->SetCoalescing(B_MOUSE_MOVED);
+	MessageQueue()->SetCoalescing(_UPDATE_, window_merge_update);
+	MessageQueue()->SetCoalescing(_UPDATE_IF_NEEDED_, window_merge_update_if_needed);
+
 	fWindow->ContactTo(&msgrSelf);
 
 	SetWorkspaces(workspace);
@@ -314,14 +346,17 @@ BWindow::DispatchMessage(BMessage *msg, BHandler *target)
 		case B_MOUSE_UP:
 		case B_MOUSE_MOVED:
 		case B_MOUSE_WHEEL_CHANGED: {
+			static const BMessageAtom atomWhere("where");
+			static const BMessageAtom atomScreenWhere("screen_where");
+
 			BPoint where;
-			if (msg->FindPoint("where", &where) == false && msg->what != B_MOUSE_WHEEL_CHANGED) {
-				if (msg->FindPoint("screen_where", &where) == false) {
+			if (msg->FindPoint(atomWhere, &where) == false && msg->what != B_MOUSE_WHEEL_CHANGED) {
+				if (msg->FindPoint(atomScreenWhere, &where) == false) {
 					ETK_DEBUG("[INTERFACE]: %s --- Invalid message.", __PRETTY_FUNCTION__);
 					break;
 				}
 				ConvertFromScreen(&where);
-				msg->AddPoint("where", where);
+				msg->AddPoint(atomWhere, where);
 			}
 
 			BMessage aMsg(*msg);
@@ -336,7 +371,7 @@ BWindow::DispatchMessage(BMessage *msg, BHandler *target)
 					if (view->fLayout->VisibleRegion()->Contains(pt)) continue;
 					if (view->EventMask() &B_POINTER_EVENTS) continue;
 
-					aMsg.ReplacePoint("where", pt);
+					aMsg.ReplacePoint(atomWhere, pt);
 					PostMessage(&aMsg, view);
 				}
 				aMsg.what = saveWhat;
@@ -347,7 +382,7 @@ BWindow::DispatchMessage(BMessage *msg, BHandler *target)
 				if (view->fLayout->VisibleRegion()->Contains(pt) == false) continue;
 
 				if (!(view->EventMask() &B_POINTER_EVENTS)) {
-					aMsg.ReplacePoint("where", pt);
+					aMsg.ReplacePoint(atomWhere, pt);
 					PostMessage(&aMsg, view);
 				}
 
@@ -357,7 +392,7 @@ BWindow::DispatchMessage(BMessage *msg, BHandler *target)
 			for (int32 i = 0; i < fMouseInterestedViews.CountItems(); i++) {
 				BView *view = (BView*)fMouseInterestedViews.ItemAt(i);
 
-				aMsg.ReplacePoint("where", view->ConvertFromWindow(where));
+				aMsg.ReplacePoint(atomWhere, view->ConvertFromWindow(where));
 				PostMessage(&aMsg, view);
 			}
 		}
@@ -168,6 +168,13 @@ BDFBGraphicsEngine::InitCheck()
 
 static void process_dfb_event(BDFBGraphicsEngine *dfbEngine, DFBEvent *evt)
 {
+	// the names of the fields every pointer event carries
+	static const BMessageAtom atomWhen("when");
+	static const BMessageAtom atomWhere("where");
+	static const BMessageAtom atomScreenWhere("screen_where");
+	static const BMessageAtom atomButtons("buttons");
+	static const BMessageAtom atomFromGui("etk:msg_from_gui");
+
 	if (dfbEngine == NULL || evt == NULL) return;
 
 	bigtime_t currentTime = e_real_time_clock_usecs();
@@ -176,8 +183,8 @@ static void process_dfb_event(BDFBGraphicsEngine *dfbEngine, DFBEvent *evt)
 	BMessenger etkWinMsgr;
 	BMessage message;
 
-	message.AddBool("etk:msg_from_gui", true);
-	message.AddInt64("when", currentTime);
+	message.AddBool(atomFromGui, true);
+	message.AddInt64(atomWhen, currentTime);
 
 	if (evt->clazz == DFEC_WINDOW) {
 		dfbEngine->Lock();
@@ -359,11 +366,11 @@ static void process_dfb_event(BDFBGraphicsEngine *dfbEngine, DFBEvent *evt)
 				if ((state & DIBM_MIDDLE) && button != 2) buttons += 2;
 				if ((state & DIBM_RIGHT) && button != 3) buttons += 3;
 				message.AddInt32("button", button);
-				message.AddInt32("buttons", buttons);
+				message.AddInt32(atomButtons, buttons);
 
-				message.AddPoint("where", BPoint((float)(event->cx - originX) - margins.left,
-				                                 (float)(event->cy - originY) - margins.top));
-				message.AddPoint("screen_where", BPoint((float)event->cx, (float)event->cy));
+				message.AddPoint(atomWhere, BPoint((float)(event->cx - originX) - margins.left,
+				                                   (float)(event->cy - originY) - margins.top));
+				message.AddPoint(atomScreenWhere, BPoint((float)event->cx, (float)event->cy));
 
 				// TODO: modifiers, clicks
 				message.AddMessenger("etk:msg_for_target", etkWinMsgr);
@@ -387,11 +394,11 @@ static void process_dfb_event(BDFBGraphicsEngine *dfbEngine, DFBEvent *evt)
 				if (state & DIBM_LEFT) buttons += 1;
 				if (state & DIBM_MIDDLE) buttons += 2;
 				if (state & DIBM_RIGHT) buttons += 3;
-				message.AddInt32("buttons", buttons);
+				message.AddInt32(atomButtons, buttons);
 
-				message.AddPoint("where", BPoint((float)(event->cx - originX) - margins.left,
-				                                 (float)(event->cy - originY) - margins.top));
-				message.AddPoint("screen_where", BPoint((float)event->cx, (float)event->cy));
+				message.AddPoint(atomWhere, BPoint((float)(event->cx - originX) - margins.left,
+				                                   (float)(event->cy - originY) - margins.top));
+				message.AddPoint(atomScreenWhere, BPoint((float)event->cx, (float)event->cy));
 
 				message.AddMessenger("etk:msg_for_target", etkWinMsgr);
 				etkWinMsgr = BMessenger(app);
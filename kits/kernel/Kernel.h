@@ -78,6 +78,12 @@ extern "C"
 	status_t	delete_area(void *area);
 	status_t	delete_area_etc(void *area, bool no_clone);
 
+	/* unlink_area:
+	 * 	The area can't be cloned by its name any more, the mappings made stay valid.
+	 * 	A clone-area must be writable to unlink.
+	 * */
+	status_t	unlink_area(void *area);
+
 	/* resize_area:
 	 * 	Only the original area that created by "create_area" is allowed resizing.
 	 * 	When it was resized, the clone-area must reclone to get the valid address.
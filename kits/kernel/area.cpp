@@ -59,7 +59,7 @@
 
 typedef struct posix_area_t {
 	posix_area_t()
-			: name(NULL), domain(NULL), ipc_name(NULL), prot(0), length(0), addr(NULL), openedIPC(true), created(false) {
+			: name(NULL), domain(NULL), ipc_name(NULL), prot(0), length(0), addr(NULL), openedIPC(true), created(false), unlinked(false) {
 	}
 
 	~posix_area_t() {
@@ -77,6 +77,7 @@ typedef struct posix_area_t {
 	void		*addr;
 	bool		openedIPC;
 	bool		created;
+	bool		unlinked;
 } posix_area_t;
 
 // return value must be free by "free()"
@@ -273,7 +274,7 @@ delete_area(void *data)
 
 	if (!(area->addr == NULL || area->addr == MAP_FAILED)) munmap(area->addr, area->length);
 
-	if (area->openedIPC == false) shm_unlink(area->ipc_name);
+	if (area->openedIPC == false && area->unlinked == false) shm_unlink(area->ipc_name);
 	free(area->ipc_name);
 
 	free(area->name);
@@ -297,7 +298,8 @@ delete_area_etc(void *data, bool no_clone)
 	if (!(area->addr == NULL || area->addr == MAP_FAILED))
 		munmap(area->addr, area->length);
 
-	if (no_clone && (area->openedIPC ? (area->prot &B_WRITE_AREA) : true)) shm_unlink(area->ipc_name);
+	if (no_clone && area->unlinked == false &&
+	    (area->openedIPC ? (area->prot &B_WRITE_AREA) : true)) shm_unlink(area->ipc_name);
 
 	free(area->ipc_name);
 
@@ -313,6 +315,22 @@ delete_area_etc(void *data, bool no_clone)
 }
 
 
+status_t
+unlink_area(void *data)
+{
+	posix_area_t *area = (posix_area_t*)data;
+	if (!area) return B_BAD_VALUE;
+	if (area->openedIPC && !(area->prot &B_WRITE_AREA)) return B_NOT_ALLOWED;
+
+	if (area->unlinked == false) {
+		if (shm_unlink(area->ipc_name) != 0) return B_ERROR;
+		area->unlinked = true;
+	}
+
+	return B_OK;
+}
+
+
 status_t
 resize_area(void *data, void **start_addr, size_t new_size)
 {
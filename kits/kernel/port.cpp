@@ -96,10 +96,8 @@ class port_locker_t
 		}
 
 		~port_locker_t() {
-			if (fSem != NULL) {
-				// leave global semaphore, without "delete_sem(fSem)"
-				delete_sem_etc(fSem, false);
-			}
+			// leave global semaphore as it is, the semaphore kit might
+			// be destructed already when it comes here at exit
 		}
 
 		void Init() {
@@ -189,10 +187,9 @@ static void* create_port_for_IPC(int32 queue_length, const char *name, area_acce
 		return NULL;
 	}
 
-	port_info *port_info = port->portInfo;
-	port_info->InitData();
-	memcpy(port_info->name, name, (size_t)strlen(name));
-	port_info->queue_length = queue_length;
+	port->portInfo->InitData();
+	memcpy(port->portInfo->name, name, (size_t)strlen(name));
+	port->portInfo->queue_length = queue_length;
 
 	if ((port->iLocker = create_sem(1, name, area_access)) == NULL) {
 		delete_area(port->mapping);
@@ -85,9 +85,14 @@ bigtime_t system_boot_time(void)
 }
 
 
+// return the number of microseconds elapsed since the boot, it never goes back when the clock is set
 bigtime_t system_time(void)
 {
-	// FIXME
-	return(real_time_clock_usecs() - system_boot_time());
+	int64 current_time = B_INT64_CONSTANT(-1);
+	struct timespec ts;
+
+	if (clock_gettime(CLOCK_MONOTONIC, &ts) == 0)
+		current_time = (int64)ts.tv_sec * SECS_TO_US + (int64)(ts.tv_nsec + 500) /B_INT64_CONSTANT(1000);
+	return current_time;
 }
 
@@ -132,6 +132,9 @@ BNetAddress::Instantiate(const BMessage *from)
 }
 
 
+static e_instantiation_entry _e_net_address_entry("BNetAddress", BNetAddress::Instantiate);
+
+
 status_t
 BNetAddress::InitCheck() const
 {
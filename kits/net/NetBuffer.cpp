@@ -82,6 +82,9 @@ BNetBuffer::Instantiate(const BMessage *from)
 }
 
 
+static e_instantiation_entry _e_net_buffer_entry("BNetBuffer", BNetBuffer::Instantiate);
+
+
 status_t
 BNetBuffer::InitCheck() const
 {
@@ -125,6 +125,9 @@ BNetEndpoint::Instantiate(const BMessage *from)
 }
 
 
+static e_instantiation_entry _e_net_endpoint_entry("BNetEndpoint", BNetEndpoint::Instantiate);
+
+
 status_t
 BNetEndpoint::InitCheck() const
 {
@@ -29,23 +29,31 @@
 
 #include <kernel/Kernel.h>
 #include <support/Locker.h>
-#include <support/List.h>
 
 #include "Token.h"
 
+#define E_TOKENS_CHUNK_SIZE	4096
+#define E_TOKENS_MAX_CHUNKS	4096
+#define E_TOKENS_FETCH_SPINS	16 // reads of a token being changed before giving up the CPU
 
+
+// the token is "(generation << 32) | index", the slot of a deleted token
+// gets a new generation when reused so the old one finds nothing there
 struct _LOCAL _token_t {
-	uint64 count;
+	uint32 seq; // odd while being changed, the readers don't lock
+	uint32 generation;
+	uint64 count; // 0 when the slot is free
 	bigtime_t time_stamp;
 	void *data;
+	int32 next_free;
 };
 
 
-class _LOCAL BTokensDepotPrivateData : public BList
+class _LOCAL BTokensDepotPrivateData
 {
 	public:
 		BTokensDepotPrivateData();
-		virtual ~BTokensDepotPrivateData();
+		~BTokensDepotPrivateData();
 
 		uint64		AddToken(void *data);
 		void		RemoveToken(uint64 token);
@@ -53,118 +61,129 @@ class _LOCAL BTokensDepotPrivateData : public BList
 
 		bool		PushToken(uint64 token);
 		void		PopToken(uint64 token);
+
+		void		SetData(_token_t *aToken, void *data);
+
+		// without locking, false when the token isn't there
+		bool		FetchToken(uint64 token, void **data, bigtime_t *time_stamp) const;
+
+	private:
+		_token_t *fChunks[E_TOKENS_MAX_CHUNKS];
+		int32 fCount;
+		int32 fFreeHead;
+		bigtime_t fTimeStamp;
+
+		_token_t	*SlotAt(uint32 index) const;
+		void		BeginChange(_token_t *aToken);
+		void		EndChange(_token_t *aToken);
 };
 
 
 BTokensDepotPrivateData::BTokensDepotPrivateData()
-		: BList()
+		: fCount(0), fFreeHead(-1)
 {
+	bzero(fChunks, sizeof(fChunks));
+
+	// the stamps only have to differ, counting up from the time keeps them apart from the previous runs
+	fTimeStamp = e_system_time();
 }
 
 
 BTokensDepotPrivateData::~BTokensDepotPrivateData()
 {
-	BList *list;
+	for (int32 i = 0; i < E_TOKENS_MAX_CHUNKS && fChunks[i] != NULL; i++) free(fChunks[i]);
+}
 
-	while ((list = (BList*)RemoveItem(0)) != NULL) {
-		for (int32 i = 0; i < list->CountItems(); i++) {
-			_token_t *aToken = (_token_t*)list->ItemAt(i);
-			free(aToken);
-		}
-		delete list;
-	}
+
+_token_t*
+BTokensDepotPrivateData::SlotAt(uint32 index) const
+{
+	if (index >= (uint32)fCount) return NULL;
+	return fChunks[index / E_TOKENS_CHUNK_SIZE] + (index % E_TOKENS_CHUNK_SIZE);
 }
 
 
-uint64
-BTokensDepotPrivateData::AddToken(void *data)
+void
+BTokensDepotPrivateData::BeginChange(_token_t *aToken)
 {
-	_token_t *aToken = (_token_t*)malloc(sizeof(_token_t));
+	*((volatile uint32*)&aToken->seq) = aToken->seq + 1;
+	__sync_synchronize();
+}
 
-	if (aToken == NULL) return B_MAXUINT64;
 
-	uint64 token = B_MAXUINT64;
+void
+BTokensDepotPrivateData::EndChange(_token_t *aToken)
+{
+	__sync_synchronize();
+	*((volatile uint32*)&aToken->seq) = aToken->seq + 1;
+}
+
 
-	BList *list = NULL;
-	for (int32 i = 0; i < CountItems(); i++) {
-		list = (BList*)ItemAt(i);
-		if (list->CountItems() >= B_MAXINT32 - 1 || list->AddItem(aToken) == false) {
-			list = NULL;
-			continue;
-		}
-		token = ((uint64)i << 32) | (uint64)(list->CountItems() - 1);
-	}
+uint64
+BTokensDepotPrivateData::AddToken(void *data)
+{
+	_token_t *aToken;
+	int32 index;
 
-	if (list == NULL && CountItems() <B_MAXINT32 - 1) {
-		if (AddItem(list = new BList()) == false || list->AddItem(aToken) == false) {
-			delete list;
-		} else {
-			token = ((uint64)(CountItems() - 1) << 32) | (uint64)(list->CountItems() - 1);
-		}
-	} else for (int32 i = 0; i < CountItems(); i++) {
-			list = (BList*)ItemAt(i);
-			int32 index = list->IndexOf(NULL);
-			if (index < 0) {
-				list = NULL;
-				continue;
-			}
-			list->ReplaceItem(index, aToken);
-			token = ((uint64)i << 32) | (uint64)index;
+	if (fFreeHead >= 0) {
+		index = fFreeHead;
+		aToken = SlotAt((uint32)index);
+		fFreeHead = aToken->next_free;
+	} else {
+		if (fCount >= E_TOKENS_CHUNK_SIZE * E_TOKENS_MAX_CHUNKS) return B_MAXUINT64;
+
+		index = fCount;
+		if (fChunks[index / E_TOKENS_CHUNK_SIZE] == NULL) {
+			_token_t *chunk = (_token_t*)malloc(sizeof(_token_t) * E_TOKENS_CHUNK_SIZE);
+			if (chunk == NULL) return B_MAXUINT64;
+			bzero(chunk, sizeof(_token_t) * E_TOKENS_CHUNK_SIZE);
+			fChunks[index / E_TOKENS_CHUNK_SIZE] = chunk;
 		}
 
-	if (token != B_MAXUINT64) {
-		aToken->count = 1;
-		aToken->time_stamp = e_system_time();
-		while (aToken->time_stamp == e_system_time()) {
-			// do nothing, waiting till "e_system_time()" changed.
-		}
-		aToken->data = data;
-	} else {
-		free(aToken);
+		// the slot is ready before the readers could take the index
+		__sync_synchronize();
+		*((volatile int32*)&fCount) = fCount + 1;
+		aToken = SlotAt((uint32)index);
 	}
 
-	return token;
+	BeginChange(aToken);
+	aToken->generation += 1;
+	aToken->count = 1;
+	aToken->time_stamp = ++fTimeStamp;
+	aToken->data = data;
+	aToken->next_free = -1;
+	EndChange(aToken);
+
+	return(((uint64)aToken->generation << 32) | (uint64)index);
 }
 
 
 void
 BTokensDepotPrivateData::RemoveToken(uint64 token)
 {
-	uint64 index = token >> 32;
-	if (index > (uint64)B_MAXINT32 - 1) return;
-
-	BList *list = (BList*)ItemAt((int32)index);
-	if (list == NULL) return;
-
-	index = token & 0xffffffff;
-	_token_t *aToken = (_token_t*)(list->ItemAt((int32)index));
+	_token_t *aToken = TokenAt(token);
 	if (aToken == NULL) return;
 
+	BeginChange(aToken);
 	if (aToken->count > 1) {
 		aToken->count -= 1;
 		aToken->data = NULL;
 	} else {
-		if (index < (uint64)list->CountItems() - 1) {
-			list->ReplaceItem((int32)index, NULL);
-		} else {
-			list->RemoveItem((int32)index);
-			while (list->LastItem() == NULL && list->IsEmpty() == false) list->RemoveItem(list->CountItems() - 1);
-			if (list->IsEmpty() && LastItem() == (void*)list) delete	(BList*)RemoveItem(CountItems() - 1);
-		}
-		free(aToken);
+		aToken->count = 0;
+		aToken->data = NULL;
+		aToken->next_free = fFreeHead;
+		fFreeHead = (int32)(token & 0xffffffff);
 	}
+	EndChange(aToken);
 }
 
 
 _token_t*
 BTokensDepotPrivateData::TokenAt(uint64 token) const
 {
-	uint64 index = token >> 32;
-	if (index > (uint64)B_MAXINT32 - 1) return NULL;
-
-	BList *list = (BList*)ItemAt((int32)index);
-	index = token & 0xffffffff;
-	return((_token_t*)(list->ItemAt((int32)index)));
+	_token_t *aToken = SlotAt((uint32)(token & 0xffffffff));
+	if (aToken == NULL || aToken->count == 0 || aToken->generation != (uint32)(token >> 32)) return NULL;
+	return aToken;
 }
 
 
@@ -182,9 +201,53 @@ void
 BTokensDepotPrivateData::PopToken(uint64 token)
 {
 	_token_t *aToken = TokenAt(token);
-	if (!(aToken == NULL || aToken->count == 0)) {
+	if (aToken == NULL) return;
+
+	if (aToken->count > 1)
 		aToken->count -= 1;
-		if (aToken->count == 0) RemoveToken(token);
+	else
+		RemoveToken(token);
+}
+
+
+void
+BTokensDepotPrivateData::SetData(_token_t *aToken, void *data)
+{
+	BeginChange(aToken);
+	aToken->data = data;
+	EndChange(aToken);
+}
+
+
+bool
+BTokensDepotPrivateData::FetchToken(uint64 token, void **data, bigtime_t *time_stamp) const
+{
+	uint32 index = (uint32)(token & 0xffffffff);
+	if (index >= *((volatile uint32*)&fCount)) return false;
+	__sync_synchronize();
+
+	const _token_t *aToken = fChunks[index / E_TOKENS_CHUNK_SIZE] + (index % E_TOKENS_CHUNK_SIZE);
+
+	for (int32 tries = 1; true; tries++) {
+		// the writer holds it for a few stores only, unless it got preempted in between
+		if (tries % E_TOKENS_FETCH_SPINS == 0) snooze(1);
+
+		uint32 seq = *((volatile uint32*)&aToken->seq);
+		if (seq & 1) continue;
+		__sync_synchronize();
+
+		bool found = (aToken->count != 0 && aToken->generation == (uint32)(token >> 32));
+		void *aData = aToken->data;
+		bigtime_t aTimeStamp = aToken->time_stamp;
+
+		__sync_synchronize();
+		if (*((volatile uint32*)&aToken->seq) != seq) continue;
+
+		if (found) {
+			if (data) *data = aData;
+			if (time_stamp) *time_stamp = aTimeStamp;
+		}
+		return found;
 	}
 }
 
@@ -269,6 +332,13 @@ BTokensDepot::PopToken(uint64 token)
 }
 
 
+bool
+BTokensDepot::FetchToken(uint64 token, void **data, bigtime_t *time_stamp)
+{
+	return (reinterpret_cast<BTokensDepotPrivateData*>(fData))->FetchToken(token, data, time_stamp);
+}
+
+
 bool
 BTokensDepot::Lock()
 {
@@ -309,12 +379,7 @@ BToken::TimeStamp() const
 	bigtime_t retVal = B_MAXINT64;
 
 	if (fToken != B_MAXUINT64 && fDepot != NULL) {
-		if (fDepot->Lock()) {
-			BTokensDepotPrivateData *depot_private = reinterpret_cast<BTokensDepotPrivateData*>(fDepot->fData);
-			_token_t *aToken = depot_private->TokenAt(fToken);
-			if (aToken != NULL) retVal = aToken->time_stamp;
-			fDepot->Unlock();
-		}
+		if (fDepot->FetchToken(fToken, NULL, &retVal) == false) retVal = B_MAXINT64;
 	}
 
 	return retVal;
@@ -326,14 +391,7 @@ BToken::Data() const
 {
 	void *retVal = NULL;
 
-	if (fToken != B_MAXUINT64 && fDepot != NULL) {
-		if (fDepot->Lock()) {
-			BTokensDepotPrivateData *depot_private = reinterpret_cast<BTokensDepotPrivateData*>(fDepot->fData);
-			_token_t *aToken = depot_private->TokenAt(fToken);
-			if (aToken != NULL) retVal = aToken->data;
-			fDepot->Unlock();
-		}
-	}
+	if (fToken != B_MAXUINT64 && fDepot != NULL) fDepot->FetchToken(fToken, &retVal, NULL);
 
 	return retVal;
 }
@@ -347,7 +405,7 @@ BToken::SetData(void *data)
 	if (fDepot->Lock()) {
 		BTokensDepotPrivateData *depot_private = reinterpret_cast<BTokensDepotPrivateData*>(fDepot->fData);
 		_token_t *aToken = depot_private->TokenAt(fToken);
-		if (aToken != NULL) aToken->data = data;
+		if (aToken != NULL) depot_private->SetData(aToken, data);
 		fDepot->Unlock();
 	}
 }
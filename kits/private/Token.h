@@ -76,6 +76,9 @@ class _LOCAL BTokensDepot
 		bool		PushToken(uint64 token);
 		void		PopToken(uint64 token);
 
+		// looks the token up without referring it nor locking, "data" or "time_stamp" could be NULL
+		bool		FetchToken(uint64 token, void **data, bigtime_t *time_stamp);
+
 		BLocker		*Locker() const;
 		bool		Lock();
 		void		Unlock();
@@ -418,6 +418,9 @@ BPixmap::DrawXPM(const char **xpm_data, int32 destX, int32 destY, int32 srcX, in
 		return;
 	}
 
+	// every pixel looks up its palette entry
+	colors.SetHashIndex(true);
+
 	for (int32 j = 0; j < xpmHeight && *xpm_data != NULL; j++, xpm_data++) {
 		int32 Y = destY + (j - srcY);
 
@@ -110,34 +110,34 @@ inline mode_t file_access_mode_to_mode_t(uint32 access_mode)
 
 
 BFile::BFile()
-		: fFD(NULL), fMode(0)
+		: BPositionIO(), fFD(NULL), fMode(0)
 {
 }
 
 
 BFile::BFile(const char *path, uint32 open_mode, uint32 access_mode)
-		: fFD(NULL), fMode(0)
+		: BPositionIO(), fFD(NULL), fMode(0)
 {
 	SetTo(path, open_mode, access_mode);
 }
 
 
 BFile::BFile(const BEntry *entry, uint32 open_mode, uint32 access_mode)
-		: fFD(NULL), fMode(0)
+		: BPositionIO(), fFD(NULL), fMode(0)
 {
 	SetTo(entry, open_mode, access_mode);
 }
 
 
 BFile::BFile(const BDirectory *dir, const char *leaf, uint32 open_mode, uint32 access_mode)
-		: fFD(NULL), fMode(0)
+		: BPositionIO(), fFD(NULL), fMode(0)
 {
 	SetTo(dir, leaf, open_mode, access_mode);
 }
 
 
 BFile::BFile(const BFile &from)
-		: fFD(NULL), fMode(0)
+		: BPositionIO(), fFD(NULL), fMode(0)
 {
 	operator=(from);
 }
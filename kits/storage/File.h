@@ -32,10 +32,11 @@
 
 #include <storage/StorageDefs.h>
 #include <storage/Directory.h>
+#include <support/DataIO.h>
 
 #ifdef __cplusplus /* Just for C++ */
 
-class BFile
+class BFile : public BPositionIO
 {
 	public:
 		BFile();
@@ -54,18 +55,20 @@ class BFile
 		bool		IsReadable() const;
 		bool		IsWritable() const;
 
-		ssize_t		Read(void *buffer, size_t size);
-		ssize_t		ReadAt(int64 pos, void *buffer, size_t size);
-		ssize_t		Write(const void *buffer, size_t size);
-		ssize_t		WriteAt(int64 pos, const void *buffer, size_t size);
+		virtual ssize_t		Read(void *buffer, size_t size);
+		virtual ssize_t		ReadAt(int64 pos, void *buffer, size_t size);
+		virtual ssize_t		Write(const void *buffer, size_t size);
+		virtual ssize_t		WriteAt(int64 pos, const void *buffer, size_t size);
 
-		int64		Seek(int64 position, uint32 seek_mode);
-		int64		Position() const;
-		status_t	SetSize(int64 size);
+		virtual int64		Seek(int64 position, uint32 seek_mode);
+		virtual int64		Position() const;
+		virtual status_t	SetSize(int64 size);
 
 		BFile&		operator=(const BFile &from);
 
 	private:
+		friend class BMappedFileIO;
+
 		void *fFD;
 		uint32 fMode;
 };
@@ -0,0 +1,356 @@
+/* --------------------------------------------------------------------------
+ *
+ * ETK++ --- The Easy Toolkit for C++ programing
+ * Copyright (C) 2004-2007, Anthony Lee, All Rights Reserved
+ *
+ * ETK++ library is a freeware; it may be used and distributed according to
+ * the terms of The MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+ * IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * File: Allocator.cpp
+ *
+ * --------------------------------------------------------------------------*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <kernel/Kernel.h>
+
+#include "Allocator.h"
+
+#define ALLOCATOR_ALIGNMENT	16
+#define ALIGN_SIZE(size)	(((size) + ALLOCATOR_ALIGNMENT - 1) & ~((size_t)ALLOCATOR_ALIGNMENT - 1))
+
+#define POOL_MAX_CHUNK_SIZE	1024
+#define POOL_SLAB_SIZE		65536
+
+
+BAllocator::BAllocator()
+{
+}
+
+
+BAllocator::~BAllocator()
+{
+}
+
+
+void*
+BAllocator::Realloc(void *ptr, size_t oldSize, size_t newSize)
+{
+	if (ptr == NULL) return Alloc(newSize);
+
+	void *newPtr = Alloc(newSize);
+	if (newPtr == NULL) return NULL;
+
+	memcpy(newPtr, ptr, min_c(oldSize, newSize));
+	Free(ptr, oldSize);
+
+	return newPtr;
+}
+
+
+struct BArenaAllocator::_block_t {
+	_block_t *next;
+	size_t size;
+	size_t used;
+	size_t reserved;
+};
+
+
+BArenaAllocator::BArenaAllocator(size_t blockSize, bool threadSafe)
+	: BAllocator(), fBlocks(NULL), fBlockSize(ALIGN_SIZE(max_c(blockSize, 1024))), fBytesAllocated(0), fLast(NULL), fLocker(NULL)
+{
+	if (threadSafe) fLocker = create_simple_locker();
+}
+
+
+BArenaAllocator::~BArenaAllocator()
+{
+	while (fBlocks != NULL) {
+		_block_t *next = fBlocks->next;
+		free(fBlocks);
+		fBlocks = next;
+	}
+
+	if (fLocker != NULL) delete_simple_locker(fLocker);
+}
+
+
+void*
+BArenaAllocator::_Alloc(size_t size)
+{
+	size = ALIGN_SIZE(max_c(size, 1));
+
+	if (fBlocks == NULL || fBlocks->size - fBlocks->used < size) {
+		// big requests get a block of their own behind the current one
+		size_t blockSize = (size > fBlockSize / 4 ? size : fBlockSize);
+
+		_block_t *block = (_block_t*)malloc(sizeof(_block_t) + blockSize);
+		if (block == NULL) return NULL;
+
+		block->size = blockSize;
+		block->used = 0;
+
+		if (blockSize != fBlockSize && fBlocks != NULL) {
+			block->next = fBlocks->next;
+			fBlocks->next = block;
+		} else {
+			block->next = fBlocks;
+			fBlocks = block;
+		}
+
+		if (block != fBlocks) {
+			block->used = size;
+			fBytesAllocated += size;
+			return(fLast = (char*)(block + 1));
+		}
+	}
+
+	char *ptr = (char*)(fBlocks + 1) + fBlocks->used;
+	fBlocks->used += size;
+	fBytesAllocated += size;
+
+	return(fLast = ptr);
+}
+
+
+void*
+BArenaAllocator::Alloc(size_t size)
+{
+	if (fLocker != NULL) lock_simple_locker(fLocker);
+	void *ptr = _Alloc(size);
+	if (fLocker != NULL) unlock_simple_locker(fLocker);
+
+	return ptr;
+}
+
+
+void*
+BArenaAllocator::Realloc(void *ptr, size_t oldSize, size_t newSize)
+{
+	if (ptr == NULL) return Alloc(newSize);
+
+	if (fLocker != NULL) lock_simple_locker(fLocker);
+
+	// the latest allocation at the end of the current block resizes in place
+	if ((char*)ptr == fLast && fBlocks != NULL &&
+	    fLast >= (char*)(fBlocks + 1) && fLast < (char*)(fBlocks + 1) + fBlocks->size) {
+		size_t offset = (size_t)(fLast - (char*)(fBlocks + 1));
+		size_t size = ALIGN_SIZE(max_c(newSize, 1));
+
+		if (size <= fBlocks->size - offset) {
+			fBytesAllocated = fBytesAllocated - (fBlocks->used - offset) + size;
+			fBlocks->used = offset + size;
+			if (fLocker != NULL) unlock_simple_locker(fLocker);
+			return ptr;
+		}
+	}
+
+	void *newPtr = _Alloc(newSize);
+	if (newPtr != NULL) memcpy(newPtr, ptr, min_c(oldSize, newSize));
+
+	if (fLocker != NULL) unlock_simple_locker(fLocker);
+
+	return newPtr;
+}
+
+
+void
+BArenaAllocator::Free(void *ptr, size_t size)
+{
+	if (ptr == NULL) return;
+
+	if (fLocker != NULL) lock_simple_locker(fLocker);
+
+	// only the latest allocation can be taken back before Reset()
+	if ((char*)ptr == fLast && fBlocks != NULL &&
+	    fLast >= (char*)(fBlocks + 1) && fLast < (char*)(fBlocks + 1) + fBlocks->used) {
+		size_t offset = (size_t)(fLast - (char*)(fBlocks + 1));
+		fBytesAllocated -= fBlocks->used - offset;
+		fBlocks->used = offset;
+		fLast = NULL;
+	}
+
+	if (fLocker != NULL) unlock_simple_locker(fLocker);
+}
+
+
+void
+BArenaAllocator::Reset()
+{
+	if (fLocker != NULL) lock_simple_locker(fLocker);
+
+	_block_t *keep = NULL;
+
+	while (fBlocks != NULL) {
+		_block_t *next = fBlocks->next;
+		if (keep == NULL && fBlocks->size == fBlockSize) {
+			keep = fBlocks;
+			keep->next = NULL;
+			keep->used = 0;
+		} else {
+			free(fBlocks);
+		}
+		fBlocks = next;
+	}
+
+	fBlocks = keep;
+	fBytesAllocated = 0;
+	fLast = NULL;
+
+	if (fLocker != NULL) unlock_simple_locker(fLocker);
+}
+
+
+size_t
+BArenaAllocator::BytesAllocated() const
+{
+	return fBytesAllocated;
+}
+
+
+struct BPoolAllocator::_slab_t {
+	_slab_t *next;
+	size_t reserved;
+};
+
+
+static const size_t e_pool_chunk_sizes[16] = {
+	16, 32, 48, 64, 80, 96, 128, 160, 192, 256, 320, 384, 512, 640, 768, 1024
+};
+
+// size class of every multiple of 16 up to POOL_MAX_CHUNK_SIZE
+static const uint8 e_pool_size_classes[POOL_MAX_CHUNK_SIZE / 16 + 1] = {
+	0, 0, 1, 2, 3, 4, 5, 6, 6, 7, 7, 8, 8, 9, 9, 9, 9, 10, 10, 10, 10, 11, 11, 11, 11,
+	12, 12, 12, 12, 12, 12, 12, 12, 13, 13, 13, 13, 13, 13, 13, 13, 14, 14, 14, 14, 14,
+	14, 14, 14, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15
+};
+
+#define POOL_SIZE_CLASS(size)	((int32)e_pool_size_classes[((size) + 15) >> 4])
+
+
+BPoolAllocator::BPoolAllocator(bool threadSafe)
+	: BAllocator(), fSlabs(NULL), fLocker(NULL)
+{
+	bzero(fFreeLists, sizeof(fFreeLists));
+	if (threadSafe) fLocker = create_simple_locker();
+}
+
+
+BPoolAllocator::~BPoolAllocator()
+{
+	while (fSlabs != NULL) {
+		_slab_t *next = fSlabs->next;
+		free(fSlabs);
+		fSlabs = next;
+	}
+
+	if (fLocker != NULL) delete_simple_locker(fLocker);
+}
+
+
+void*
+BPoolAllocator::_Grow(int32 sizeClass)
+{
+	_slab_t *slab = (_slab_t*)malloc(POOL_SLAB_SIZE);
+	if (slab == NULL) return NULL;
+
+	slab->next = fSlabs;
+	fSlabs = slab;
+
+	// thread the chunks of the slab into the free list, the first one is returned
+	size_t chunkSize = e_pool_chunk_sizes[sizeClass];
+	char *first = (char*)slab + ALIGN_SIZE(sizeof(_slab_t));
+	size_t count = (POOL_SLAB_SIZE - ALIGN_SIZE(sizeof(_slab_t))) / chunkSize;
+	void *list = fFreeLists[sizeClass];
+
+	for (size_t i = count - 1; i > 0; i--) {
+		char *chunk = first + i * chunkSize;
+		*((void**)chunk) = list;
+		list = chunk;
+	}
+	fFreeLists[sizeClass] = list;
+
+	return first;
+}
+
+
+void*
+BPoolAllocator::Alloc(size_t size)
+{
+	if (size > POOL_MAX_CHUNK_SIZE) return malloc(size);
+
+	int32 sizeClass = POOL_SIZE_CLASS(size);
+
+	if (fLocker != NULL) lock_simple_locker(fLocker);
+
+	void *ptr = fFreeLists[sizeClass];
+	if (ptr != NULL)
+		fFreeLists[sizeClass] = *((void**)ptr);
+	else
+		ptr = _Grow(sizeClass);
+
+	if (fLocker != NULL) unlock_simple_locker(fLocker);
+
+	return ptr;
+}
+
+
+void*
+BPoolAllocator::Realloc(void *ptr, size_t oldSize, size_t newSize)
+{
+	if (ptr == NULL) return Alloc(newSize);
+
+	if (oldSize > POOL_MAX_CHUNK_SIZE && newSize > POOL_MAX_CHUNK_SIZE) return realloc(ptr, newSize);
+	if (oldSize <= POOL_MAX_CHUNK_SIZE && newSize <= POOL_MAX_CHUNK_SIZE &&
+	    POOL_SIZE_CLASS(oldSize) == POOL_SIZE_CLASS(newSize)) return ptr;
+
+	return BAllocator::Realloc(ptr, oldSize, newSize);
+}
+
+
+void
+BPoolAllocator::Free(void *ptr, size_t size)
+{
+	if (ptr == NULL) return;
+
+	if (size > POOL_MAX_CHUNK_SIZE) {
+		free(ptr);
+		return;
+	}
+
+	int32 sizeClass = POOL_SIZE_CLASS(size);
+
+	if (fLocker != NULL) lock_simple_locker(fLocker);
+
+	*((void**)ptr) = fFreeLists[sizeClass];
+	fFreeLists[sizeClass] = ptr;
+
+	if (fLocker != NULL) unlock_simple_locker(fLocker);
+}
+
+
+BPoolAllocator*
+BPoolAllocator::Default()
+{
+	// never destructed, objects may be freed into it from other static destructors
+	static BPoolAllocator *pool = new BPoolAllocator(true);
+	return pool;
+}
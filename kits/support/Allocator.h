@@ -0,0 +1,112 @@
+/* --------------------------------------------------------------------------
+ *
+ * ETK++ --- The Easy Toolkit for C++ programing
+ * Copyright (C) 2004-2007, Anthony Lee, All Rights Reserved
+ *
+ * ETK++ library is a freeware; it may be used and distributed according to
+ * the terms of The MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+ * IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * File: Allocator.h
+ *
+ * --------------------------------------------------------------------------*/
+
+#ifndef __ETK_ALLOCATOR_H__
+#define __ETK_ALLOCATOR_H__
+
+#include <support/SupportDefs.h>
+
+#ifdef __cplusplus /* Just for C++ */
+
+// BAllocator: where a container gets its memory from.
+// 	Free() and Realloc() take the size that was asked for, so that the allocators
+// 	don't have to keep a header in front of every block.
+class BAllocator
+{
+	public:
+		BAllocator();
+		virtual ~BAllocator();
+
+		virtual void	*Alloc(size_t size) = 0;
+		virtual void	*Realloc(void *ptr, size_t oldSize, size_t newSize);
+		virtual void	Free(void *ptr, size_t size) = 0;
+};
+
+
+// BArenaAllocator: bump allocation from big blocks, everything is given back at once by Reset()
+// 	or the destructor. Free() only takes back the latest allocation.
+// 	With "threadSafe" it can be shared between threads, otherwise it belongs to one thread and
+// 	costs no locking at all.
+class BArenaAllocator : public BAllocator
+{
+	public:
+		BArenaAllocator(size_t blockSize = 65536, bool threadSafe = false);
+		virtual ~BArenaAllocator();
+
+		virtual void	*Alloc(size_t size);
+		virtual void	*Realloc(void *ptr, size_t oldSize, size_t newSize);
+		virtual void	Free(void *ptr, size_t size);
+
+		// Reset(): invalidate all the allocations, the first block is kept for reuse.
+		void		Reset();
+
+		size_t		BytesAllocated() const;
+
+	private:
+		struct _block_t;
+
+		_block_t *fBlocks;
+		size_t fBlockSize;
+		size_t fBytesAllocated;
+		char *fLast;
+		void *fLocker;
+
+		void		*_Alloc(size_t size);
+};
+
+
+// BPoolAllocator: free lists of fixed-size chunks cut out of big slabs, one list per size class
+// 	(16 to 1024 bytes), bigger requests go to malloc(). Memory freed into a pool stays there
+// 	until the pool is destructed.
+class BPoolAllocator : public BAllocator
+{
+	public:
+		BPoolAllocator(bool threadSafe = false);
+		virtual ~BPoolAllocator();
+
+		virtual void	*Alloc(size_t size);
+		virtual void	*Realloc(void *ptr, size_t oldSize, size_t newSize);
+		virtual void	Free(void *ptr, size_t size);
+
+		// Default(): a thread safe pool shared by the whole process.
+		static BPoolAllocator *Default();
+
+	private:
+		struct _slab_t;
+
+		_slab_t *fSlabs;
+		void *fFreeLists[16];
+		void *fLocker;
+
+		void		*_Grow(int32 sizeClass);
+};
+
+#endif /* __cplusplus */
+
+#endif /* __ETK_ALLOCATOR_H__ */
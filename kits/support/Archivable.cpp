@@ -27,9 +27,45 @@
  *
  * --------------------------------------------------------------------------*/
 
+#include <kernel/Kernel.h>
+#include <support/String.h>
+#include <support/HashMap.h>
+#include <support/SimpleLocker.h>
+#include <support/Autolock.h>
+
 #include "Archivable.h"
 
 
+typedef BHashMap<BString, e_instantiation_func> _e_instantiation_map_t;
+
+struct _e_instantiation_addon_t {
+	BString path;
+	void *image;
+	bool loadFailed;
+	_e_instantiation_map_t funcs;
+};
+
+typedef BHashMap<BString, _e_instantiation_addon_t*> _e_instantiation_addon_map_t;
+
+static BSimpleLocker instantiation_locker(true);
+static _e_instantiation_map_t *instantiation_funcs = NULL;
+static _e_instantiation_addon_map_t *instantiation_addons = NULL;
+
+// the entries are put on the list by static constructors, before the locker might be constructed,
+// "instantiation_entries_taken" is the head of the list when the table took the entries last
+static e_instantiation_entry *instantiation_entries = NULL;
+static e_instantiation_entry *instantiation_entries_taken = NULL;
+
+
+e_instantiation_entry::e_instantiation_entry(const char *_class_name, e_instantiation_func _func)
+	: class_name(_class_name), func(_func), next(NULL)
+{
+	do {
+		next = instantiation_entries;
+	} while (__sync_bool_compare_and_swap(&instantiation_entries, next, this) == false);
+}
+
+
 BArchivable::BArchivable()
 {
 }
@@ -80,18 +116,221 @@ bool e_validate_instantiation(const BMessage *from, const char *class_name)
 }
 
 
+static bool e_instantiation_init()
+{
+	if (instantiation_funcs == NULL) {
+		if ((instantiation_funcs = new _e_instantiation_map_t()) == NULL ||
+		    (instantiation_addons = new _e_instantiation_addon_map_t()) == NULL) {
+			if (instantiation_funcs) delete instantiation_funcs;
+			instantiation_funcs = NULL;
+			return false;
+		}
+	}
+
+	// the entries of the add-ons loaded since the last time come first
+	e_instantiation_entry *entries = instantiation_entries;
+	for (e_instantiation_entry *entry = entries; entry != instantiation_entries_taken; entry = entry->next) {
+		if (instantiation_funcs->Put(entry->class_name, entry->func) != B_OK) return false;
+	}
+	instantiation_entries_taken = entries;
+
+	return true;
+}
+
+
+// the symbol of "static BArchivable* ClassName::Instantiate(const BMessage*)" with the Itanium C++ ABI,
+// "A::B" goes to "_ZN1A1B11InstantiateEPK8BMessage"
+static bool e_instantiation_symbol(const char *class_name, BString &symbol)
+{
+	symbol = "_ZN";
+
+	const char *name = class_name;
+	while (*name != 0) {
+		const char *end = strstr(name, "::");
+		int32 len = (end == NULL ? (int32)strlen(name) : (int32)(end - name));
+		if (len == 0) return false;
+
+		symbol << len;
+		symbol.Append(name, len);
+
+		name += len;
+		if (end != NULL) name += 2;
+	}
+
+	symbol << "11InstantiateEPK8BMessage";
+	return true;
+}
+
+
+static e_instantiation_func e_find_addon_instantiation_func(_e_instantiation_addon_t *addon, const char *class_name, void **image)
+{
+	e_instantiation_func *found = addon->funcs.Lookup(class_name);
+	if (found != NULL) {
+		if (image) *image = addon->image;
+		return *found;
+	}
+
+	if (addon->path.Length() == 0 || addon->loadFailed) return NULL;
+
+	if (addon->image == NULL) {
+		if ((addon->image = load_addon(addon->path.String())) == NULL) {
+			ETK_WARNING("[SUPPORT]: %s --- Unable to load add-on \"%s\".", __PRETTY_FUNCTION__, addon->path.String());
+			addon->loadFailed = true;
+			return NULL;
+		}
+	}
+
+	BString symbol;
+	void *ptr = NULL;
+	if (e_instantiation_symbol(class_name, symbol) == false ||
+	    get_image_symbol(addon->image, symbol.String(), &ptr) != B_OK || ptr == NULL) return NULL;
+
+	// cached, the next lookup of the class costs one hash
+	e_instantiation_func func = (e_instantiation_func)ptr;
+	addon->funcs.Put(class_name, func);
+
+	if (image) *image = addon->image;
+	return func;
+}
+
+
+static e_instantiation_func e_find_instantiation_func_locked(const char *class_name, const char *signature, void **image)
+{
+	if (signature != NULL && *signature != 0) {
+		_e_instantiation_addon_t **addon = instantiation_addons->Lookup(signature);
+		if (addon != NULL) {
+			e_instantiation_func func = e_find_addon_instantiation_func(*addon, class_name, image);
+			if (func != NULL) return func;
+		}
+	}
+
+	e_instantiation_func *found = instantiation_funcs->Lookup(class_name);
+	if (found == NULL) return NULL;
+
+	if (image) *image = NULL;
+	return *found;
+}
+
+
+e_instantiation_func e_find_instantiation_func(const char *class_name, const char *signature, void **image)
+{
+	if (image) *image = NULL;
+	if (class_name == NULL || *class_name == 0) return NULL;
+
+	BAutolock<BSimpleLocker> autolock(instantiation_locker);
+	if (e_instantiation_init() == false) return NULL;
+
+	return e_find_instantiation_func_locked(class_name, signature, image);
+}
+
+
 e_instantiation_func e_find_instantiation_func(const char *class_name)
 {
-	// TODO
-	return NULL;
+	return e_find_instantiation_func(class_name, NULL, NULL);
 }
 
 
-e_instantiation_func e_find_instantiation_func(const BMessage *archive_data)
+e_instantiation_func e_find_instantiation_func(const BMessage *archive_data, void **image)
 {
-	const char *class_name = NULL;
+	if (image) *image = NULL;
 	if (archive_data == NULL) return NULL;
+
+	const char *signature = NULL;
+	archive_data->FindString("add_on", &signature);
+
+	// the last class is the most derived one, instantiating one of its bases would lose the rest
+	const char *class_name = NULL;
 	archive_data->FindString("class", archive_data->CountItems("class", B_STRING_TYPE) - 1, &class_name);
-	return e_find_instantiation_func(class_name);
+	if (class_name == NULL || *class_name == 0) return NULL;
+
+	BAutolock<BSimpleLocker> autolock(instantiation_locker);
+	if (e_instantiation_init() == false) return NULL;
+
+	return e_find_instantiation_func_locked(class_name, signature, image);
+}
+
+
+status_t e_register_instantiation_func(const char *class_name, e_instantiation_func func, const char *signature)
+{
+	if (class_name == NULL || *class_name == 0 || func == NULL) return B_BAD_VALUE;
+
+	BAutolock<BSimpleLocker> autolock(instantiation_locker);
+	if (e_instantiation_init() == false) return B_NO_MEMORY;
+
+	if (signature == NULL || *signature == 0) return instantiation_funcs->Put(class_name, func);
+
+	_e_instantiation_addon_t **found = instantiation_addons->Lookup(signature);
+	_e_instantiation_addon_t *addon = (found == NULL ? NULL : *found);
+
+	if (addon == NULL) {
+		if ((addon = new _e_instantiation_addon_t) == NULL) return B_NO_MEMORY;
+		addon->image = NULL;
+		addon->loadFailed = false;
+		if (instantiation_addons->Put(signature, addon) != B_OK) {
+			delete addon;
+			return B_NO_MEMORY;
+		}
+	}
+
+	return addon->funcs.Put(class_name, func);
+}
+
+
+status_t e_unregister_instantiation_func(const char *class_name, const char *signature)
+{
+	if (class_name == NULL || *class_name == 0) return B_BAD_VALUE;
+
+	BAutolock<BSimpleLocker> autolock(instantiation_locker);
+	if (e_instantiation_init() == false) return B_NO_MEMORY;
+
+	if (signature == NULL || *signature == 0) return(instantiation_funcs->Remove(class_name) ? B_OK : B_ERROR);
+
+	_e_instantiation_addon_t **addon = instantiation_addons->Lookup(signature);
+	if (addon == NULL) return B_ERROR;
+
+	return((*addon)->funcs.Remove(class_name) ? B_OK : B_ERROR);
 }
 
+
+status_t e_register_instantiation_addon(const char *signature, const char *path)
+{
+	if (signature == NULL || *signature == 0 || path == NULL || *path == 0) return B_BAD_VALUE;
+
+	BAutolock<BSimpleLocker> autolock(instantiation_locker);
+	if (e_instantiation_init() == false) return B_NO_MEMORY;
+
+	_e_instantiation_addon_t **found = instantiation_addons->Lookup(signature);
+	_e_instantiation_addon_t *addon = (found == NULL ? NULL : *found);
+
+	if (addon == NULL) {
+		if ((addon = new _e_instantiation_addon_t) == NULL) return B_NO_MEMORY;
+		addon->image = NULL;
+		if (instantiation_addons->Put(signature, addon) != B_OK) {
+			delete addon;
+			return B_NO_MEMORY;
+		}
+	} else if (addon->image != NULL) {
+		// already loaded, the functions found there stay valid
+		return(addon->path == path ? B_OK : B_NOT_ALLOWED);
+	}
+
+	addon->path = path;
+	addon->loadFailed = false;
+
+	return B_OK;
+}
+
+
+BArchivable* e_instantiate_object(const BMessage *from, void **image)
+{
+	e_instantiation_func func = e_find_instantiation_func(from, image);
+	if (func == NULL) {
+		const char *class_name = NULL;
+		if (from) from->FindString("class", &class_name);
+		ETK_DEBUG("[SUPPORT]: %s --- No instantiation function for \"%s\".",
+			  __PRETTY_FUNCTION__, class_name ? class_name : "(null)");
+		return NULL;
+	}
+
+	return (*func)(from);
+}
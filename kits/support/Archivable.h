@@ -52,7 +52,32 @@ typedef BArchivable *(*e_instantiation_func)(const BMessage*);
 
 bool			e_validate_instantiation(const BMessage *from, const char *class_name);
 e_instantiation_func	e_find_instantiation_func(const char *class_name);
-e_instantiation_func	e_find_instantiation_func(const BMessage *archive_data);
+e_instantiation_func	e_find_instantiation_func(const char *class_name, const char *signature, void **image = NULL);
+e_instantiation_func	e_find_instantiation_func(const BMessage *archive_data, void **image = NULL);
+
+// e_register_instantiation_func(): makes "class_name" known to e_find_instantiation_func(),
+// with "signature" it's only found for archives having the same "add_on" field.
+status_t		e_register_instantiation_func(const char *class_name, e_instantiation_func func, const char *signature = NULL);
+status_t		e_unregister_instantiation_func(const char *class_name, const char *signature = NULL);
+
+// e_instantiation_entry: a static one in the translation unit of a class makes the class known
+// to e_find_instantiation_func() as if registered, e.g.
+//	static e_instantiation_entry _e_handler_entry("BHandler", BHandler::Instantiate);
+struct e_instantiation_entry {
+	e_instantiation_entry(const char *class_name, e_instantiation_func func);
+
+	const char *class_name;
+	e_instantiation_func func;
+	e_instantiation_entry *next;
+};
+
+// e_register_instantiation_addon(): the classes of "signature" not registered yet are looked up
+// in the add-on at "path", loaded on the first demand, by the symbol of "ClassName::Instantiate()".
+status_t		e_register_instantiation_addon(const char *signature, const char *path);
+
+// e_instantiate_object(): the most derived class of "from" gets instantiated, NULL when it isn't found;
+// "image" returns the add-on holding the class or NULL.
+BArchivable*		e_instantiate_object(const BMessage *from, void **image = NULL);
 
 #endif /* __cplusplus */
 
@@ -35,27 +35,161 @@
 #define SIZEOF_FLOAT 4
 #define SIZEOF_DOUBLE 8
 
-status_t e_swap_data(type_code type, void *_data, size_t len, e_swap_action action)
+#if defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)) && \
+    (defined(__i386__) || defined(__x86_64__))
+#define ETK_SWAP_DATA_SIMD
+#include <immintrin.h>
+#endif
+
+typedef void (*e_swap_func)(uint8 *dest, const uint8 *src, size_t count);
+
+
+/* Scalar versions, they also finish the tails of the vector versions. */
+static void e_swap_16(uint8 *dest, const uint8 *src, size_t count)
 {
-	status_t retVal = B_BAD_VALUE;
+	for(; count > 0; count--, src += 2, dest += 2)
+	{
+		uint8 c = src[0];
+		dest[0] = src[1];
+		dest[1] = c;
+	}
+}
 
-	if(_data == NULL || len == 0) return B_BAD_VALUE;
 
-	switch(action)
+static void e_swap_32(uint8 *dest, const uint8 *src, size_t count)
+{
+	for(; count > 0; count--, src += 4, dest += 4)
 	{
-#ifdef ETK_LITTLE_ENDIAN
-		case B_SWAP_HOST_TO_LENDIAN:
-		case B_SWAP_LENDIAN_TO_HOST:
-#else
-		case B_SWAP_HOST_TO_BENDIAN:
-		case B_SWAP_BENDIAN_TO_HOST:
-#endif
-			return B_OK;
+		uint32 v;
+		memcpy(&v, src, 4);
+		v = B_SWAP_INT32(v);
+		memcpy(dest, &v, 4);
+	}
+}
 
-		default:
-			break;
+
+static void e_swap_64(uint8 *dest, const uint8 *src, size_t count)
+{
+	for(; count > 0; count--, src += 8, dest += 8)
+	{
+		uint64 v;
+		memcpy(&v, src, 8);
+		v = B_SWAP_INT64(v);
+		memcpy(dest, &v, 8);
+	}
+}
+
+
+#ifdef ETK_SWAP_DATA_SIMD
+
+/* pshufb masks reversing every element of 2, 4 or 8 bytes within 16 bytes */
+static const int8 e_swap_masks[3][16] = {
+	{1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14},
+	{3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12},
+	{7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8}
+};
+
+
+__attribute__((target("ssse3")))
+static size_t e_swap_ssse3(uint8 *dest, const uint8 *src, size_t len, int32 width)
+{
+	__m128i mask = _mm_loadu_si128((const __m128i*)e_swap_masks[width]);
+	size_t done = 0;
+
+	for(; len - done >= 64; done += 64)
+	{
+		__m128i a = _mm_loadu_si128((const __m128i*)(src + done));
+		__m128i b = _mm_loadu_si128((const __m128i*)(src + done + 16));
+		__m128i c = _mm_loadu_si128((const __m128i*)(src + done + 32));
+		__m128i d = _mm_loadu_si128((const __m128i*)(src + done + 48));
+		_mm_storeu_si128((__m128i*)(dest + done), _mm_shuffle_epi8(a, mask));
+		_mm_storeu_si128((__m128i*)(dest + done + 16), _mm_shuffle_epi8(b, mask));
+		_mm_storeu_si128((__m128i*)(dest + done + 32), _mm_shuffle_epi8(c, mask));
+		_mm_storeu_si128((__m128i*)(dest + done + 48), _mm_shuffle_epi8(d, mask));
 	}
 
+	for(; len - done >= 16; done += 16)
+		_mm_storeu_si128((__m128i*)(dest + done),
+				 _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(src + done)), mask));
+
+	return done;
+}
+
+
+__attribute__((target("avx2")))
+static size_t e_swap_avx2(uint8 *dest, const uint8 *src, size_t len, int32 width)
+{
+	/* vpshufb shuffles within each 128-bit lane, so the same mask serves both lanes */
+	__m128i mask128 = _mm_loadu_si128((const __m128i*)e_swap_masks[width]);
+	__m256i mask = _mm256_broadcastsi128_si256(mask128);
+	size_t done = 0;
+
+	for(; len - done >= 128; done += 128)
+	{
+		__m256i a = _mm256_loadu_si256((const __m256i*)(src + done));
+		__m256i b = _mm256_loadu_si256((const __m256i*)(src + done + 32));
+		__m256i c = _mm256_loadu_si256((const __m256i*)(src + done + 64));
+		__m256i d = _mm256_loadu_si256((const __m256i*)(src + done + 96));
+		_mm256_storeu_si256((__m256i*)(dest + done), _mm256_shuffle_epi8(a, mask));
+		_mm256_storeu_si256((__m256i*)(dest + done + 32), _mm256_shuffle_epi8(b, mask));
+		_mm256_storeu_si256((__m256i*)(dest + done + 64), _mm256_shuffle_epi8(c, mask));
+		_mm256_storeu_si256((__m256i*)(dest + done + 96), _mm256_shuffle_epi8(d, mask));
+	}
+
+	for(; len - done >= 32; done += 32)
+		_mm256_storeu_si256((__m256i*)(dest + done),
+				    _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i*)(src + done)), mask));
+
+	for(; len - done >= 16; done += 16)
+		_mm_storeu_si128((__m128i*)(dest + done),
+				 _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(src + done)), mask128));
+
+	return done;
+}
+
+
+typedef size_t (*e_swap_simd_func)(uint8 *dest, const uint8 *src, size_t len, int32 width);
+
+static e_swap_simd_func e_swap_simd = NULL;
+static bool e_swap_simd_checked = false;
+
+/* The check is idempotent, racing threads store the same result. */
+static e_swap_simd_func e_get_swap_simd(void)
+{
+	if(!e_swap_simd_checked)
+	{
+		__builtin_cpu_init();
+		if(__builtin_cpu_supports("avx2")) e_swap_simd = e_swap_avx2;
+		else if(__builtin_cpu_supports("ssse3")) e_swap_simd = e_swap_ssse3;
+		e_swap_simd_checked = true;
+	}
+
+	return e_swap_simd;
+}
+
+#endif /* ETK_SWAP_DATA_SIMD */
+
+
+/* width: 0 = 16 bits, 1 = 32 bits, 2 = 64 bits */
+static void e_swap_elements(uint8 *dest, const uint8 *src, size_t len, int32 width)
+{
+	static const e_swap_func funcs[3] = {e_swap_16, e_swap_32, e_swap_64};
+	size_t done = 0;
+
+#ifdef ETK_SWAP_DATA_SIMD
+	e_swap_simd_func simd = e_get_swap_simd();
+	if(simd != NULL && len >= 16) done = (*simd)(dest, src, len, width);
+#endif
+
+	if(done < len) (*funcs[width])(dest + done, src + done, (len - done) >> (width + 1));
+}
+
+
+/* Returns the element width for e_swap_elements(), 3 when the type has no byte order, -1 when unknown. */
+static int32 e_swap_width(type_code type, size_t len)
+{
+	int32 width;
+
 	switch(type)
 	{
 		case B_BOOL_TYPE:
@@ -64,69 +198,91 @@ status_t e_swap_data(type_code type, void *_data, size_t len, e_swap_action acti
 		case B_CHAR_TYPE:
 		case B_STRING_TYPE:
 		case B_MIME_TYPE:
-			retVal = B_OK;
-			break;
+			return 3;
 
 		case B_INT16_TYPE:
 		case B_UINT16_TYPE:
-			if(len % 2 == 0)
-			{
-				uint16 *data = (uint16*)_data;
-				for(len = len / 2; len > 0; len--, data++) *data = B_SWAP_INT16(*data);
-				retVal = B_OK;
-			}
+			width = 0;
 			break;
 
 		case B_INT32_TYPE:
 		case B_UINT32_TYPE:
-			if(len % 4 == 0)
-			{
-				uint32 *data = (uint32*)_data;
-				for(len = len / 4; len > 0; len--, data++) *data = B_SWAP_INT32(*data);
-				retVal = B_OK;
-			}
-			break;
-
-		case B_INT64_TYPE:
-		case B_UINT64_TYPE:
-			if(len % 8 == 0)
-			{
-				uint64 *data = (uint64*)_data;
-				for(len = len / 8; len > 0; len--, data++) *data = B_SWAP_INT64(*data);
-				retVal = B_OK;
-			}
-			break;
-
 #if SIZEOF_FLOAT == 4
 		case B_FLOAT_TYPE:
 		case B_RECT_TYPE:
 		case B_POINT_TYPE:
-			if(len % 4 == 0)
-			{
-				float *data = (float*)_data;
-				for(len = len / 4; len > 0; len--, data++) *data = B_SWAP_FLOAT(*data);
-				retVal = B_OK;
-			}
-			break;
 #endif
+			width = 1;
+			break;
 
+		case B_INT64_TYPE:
+		case B_UINT64_TYPE:
 #if SIZEOF_DOUBLE == 8
 		case B_DOUBLE_TYPE:
-			if(len % 8 == 0)
-			{
-				double *data = (double*)_data;
-				for(len = len / 8; len > 0; len--, data++) *data = B_SWAP_DOUBLE(*data);
-				retVal = B_OK;
-			}
-			break;
 #endif
+			width = 2;
+			break;
 
 		default:
 			/* TODO: other types */
-			break;
+			return -1;
+	}
+
+	return(len % ((size_t)2 << width) == 0 ? width : -1);
+}
+
+
+static bool e_swap_needed(e_swap_action action)
+{
+	switch(action)
+	{
+#ifdef ETK_LITTLE_ENDIAN
+		case B_SWAP_HOST_TO_LENDIAN:
+		case B_SWAP_LENDIAN_TO_HOST:
+#else
+		case B_SWAP_HOST_TO_BENDIAN:
+		case B_SWAP_BENDIAN_TO_HOST:
+#endif
+			return false;
+
+		default:
+			return true;
 	}
+}
+
+
+status_t e_swap_data(type_code type, void *data, size_t len, e_swap_action action)
+{
+	int32 width;
+
+	if(data == NULL || len == 0) return B_BAD_VALUE;
+	if(!e_swap_needed(action)) return B_OK;
+
+	if((width = e_swap_width(type, len)) < 0) return B_BAD_VALUE;
+	if(width < 3) e_swap_elements((uint8*)data, (const uint8*)data, len, width);
+
+	return B_OK;
+}
+
+
+status_t e_swap_data_copy(type_code type, void *dest, const void *src, size_t len, e_swap_action action)
+{
+	int32 width;
+
+	if(dest == NULL || src == NULL || len == 0) return B_BAD_VALUE;
+
+	if(!e_swap_needed(action))
+	{
+		if(dest != src) memcpy(dest, src, len);
+		return B_OK;
+	}
+
+	if((width = e_swap_width(type, len)) < 0) return B_BAD_VALUE;
+
+	if(width < 3) e_swap_elements((uint8*)dest, (const uint8*)src, len, width);
+	else if(dest != src) memcpy(dest, src, len);
 
-	return retVal;
+	return B_OK;
 }
 
 
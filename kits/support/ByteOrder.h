@@ -46,6 +46,8 @@ extern "C"
 	} e_swap_action;
 
 	status_t			e_swap_data(type_code type, void *data, size_t len, e_swap_action action);
+	/* Same as memcpy() followed by e_swap_data() but in one pass, "dest" and "src" must not overlap unless equal. */
+	status_t			e_swap_data_copy(type_code type, void *dest, const void *src, size_t len, e_swap_action action);
 	bool			e_is_type_swapped(type_code type);
 	float			e_swap_float(float value);
 	double			e_swap_double(double value);
@@ -27,7 +27,13 @@
  *
  * --------------------------------------------------------------------------*/
 
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
 #include <support/SupportDefs.h>
+#include <storage/File.h>
 
 #include "DataIO.h"
 
@@ -121,12 +127,12 @@ BMallocIO::Seek(int64 position, uint32 seek_mode)
 
 	switch (seek_mode) {
 		case B_SEEK_SET:
-			if (!(position < 0 || position > (int64)~((size_t)0)))
+			if (!(position < 0 || (uint64)position > (uint64)~((size_t)0)))
 				fPosition = (size_t)(retVal = position);
 			break;
 
 		case B_SEEK_CUR:
-			if (position < 0 ? (int64)fPosition >= -position : position <= (int64)(~((size_t)0) - fPosition)) {
+			if (position < 0 ? (int64)fPosition >= -position : (uint64)position <= (uint64)(~((size_t)0) - fPosition)) {
 				if (position < 0) fPosition -= (size_t)(-position);
 				else fPosition += (size_t)position;
 				retVal = (int64)fPosition;
@@ -134,7 +140,7 @@ BMallocIO::Seek(int64 position, uint32 seek_mode)
 			break;
 
 		case B_SEEK_END:
-			if (position < 0 ? (int64)fLength >= -position : position <= (int64)(~((size_t)0) - fLength)) {
+			if (position < 0 ? (int64)fLength >= -position : (uint64)position <= (uint64)(~((size_t)0) - fLength)) {
 				if (position < 0) fPosition = fLength - (size_t)(-position);
 				else fPosition = fLength + (size_t)position;
 				retVal = (int64)fPosition;
@@ -170,7 +176,7 @@ BMallocIO::SetSize(int64 size)
 	int64 alloc_size = size >= B_MAXINT64 - fBlockSize ?
 	                   B_MAXINT64 : ((size + (int64)fBlockSize - 1) & ~((int64)fBlockSize - 1));
 
-	if (alloc_size > (int64)~((size_t)0)) alloc_size = (int64)~((size_t)0);
+	if ((uint64)alloc_size > (uint64)~((size_t)0)) alloc_size = (int64)(~((size_t)0) >> 1);
 	if (alloc_size != (int64)fMallocSize) {
 		char *data = (char*)realloc(fData, (size_t)alloc_size);
 		if (data == NULL) {
@@ -312,3 +318,746 @@ BMemoryIO::SetSize(int64 size)
 	return B_OK;
 }
 
+
+
+BMappedFileIO::BMappedFileIO(const BFile *file, bool writable)
+		: BPositionIO(), fFD(-1), fWritable(false), fData(NULL), fMapSize(0), fLength(0), fPosition(0), fAdvice(B_MAPPED_IO_NORMAL)
+{
+	if (file == NULL || file->fFD == NULL) return;
+
+	// PROT_WRITE on a shared mapping needs a descriptor opened for reading too
+	if (writable && !(file->fMode & B_READ_WRITE)) return;
+
+	struct stat st;
+	int fd = dup(*((int*)file->fFD));
+	if (fd < 0) return;
+	if (fstat(fd, &st) != 0 || st.st_size < 0 || (uint64)st.st_size > (uint64)~((size_t)0)) {
+		close(fd);
+		return;
+	}
+
+	fFD = fd;
+	fWritable = writable;
+	fLength = (size_t)st.st_size;
+
+	if (_Remap(fLength) != B_OK) {
+		close(fFD);
+		fFD = -1;
+		fLength = 0;
+	}
+}
+
+
+BMappedFileIO::~BMappedFileIO()
+{
+	if (fFD < 0) return;
+
+	if (fWritable) Sync(false);
+	if (fData != NULL) munmap(fData, fMapSize);
+	close(fFD);
+}
+
+
+status_t
+BMappedFileIO::InitCheck() const
+{
+	return(fFD < 0 ? B_NO_INIT : B_OK);
+}
+
+
+status_t
+BMappedFileIO::_Remap(size_t size)
+{
+	if (size == fMapSize && (fData != NULL || size == 0)) return B_OK;
+
+	// The file must cover the whole mapping, touching pages past its end raises SIGBUS.
+	if (fWritable && size > fMapSize && ftruncate(fFD, (off_t)size) != 0) return B_IO_ERROR;
+
+	char *data;
+	if (size == 0) {
+		data = NULL;
+		if (fData != NULL) munmap(fData, fMapSize);
+	} else if (fData == NULL) {
+		data = (char*)mmap(NULL, size, PROT_READ | (fWritable ? PROT_WRITE : 0), MAP_SHARED, fFD, 0);
+		if (data == (char*)MAP_FAILED) return B_NO_MEMORY;
+	} else {
+		data = (char*)mremap(fData, fMapSize, size, MREMAP_MAYMOVE);
+		if (data == (char*)MAP_FAILED) return B_NO_MEMORY;
+	}
+
+	if (fWritable && size < fMapSize && ftruncate(fFD, (off_t)size) != 0) {
+		fData = data;
+		fMapSize = size;
+		return B_IO_ERROR;
+	}
+
+	fData = data;
+	fMapSize = size;
+	if (fData != NULL && fAdvice != B_MAPPED_IO_NORMAL) SetAdvice(fAdvice);
+
+	return B_OK;
+}
+
+
+ssize_t
+BMappedFileIO::ReadAt(int64 pos, void *buffer, size_t size)
+{
+	if (buffer == NULL) return B_BAD_VALUE;
+
+	if (size == 0 || BMappedFileIO::Seek(pos, B_SEEK_CUR) < 0) return 0;
+	if (fPosition >= fLength) return 0;
+
+	size = min_c(size, fLength - fPosition);
+	memcpy(buffer, fData + fPosition, size);
+
+	fPosition += size;
+	return size;
+}
+
+
+ssize_t
+BMappedFileIO::WriteAt(int64 pos, const void *buffer, size_t size)
+{
+	if (!fWritable) return B_NOT_ALLOWED;
+	if (buffer == NULL) return B_BAD_VALUE;
+
+	if (size == 0 || BMappedFileIO::Seek(pos, B_SEEK_CUR) < 0) return 0;
+	if (size > ~((size_t)0) - fPosition) return B_BAD_VALUE;
+
+	if (fPosition + size > fLength) {
+		status_t status = BMappedFileIO::SetSize((int64)(fPosition + size));
+		if (status != B_OK) return status;
+	}
+
+	memcpy(fData + fPosition, buffer, size);
+
+	fPosition += size;
+	return size;
+}
+
+
+int64
+BMappedFileIO::Seek(int64 position, uint32 seek_mode)
+{
+	int64 retVal = B_INT64_CONSTANT(-1);
+
+	switch (seek_mode) {
+		case B_SEEK_SET:
+			if (!(position < 0 || (uint64)position > (uint64)~((size_t)0)))
+				fPosition = (size_t)(retVal = position);
+			break;
+
+		case B_SEEK_CUR:
+			if (position < 0 ? (int64)fPosition >= -position : (uint64)position <= (uint64)(~((size_t)0) - fPosition)) {
+				if (position < 0) fPosition -= (size_t)(-position);
+				else fPosition += (size_t)position;
+				retVal = (int64)fPosition;
+			}
+			break;
+
+		case B_SEEK_END:
+			if (position < 0 ? (int64)fLength >= -position : (uint64)position <= (uint64)(~((size_t)0) - fLength)) {
+				if (position < 0) fPosition = fLength - (size_t)(-position);
+				else fPosition = fLength + (size_t)position;
+				retVal = (int64)fPosition;
+			}
+			break;
+
+		default:
+			break;
+	}
+
+	return retVal;
+}
+
+
+int64
+BMappedFileIO::Position() const
+{
+	return (int64)fPosition;
+}
+
+
+status_t
+BMappedFileIO::SetSize(int64 size)
+{
+	if (fFD < 0) return B_NO_INIT;
+	if (!fWritable) return B_NOT_ALLOWED;
+	if (size < 0 || size > (int64)(~((size_t)0) >> 1)) return B_BAD_VALUE;
+
+	if ((size_t)size > fMapSize) {
+		// grow geometrically so that appending doesn't remap on every write
+		size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+		size_t newSize = max_c((size_t)size, fMapSize * 2);
+		newSize = (newSize + pageSize - 1) & ~(pageSize - 1);
+
+		status_t status = _Remap(newSize);
+		if (status != B_OK && (status = _Remap((size_t)size)) != B_OK) return status;
+	}
+
+	if ((size_t)size > fLength) bzero(fData + fLength, (size_t)size - fLength);
+	fLength = (size_t)size;
+
+	return B_OK;
+}
+
+
+status_t
+BMappedFileIO::SetAdvice(uint32 advice)
+{
+	int flag;
+
+	switch (advice) {
+		case B_MAPPED_IO_NORMAL: flag = MADV_NORMAL; break;
+		case B_MAPPED_IO_SEQUENTIAL: flag = MADV_SEQUENTIAL; break;
+		case B_MAPPED_IO_RANDOM: flag = MADV_RANDOM; break;
+		case B_MAPPED_IO_WILL_NEED: flag = MADV_WILLNEED; break;
+		default: return B_BAD_VALUE;
+	}
+
+	fAdvice = advice;
+	if (fData == NULL) return B_OK;
+
+	return(madvise(fData, fMapSize, flag) == 0 ? B_OK : B_ERROR);
+}
+
+
+status_t
+BMappedFileIO::Sync(bool wait)
+{
+	if (fFD < 0) return B_NO_INIT;
+	if (!fWritable) return B_OK;
+
+	// trim the slack left by the geometric growth
+	status_t status = _Remap(fLength);
+	if (status != B_OK) return status;
+
+	if (fData == NULL) return B_OK;
+	return(msync(fData, fMapSize, wait ? MS_SYNC : MS_ASYNC) == 0 ? B_OK : B_IO_ERROR);
+}
+
+
+const void*
+BMappedFileIO::Buffer() const
+{
+	return((const void*)fData);
+}
+
+
+size_t
+BMappedFileIO::BufferLength() const
+{
+	return fLength;
+}
+
+
+BBufferedDataIO::BBufferedDataIO(BDataIO *stream, size_t bufferSize, bool ownsStream)
+		: BDataIO(), fStream(stream), fOwnsStream(ownsStream), fBufferSize(max_c(bufferSize, 1)),
+		  fReadBuffer(NULL), fReadStart(0), fReadEnd(0), fWriteBuffer(NULL), fWriteLength(0)
+{
+}
+
+
+BBufferedDataIO::~BBufferedDataIO()
+{
+	if (fStream != NULL) {
+		Flush();
+		if (fOwnsStream) delete fStream;
+	}
+
+	if (fReadBuffer != NULL) free(fReadBuffer);
+	if (fWriteBuffer != NULL) free(fWriteBuffer);
+}
+
+
+status_t
+BBufferedDataIO::InitCheck() const
+{
+	return(fStream == NULL ? B_NO_INIT : B_OK);
+}
+
+
+ssize_t
+BBufferedDataIO::_Fill()
+{
+	// the other side may wait for what we wrote before it sends anything
+	if (fWriteLength > 0) {
+		status_t status = Flush();
+		if (status != B_OK) return status;
+	}
+
+	if (fReadBuffer == NULL && (fReadBuffer = (char*)malloc(fBufferSize)) == NULL) return B_NO_MEMORY;
+
+	if (fReadStart > 0) {
+		if (fReadEnd > fReadStart) memmove(fReadBuffer, fReadBuffer + fReadStart, fReadEnd - fReadStart);
+		fReadEnd -= fReadStart;
+		fReadStart = 0;
+	}
+	if (fReadEnd == fBufferSize) return 0;
+
+	ssize_t n = fStream->Read(fReadBuffer + fReadEnd, fBufferSize - fReadEnd);
+	if (n > 0) fReadEnd += (size_t)n;
+
+	return n;
+}
+
+
+ssize_t
+BBufferedDataIO::Read(void *buffer, size_t size)
+{
+	if (fStream == NULL) return B_NO_INIT;
+	if (buffer == NULL) return B_BAD_VALUE;
+
+	size_t nRead = 0;
+	bool drained = false;
+
+	while (nRead < size) {
+		if (fReadStart < fReadEnd) {
+			size_t len = min_c(size - nRead, fReadEnd - fReadStart);
+			memcpy((char*)buffer + nRead, fReadBuffer + fReadStart, len);
+			fReadStart += len;
+			nRead += len;
+			continue;
+		}
+
+		// a short read tells that nothing more is available now, don't block on the stream again
+		if (drained) break;
+
+		size_t left = size - nRead;
+		ssize_t n;
+
+		if (left >= fBufferSize) {
+			// large reads go to the caller's buffer directly
+			if (fWriteLength > 0 && (n = Flush()) != B_OK) return(nRead > 0 ? (ssize_t)nRead : n);
+			if ((n = fStream->Read((char*)buffer + nRead, left)) > 0) nRead += (size_t)n;
+		} else {
+			n = _Fill();
+		}
+
+		if (n <= 0) return(nRead > 0 ? (ssize_t)nRead : n);
+		drained = ((size_t)n < max_c(left, fBufferSize));
+	}
+
+	return (ssize_t)nRead;
+}
+
+
+ssize_t
+BBufferedDataIO::Peek(const void **data, size_t size)
+{
+	if (fStream == NULL) return B_NO_INIT;
+	if (data == NULL) return B_BAD_VALUE;
+
+	size = min_c(size, fBufferSize);
+
+	while (fReadEnd - fReadStart < size) {
+		ssize_t n = _Fill();
+		if (n < 0 && fReadStart == fReadEnd) return n;
+		if (n <= 0) break;
+	}
+
+	*data = (fReadBuffer == NULL ? NULL : fReadBuffer + fReadStart);
+	return (ssize_t)min_c(size, fReadEnd - fReadStart);
+}
+
+
+ssize_t
+BBufferedDataIO::Skip(size_t size)
+{
+	if (fStream == NULL) return B_NO_INIT;
+
+	size_t nSkipped = 0;
+
+	while (nSkipped < size) {
+		if (fReadStart == fReadEnd) {
+			ssize_t n = _Fill();
+			if (n <= 0) return(nSkipped > 0 ? (ssize_t)nSkipped : n);
+		}
+
+		size_t len = min_c(size - nSkipped, fReadEnd - fReadStart);
+		fReadStart += len;
+		nSkipped += len;
+	}
+
+	return (ssize_t)nSkipped;
+}
+
+
+ssize_t
+BBufferedDataIO::Write(const void *buffer, size_t size)
+{
+	if (fStream == NULL) return B_NO_INIT;
+	if (buffer == NULL) return B_BAD_VALUE;
+
+	if (size > fBufferSize - fWriteLength) {
+		status_t status = Flush();
+		if (status != B_OK) return status;
+
+		if (size >= fBufferSize) {
+			size_t nWrote = 0;
+			while (nWrote < size) {
+				ssize_t n = fStream->Write((const char*)buffer + nWrote, size - nWrote);
+				if (n <= 0) return(nWrote > 0 ? (ssize_t)nWrote : (n < 0 ? n : B_IO_ERROR));
+				nWrote += (size_t)n;
+			}
+			return (ssize_t)nWrote;
+		}
+	}
+
+	if (fWriteBuffer == NULL && (fWriteBuffer = (char*)malloc(fBufferSize)) == NULL) return B_NO_MEMORY;
+
+	memcpy(fWriteBuffer + fWriteLength, buffer, size);
+	fWriteLength += size;
+
+	return (ssize_t)size;
+}
+
+
+status_t
+BBufferedDataIO::Flush()
+{
+	if (fStream == NULL) return B_NO_INIT;
+
+	size_t nWrote = 0;
+
+	while (nWrote < fWriteLength) {
+		ssize_t n = fStream->Write(fWriteBuffer + nWrote, fWriteLength - nWrote);
+		if (n <= 0) {
+			// keep what is left for the next try
+			memmove(fWriteBuffer, fWriteBuffer + nWrote, fWriteLength - nWrote);
+			fWriteLength -= nWrote;
+			return(n < 0 ? (status_t)n : B_IO_ERROR);
+		}
+		nWrote += (size_t)n;
+	}
+
+	fWriteLength = 0;
+	return B_OK;
+}
+
+
+BDataIO*
+BBufferedDataIO::Stream() const
+{
+	return fStream;
+}
+
+
+size_t
+BBufferedDataIO::BufferSize() const
+{
+	return fBufferSize;
+}
+
+
+BBufferedPositionIO::BBufferedPositionIO(BPositionIO *stream, size_t bufferSize, bool ownsStream)
+		: BPositionIO(), fStream(stream), fOwnsStream(ownsStream), fBufferSize(max_c(bufferSize, 1)), fBuffer(NULL),
+		  fBufferOffset(0), fBufferLength(0), fDirtyStart(0), fDirtyEnd(0), fPosition(0), fStreamPosition(-1)
+{
+	if (fStream != NULL && (fPosition = fStream->Position()) < 0) fPosition = 0;
+	fStreamPosition = fPosition;
+}
+
+
+BBufferedPositionIO::~BBufferedPositionIO()
+{
+	if (fStream != NULL) {
+		Flush();
+		if (fOwnsStream) delete fStream;
+	}
+
+	if (fBuffer != NULL) free(fBuffer);
+}
+
+
+status_t
+BBufferedPositionIO::InitCheck() const
+{
+	return(fStream == NULL ? B_NO_INIT : B_OK);
+}
+
+
+// Some streams take the offset of ReadAt()/WriteAt() as relative, others as absolute,
+// Seek() followed by Read()/Write() means the same to all of them.
+ssize_t
+BBufferedPositionIO::_StreamRead(int64 offset, void *buffer, size_t size)
+{
+	if (fStreamPosition != offset) {
+		if (fStream->Seek(offset, B_SEEK_SET) != offset) {
+			fStreamPosition = -1;
+			return B_IO_ERROR;
+		}
+		fStreamPosition = offset;
+	}
+
+	ssize_t n = fStream->Read(buffer, size);
+	if (n > 0) fStreamPosition += n;
+	else if (n < 0) fStreamPosition = -1;
+
+	return n;
+}
+
+
+ssize_t
+BBufferedPositionIO::_StreamWrite(int64 offset, const void *buffer, size_t size)
+{
+	if (fStreamPosition != offset) {
+		if (fStream->Seek(offset, B_SEEK_SET) != offset) {
+			fStreamPosition = -1;
+			return B_IO_ERROR;
+		}
+		fStreamPosition = offset;
+	}
+
+	size_t nWrote = 0;
+	while (nWrote < size) {
+		ssize_t n = fStream->Write((const char*)buffer + nWrote, size - nWrote);
+		if (n <= 0) {
+			fStreamPosition = -1;
+			return(nWrote > 0 ? (ssize_t)nWrote : (n < 0 ? n : B_IO_ERROR));
+		}
+		nWrote += (size_t)n;
+		fStreamPosition += n;
+	}
+
+	return (ssize_t)nWrote;
+}
+
+
+status_t
+BBufferedPositionIO::Flush()
+{
+	if (fStream == NULL) return B_NO_INIT;
+	if (fDirtyEnd <= fDirtyStart) return B_OK;
+
+	size_t len = fDirtyEnd - fDirtyStart;
+	ssize_t n = _StreamWrite(fBufferOffset + (int64)fDirtyStart, fBuffer + fDirtyStart, len);
+	if (n < 0) return (status_t)n;
+	if ((size_t)n < len) {
+		fDirtyStart += (size_t)n;
+		return B_IO_ERROR;
+	}
+
+	fDirtyStart = fDirtyEnd = 0;
+	return B_OK;
+}
+
+
+ssize_t
+BBufferedPositionIO::_Fill(int64 offset)
+{
+	status_t status = Flush();
+	if (status != B_OK) return status;
+
+	if (fBuffer == NULL && (fBuffer = (char*)malloc(fBufferSize)) == NULL) return B_NO_MEMORY;
+
+	fBufferOffset = offset;
+	fBufferLength = 0;
+
+	ssize_t n = _StreamRead(offset, fBuffer, fBufferSize);
+	if (n > 0) fBufferLength = (size_t)n;
+
+	return n;
+}
+
+
+ssize_t
+BBufferedPositionIO::ReadAt(int64 pos, void *buffer, size_t size)
+{
+	if (fStream == NULL) return B_NO_INIT;
+	if (buffer == NULL) return B_BAD_VALUE;
+
+	if (size == 0 || BBufferedPositionIO::Seek(pos, B_SEEK_CUR) < 0) return 0;
+
+	size_t nRead = 0;
+
+	while (nRead < size) {
+		if (fPosition >= fBufferOffset && fPosition < fBufferOffset + (int64)fBufferLength) {
+			size_t offset = (size_t)(fPosition - fBufferOffset);
+			size_t len = min_c(size - nRead, fBufferLength - offset);
+			memcpy((char*)buffer + nRead, fBuffer + offset, len);
+			fPosition += (int64)len;
+			nRead += len;
+			continue;
+		}
+
+		size_t left = size - nRead;
+		ssize_t n;
+
+		if (left >= fBufferSize) {
+			// large reads go to the caller's buffer directly
+			status_t status = Flush();
+			if (status != B_OK) return(nRead > 0 ? (ssize_t)nRead : status);
+
+			if ((n = _StreamRead(fPosition, (char*)buffer + nRead, left)) > 0) {
+				fPosition += n;
+				nRead += (size_t)n;
+			}
+			if (n <= 0 || (size_t)n < left) return(nRead > 0 ? (ssize_t)nRead : n);
+		} else if ((n = _Fill(fPosition)) <= 0) {
+			return(nRead > 0 ? (ssize_t)nRead : n);
+		}
+	}
+
+	return (ssize_t)nRead;
+}
+
+
+ssize_t
+BBufferedPositionIO::WriteAt(int64 pos, const void *buffer, size_t size)
+{
+	if (fStream == NULL) return B_NO_INIT;
+	if (buffer == NULL) return B_BAD_VALUE;
+
+	if (size == 0 || BBufferedPositionIO::Seek(pos, B_SEEK_CUR) < 0) return 0;
+
+	size_t nWrote = 0;
+
+	while (nWrote < size) {
+		// the data of the window must stay contiguous, a write may extend it but not leave a hole
+		if (fBuffer != NULL && fPosition >= fBufferOffset &&
+		    fPosition <= fBufferOffset + (int64)fBufferLength &&
+		    fPosition < fBufferOffset + (int64)fBufferSize) {
+			size_t offset = (size_t)(fPosition - fBufferOffset);
+			size_t len = min_c(size - nWrote, fBufferSize - offset);
+			memcpy(fBuffer + offset, (const char*)buffer + nWrote, len);
+
+			if (fDirtyEnd <= fDirtyStart) {
+				fDirtyStart = offset;
+				fDirtyEnd = offset + len;
+			} else {
+				fDirtyStart = min_c(fDirtyStart, offset);
+				fDirtyEnd = max_c(fDirtyEnd, offset + len);
+			}
+			if (fBufferLength < offset + len) fBufferLength = offset + len;
+
+			fPosition += (int64)len;
+			nWrote += len;
+			continue;
+		}
+
+		status_t status = Flush();
+		if (status != B_OK) return(nWrote > 0 ? (ssize_t)nWrote : status);
+
+		size_t left = size - nWrote;
+
+		if (left >= fBufferSize) {
+			ssize_t n = _StreamWrite(fPosition, (const char*)buffer + nWrote, left);
+			if (n <= 0) return(nWrote > 0 ? (ssize_t)nWrote : n);
+
+			// drop the window when it holds stale data now
+			if (fPosition < fBufferOffset + (int64)fBufferLength && fPosition + n > fBufferOffset) fBufferLength = 0;
+
+			fPosition += n;
+			nWrote += (size_t)n;
+			continue;
+		}
+
+		if (fBuffer == NULL && (fBuffer = (char*)malloc(fBufferSize)) == NULL) return(nWrote > 0 ? (ssize_t)nWrote : B_NO_MEMORY);
+
+		// start an empty window at the position
+		fBufferOffset = fPosition;
+		fBufferLength = 0;
+	}
+
+	return (ssize_t)nWrote;
+}
+
+
+int64
+BBufferedPositionIO::Seek(int64 position, uint32 seek_mode)
+{
+	int64 base;
+
+	switch (seek_mode) {
+		case B_SEEK_SET:
+			base = 0;
+			break;
+
+		case B_SEEK_CUR:
+			base = fPosition;
+			break;
+
+		case B_SEEK_END:
+			if (fStream == NULL || Flush() != B_OK) return B_INT64_CONSTANT(-1);
+			if ((base = fStream->Seek(0, B_SEEK_END)) < 0) {
+				fStreamPosition = -1;
+				return B_INT64_CONSTANT(-1);
+			}
+			fStreamPosition = base;
+			break;
+
+		default:
+			return B_INT64_CONSTANT(-1);
+	}
+
+	if (position < 0 ? base < -position : position > B_MAXINT64 - base) return B_INT64_CONSTANT(-1);
+
+	fPosition = base + position;
+	return fPosition;
+}
+
+
+int64
+BBufferedPositionIO::Position() const
+{
+	return fPosition;
+}
+
+
+status_t
+BBufferedPositionIO::SetSize(int64 size)
+{
+	if (fStream == NULL) return B_NO_INIT;
+	if (size < 0) return B_BAD_VALUE;
+
+	status_t status = Flush();
+	if (status != B_OK) return status;
+
+	// some streams move their position on SetSize()
+	fStreamPosition = -1;
+	if ((status = fStream->SetSize(size)) != B_OK) return status;
+
+	if (fBufferOffset + (int64)fBufferLength > size)
+		fBufferLength = (size > fBufferOffset ? (size_t)(size - fBufferOffset) : 0);
+
+	return B_OK;
+}
+
+
+ssize_t
+BBufferedPositionIO::Peek(const void **data, size_t size)
+{
+	if (fStream == NULL) return B_NO_INIT;
+	if (data == NULL) return B_BAD_VALUE;
+
+	size = min_c(size, fBufferSize);
+
+	if (!(fPosition >= fBufferOffset && fPosition + (int64)size <= fBufferOffset + (int64)fBufferLength)) {
+		ssize_t n = _Fill(fPosition);
+		if (n < 0) return n;
+	}
+
+	if (fPosition < fBufferOffset || fPosition >= fBufferOffset + (int64)fBufferLength) {
+		*data = NULL;
+		return 0;
+	}
+
+	size_t offset = (size_t)(fPosition - fBufferOffset);
+	*data = fBuffer + offset;
+	return (ssize_t)min_c(size, fBufferLength - offset);
+}
+
+
+BPositionIO*
+BBufferedPositionIO::Stream() const
+{
+	return fStream;
+}
+
+
+size_t
+BBufferedPositionIO::BufferSize() const
+{
+	return fBufferSize;
+}
@@ -34,6 +34,8 @@
 
 #ifdef __cplusplus /* Just for C++ */
 
+class BFile;
+
 
 class BDataIO
 {
@@ -113,6 +115,139 @@ class BMemoryIO : public BPositionIO
 };
 
 
+enum {
+	B_MAPPED_IO_NORMAL = 0,
+	B_MAPPED_IO_SEQUENTIAL,		// read ahead aggressively, drop pages after use
+	B_MAPPED_IO_RANDOM,		// don't read ahead
+	B_MAPPED_IO_WILL_NEED,		// start reading in the whole file now
+};
+
+
+// BMappedFileIO: the content of a file mapped into memory, nothing is copied into the heap.
+//                The read-write mode needs a file opened with B_READ_WRITE, writing past the end
+//                grows the file and remaps it, so the pointer from Buffer() can change then.
+class BMappedFileIO : public BPositionIO
+{
+	public:
+		BMappedFileIO(const BFile *file, bool writable = false);
+		virtual ~BMappedFileIO();
+
+		status_t		InitCheck() const;
+
+		virtual ssize_t		ReadAt(int64 pos, void *buffer, size_t size);
+		virtual ssize_t		WriteAt(int64 pos, const void *buffer, size_t size);
+
+		virtual int64		Seek(int64 position, uint32 seek_mode);
+		virtual int64		Position() const;
+		virtual status_t	SetSize(int64 size);
+
+		status_t		SetAdvice(uint32 advice);
+		status_t		Sync(bool wait = true);
+
+		const void		*Buffer() const;
+		size_t			BufferLength() const;
+
+	private:
+		int fFD;
+		bool fWritable;
+		char *fData;
+		size_t fMapSize;
+		size_t fLength;
+		size_t fPosition;
+		uint32 fAdvice;
+
+		status_t _Remap(size_t size);
+};
+
+
+// BBufferedDataIO: read-ahead and write-behind on top of a stream, so that reading or writing
+//                  a few bytes at a time doesn't cost a call into the stream each time.
+//                  Reading and writing are buffered separately like they are on a pipe or a
+//                  socket, use BBufferedPositionIO for a file that is read and written.
+class BBufferedDataIO : public BDataIO
+{
+	public:
+		BBufferedDataIO(BDataIO *stream, size_t bufferSize = 65536, bool ownsStream = false);
+		virtual ~BBufferedDataIO();
+
+		status_t		InitCheck() const;
+
+		virtual ssize_t		Read(void *buffer, size_t size);
+		virtual ssize_t		Write(const void *buffer, size_t size);
+
+		// Peek() returns the data which Read() would return next without consuming it,
+		// "size" is limited by the buffer size. Skip() consumes it.
+		ssize_t			Peek(const void **data, size_t size);
+		ssize_t			Skip(size_t size);
+
+		status_t		Flush();
+
+		BDataIO			*Stream() const;
+		size_t			BufferSize() const;
+
+	private:
+		BDataIO *fStream;
+		bool fOwnsStream;
+		size_t fBufferSize;
+
+		char *fReadBuffer;
+		size_t fReadStart;
+		size_t fReadEnd;
+
+		char *fWriteBuffer;
+		size_t fWriteLength;
+
+		ssize_t _Fill();
+};
+
+
+// BBufferedPositionIO: one buffer window over a positioned stream, used for reading and writing.
+//                      The dirty part of the window is written back when the position leaves it,
+//                      on Flush(), SetSize(), seeking from the end and in the destructor.
+class BBufferedPositionIO : public BPositionIO
+{
+	public:
+		BBufferedPositionIO(BPositionIO *stream, size_t bufferSize = 65536, bool ownsStream = false);
+		virtual ~BBufferedPositionIO();
+
+		status_t		InitCheck() const;
+
+		virtual ssize_t		ReadAt(int64 pos, void *buffer, size_t size);
+		virtual ssize_t		WriteAt(int64 pos, const void *buffer, size_t size);
+
+		virtual int64		Seek(int64 position, uint32 seek_mode);
+		virtual int64		Position() const;
+		virtual status_t	SetSize(int64 size);
+
+		// Peek() returns the data at the current position without consuming it,
+		// "size" is limited by the buffer size. Seek(n, B_SEEK_CUR) consumes it.
+		ssize_t			Peek(const void **data, size_t size);
+
+		status_t		Flush();
+
+		BPositionIO		*Stream() const;
+		size_t			BufferSize() const;
+
+	private:
+		BPositionIO *fStream;
+		bool fOwnsStream;
+		size_t fBufferSize;
+		char *fBuffer;
+
+		int64 fBufferOffset;
+		size_t fBufferLength;
+		size_t fDirtyStart;
+		size_t fDirtyEnd;
+
+		int64 fPosition;
+		int64 fStreamPosition;
+
+		ssize_t _StreamRead(int64 offset, void *buffer, size_t size);
+		ssize_t _StreamWrite(int64 offset, const void *buffer, size_t size);
+		ssize_t _Fill(int64 offset);
+};
+
+
 #endif /* __cplusplus */
 
 #endif /* __ETK_DATA_IO_H__ */
@@ -0,0 +1,499 @@
+/* --------------------------------------------------------------------------
+ *
+ * ETK++ --- The Easy Toolkit for C++ programing
+ * Copyright (C) 2004-2007, Anthony Lee, All Rights Reserved
+ *
+ * ETK++ library is a freeware; it may be used and distributed according to
+ * the terms of The MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+ * IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * File: HashMap.h
+ *
+ * --------------------------------------------------------------------------*/
+
+#ifndef __ETK_HASH_MAP_H__
+#define __ETK_HASH_MAP_H__
+
+#include <string.h>
+
+#include <support/SupportDefs.h>
+#include <support/String.h>
+
+#ifdef __cplusplus /* Just for C++ */
+
+#include <new>
+
+// e_hash_data(),e_hash_string(),e_hash_int(): fast non-cryptographic hashes, NOT stable between releases.
+inline uint32 e_hash_data(const void *data, size_t length)
+{
+	const uint8 *p = (const uint8*)data;
+	uint64 h = B_INT64_CONSTANT(0x9e3779b97f4a7c15) ^ (uint64)length;
+
+	for (; length >= 8; length -= 8, p += 8) {
+		uint64 v;
+		memcpy(&v, p, 8);
+		v *= B_INT64_CONSTANT(0xff51afd7ed558ccd);
+		v ^= v >> 32;
+		h = (h ^ v) * B_INT64_CONSTANT(0xc4ceb9fe1a85ec53);
+	}
+
+	if (length > 0) {
+		uint64 v = 0;
+		memcpy(&v, p, length);
+		v *= B_INT64_CONSTANT(0xff51afd7ed558ccd);
+		v ^= v >> 32;
+		h = (h ^ v) * B_INT64_CONSTANT(0xc4ceb9fe1a85ec53);
+	}
+
+	h ^= h >> 33;
+	h *= B_INT64_CONSTANT(0xff51afd7ed558ccd);
+	h ^= h >> 33;
+
+	return (uint32)h;
+}
+
+
+inline uint32 e_hash_string(const char *str)
+{
+	return e_hash_data(str, str == NULL ? 0 : strlen(str));
+}
+
+
+inline uint32 e_hash_int(uint64 value)
+{
+	value ^= value >> 33;
+	value *= B_INT64_CONSTANT(0xff51afd7ed558ccd);
+	value ^= value >> 33;
+	value *= B_INT64_CONSTANT(0xc4ceb9fe1a85ec53);
+	value ^= value >> 33;
+
+	return (uint32)value;
+}
+
+
+// BHashKeyTraits: how BHashMap/BHashSet hash and compare the keys.
+// 	The default handles integers and enums, there are specializations for pointers,
+// 	C strings (compared by content, the map doesn't copy them) and BString.
+template<typename Key>
+struct BHashKeyTraits {
+	static uint32 Hash(const Key &key) {return e_hash_int((uint64)key);}
+	static bool Equal(const Key &a, const Key &b) {return a == b;}
+};
+
+template<typename T>
+struct BHashKeyTraits<T*> {
+	static uint32 Hash(const T *key) {return e_hash_int((uint64)(size_t)key);}
+	static bool Equal(const T *a, const T *b) {return a == b;}
+};
+
+template<>
+struct BHashKeyTraits<const char*> {
+	static uint32 Hash(const char *key) {return e_hash_string(key);}
+	static bool Equal(const char *a, const char *b) {return(a == b || (a != NULL && b != NULL && strcmp(a, b) == 0));}
+};
+
+template<>
+struct BHashKeyTraits<char*> : public BHashKeyTraits<const char*> {
+};
+
+template<>
+struct BHashKeyTraits<BString> {
+	static uint32 Hash(const BString &key) {return e_hash_data(key.String(), (size_t)key.Length());}
+	static uint32 Hash(const char *key) {return e_hash_string(key);}
+	static bool Equal(const BString &a, const BString &b) {return a == b;}
+	static bool Equal(const BString &a, const char *b) {return a == b;}
+};
+
+
+// BHashMap: open addressing with Robin Hood probing, the full hash of every slot is kept
+// 	beside the entries so that most mismatches never touch a key.
+// 	Put() and Remove() move entries around, pointers from Lookup() and cookies of GetNext()
+// 	are only valid until the next change. Lookup(), ContainsKey() and Remove() accept anything
+// 	the traits can hash and compare to a key, e.g. a "const char*" for BString keys.
+template<typename Key, typename Value, typename Traits = BHashKeyTraits<Key> >
+class BHashMap
+{
+	public:
+		BHashMap(int32 initialCapacity = 0);
+		BHashMap(const BHashMap &from);
+		~BHashMap();
+
+		BHashMap	&operator=(const BHashMap &from);
+
+		// Put(): add the key or replace the value of it.
+		status_t	Put(const Key &key, const Value &value);
+
+		template<typename K> Value *Lookup(const K &key) const;
+		template<typename K> bool ContainsKey(const K &key) const;
+		template<typename K> bool Remove(const K &key, Value *oldValue = NULL);
+
+		// Get(): the value of the key, or "defaultValue" when not found.
+		Value		Get(const Key &key, const Value &defaultValue = Value()) const;
+
+		void		MakeEmpty();
+		status_t	SetCapacity(int32 count);
+
+		int32		CountItems() const;
+		bool		IsEmpty() const;
+
+		// GetNext(): iteration, start with *cookie = 0.
+		bool		GetNext(int32 *cookie, const Key **key, Value **value = NULL) const;
+
+	private:
+		struct _entry_t {
+			_entry_t(const Key &k, const Value &v) : key(k), value(v) {}
+
+			Key key;
+			Value value;
+		};
+
+		uint32 *fHashes;
+		_entry_t *fEntries;
+		uint32 fMask;
+		int32 fCount;
+
+		template<typename K> int32 _Find(const K &key, uint32 hash) const;
+		void		_Insert(uint32 hash, const Key &key, const Value &value);
+		status_t	_Rehash(uint32 capacity);
+		void		_Free();
+
+		static uint32	_HashOf(uint32 hash) {return hash | 0x80000000;} // 0 marks an empty slot
+};
+
+
+// BHashSet: a set of keys on top of BHashMap.
+template<typename Key, typename Traits = BHashKeyTraits<Key> >
+class BHashSet
+{
+	public:
+		BHashSet(int32 initialCapacity = 0) : fMap(initialCapacity) {}
+
+		status_t	Add(const Key &key) {return fMap.Put(key, 0);}
+		template<typename K> bool Contains(const K &key) const {return fMap.ContainsKey(key);}
+		template<typename K> bool Remove(const K &key) {return fMap.Remove(key);}
+
+		void		MakeEmpty() {fMap.MakeEmpty();}
+		status_t	SetCapacity(int32 count) {return fMap.SetCapacity(count);}
+
+		int32		CountItems() const {return fMap.CountItems();}
+		bool		IsEmpty() const {return fMap.IsEmpty();}
+
+		bool		GetNext(int32 *cookie, const Key **key) const {return fMap.GetNext(cookie, key);}
+
+	private:
+		BHashMap<Key, uint8, Traits> fMap;
+};
+
+
+template<typename Key, typename Value, typename Traits>
+BHashMap<Key, Value, Traits>::BHashMap(int32 initialCapacity)
+	: fHashes(NULL), fEntries(NULL), fMask(0), fCount(0)
+{
+	if (initialCapacity > 0) SetCapacity(initialCapacity);
+}
+
+
+template<typename Key, typename Value, typename Traits>
+BHashMap<Key, Value, Traits>::BHashMap(const BHashMap &from)
+	: fHashes(NULL), fEntries(NULL), fMask(0), fCount(0)
+{
+	operator=(from);
+}
+
+
+template<typename Key, typename Value, typename Traits>
+BHashMap<Key, Value, Traits>::~BHashMap()
+{
+	_Free();
+}
+
+
+template<typename Key, typename Value, typename Traits>
+BHashMap<Key, Value, Traits>&
+BHashMap<Key, Value, Traits>::operator=(const BHashMap &from)
+{
+	if (&from == this) return *this;
+
+	MakeEmpty();
+	if (from.fCount == 0 || SetCapacity(from.fCount) != B_OK) return *this;
+
+	for (uint32 i = 0; i <= from.fMask; i++) {
+		if (from.fHashes[i] != 0) _Insert(from.fHashes[i], from.fEntries[i].key, from.fEntries[i].value);
+	}
+
+	return *this;
+}
+
+
+template<typename Key, typename Value, typename Traits>
+void
+BHashMap<Key, Value, Traits>::_Free()
+{
+	if (fHashes == NULL) return;
+
+	for (uint32 i = 0; i <= fMask; i++) {
+		if (fHashes[i] != 0) fEntries[i].~_entry_t();
+	}
+
+	free(fHashes);
+	free(fEntries);
+	fHashes = NULL;
+	fEntries = NULL;
+	fMask = 0;
+	fCount = 0;
+}
+
+
+template<typename Key, typename Value, typename Traits>
+template<typename K>
+int32
+BHashMap<Key, Value, Traits>::_Find(const K &key, uint32 hash) const
+{
+	if (fCount == 0) return -1;
+
+	uint32 index = hash & fMask;
+
+	for (uint32 distance = 0; ; distance++, index = (index + 1) & fMask) {
+		uint32 h = fHashes[index];
+
+		// an entry closer to its home than we are to ours: the key would have taken that slot
+		if (h == 0 || ((index - h) & fMask) < distance) return -1;
+		if (h == hash && Traits::Equal(fEntries[index].key, key)) return (int32)index;
+	}
+}
+
+
+template<typename Key, typename Value, typename Traits>
+void
+BHashMap<Key, Value, Traits>::_Insert(uint32 hash, const Key &key, const Value &value)
+{
+	uint32 index = hash & fMask;
+	uint32 distance = 0;
+
+	// find the slot of the new entry, richer entries on the way are left alone
+	for (; fHashes[index] != 0; distance++, index = (index + 1) & fMask) {
+		if (((index - fHashes[index]) & fMask) < distance) break;
+	}
+
+	if (fHashes[index] != 0) {
+		// shift the run up to the next empty slot one step forward, every entry of it
+		// moves one step further from its home which keeps the Robin Hood order
+		uint32 end = index;
+		while (fHashes[end] != 0) end = (end + 1) & fMask;
+
+		for (uint32 i = end; i != index; i = (i - 1) & fMask) {
+			uint32 prev = (i - 1) & fMask;
+			new (&fEntries[i]) _entry_t(fEntries[prev]);
+			fEntries[prev].~_entry_t();
+			fHashes[i] = fHashes[prev];
+		}
+	}
+
+	new (&fEntries[index]) _entry_t(key, value);
+	fHashes[index] = hash;
+	fCount++;
+}
+
+
+template<typename Key, typename Value, typename Traits>
+status_t
+BHashMap<Key, Value, Traits>::_Rehash(uint32 capacity)
+{
+	uint32 *hashes = (uint32*)malloc(sizeof(uint32) * capacity);
+	_entry_t *entries = (_entry_t*)malloc(sizeof(_entry_t) * capacity);
+
+	if (hashes == NULL || entries == NULL) {
+		if (hashes) free(hashes);
+		if (entries) free(entries);
+		return B_NO_MEMORY;
+	}
+
+	bzero(hashes, sizeof(uint32) * capacity);
+
+	uint32 *oldHashes = fHashes;
+	_entry_t *oldEntries = fEntries;
+	uint32 oldCapacity = (oldHashes == NULL ? 0 : fMask + 1);
+
+	fHashes = hashes;
+	fEntries = entries;
+	fMask = capacity - 1;
+	fCount = 0;
+
+	for (uint32 i = 0; i < oldCapacity; i++) {
+		if (oldHashes[i] == 0) continue;
+		_Insert(oldHashes[i], oldEntries[i].key, oldEntries[i].value);
+		oldEntries[i].~_entry_t();
+	}
+
+	if (oldHashes) free(oldHashes);
+	if (oldEntries) free(oldEntries);
+
+	return B_OK;
+}
+
+
+template<typename Key, typename Value, typename Traits>
+status_t
+BHashMap<Key, Value, Traits>::SetCapacity(int32 count)
+{
+	if (count < fCount) count = fCount;
+	if (count > B_MAXINT32 / 2) return B_NO_MEMORY;
+
+	// keep the load under 7/8
+	uint32 capacity = 8;
+	while (capacity - (capacity >> 3) < (uint32)count) capacity <<= 1;
+
+	if (fHashes != NULL && capacity == fMask + 1) return B_OK;
+	return _Rehash(capacity);
+}
+
+
+template<typename Key, typename Value, typename Traits>
+status_t
+BHashMap<Key, Value, Traits>::Put(const Key &key, const Value &value)
+{
+	uint32 hash = _HashOf(Traits::Hash(key));
+
+	int32 index = _Find(key, hash);
+	if (index >= 0) {
+		fEntries[index].value = value;
+		return B_OK;
+	}
+
+	if (fHashes == NULL || (uint32)fCount + 1 > (fMask + 1) - ((fMask + 1) >> 3)) {
+		if (fCount == B_MAXINT32 / 2) return B_NO_MEMORY;
+		status_t status = _Rehash(fHashes == NULL ? 8 : (fMask + 1) << 1);
+		if (status != B_OK) return status;
+	}
+
+	_Insert(hash, key, value);
+	return B_OK;
+}
+
+
+template<typename Key, typename Value, typename Traits>
+template<typename K>
+Value*
+BHashMap<Key, Value, Traits>::Lookup(const K &key) const
+{
+	int32 index = _Find(key, _HashOf(Traits::Hash(key)));
+	return(index < 0 ? NULL : &fEntries[index].value);
+}
+
+
+template<typename Key, typename Value, typename Traits>
+template<typename K>
+bool
+BHashMap<Key, Value, Traits>::ContainsKey(const K &key) const
+{
+	return(_Find(key, _HashOf(Traits::Hash(key))) >= 0);
+}
+
+
+template<typename Key, typename Value, typename Traits>
+Value
+BHashMap<Key, Value, Traits>::Get(const Key &key, const Value &defaultValue) const
+{
+	int32 index = _Find(key, _HashOf(Traits::Hash(key)));
+	return(index < 0 ? defaultValue : fEntries[index].value);
+}
+
+
+template<typename Key, typename Value, typename Traits>
+template<typename K>
+bool
+BHashMap<Key, Value, Traits>::Remove(const K &key, Value *oldValue)
+{
+	int32 found = _Find(key, _HashOf(Traits::Hash(key)));
+	if (found < 0) return false;
+
+	uint32 index = (uint32)found;
+	if (oldValue) *oldValue = fEntries[index].value;
+	fEntries[index].~_entry_t();
+
+	// backward shift: pull the following entries which aren't at home one step back
+	for (uint32 next = (index + 1) & fMask;
+	     fHashes[next] != 0 && ((next - fHashes[next]) & fMask) != 0;
+	     index = next, next = (next + 1) & fMask) {
+		new (&fEntries[index]) _entry_t(fEntries[next]);
+		fEntries[next].~_entry_t();
+		fHashes[index] = fHashes[next];
+	}
+
+	fHashes[index] = 0;
+	fCount--;
+
+	return true;
+}
+
+
+template<typename Key, typename Value, typename Traits>
+void
+BHashMap<Key, Value, Traits>::MakeEmpty()
+{
+	if (fHashes == NULL) return;
+
+	for (uint32 i = 0; i <= fMask; i++) {
+		if (fHashes[i] == 0) continue;
+		fEntries[i].~_entry_t();
+		fHashes[i] = 0;
+	}
+
+	fCount = 0;
+}
+
+
+template<typename Key, typename Value, typename Traits>
+int32
+BHashMap<Key, Value, Traits>::CountItems() const
+{
+	return fCount;
+}
+
+
+template<typename Key, typename Value, typename Traits>
+bool
+BHashMap<Key, Value, Traits>::IsEmpty() const
+{
+	return(fCount == 0);
+}
+
+
+template<typename Key, typename Value, typename Traits>
+bool
+BHashMap<Key, Value, Traits>::GetNext(int32 *cookie, const Key **key, Value **value) const
+{
+	if (cookie == NULL || *cookie < 0 || fHashes == NULL) return false;
+
+	for (uint32 i = (uint32)*cookie; i <= fMask; i++) {
+		if (fHashes[i] == 0) continue;
+
+		if (key) *key = &fEntries[i].key;
+		if (value) *value = &fEntries[i].value;
+		*cookie = (int32)i + 1;
+		return true;
+	}
+
+	*cookie = (int32)fMask + 1;
+	return false;
+}
+
+#endif /* __cplusplus */
+
+#endif /* __ETK_HASH_MAP_H__ */
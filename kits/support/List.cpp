@@ -32,64 +32,80 @@
 #include <string.h>
 
 #include "List.h"
+#include "Allocator.h"
 
 #define MAX_LIST_COUNT	(B_MAXINT32 - 1)
 
 
+void**
+BList::_Realloc(int32 itemReal)
+{
+	if (fAllocator == NULL) return (void**)realloc(fObjects, (size_t)itemReal * sizeof(void*));
+	return (void**)fAllocator->Realloc(fObjects, (size_t)fItemReal * sizeof(void*), (size_t)itemReal * sizeof(void*));
+}
+
+
+void
+BList::_Free()
+{
+	if (fObjects == NULL) return;
+
+	if (fAllocator == NULL) free(fObjects);
+	else fAllocator->Free(fObjects, (size_t)fItemReal * sizeof(void*));
+
+	fObjects = NULL;
+	fItemReal = 0;
+}
+
+
+// The array keeps a NULL after the last item, all the slots past the count are NULL.
+// It grows by half of its size at least and shrinks when less than a quarter is used,
+// so that adding or removing items one by one doesn't reallocate every time.
 bool
 BList::_Resize(int32 count)
 {
-	if (count <= 0) {
-		if (fMinimumCount > 0) {
-			void **newObjects = (void**)realloc(fObjects, (size_t)(fMinimumCount + 1) * sizeof(void*));
-			if (newObjects != NULL) {
-				fObjects = newObjects;
-				fItemReal = fMinimumCount + 1;
-			}
-		} else {
-			if (fObjects) free(fObjects);
-			fObjects = NULL;
-			fItemReal = 0;
-		}
+	if (count > MAX_LIST_COUNT) return false;
+	if (count < 0) count = 0;
 
+	if (count == 0 && fMinimumCount == 0) {
+		_Free();
 		fItemCount = 0;
-		if (fObjects) bzero(fObjects, sizeof(void*));
-
-		return true;
-	} else if (count > MAX_LIST_COUNT) {
-		return false;
-	} else if (count <= fMinimumCount || count + 1 == fItemReal) {
-		fItemCount = count;
-		bzero(fObjects + count, sizeof(void*));
 		return true;
 	}
 
-	void **newObjects = (void**)realloc(fObjects, (size_t)(count + 1) * sizeof(void*));
-	if (newObjects == NULL) {
-		if (count + 1 < fItemReal) {
-			bzero(fObjects + count, (size_t)(fItemReal - count) * sizeof(void*));
-			fItemCount = count;
-			return true;
-		} else {
+	int32 needed = max_c(count, fMinimumCount) + 1;
+	int32 itemReal = fItemReal;
+
+	if (needed > fItemReal)
+		itemReal = (int32)min_c((int64)B_MAXINT32, max_c((int64)needed, (int64)fItemReal + (fItemReal >> 1) + 4));
+	else if (needed < (fItemReal >> 2))
+		itemReal = needed << 1;
+
+	if (count < fItemCount && fObjects != NULL)
+		bzero(fObjects + count, (size_t)(fItemCount - count) * sizeof(void*));
+
+	if (itemReal != fItemReal) {
+		void **newObjects = _Realloc(itemReal);
+		if (newObjects == NULL && needed > fItemReal) newObjects = _Realloc(itemReal = needed);
+
+		if (newObjects != NULL) {
+			if (itemReal > fItemReal)
+				bzero(newObjects + fItemReal, (size_t)(itemReal - fItemReal) * sizeof(void*));
+			fObjects = newObjects;
+			fItemReal = itemReal;
+		} else if (needed > fItemReal) {
 			return false;
 		}
 	}
 
-	if (fItemReal < count + 1)
-		bzero(newObjects + fItemReal, (size_t)(count + 1 - fItemReal) * sizeof(void*));
-	else
-		bzero(newObjects + count, sizeof(void*));
-
-	fObjects = newObjects;
 	fItemCount = count;
-	fItemReal = count + 1;
 
 	return true;
 }
 
 
 BList::BList(int32 initialAllocSize)
-		: fObjects(NULL), fItemCount(0), fItemReal(0), fMinimumCount(0)
+		: fObjects(NULL), fItemCount(0), fItemReal(0), fMinimumCount(0), fAllocator(NULL)
 {
 	if (initialAllocSize > 0 && initialAllocSize <= MAX_LIST_COUNT) {
 		if (_Resize(initialAllocSize)) {
@@ -101,7 +117,7 @@ BList::BList(int32 initialAllocSize)
 
 
 BList::BList(int32 initialAllocSize, int32 nullItems)
-		: fObjects(NULL), fItemCount(0), fItemReal(0), fMinimumCount(0)
+		: fObjects(NULL), fItemCount(0), fItemReal(0), fMinimumCount(0), fAllocator(NULL)
 {
 	if (initialAllocSize > 0 && initialAllocSize <= MAX_LIST_COUNT) {
 		if (_Resize(initialAllocSize)) {
@@ -115,7 +131,7 @@ BList::BList(int32 initialAllocSize, int32 nullItems)
 
 
 BList::BList(const BList& list)
-		: fObjects(NULL), fItemCount(0), fItemReal(0), fMinimumCount(0)
+		: fObjects(NULL), fItemCount(0), fItemReal(0), fMinimumCount(0), fAllocator(NULL)
 {
 	BList::operator=(list);
 }
@@ -123,17 +139,15 @@ BList::BList(const BList& list)
 
 BList::~BList()
 {
-	if (fObjects) free(fObjects);
+	_Free();
 }
 
 
 BList&
 BList::operator=(const BList &from)
 {
-	if (fObjects) free(fObjects);
-	fObjects = NULL;
+	_Free();
 	fItemCount = 0;
-	fItemReal = 0;
 	fMinimumCount = 0;
 
 	if (from.fMinimumCount > 0 && from.fMinimumCount <= MAX_LIST_COUNT) {
@@ -225,24 +239,24 @@ BList::AddList(const BList *newItems, int32 atIndex)
 	}
 
 	if (memcpy(newObjects, newItems->fObjects, newItems->fItemCount * sizeof(void*)) == NULL) {
-		delete newObjects;
+		free(newObjects);
 		fItemCount -= newItems->fItemCount;
 		return false;
 	}
 
 	if (memcpy(newObjects + newItems->fItemCount, fObjects + atIndex, (fItemCount - atIndex) * sizeof(void*)) == NULL) {
-		delete newObjects;
+		free(newObjects);
 		fItemCount -= newItems->fItemCount;
 		return false;
 	}
 
 	if (memcpy(fObjects + atIndex, newObjects,  (fItemCount - atIndex + newItems->fItemCount) * sizeof(void*)) == NULL) {
-		delete newObjects;
+		free(newObjects);
 		fItemCount -= newItems->fItemCount;
 		return false;
 	}
 
-	delete newObjects;
+	free(newObjects);
 
 	return true;
 }
@@ -445,3 +459,34 @@ BList::Items() const
 	return(fObjects);
 }
 
+
+bool
+BList::SetAllocator(BAllocator *allocator)
+{
+	if (allocator == fAllocator) return true;
+
+	void **newObjects = NULL;
+	if (fObjects != NULL) {
+		size_t size = (size_t)fItemReal * sizeof(void*);
+		newObjects = (void**)(allocator == NULL ? malloc(size) : allocator->Alloc(size));
+		if (newObjects == NULL) return false;
+		memcpy(newObjects, fObjects, size);
+	}
+
+	int32 itemReal = fItemReal;
+	_Free();
+
+	fObjects = newObjects;
+	fItemReal = (newObjects == NULL ? 0 : itemReal);
+	fAllocator = allocator;
+
+	return true;
+}
+
+
+BAllocator*
+BList::Allocator() const
+{
+	return fAllocator;
+}
+
@@ -35,6 +35,8 @@
 
 #ifdef __cplusplus /* Just for C++ */
 
+class BAllocator;
+
 class BList
 {
 	public:
@@ -88,14 +90,22 @@ class BList
 		// Items(): return the list, use it carefully please
 		void	**Items() const;
 
+		// SetAllocator(): the allocator to hold the list, NULL means malloc().
+		// 	The allocator must live as long as the list, copies of the list use malloc().
+		bool		SetAllocator(BAllocator *allocator);
+		BAllocator	*Allocator() const;
+
 	private:
 		void **fObjects;
 
 		int32 fItemCount;
 		int32 fItemReal;
 		int32 fMinimumCount;
+		BAllocator *fAllocator;
 
 		bool _Resize(int32 count);
+		void **_Realloc(int32 itemReal);
+		void _Free();
 };
 
 #endif /* __cplusplus */
@@ -0,0 +1,735 @@
+/* --------------------------------------------------------------------------
+ *
+ * ETK++ --- The Easy Toolkit for C++ programing
+ * Copyright (C) 2004-2007, Anthony Lee, All Rights Reserved
+ *
+ * ETK++ library is a freeware; it may be used and distributed according to
+ * the terms of The MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+ * IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * File: NumberFormat.cpp
+ * Description: locale independent conversions between numbers and text
+ *
+ * --------------------------------------------------------------------------*/
+
+#include <string.h>
+#include <stdlib.h>
+#include <locale.h>
+#include <float.h>
+#include <math.h>
+
+#include "String.h"
+
+// Shortest round-trip output of float and double is done by Grisu2 (Florian Loitsch,
+// "Printing Floating-Point Numbers Quickly and Accurately with Integers", PLDI 2010):
+// the digits always read back to the same value. Grisu2 works in a slightly narrowed
+// interval and gives a digit more than needed now and then, e_shorten_digits() finds
+// those with a widened interval and drops the digit by reading the shorter ones back.
+
+typedef struct e_diyfp {
+	uint64 f;
+	int32 e;
+} e_diyfp;
+
+typedef struct e_cached_power {
+	uint64 f;
+	int32 e;
+	int32 k;
+} e_cached_power;
+
+// 10^k as normalized 64-bit significand and binary exponent, k = -300, -292, ..., 340
+static const e_cached_power e_cached_powers[] = {
+	{B_INT64_CONSTANT(0xab70fe17c79ac6ca), -1060, -300},
+	{B_INT64_CONSTANT(0xff77b1fcbebcdc4f), -1034, -292},
+	{B_INT64_CONSTANT(0xbe5691ef416bd60c), -1007, -284},
+	{B_INT64_CONSTANT(0x8dd01fad907ffc3c), -980, -276},
+	{B_INT64_CONSTANT(0xd3515c2831559a83), -954, -268},
+	{B_INT64_CONSTANT(0x9d71ac8fada6c9b5), -927, -260},
+	{B_INT64_CONSTANT(0xea9c227723ee8bcb), -901, -252},
+	{B_INT64_CONSTANT(0xaecc49914078536d), -874, -244},
+	{B_INT64_CONSTANT(0x823c12795db6ce57), -847, -236},
+	{B_INT64_CONSTANT(0xc21094364dfb5637), -821, -228},
+	{B_INT64_CONSTANT(0x9096ea6f3848984f), -794, -220},
+	{B_INT64_CONSTANT(0xd77485cb25823ac7), -768, -212},
+	{B_INT64_CONSTANT(0xa086cfcd97bf97f4), -741, -204},
+	{B_INT64_CONSTANT(0xef340a98172aace5), -715, -196},
+	{B_INT64_CONSTANT(0xb23867fb2a35b28e), -688, -188},
+	{B_INT64_CONSTANT(0x84c8d4dfd2c63f3b), -661, -180},
+	{B_INT64_CONSTANT(0xc5dd44271ad3cdba), -635, -172},
+	{B_INT64_CONSTANT(0x936b9fcebb25c996), -608, -164},
+	{B_INT64_CONSTANT(0xdbac6c247d62a584), -582, -156},
+	{B_INT64_CONSTANT(0xa3ab66580d5fdaf6), -555, -148},
+	{B_INT64_CONSTANT(0xf3e2f893dec3f126), -529, -140},
+	{B_INT64_CONSTANT(0xb5b5ada8aaff80b8), -502, -132},
+	{B_INT64_CONSTANT(0x87625f056c7c4a8b), -475, -124},
+	{B_INT64_CONSTANT(0xc9bcff6034c13053), -449, -116},
+	{B_INT64_CONSTANT(0x964e858c91ba2655), -422, -108},
+	{B_INT64_CONSTANT(0xdff9772470297ebd), -396, -100},
+	{B_INT64_CONSTANT(0xa6dfbd9fb8e5b88f), -369, -92},
+	{B_INT64_CONSTANT(0xf8a95fcf88747d94), -343, -84},
+	{B_INT64_CONSTANT(0xb94470938fa89bcf), -316, -76},
+	{B_INT64_CONSTANT(0x8a08f0f8bf0f156b), -289, -68},
+	{B_INT64_CONSTANT(0xcdb02555653131b6), -263, -60},
+	{B_INT64_CONSTANT(0x993fe2c6d07b7fac), -236, -52},
+	{B_INT64_CONSTANT(0xe45c10c42a2b3b06), -210, -44},
+	{B_INT64_CONSTANT(0xaa242499697392d3), -183, -36},
+	{B_INT64_CONSTANT(0xfd87b5f28300ca0e), -157, -28},
+	{B_INT64_CONSTANT(0xbce5086492111aeb), -130, -20},
+	{B_INT64_CONSTANT(0x8cbccc096f5088cc), -103, -12},
+	{B_INT64_CONSTANT(0xd1b71758e219652c), -77, -4},
+	{B_INT64_CONSTANT(0x9c40000000000000), -50, 4},
+	{B_INT64_CONSTANT(0xe8d4a51000000000), -24, 12},
+	{B_INT64_CONSTANT(0xad78ebc5ac620000), 3, 20},
+	{B_INT64_CONSTANT(0x813f3978f8940984), 30, 28},
+	{B_INT64_CONSTANT(0xc097ce7bc90715b3), 56, 36},
+	{B_INT64_CONSTANT(0x8f7e32ce7bea5c70), 83, 44},
+	{B_INT64_CONSTANT(0xd5d238a4abe98068), 109, 52},
+	{B_INT64_CONSTANT(0x9f4f2726179a2245), 136, 60},
+	{B_INT64_CONSTANT(0xed63a231d4c4fb27), 162, 68},
+	{B_INT64_CONSTANT(0xb0de65388cc8ada8), 189, 76},
+	{B_INT64_CONSTANT(0x83c7088e1aab65db), 216, 84},
+	{B_INT64_CONSTANT(0xc45d1df942711d9a), 242, 92},
+	{B_INT64_CONSTANT(0x924d692ca61be758), 269, 100},
+	{B_INT64_CONSTANT(0xda01ee641a708dea), 295, 108},
+	{B_INT64_CONSTANT(0xa26da3999aef774a), 322, 116},
+	{B_INT64_CONSTANT(0xf209787bb47d6b85), 348, 124},
+	{B_INT64_CONSTANT(0xb454e4a179dd1877), 375, 132},
+	{B_INT64_CONSTANT(0x865b86925b9bc5c2), 402, 140},
+	{B_INT64_CONSTANT(0xc83553c5c8965d3d), 428, 148},
+	{B_INT64_CONSTANT(0x952ab45cfa97a0b3), 455, 156},
+	{B_INT64_CONSTANT(0xde469fbd99a05fe3), 481, 164},
+	{B_INT64_CONSTANT(0xa59bc234db398c25), 508, 172},
+	{B_INT64_CONSTANT(0xf6c69a72a3989f5c), 534, 180},
+	{B_INT64_CONSTANT(0xb7dcbf5354e9bece), 561, 188},
+	{B_INT64_CONSTANT(0x88fcf317f22241e2), 588, 196},
+	{B_INT64_CONSTANT(0xcc20ce9bd35c78a5), 614, 204},
+	{B_INT64_CONSTANT(0x98165af37b2153df), 641, 212},
+	{B_INT64_CONSTANT(0xe2a0b5dc971f303a), 667, 220},
+	{B_INT64_CONSTANT(0xa8d9d1535ce3b396), 694, 228},
+	{B_INT64_CONSTANT(0xfb9b7cd9a4a7443c), 720, 236},
+	{B_INT64_CONSTANT(0xbb764c4ca7a44410), 747, 244},
+	{B_INT64_CONSTANT(0x8bab8eefb6409c1a), 774, 252},
+	{B_INT64_CONSTANT(0xd01fef10a657842c), 800, 260},
+	{B_INT64_CONSTANT(0x9b10a4e5e9913129), 827, 268},
+	{B_INT64_CONSTANT(0xe7109bfba19c0c9d), 853, 276},
+	{B_INT64_CONSTANT(0xac2820d9623bf429), 880, 284},
+	{B_INT64_CONSTANT(0x80444b5e7aa7cf85), 907, 292},
+	{B_INT64_CONSTANT(0xbf21e44003acdd2d), 933, 300},
+	{B_INT64_CONSTANT(0x8e679c2f5e44ff8f), 960, 308},
+	{B_INT64_CONSTANT(0xd433179d9c8cb841), 986, 316},
+	{B_INT64_CONSTANT(0x9e19db92b4e31ba9), 1013, 324},
+	{B_INT64_CONSTANT(0xeb96bf6ebadf77d9), 1039, 332},
+	{B_INT64_CONSTANT(0xaf87023b9bf0ee6b), 1066, 340}
+};
+
+#define E_CACHED_POWERS_MIN_DEC_EXP	-300
+#define E_CACHED_POWERS_DEC_STEP	8
+
+#define E_GRISU_ALPHA			-60
+#define E_GRISU_GAMMA			-32
+
+static const char e_digit_pairs[201] =
+	"00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+	"40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+	"8081828384858687888990919293949596979899";
+
+
+static inline e_diyfp e_diyfp_make(uint64 f, int32 e)
+{
+	e_diyfp x;
+	x.f = f;
+	x.e = e;
+	return x;
+}
+
+
+// the upper 64 bits of the 128-bit product, rounded
+static inline e_diyfp e_diyfp_mul(e_diyfp x, e_diyfp y)
+{
+	uint64 u_lo = x.f & 0xffffffff, u_hi = x.f >> 32;
+	uint64 v_lo = y.f & 0xffffffff, v_hi = y.f >> 32;
+
+	uint64 p0 = u_lo * v_lo;
+	uint64 p1 = u_lo * v_hi;
+	uint64 p2 = u_hi * v_lo;
+	uint64 p3 = u_hi * v_hi;
+
+	uint64 q = (p0 >> 32) + (p1 & 0xffffffff) + (p2 & 0xffffffff) + (B_INT64_CONSTANT(1) << 31);
+
+	return e_diyfp_make(p3 + (p2 >> 32) + (p1 >> 32) + (q >> 32), x.e + y.e + 64);
+}
+
+
+static inline e_diyfp e_diyfp_normalize(e_diyfp x)
+{
+	while ((x.f >> 63) == 0) {
+		x.f <<= 1;
+		x.e--;
+	}
+	return x;
+}
+
+
+// value = (significand + hiddenBit) * 2^exponent, the boundaries m- and m+ are the halfway
+// points to the neighbours, every number between them reads back as value.
+static void e_grisu_boundaries(uint64 significand, int32 exponent, uint64 hiddenBit, int32 minExponent,
+			       e_diyfp *w_minus, e_diyfp *w, e_diyfp *w_plus)
+{
+	e_diyfp v;
+	bool lowerIsCloser = (significand == 0 && exponent > 1);
+
+	if (exponent == 0) v = e_diyfp_make(significand, minExponent);
+	else v = e_diyfp_make(significand + hiddenBit, exponent - 1 + minExponent);
+
+	e_diyfp m_plus = e_diyfp_make(2 * v.f + 1, v.e - 1);
+	e_diyfp m_minus = (lowerIsCloser ? e_diyfp_make(4 * v.f - 1, v.e - 2) : e_diyfp_make(2 * v.f - 1, v.e - 1));
+
+	*w_plus = e_diyfp_normalize(m_plus);
+	*w_minus = e_diyfp_make(m_minus.f << (m_minus.e - w_plus->e), w_plus->e);
+	*w = e_diyfp_normalize(v);
+}
+
+
+static inline void e_grisu_round(char *buffer, int32 length, uint64 dist, uint64 delta, uint64 rest, uint64 ten_k)
+{
+	// move the last digit towards w while the result stays inside the boundaries
+	while (rest < dist && delta - rest >= ten_k &&
+	       (rest + ten_k < dist || dist - rest > rest + ten_k - dist)) {
+		buffer[length - 1]--;
+		rest += ten_k;
+	}
+}
+
+
+// "margin" units off each side of the interval, 1 keeps the digits inside it whatever the rounding
+// errors of the products are, -1 gives a lower bound of the count of the shortest digits
+static int32 e_grisu_digits(char *buffer, int32 *exponent, e_diyfp m_minus, e_diyfp v, e_diyfp m_plus, int32 margin)
+{
+	// choose c = 10^-k so that the exponent of m+ * c falls into [alpha, gamma]
+	int32 f = E_GRISU_ALPHA - m_plus.e - 1;
+	int32 k = (f * 78913) / (1 << 18) + (f > 0 ? 1 : 0);
+	const e_cached_power *cached = &e_cached_powers[(-E_CACHED_POWERS_MIN_DEC_EXP + k + (E_CACHED_POWERS_DEC_STEP - 1)) / E_CACHED_POWERS_DEC_STEP];
+	e_diyfp c = e_diyfp_make(cached->f, cached->e);
+
+	e_diyfp w = e_diyfp_mul(v, c);
+	e_diyfp w_minus = e_diyfp_mul(m_minus, c);
+	e_diyfp w_plus = e_diyfp_mul(m_plus, c);
+
+	e_diyfp M_minus = e_diyfp_make(w_minus.f + margin, w_minus.e);
+	e_diyfp M_plus = e_diyfp_make(w_plus.f - margin, w_plus.e);
+
+	*exponent = -cached->k;
+
+	uint64 delta = M_plus.f - M_minus.f;
+	uint64 dist = M_plus.f - w.f;
+	int32 shift = -M_plus.e;
+	uint64 one = B_INT64_CONSTANT(1) << shift;
+
+	uint32 p1 = (uint32)(M_plus.f >> shift);
+	uint64 p2 = M_plus.f & (one - 1);
+
+	uint32 pow10 = 1000000000;
+	int32 n = 10;
+	while (n > 1 && p1 < pow10) {
+		pow10 /= 10;
+		n--;
+	}
+
+	int32 length = 0;
+
+	// the integral part, stop as soon as the digits are inside the interval
+	while (n > 0) {
+		buffer[length++] = (char)('0' + p1 / pow10);
+		p1 %= pow10;
+		n--;
+
+		uint64 rest = ((uint64)p1 << shift) + p2;
+		if (rest <= delta) {
+			*exponent += n;
+			e_grisu_round(buffer, length, dist, delta, rest, (uint64)pow10 << shift);
+			return length;
+		}
+
+		pow10 /= 10;
+	}
+
+	// the fractional part
+	int32 m = 0;
+	while (true) {
+		p2 *= 10;
+		buffer[length++] = (char)('0' + (p2 >> shift));
+		p2 &= one - 1;
+		m++;
+
+		delta *= 10;
+		dist *= 10;
+		if (p2 <= delta) break;
+	}
+
+	*exponent -= m;
+	e_grisu_round(buffer, length, dist, delta, p2, one);
+
+	return length;
+}
+
+
+// digits * 10^exponent, like "%g" but with all the digits needed
+static int32 e_format_digits(char *buffer, bool negative, const char *digits, int32 count, int32 exponent, int32 maxFixed)
+{
+	char *p = buffer;
+	if (negative) *p++ = '-';
+
+	int32 point = count + exponent; // digits before the decimal point
+
+	if (point > -4 && point <= maxFixed) {
+		if (point <= 0) {
+			*p++ = '0';
+			*p++ = '.';
+			for (int32 i = point; i < 0; i++) *p++ = '0';
+			memcpy(p, digits, count);
+			p += count;
+		} else if (point < count) {
+			memcpy(p, digits, point);
+			p += point;
+			*p++ = '.';
+			memcpy(p, digits + point, count - point);
+			p += count - point;
+		} else {
+			memcpy(p, digits, count);
+			p += count;
+			for (int32 i = count; i < point; i++) *p++ = '0';
+		}
+	} else {
+		int32 exp = point - 1;
+
+		*p++ = digits[0];
+		if (count > 1) {
+			*p++ = '.';
+			memcpy(p, digits + 1, count - 1);
+			p += count - 1;
+		}
+
+		*p++ = 'e';
+		*p++ = (exp < 0 ? '-' : '+');
+		if (exp < 0) exp = -exp;
+		if (exp >= 100) {
+			*p++ = (char)('0' + exp / 100);
+			exp %= 100;
+		}
+		*p++ = e_digit_pairs[exp * 2];
+		*p++ = e_digit_pairs[exp * 2 + 1];
+	}
+
+	*p = 0;
+	return (int32)(p - buffer);
+}
+
+
+// strtod() and strtof() read the decimal point of the locale, so they run in the "C" locale
+static locale_t e_c_locale()
+{
+	static locale_t c_locale = (locale_t)0;
+
+	locale_t loc = c_locale;
+	if (loc == (locale_t)0 && (loc = newlocale(LC_NUMERIC_MASK, "C", (locale_t)0)) != (locale_t)0) {
+		if (!__sync_bool_compare_and_swap(&c_locale, (locale_t)0, loc)) {
+			freelocale(loc);
+			loc = c_locale;
+		}
+	}
+
+	return loc;
+}
+
+
+static double e_strtod_c(const char *str)
+{
+	locale_t loc = e_c_locale();
+	locale_t old = (loc == (locale_t)0 ? (locale_t)0 : uselocale(loc));
+
+	double value = strtod(str, NULL);
+
+	if (loc != (locale_t)0) uselocale(old);
+	return value;
+}
+
+
+static float e_strtof_c(const char *str)
+{
+	locale_t loc = e_c_locale();
+	locale_t old = (loc == (locale_t)0 ? (locale_t)0 : uselocale(loc));
+
+	float value = strtof(str, NULL);
+
+	if (loc != (locale_t)0) uselocale(old);
+	return value;
+}
+
+
+// whether digits * 10^exponent reads back as value
+static bool e_digits_read_back(const char *digits, int32 count, int32 exponent, double value, bool isFloat)
+{
+	char buf[48];
+	memcpy(buf, digits, count);
+	buf[count] = 'e';
+	e_format_int64(buf + count + 1, exponent);
+
+	if (isFloat) return(e_strtof_c(buf) == (float)value);
+
+	double v = 0;
+	e_parse_double(buf, -1, &v);
+	return(v == value);
+}
+
+
+// the shorter digits closest to the value, rounded down or up, as long as they read back;
+// any shorter digits reading back make one of these two read back too
+static int32 e_shorten_digits(char *digits, int32 count, int32 *exponent, double value, bool isFloat,
+			      e_diyfp m_minus, e_diyfp v, e_diyfp m_plus)
+{
+	// fewer digits can't do when the widened interval needs as many
+	char wide[20];
+	int32 wideExponent;
+	int32 least = e_grisu_digits(wide, &wideExponent, m_minus, v, m_plus, -1);
+
+	while (count > least && count > 1) {
+		char down[20], up[20];
+		int32 downCount = count - 1, upCount = count - 1;
+		int32 downExponent = *exponent + 1, upExponent = *exponent + 1;
+
+		memcpy(down, digits, downCount);
+		while (downCount > 1 && down[downCount - 1] == '0') {
+			downCount--;
+			downExponent++;
+		}
+
+		memcpy(up, digits, upCount);
+		while (upCount > 0 && up[upCount - 1] == '9') {
+			upCount--;
+			upExponent++;
+		}
+		if (upCount == 0) up[upCount++] = '1';
+		else up[upCount - 1]++;
+
+		bool upFirst = (digits[count - 1] >= '5');
+		const char *first = (upFirst ? up : down);
+		const char *second = (upFirst ? down : up);
+		int32 firstCount = (upFirst ? upCount : downCount), secondCount = (upFirst ? downCount : upCount);
+		int32 firstExponent = (upFirst ? upExponent : downExponent), secondExponent = (upFirst ? downExponent : upExponent);
+
+		if (e_digits_read_back(first, firstCount, firstExponent, value, isFloat)) {
+			memcpy(digits, first, firstCount);
+			count = firstCount;
+			*exponent = firstExponent;
+		} else if (e_digits_read_back(second, secondCount, secondExponent, value, isFloat)) {
+			memcpy(digits, second, secondCount);
+			count = secondCount;
+			*exponent = secondExponent;
+		} else {
+			break;
+		}
+	}
+
+	return count;
+}
+
+
+static int32 e_format_special(char *buffer, bool negative, bool isNaN, bool isZero)
+{
+	const char *str = (isNaN ? "nan" : (isZero ? "0" : "inf"));
+
+	int32 length = 0;
+	if (negative && !isNaN) buffer[length++] = '-';
+	strcpy(buffer + length, str);
+
+	return length + (int32)strlen(str);
+}
+
+
+extern "C" {
+
+int32 e_format_double(char *buffer, double value)
+{
+	if (buffer == NULL) return 0;
+
+	uint64 bits;
+	memcpy(&bits, &value, sizeof(bits));
+
+	bool negative = ((bits >> 63) != 0);
+	int32 exponent = (int32)((bits >> 52) & 0x7ff);
+	uint64 significand = bits & ((B_INT64_CONSTANT(1) << 52) - 1);
+
+	if (exponent == 0x7ff) return e_format_special(buffer, negative, significand != 0, false);
+	if (exponent == 0 && significand == 0) return e_format_special(buffer, negative, false, true);
+
+	e_diyfp m_minus, v, m_plus;
+	e_grisu_boundaries(significand, exponent, B_INT64_CONSTANT(1) << 52, -1074, &m_minus, &v, &m_plus);
+
+	char digits[20];
+	int32 decimalExponent;
+	int32 count = e_grisu_digits(digits, &decimalExponent, m_minus, v, m_plus, 1);
+	count = e_shorten_digits(digits, count, &decimalExponent, negative ? -value : value, false, m_minus, v, m_plus);
+
+	return e_format_digits(buffer, negative, digits, count, decimalExponent, 17);
+}
+
+
+int32 e_format_float(char *buffer, float value)
+{
+	if (buffer == NULL) return 0;
+
+	uint32 bits;
+	memcpy(&bits, &value, sizeof(bits));
+
+	bool negative = ((bits >> 31) != 0);
+	int32 exponent = (int32)((bits >> 23) & 0xff);
+	uint64 significand = bits & ((1 << 23) - 1);
+
+	if (exponent == 0xff) return e_format_special(buffer, negative, significand != 0, false);
+	if (exponent == 0 && significand == 0) return e_format_special(buffer, negative, false, true);
+
+	e_diyfp m_minus, v, m_plus;
+	e_grisu_boundaries(significand, exponent, 1 << 23, -149, &m_minus, &v, &m_plus);
+
+	char digits[20];
+	int32 decimalExponent;
+	int32 count = e_grisu_digits(digits, &decimalExponent, m_minus, v, m_plus, 1);
+	count = e_shorten_digits(digits, count, &decimalExponent, negative ? -value : value, true, m_minus, v, m_plus);
+
+	return e_format_digits(buffer, negative, digits, count, decimalExponent, 9);
+}
+
+
+int32 e_format_uint64(char *buffer, uint64 value)
+{
+	if (buffer == NULL) return 0;
+
+	char tmp[24];
+	char *p = tmp + sizeof(tmp);
+
+	// two digits per division
+	while (value >= 100) {
+		uint32 pair = (uint32)(value % 100) * 2;
+		value /= 100;
+		*--p = e_digit_pairs[pair + 1];
+		*--p = e_digit_pairs[pair];
+	}
+
+	if (value >= 10) {
+		*--p = e_digit_pairs[value * 2 + 1];
+		*--p = e_digit_pairs[value * 2];
+	} else {
+		*--p = (char)('0' + value);
+	}
+
+	int32 length = (int32)(tmp + sizeof(tmp) - p);
+	memcpy(buffer, p, length);
+	buffer[length] = 0;
+
+	return length;
+}
+
+
+int32 e_format_int64(char *buffer, int64 value)
+{
+	if (buffer == NULL) return 0;
+	if (value >= 0) return e_format_uint64(buffer, (uint64)value);
+
+	buffer[0] = '-';
+	return 1 + e_format_uint64(buffer + 1, ~((uint64)value) + 1);
+}
+
+
+int32 e_parse_uint64(const char *str, int32 length, uint64 *value)
+{
+	if (str == NULL) return 0;
+	if (length < 0) length = (int32)strlen(str);
+
+	int32 i = 0;
+	while (i < length && (str[i] == ' ' || (str[i] >= '\t' && str[i] <= '\r'))) i++;
+
+	bool negative = false;
+	if (i < length && (str[i] == '-' || str[i] == '+')) negative = (str[i++] == '-');
+
+	int32 start = i;
+	uint64 v = 0;
+	bool overflow = false;
+
+	for (; i < length && str[i] >= '0' && str[i] <= '9'; i++) {
+		uint64 d = (uint64)(str[i] - '0');
+		if (v > (B_MAXUINT64 - d) / 10) overflow = true;
+		else v = v * 10 + d;
+	}
+
+	if (i == start) return 0;
+
+	// like strtoull(): out of range gives the maximum, a minus sign negates
+	if (overflow) v = B_MAXUINT64;
+	else if (negative) v = ~v + 1;
+
+	if (value) *value = v;
+	return i;
+}
+
+
+int32 e_parse_int64(const char *str, int32 length, int64 *value)
+{
+	if (str == NULL) return 0;
+	if (length < 0) length = (int32)strlen(str);
+
+	int32 i = 0;
+	while (i < length && (str[i] == ' ' || (str[i] >= '\t' && str[i] <= '\r'))) i++;
+
+	bool negative = false;
+	if (i < length && (str[i] == '-' || str[i] == '+')) negative = (str[i++] == '-');
+
+	int32 start = i;
+	uint64 v = 0;
+	uint64 limit = (negative ? (uint64)B_MAXINT64 + 1 : (uint64)B_MAXINT64);
+
+	for (; i < length && str[i] >= '0' && str[i] <= '9'; i++) {
+		uint64 d = (uint64)(str[i] - '0');
+		if (v > (limit - d) / 10) v = limit; // like strtoll(): clamped to the range
+		else v = v * 10 + d;
+	}
+
+	if (i == start) return 0;
+
+	if (value) *value = (negative ? (int64)(~v + 1) : (int64)v);
+	return i;
+}
+
+} // extern "C"
+
+
+static const double e_exact_powers_of_ten[23] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+
+static bool e_match_nocase(const char *str, int32 length, const char *word)
+{
+	int32 i = 0;
+	for (; word[i] != 0; i++) {
+		if (i >= length || (str[i] | 0x20) != word[i]) return false;
+	}
+	return true;
+}
+
+
+extern "C" int32 e_parse_double(const char *str, int32 length, double *value)
+{
+	if (str == NULL) return 0;
+	if (length < 0) length = (int32)strlen(str);
+
+	int32 i = 0;
+	while (i < length && (str[i] == ' ' || (str[i] >= '\t' && str[i] <= '\r'))) i++;
+
+	int32 start = i;
+	bool negative = false;
+	if (i < length && (str[i] == '-' || str[i] == '+')) negative = (str[i++] == '-');
+
+	if (e_match_nocase(str + i, length - i, "inf") || e_match_nocase(str + i, length - i, "nan")) {
+		bool isNaN = ((str[i] | 0x20) == 'n');
+		i += (!isNaN && e_match_nocase(str + i, length - i, "infinity") ? 8 : 3);
+		if (value) *value = (isNaN ? (negative ? -NAN : NAN) : (negative ? -HUGE_VAL : HUGE_VAL));
+		return i;
+	}
+
+	uint64 mantissa = 0;
+	int32 digits = 0, dropped = 0, exponent = 0;
+	bool seenDigit = false, seenPoint = false;
+
+	for (; i < length; i++) {
+		char c = str[i];
+		if (c == '.' && !seenPoint) {
+			seenPoint = true;
+			continue;
+		}
+		if (c < '0' || c > '9') break;
+
+		seenDigit = true;
+		if (mantissa == 0 && c == '0') {
+			// leading zeros don't count
+			if (seenPoint) exponent--;
+			continue;
+		}
+
+		if (digits < 19) {
+			mantissa = mantissa * 10 + (uint64)(c - '0');
+			digits++;
+			if (seenPoint) exponent--;
+		} else {
+			if (c != '0') dropped++;
+			if (!seenPoint) exponent++;
+		}
+	}
+
+	if (!seenDigit) return 0;
+
+	if (i < length && (str[i] == 'e' || str[i] == 'E')) {
+		int32 k = i + 1;
+		bool expNegative = false;
+		if (k < length && (str[k] == '-' || str[k] == '+')) expNegative = (str[k++] == '-');
+
+		if (k < length && str[k] >= '0' && str[k] <= '9') {
+			int32 exp = 0;
+			for (; k < length && str[k] >= '0' && str[k] <= '9'; k++) {
+				if (exp < 100000) exp = exp * 10 + (str[k] - '0');
+			}
+			exponent += (expNegative ? -exp : exp);
+			i = k;
+		}
+	}
+
+	double result;
+
+#if !defined(FLT_EVAL_METHOD) || FLT_EVAL_METHOD == 0
+	// exact when both the mantissa and the power of ten are exact doubles, one rounding only
+	if (dropped == 0 && mantissa < (B_INT64_CONSTANT(1) << 53) && exponent >= -22 && exponent <= 22) {
+		result = (double)mantissa;
+		if (exponent < 0) result /= e_exact_powers_of_ten[-exponent];
+		else result *= e_exact_powers_of_ten[exponent];
+
+		if (value) *value = (negative ? -result : result);
+		return i;
+	}
+#endif
+
+	if (mantissa == 0) {
+		if (value) *value = (negative ? -0.0 : 0.0);
+		return i;
+	}
+
+	// the rest needs correct rounding of big numbers, strtod() does it
+	char buf[128];
+	int32 n = i - start;
+	char *tmp = (n < (int32)sizeof(buf) ? buf : (char*)malloc((size_t)n + 1));
+	if (tmp == NULL) return 0;
+
+	memcpy(tmp, str + start, n);
+	tmp[n] = 0;
+
+	result = e_strtod_c(tmp);
+	if (tmp != buf) free(tmp);
+
+	if (value) *value = result;
+	return i;
+}
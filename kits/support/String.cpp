@@ -38,66 +38,145 @@
 #include "String.h"
 #include "StringArray.h"
 
-static char* strrstr(const char *haystack, const char *needle)
+#define E_TWO_WAY_NEEDLE_LENGTH	32
+#define E_NOCASE_WINDOW_SIZE	4096
+
+static inline uint8 e_ascii_tolower(uint8 c)
 {
-	if (!haystack || !needle) return NULL;
+	return((c >= 'A' && c <= 'Z') ? (uint8)(c + ('a' - 'A')) : c);
+}
+
+
+static inline uint8 e_ascii_toupper(uint8 c)
+{
+	return((c >= 'a' && c <= 'z') ? (uint8)(c - ('a' - 'A')) : c);
+}
+
+
+static int e_memcasecmp(const char *s1, const char *s2, size_t n)
+{
+	for (size_t i = 0; i < n; i++) {
+		int d = (int)e_ascii_tolower((uint8)s1[i]) - (int)e_ascii_tolower((uint8)s2[i]);
+		if (d != 0) return d;
+	}
+
+	return 0;
+}
 
-	size_t needle_len = strlen(needle);
-	size_t haystack_len = strlen(haystack);
 
-	if (needle_len == 0) return (char*)haystack;
+// e_find_bytes(): first occurrence of needle in haystack[0, haystack_len).
+// The libc memchr() is vectorized, so we let it skip to each candidate first byte
+// and verify the remaining bytes; long needles go to memmem() which uses Two-Way.
+static const char* e_find_bytes(const char *haystack, size_t haystack_len, const char *needle, size_t needle_len)
+{
+	if (needle_len == 0) return haystack;
 	if (haystack_len < needle_len) return NULL;
+	if (needle_len == 1) return (const char*)memchr(haystack, *needle, haystack_len);
+	if (needle_len >= E_TWO_WAY_NEEDLE_LENGTH) return (const char*)memmem(haystack, haystack_len, needle, needle_len);
 
-	const char *tmp = haystack + haystack_len - needle_len;
+	const char *end = haystack + (haystack_len - needle_len) + 1;
+	const char last = needle[needle_len - 1];
 
-	while (*tmp && tmp >= haystack) {
-		if (strncmp(tmp, needle, needle_len) == 0) return (char*)tmp;
-		tmp--;
+	while (haystack < end) {
+		haystack = (const char*)memchr(haystack, *needle, (size_t)(end - haystack));
+		if (haystack == NULL) return NULL;
+		if (haystack[needle_len - 1] == last &&
+		    memcmp(haystack + 1, needle + 1, needle_len - 2) == 0) return haystack;
+		haystack++;
 	}
 
 	return NULL;
 }
 
-static char* strrcasestr(const char *haystack, const char *needle)
+
+// e_rfind_bytes(): last occurrence of needle lying entirely inside haystack[0, haystack_len).
+static const char* e_rfind_bytes(const char *haystack, size_t haystack_len, const char *needle, size_t needle_len)
 {
-	if (!haystack || !needle) return NULL;
+	if (needle_len == 0) return haystack;
+	if (haystack_len < needle_len) return NULL;
+
+	size_t n = haystack_len - needle_len + 1;
+	const char last = needle[needle_len - 1];
 
-	size_t needle_len = strlen(needle);
-	size_t haystack_len = strlen(haystack);
+	while (n > 0) {
+		const char *tmp = (const char*)memrchr(haystack, *needle, n);
+		if (tmp == NULL) return NULL;
+		if (tmp[needle_len - 1] == last &&
+		    memcmp(tmp, needle, needle_len) == 0) return tmp;
+		n = (size_t)(tmp - haystack);
+	}
 
-	if (needle_len == 0) return (char*)haystack;
+	return NULL;
+}
+
+
+// e_find_bytes_nocase(): like e_find_bytes() but ASCII case-insensitive, without
+// making lowercase copies: both cases of the first byte are located with memchr(),
+// window by window so that a case which never occurs doesn't rescan the whole tail.
+static const char* e_find_bytes_nocase(const char *haystack, size_t haystack_len, const char *needle, size_t needle_len)
+{
+	if (needle_len == 0) return haystack;
 	if (haystack_len < needle_len) return NULL;
 
-	const char *tmp = haystack + haystack_len - needle_len;
+	const char *end = haystack + (haystack_len - needle_len) + 1;
+	const char lower = (char)e_ascii_tolower((uint8)*needle);
+	const char upper = (char)e_ascii_toupper((uint8)*needle);
+
+	while (haystack < end) {
+		const char *window_end = ((size_t)(end - haystack) > E_NOCASE_WINDOW_SIZE ? haystack + E_NOCASE_WINDOW_SIZE : end);
 
-	while (*tmp && tmp >= haystack) {
-		if (strncasecmp(tmp, needle, needle_len) == 0) return (char*)tmp;
-		tmp--;
+		const char *tmp = (const char*)memchr(haystack, lower, (size_t)(window_end - haystack));
+		if (lower != upper) {
+			const char *upper_at = (const char*)memchr(haystack, upper, (size_t)((tmp ? tmp : window_end) - haystack));
+			if (upper_at != NULL) tmp = upper_at;
+		}
+
+		if (tmp == NULL) {
+			haystack = window_end;
+			continue;
+		}
+
+		if (e_memcasecmp(tmp + 1, needle + 1, needle_len - 1) == 0) return tmp;
+		haystack = tmp + 1;
 	}
 
 	return NULL;
 }
 
-static char* strcasechr(const char *s, int c)
+
+// e_rfind_bytes_nocase(): last case-insensitive occurrence inside haystack[0, haystack_len).
+static const char* e_rfind_bytes_nocase(const char *haystack, size_t haystack_len, const char *needle, size_t needle_len)
 {
-	if (s == NULL || *s == 0 || c == 0) return NULL;
+	if (needle_len == 0) return haystack;
+	if (haystack_len < needle_len) return NULL;
 
-	const char *tmp = strchr(s, tolower(c));
-	if (tmp == NULL) tmp = strchr(s, toupper(c));
+	const uint8 first = e_ascii_tolower((uint8)*needle);
 
-	return (char*)tmp;
+	for (const char *tmp = haystack + (haystack_len - needle_len); tmp >= haystack; tmp--) {
+		if (e_ascii_tolower((uint8)*tmp) != first) continue;
+		if (e_memcasecmp(tmp + 1, needle + 1, needle_len - 1) == 0) return tmp;
+	}
+
+	return NULL;
 }
 
-static char* strrcasechr(const char *s, int c)
+
+static char* strrstr(const char *haystack, const char *needle)
 {
-	if (s == NULL || *s == 0 || c == 0) return NULL;
+	if (!haystack || !needle) return NULL;
+
+	return (char*)e_rfind_bytes(haystack, strlen(haystack), needle, strlen(needle));
+}
 
-	const char *tmp = strrchr(s, tolower(c));
-	if (tmp == NULL) tmp = strrchr(s, toupper(c));
 
-	return (char*)tmp;
+static char* strrcasestr(const char *haystack, const char *needle)
+{
+	if (!haystack || !needle) return NULL;
+
+	return (char*)e_rfind_bytes_nocase(haystack, strlen(haystack), needle, strlen(needle));
 }
 
+
 char* EStrdup(const char* src, int32 length)
 {
 	if (src == NULL || *src == 0 || length == 0) return NULL;
@@ -212,6 +291,85 @@ BString::_Resize(int32 length)
 }
 
 
+bool
+BString::_Replace(const char *replaceThis, const char *withThis, int32 maxReplaceCount, int32 fromOffset, bool ignoreCase)
+{
+	const char* (*find_func)(const char*, size_t, const char*, size_t) = (ignoreCase ? e_find_bytes_nocase : e_find_bytes);
+
+	size_t strLenReplace = strlen(replaceThis);
+	size_t strLenWith = strlen(withThis);
+	uint32 maxCount = (maxReplaceCount < 0 ? B_MAXUINT32 : (uint32)maxReplaceCount);
+
+	const char *src = fBuffer + fromOffset;
+	const char *srcEnd = fBuffer + fLen;
+	const char *found;
+
+	if (strLenWith <= strLenReplace) {
+		// The string never grows, so it is rewritten in place in one pass.
+		char *dst = fBuffer + fromOffset;
+		uint32 count = 0;
+
+		while (count < maxCount &&
+		       (found = find_func(src, (size_t)(srcEnd - src), replaceThis, strLenReplace)) != NULL) {
+			if (dst != src) memmove(dst, src, (size_t)(found - src));
+			dst += found - src;
+			memcpy(dst, withThis, strLenWith);
+			dst += strLenWith;
+			src = found + strLenReplace;
+			count++;
+		}
+
+		if (count == 0) return false;
+
+		if (dst != src) memmove(dst, src, (size_t)(srcEnd - src));
+		dst += srcEnd - src;
+
+		return _Resize((int32)(dst - fBuffer));
+	}
+
+	// The string grows: count the matches once, allocate the final size once,
+	// then copy the unchanged runs and the replacements into the new buffer.
+	uint32 count = 0;
+	while (count < maxCount &&
+	       (found = find_func(src, (size_t)(srcEnd - src), replaceThis, strLenReplace)) != NULL) {
+		src = found + strLenReplace;
+		count++;
+	}
+
+	if (count == 0) return false;
+
+	int64 newLen = (int64)fLen + (int64)count * (int64)(strLenWith - strLenReplace);
+	if (newLen > (int64)MAX_STRING_LENGTH) return false;
+
+	int32 length_to_alloc = max_c((int32)newLen + 1, fMinBufferSize);
+	char *newData = (char*)malloc((size_t)length_to_alloc);
+	if (newData == NULL) return false;
+
+	char *dst = newData;
+	memcpy(dst, fBuffer, (size_t)fromOffset);
+	dst += fromOffset;
+
+	src = fBuffer + fromOffset;
+	for (uint32 i = 0; i < count; i++) {
+		found = find_func(src, (size_t)(srcEnd - src), replaceThis, strLenReplace);
+		memcpy(dst, src, (size_t)(found - src));
+		dst += found - src;
+		memcpy(dst, withThis, strLenWith);
+		dst += strLenWith;
+		src = found + strLenReplace;
+	}
+	memcpy(dst, src, (size_t)(srcEnd - src));
+	newData[newLen] = 0;
+
+	free(fBuffer);
+	fBuffer = newData;
+	fLen = (int32)newLen;
+	fLenReal = length_to_alloc;
+
+	return true;
+}
+
+
 BString::BString()
 		: fLen(0), fLenReal(0), fMinBufferSize(0), fBuffer(NULL)
 {
@@ -464,9 +622,13 @@ BString::Append(const char *str, int32 length)
 {
 	if (str == NULL || *str == 0 || length == 0) return *this;
 
-	int32 strLen = (int32)strlen(str);
-
-	if (length < 0 || length > strLen) length = strLen;
+	// no more than "length" bytes get read, "str" needn't be NUL-terminated then
+	if (length < 0) {
+		length = (int32)strlen(str);
+	} else {
+		const char *end = (const char*)memchr(str, 0, (size_t)length);
+		if (end != NULL) length = (int32)(end - str);
+	}
 	if (MAX_STRING_LENGTH - fLen < length) return *this;
 
 	if (_Resize(fLen + length)) {
@@ -1050,7 +1212,7 @@ BString::FindFirst(const BString &string) const
 {
 	if (String() == NULL || string.String() == NULL) return -1;
 
-	const char *tmp = strstr(String(), string.String());
+	const char *tmp = e_find_bytes(String(), (size_t)Length(), string.String(), (size_t)string.Length());
 
 	if (tmp == NULL) return -1;
 
@@ -1063,7 +1225,7 @@ BString::FindFirst(const char *string) const
 {
 	if (String() == NULL || string == NULL || *string == 0) return -1;
 
-	const char *tmp = strstr(String(), string);
+	const char *tmp = e_find_bytes(String(), (size_t)Length(), string, strlen(string));
 
 	if (tmp == NULL) return -1;
 
@@ -1076,8 +1238,8 @@ BString::FindFirst(const BString &string, int32 fromOffset) const
 {
 	if (String() == NULL || string.String() == NULL || fromOffset < 0 || fromOffset >= Length()) return -1;
 
-	const char *string_find = String() + fromOffset;
-	const char *tmp = strstr(string_find, string.String());
+	const char *tmp = e_find_bytes(String() + fromOffset, (size_t)(Length() - fromOffset),
+				  string.String(), (size_t)string.Length());
 
 	if (tmp == NULL) return -1;
 
@@ -1090,8 +1252,7 @@ BString::FindFirst(const char *string, int32 fromOffset) const
 {
 	if (String() == NULL || string == NULL || *string == 0 || fromOffset < 0 || fromOffset >= Length()) return -1;
 
-	const char *string_find = String() + fromOffset;
-	const char *tmp = strstr(string_find, string);
+	const char *tmp = e_find_bytes(String() + fromOffset, (size_t)(Length() - fromOffset), string, strlen(string));
 
 	if (tmp == NULL) return -1;
 
@@ -1104,7 +1265,7 @@ BString::FindFirst(char c) const
 {
 	if (String() == NULL || c == 0) return -1;
 
-	const char *tmp = strchr(String(), c);
+	const char *tmp = e_find_bytes(String(), (size_t)Length(), &c, 1);
 
 	if (tmp == NULL) return -1;
 
@@ -1117,8 +1278,7 @@ BString::FindFirst(char c, int32 fromOffset) const
 {
 	if (String() == NULL || c == 0 || fromOffset < 0 || fromOffset >= Length()) return -1;
 
-	const char *string_find = String() + fromOffset;
-	const char *tmp = strchr(string_find, c);
+	const char *tmp = e_find_bytes(String() + fromOffset, (size_t)(Length() - fromOffset), &c, 1);
 
 	if (tmp == NULL) return -1;
 
@@ -1131,7 +1291,7 @@ BString::FindLast(const BString &string) const
 {
 	if (String() == NULL || string.String() == NULL) return -1;
 
-	const char *tmp = strrstr(String(), string.String());
+	const char *tmp = e_rfind_bytes(String(), (size_t)Length(), string.String(), (size_t)string.Length());
 
 	if (tmp == NULL) return -1;
 
@@ -1144,7 +1304,7 @@ BString::FindLast(const char *string) const
 {
 	if (String() == NULL || string == NULL || *string == 0) return -1;
 
-	const char *tmp = strrstr(String(), string);
+	const char *tmp = e_rfind_bytes(String(), (size_t)Length(), string, strlen(string));
 
 	if (tmp == NULL) return -1;
 
@@ -1157,17 +1317,11 @@ BString::FindLast(const BString &string, int32 beforeOffset) const
 {
 	if (String() == NULL || string.String() == NULL || beforeOffset < 0 || beforeOffset >= Length()) return -1;
 
-	char *string_find = b_strndup(String(), beforeOffset + 1);
-	if (string_find == NULL) return -1;
-
-	const char *tmp = strrstr(string_find, string.String());
+	const char *tmp = e_rfind_bytes(String(), (size_t)beforeOffset + 1, string.String(), (size_t)string.Length());
 
-	int32 ret = -1;
-	if (tmp != NULL) ret = (int32)(tmp - string_find);
-
-	free(string_find);
+	if (tmp == NULL) return -1;
 
-	return ret;
+	return((int32)(tmp - String()));
 }
 
 
@@ -1176,26 +1330,20 @@ BString::FindLast(const char *string, int32 beforeOffset) const
 {
 	if (String() == NULL || string == NULL || *string == 0 || beforeOffset < 0 || beforeOffset >= Length()) return -1;
 
-	char *string_find = b_strndup(String(), beforeOffset + 1);
-	if (string_find == NULL) return -1;
+	const char *tmp = e_rfind_bytes(String(), (size_t)beforeOffset + 1, string, strlen(string));
 
-	const char *tmp = strrstr(string_find, string);
-
-	int32 ret = -1;
-	if (tmp != NULL) ret = (int32)(tmp - string_find);
-
-	free(string_find);
+	if (tmp == NULL) return -1;
 
-	return ret;
+	return((int32)(tmp - String()));
 }
 
 
 int32
 BString::FindLast(char c) const
 {
-	if (String() == 0 || c == 0) return -1;
+	if (String() == NULL || c == 0) return -1;
 
-	const char *tmp = strrchr(String(), c);
+	const char *tmp = e_rfind_bytes(String(), (size_t)Length(), &c, 1);
 
 	if (tmp == NULL) return -1;
 
@@ -1208,17 +1356,11 @@ BString::FindLast(char c, int32 beforeOffset) const
 {
 	if (String() == NULL || c == 0 || beforeOffset < 0 || beforeOffset >= Length()) return -1;
 
-	char *string_find = b_strndup(String(), beforeOffset + 1);
-	if (string_find == NULL) return -1;
-
-	const char *tmp = strrchr(string_find, c);
-
-	int32 ret = -1;
-	if (tmp != NULL) ret = (int32)(tmp - string_find);
+	const char *tmp = e_rfind_bytes(String(), (size_t)beforeOffset + 1, &c, 1);
 
-	free(string_find);
+	if (tmp == NULL) return -1;
 
-	return ret;
+	return((int32)(tmp - String()));
 }
 
 
@@ -1227,7 +1369,7 @@ BString::IFindFirst(const BString &string) const
 {
 	if (String() == NULL || string.String() == NULL) return -1;
 
-	const char *tmp = strcasestr(String(), string.String());
+	const char *tmp = e_find_bytes_nocase(String(), (size_t)Length(), string.String(), (size_t)string.Length());
 
 	if (tmp == NULL) return -1;
 
@@ -1240,7 +1382,7 @@ BString::IFindFirst(const char *string) const
 {
 	if (String() == NULL || string == NULL || *string == 0) return -1;
 
-	const char *tmp = strcasestr(String(), string);
+	const char *tmp = e_find_bytes_nocase(String(), (size_t)Length(), string, strlen(string));
 
 	if (tmp == NULL) return -1;
 
@@ -1253,8 +1395,8 @@ BString::IFindFirst(const BString &string, int32 fromOffset) const
 {
 	if (String() == NULL || string.String() == NULL || fromOffset < 0 || fromOffset >= Length()) return -1;
 
-	const char *string_find = String() + fromOffset;
-	const char *tmp = strcasestr(string_find, string.String());
+	const char *tmp = e_find_bytes_nocase(String() + fromOffset, (size_t)(Length() - fromOffset),
+				  string.String(), (size_t)string.Length());
 
 	if (tmp == NULL) return -1;
 
@@ -1267,8 +1409,7 @@ BString::IFindFirst(const char *string, int32 fromOffset) const
 {
 	if (String() == NULL || string == NULL || *string == 0 || fromOffset < 0 || fromOffset >= Length()) return -1;
 
-	const char *string_find = String() + fromOffset;
-	const char *tmp = strcasestr(string_find, string);
+	const char *tmp = e_find_bytes_nocase(String() + fromOffset, (size_t)(Length() - fromOffset), string, strlen(string));
 
 	if (tmp == NULL) return -1;
 
@@ -1281,7 +1422,7 @@ BString::IFindFirst(char c) const
 {
 	if (String() == NULL || c == 0) return -1;
 
-	const char *tmp = strcasechr(String(), c);
+	const char *tmp = e_find_bytes_nocase(String(), (size_t)Length(), &c, 1);
 
 	if (tmp == NULL) return -1;
 
@@ -1294,8 +1435,7 @@ BString::IFindFirst(char c, int32 fromOffset) const
 {
 	if (String() == NULL || c == 0 || fromOffset < 0 || fromOffset >= Length()) return -1;
 
-	const char *string_find = String() + fromOffset;
-	const char *tmp = strcasechr(string_find, c);
+	const char *tmp = e_find_bytes_nocase(String() + fromOffset, (size_t)(Length() - fromOffset), &c, 1);
 
 	if (tmp == NULL) return -1;
 
@@ -1308,7 +1448,7 @@ BString::IFindLast(const BString &string) const
 {
 	if (String() == NULL || string.String() == NULL) return -1;
 
-	const char *tmp = strrcasestr(String(), string.String());
+	const char *tmp = e_rfind_bytes_nocase(String(), (size_t)Length(), string.String(), (size_t)string.Length());
 
 	if (tmp == NULL) return -1;
 
@@ -1321,7 +1461,7 @@ BString::IFindLast(const char *string) const
 {
 	if (String() == NULL || string == NULL || *string == 0) return -1;
 
-	const char *tmp = strrcasestr(String(), string);
+	const char *tmp = e_rfind_bytes_nocase(String(), (size_t)Length(), string, strlen(string));
 
 	if (tmp == NULL) return -1;
 
@@ -1334,17 +1474,11 @@ BString::IFindLast(const BString &string, int32 beforeOffset) const
 {
 	if (String() == NULL || string.String() == NULL || beforeOffset < 0 || beforeOffset >= Length()) return -1;
 
-	char *string_find = b_strndup(String(), beforeOffset + 1);
-	if (string_find == NULL) return -1;
-
-	const char *tmp = strrcasestr(string_find, string.String());
+	const char *tmp = e_rfind_bytes_nocase(String(), (size_t)beforeOffset + 1, string.String(), (size_t)string.Length());
 
-	int32 ret = -1;
-	if (tmp != NULL) ret = (int32)(tmp - string_find);
-
-	free(string_find);
+	if (tmp == NULL) return -1;
 
-	return ret;
+	return((int32)(tmp - String()));
 }
 
 
@@ -1353,17 +1487,11 @@ BString::IFindLast(const char *string, int32 beforeOffset) const
 {
 	if (String() == NULL || string == NULL || *string == 0 || beforeOffset < 0 || beforeOffset >= Length()) return -1;
 
-	char *string_find = b_strndup(String(), beforeOffset + 1);
-	if (string_find == NULL) return -1;
+	const char *tmp = e_rfind_bytes_nocase(String(), (size_t)beforeOffset + 1, string, strlen(string));
 
-	const char *tmp = strrcasestr(string_find, string);
-
-	int32 ret = -1;
-	if (tmp != NULL) ret = (int32)(tmp - string_find);
-
-	free(string_find);
+	if (tmp == NULL) return -1;
 
-	return ret;
+	return((int32)(tmp - String()));
 }
 
 
@@ -1372,7 +1500,7 @@ BString::IFindLast(char c) const
 {
 	if (String() == NULL || c == 0) return -1;
 
-	const char *tmp = strrcasechr(String(), c);
+	const char *tmp = e_rfind_bytes_nocase(String(), (size_t)Length(), &c, 1);
 
 	if (tmp == NULL) return -1;
 
@@ -1385,17 +1513,11 @@ BString::IFindLast(char c, int32 beforeOffset) const
 {
 	if (String() == NULL || c == 0 || beforeOffset < 0 || beforeOffset >= Length()) return -1;
 
-	char *string_find = b_strndup(String(), beforeOffset + 1);
-	if (string_find == NULL) return -1;
-
-	const char *tmp = strrcasechr(string_find, c);
+	const char *tmp = e_rfind_bytes_nocase(String(), (size_t)beforeOffset + 1, &c, 1);
 
-	int32 ret = -1;
-	if (tmp != NULL) ret = (int32)(tmp - string_find);
-
-	free(string_find);
+	if (tmp == NULL) return -1;
 
-	return ret;
+	return((int32)(tmp - String()));
 }
 
 
@@ -1424,16 +1546,10 @@ BString::ReplaceLast(char replaceThis, char withThis)
 BString&
 BString::ReplaceAll(char replaceThis, char withThis, int32 fromOffset)
 {
-	if (fromOffset < 0 || fromOffset >= fLen) return *this;
+	if (fromOffset < 0 || fromOffset >= fLen || replaceThis == 0) return *this;
 
-	while (fromOffset < fLen) {
-		int32 index = FindFirst(replaceThis, fromOffset);
-
-		if (index >= 0) {
-			fBuffer[index] = withThis;
-			fromOffset = index + 1;
-		} else break;
-	}
+	char *tmp = fBuffer + fromOffset;
+	while ((tmp = (char*)memchr(tmp, replaceThis, (size_t)(fBuffer + fLen - tmp))) != NULL) *tmp++ = withThis;
 
 	return *this;
 }
@@ -1477,18 +1593,7 @@ BString::ReplaceAll(const char *replaceThis, const char *withThis, int32 fromOff
 	if (fromOffset < 0 || fromOffset >= fLen) return *this;
 	if (replaceThis == NULL || *replaceThis == 0 || withThis == NULL || *withThis == 0) return *this;
 
-	int32 strLenReplace = (int32)strlen(replaceThis);
-	int32 strLenWith = (int32)strlen(withThis);
-
-	while (fromOffset < fLen) {
-		int32 index = FindFirst(replaceThis, fromOffset);
-
-		if (index >= 0) {
-			Remove(index, strLenReplace);
-			Insert(withThis, index);
-			fromOffset = index + strLenWith;
-		} else break;
-	}
+	_Replace(replaceThis, withThis, -1, fromOffset, false);
 
 	return *this;
 }
@@ -1501,24 +1606,8 @@ BString::Replace(const char *replaceThis, const char *withThis, int32 maxReplace
 	if (replaceThis == NULL || *replaceThis == 0 || withThis == NULL || *withThis == 0) return *this;
 
 	if (maxReplaceCount == 0) return *this;
-	if (maxReplaceCount < 0) return ReplaceAll(replaceThis, withThis, fromOffset);
-
-	int count = 0;
-	int32 strLenReplace = (int32)strlen(replaceThis);
-	int32 strLenWith = (int32)strlen(withThis);
 
-	while (true) {
-		int32 index = FindFirst(replaceThis, fromOffset);
-
-		if (index >= 0) {
-			Remove(index, strLenReplace);
-			Insert(withThis, index);
-			fromOffset = index + strLenWith;
-			count++;
-		} else break;
-
-		if (count >= maxReplaceCount) break;
-	}
+	_Replace(replaceThis, withThis, maxReplaceCount, fromOffset, false);
 
 	return *this;
 }
@@ -1602,18 +1691,7 @@ BString::IReplaceAll(const char *replaceThis, const char *withThis, int32 fromOf
 	if (fromOffset < 0 || fromOffset >= fLen) return *this;
 	if (replaceThis == NULL || *replaceThis == 0 || withThis == NULL || *withThis == 0) return *this;
 
-	int32 strLenReplace = (int32)strlen(replaceThis);
-	int32 strLenWith = (int32)strlen(withThis);
-
-	while (fromOffset < fLen) {
-		int32 index = IFindFirst(replaceThis, fromOffset);
-
-		if (index >= 0) {
-			Remove(index, strLenReplace);
-			Insert(withThis, index);
-			fromOffset = index + strLenWith;
-		} else break;
-	}
+	_Replace(replaceThis, withThis, -1, fromOffset, true);
 
 	return *this;
 }
@@ -1626,24 +1704,8 @@ BString::IReplace(const char *replaceThis, const char *withThis, int32 maxReplac
 	if (replaceThis == NULL || *replaceThis == 0 || withThis == NULL || *withThis == 0) return *this;
 
 	if (maxReplaceCount == 0) return *this;
-	if (maxReplaceCount < 0) return IReplaceAll(replaceThis, withThis, fromOffset);
 
-	int count = 0;
-	int32 strLenReplace = (int32)strlen(replaceThis);
-	int32 strLenWith = (int32)strlen(withThis);
-
-	while (true) {
-		int32 index = IFindFirst(replaceThis, fromOffset);
-
-		if (index >= 0) {
-			Remove(index, strLenReplace);
-			Insert(withThis, index);
-			fromOffset = index + strLenWith;
-			count++;
-		} else break;
-
-		if (count >= maxReplaceCount) break;
-	}
+	_Replace(replaceThis, withThis, maxReplaceCount, fromOffset, true);
 
 	return *this;
 }
@@ -2006,8 +2068,6 @@ bool e_get_hex(const BString &str, TYPB_INT *value)
 bool
 BString::GetDecimal(float *value) const
 {
-#if !(defined(_MSC_VER) && _MSC_VER <= 0x4b0)
-
 	if (!value || !IsNumber()) return false;
 
 	uint64 tmp;
@@ -2016,26 +2076,17 @@ BString::GetDecimal(float *value) const
 		return true;
 	}
 
-#ifdef HAVE_STRTOF
-	*value = strtof(String(), NULL);
-#else
-	*value = (float)strtod(String(), NULL);
-#endif
+	double v = 0;
+	e_parse_double(String(), Length(), &v);
+	*value = (float)v;
 
 	return true;
-
-#else
-	// TODO
-	return false;
-#endif
 }
 
 
 bool
 BString::GetDecimal(double *value) const
 {
-#if !(defined(_MSC_VER) && _MSC_VER <= 0x4b0)
-
 	if (!value || !IsNumber()) return false;
 
 	uint64 tmp;
@@ -2044,14 +2095,10 @@ BString::GetDecimal(double *value) const
 		return true;
 	}
 
-	*value = strtod(String(), NULL);
+	*value = 0;
+	e_parse_double(String(), Length(), value);
 
 	return true;
-
-#else
-	// TODO
-	return false;
-#endif
 }
 
 
@@ -2074,139 +2121,89 @@ BString::GetDecimal(long double *value) const
 #endif // ETK_SUPPORT_LONG_DOUBLE
 
 
-bool
-BString::GetInteger(int8 *value) const
+template<class TYPB_INT>
+bool e_get_int(const BString &str, TYPB_INT *value)
 {
-	if (!value || !IsNumber()) return false;
+	if (value == NULL || !str.IsNumber()) return false;
 
-	*value = (int8)strtol(String(), NULL, 10);
+	int64 tmp = 0;
+	e_parse_int64(str.String(), str.Length(), &tmp);
+	*value = (TYPB_INT)tmp;
 
 	return true;
 }
 
 
-bool
-BString::GetInteger(uint8 *value) const
+template<class TYPB_INT>
+bool e_get_uint(const BString &str, TYPB_INT *value)
 {
-	if (!value || !IsNumber()) return false;
+	if (value == NULL || !str.IsNumber()) return false;
 
-	if (e_get_hex(*this, value)) return true;
+	if (e_get_hex(str, value)) return true;
 
-	*value = (uint8)strtoul(String(), NULL, 10);
+	uint64 tmp = 0;
+	e_parse_uint64(str.String(), str.Length(), &tmp);
+	*value = (TYPB_INT)tmp;
 
 	return true;
 }
 
 
 bool
-BString::GetInteger(int16 *value) const
+BString::GetInteger(int8 *value) const
 {
-	if (!value || !IsNumber()) return false;
+	return e_get_int(*this, value);
+}
 
-	*value = (int16)strtol(String(), NULL, 10);
 
-	return true;
+bool
+BString::GetInteger(uint8 *value) const
+{
+	return e_get_uint(*this, value);
 }
 
 
 bool
-BString::GetInteger(uint16 *value) const
+BString::GetInteger(int16 *value) const
 {
-	if (!value || !IsNumber()) return false;
-
-	if (e_get_hex(*this, value)) return true;
+	return e_get_int(*this, value);
+}
 
-	*value = (uint16)strtoul(String(), NULL, 10);
 
-	return true;
+bool
+BString::GetInteger(uint16 *value) const
+{
+	return e_get_uint(*this, value);
 }
 
 
 bool
 BString::GetInteger(int32 *value) const
 {
-	if (!value || !IsNumber()) return false;
-
-	if (e_get_hex(*this, value)) return true;
-
-	*value = (int32)strtol(String(), NULL, 10);
-
-	return true;
+	if (value && e_get_hex(*this, value)) return true;
+	return e_get_int(*this, value);
 }
 
 
 bool
 BString::GetInteger(uint32 *value) const
 {
-	if (!value || !IsNumber()) return false;
-
-	if (e_get_hex(*this, value)) return true;
-
-	*value = (uint32)strtoul(String(), NULL, 10);
-
-	return true;
+	return e_get_uint(*this, value);
 }
 
 
 bool
 BString::GetInteger(int64 *value) const
 {
-	if (!value || !IsNumber()) return false;
-
-	if (e_get_hex(*this, value)) return true;
-
-#if SIZEOF_INT == 8 || SIZEOF_LONG == 8
-	*value = (int64)strtol(String(), NULL, 10);
-	return true;
-#else
-#if SIZEOF_LONG_LONG == 8 && !defined(_MSC_VER)
-	*value = (int64)strtoll(String(), NULL, 10);
-	return true;
-#else
-#if SIZEOF___INT64 == 8
-#if _MSC_VER <= 0x4b0
-	*value = (int64)_atoi64(String());
-#else
-	*value = (int64)_strtoi64(String(), NULL, 10);
-#endif
-	return true;
-#else
-	return false;
-#endif
-#endif
-#endif
+	if (value && e_get_hex(*this, value)) return true;
+	return e_get_int(*this, value);
 }
 
 
 bool
 BString::GetInteger(uint64 *value) const
 {
-#if !(defined(_MSC_VER) && _MSC_VER <= 0x4b0)
-	if (!value || !IsNumber()) return false;
-
-	if (e_get_hex(*this, value)) return true;
-
-#if SIZEOF_INT == 8 || SIZEOF_LONG == 8
-	*value = (uint64)strtoul(String(), NULL, 10);
-	return true;
-#else
-#if SIZEOF_LONG_LONG == 8 && !defined(_MSC_VER)
-	*value = (uint64)strtoull(String(), NULL, 10);
-	return true;
-#else
-#if SIZEOF___INT64 == 8
-	*value = (uint64)_strtoui64(String(), NULL, 10);
-	return true;
-#else
-	return false;
-#endif
-#endif
-#endif
-
-#else
-	// TODO
-	return false;
-#endif
+	return e_get_uint(*this, value);
 }
 
 
@@ -2234,70 +2231,80 @@ BString::operator<<(char c)
 BString&
 BString::operator<<(int8 value)
 {
-	return AppendFormat("%I8i", value);
+	char buf[32];
+	return Append(buf, e_format_int64(buf, (int64)value));
 }
 
 
 BString&
 BString::operator<<(uint8 value)
 {
-	return AppendFormat("%I8u", value);
+	char buf[32];
+	return Append(buf, e_format_uint64(buf, (uint64)value));
 }
 
 
 BString&
 BString::operator<<(int16 value)
 {
-	return AppendFormat("%I16i", value);
+	char buf[32];
+	return Append(buf, e_format_int64(buf, (int64)value));
 }
 
 
 BString&
 BString::operator<<(uint16 value)
 {
-	return AppendFormat("%I16u", value);
+	char buf[32];
+	return Append(buf, e_format_uint64(buf, (uint64)value));
 }
 
 
 BString&
 BString::operator<<(int32 value)
 {
-	return AppendFormat("%I32i", value);
+	char buf[32];
+	return Append(buf, e_format_int64(buf, (int64)value));
 }
 
 
 BString&
 BString::operator<<(uint32 value)
 {
-	return AppendFormat("%I32u", value);
+	char buf[32];
+	return Append(buf, e_format_uint64(buf, (uint64)value));
 }
 
 
 BString&
 BString::operator<<(int64 value)
 {
-	return AppendFormat("%I64i", value);
+	char buf[32];
+	return Append(buf, e_format_int64(buf, (int64)value));
 }
 
 
 BString&
 BString::operator<<(uint64 value)
 {
-	return AppendFormat("%I64u", value);
+	char buf[32];
+	return Append(buf, e_format_uint64(buf, (uint64)value));
 }
 
 
 BString&
 BString::operator<<(float value)
 {
-	return AppendFormat("%g", value);
+	char buf[32];
+	return Append(buf, e_format_float(buf, value));
 }
 
 
 BString&
 BString::operator<<(double value)
 {
-	return AppendFormat("%g", value);
+	char buf[32];
+	return Append(buf, e_format_double(buf, value));
 }
 
 
@@ -2437,15 +2444,22 @@ void e_printf_int(BString &str, TYPB_INT value, uint8 _base, int precision_width
 
 	TYPB_INT base = (TYPB_INT)_base;
 
+	// filled backward within the stack, then appended at once
+	char buf[sizeof(TYPB_INT) * 3 + 2];
+	char *p = buf + sizeof(buf) - 1;
+	*p = '\0';
+
 	while (value != (TYPB_INT)0) {
 		int nIndex = (int)(value % base);
 		if (nIndex < 0) nIndex = -nIndex;
 		if (nIndex >= (int)_base) break;
-		str.Prepend((char)(nIndex <= 9 ? '0' + nIndex : (upper_style ? 'A' : 'a') + nIndex - 10), 1);
+		*--p = (char)(nIndex <= 9 ? '0' + nIndex : (upper_style ? 'A' : 'a') + nIndex - 10);
 		value /= base;
 	}
 
-	if (!(str.Length() < 0 || precision_width < 0 || str.Length() >= precision_width)) str.Prepend('0', precision_width - str.Length());
+	int32 count = (int32)(buf + sizeof(buf) - 1 - p);
+	if (precision_width > count) str.Append('0', precision_width - count);
+	str.Append(p, count);
 }
 
 
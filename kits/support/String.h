@@ -69,6 +69,17 @@ extern "C"
 	const unichar32*	e_utf32_at(const unichar32* ustr, int32 index);
 	const unichar32*	e_utf32_next(const unichar32* ustr);
 
+	/* locale independent, "buffer" must hold 32 bytes at least, return the length */
+	int32		e_format_double(char *buffer, double value); /* shortest round-trip digits */
+	int32		e_format_float(char *buffer, float value);
+	int32		e_format_int64(char *buffer, int64 value);
+	int32		e_format_uint64(char *buffer, uint64 value);
+
+	/* locale independent, return the count of bytes parsed or 0 when failed; length < 0 means NUL-terminated */
+	int32		e_parse_double(const char *str, int32 length, double *value);
+	int32		e_parse_int64(const char *str, int32 length, int64 *value);
+	int32		e_parse_uint64(const char *str, int32 length, uint64 *value);
+
 #ifdef __cplusplus /* Just for C++ */
 } // extern "C"
 
@@ -311,6 +322,8 @@ class BString
 		char *fBuffer;
 
 		bool _Resize(int32 length);
+		bool _Replace(const char *replaceThis, const char *withThis,
+			      int32 maxReplaceCount, int32 fromOffset, bool ignoreCase);
 };
 
 
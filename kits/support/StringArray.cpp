@@ -27,6 +27,8 @@
  *
  * --------------------------------------------------------------------------*/
 
+#include <ctype.h>
+
 #include "StringArray.h"
 
 
@@ -45,30 +47,76 @@ typedef struct __string_node__ {
 } __string_node__;
 
 
+// Chained hash index over the item positions: "buckets" holds the first item
+// of each chain and "next" links the items, both chains kept in ascending order.
+struct __string_index__ {
+	uint32 mask;
+	int32 *buckets;
+	int32 *next;
+
+	__string_index__(int32 count) {
+		uint32 nBuckets = 16;
+		while (nBuckets < (uint32)count * 2) nBuckets <<= 1;
+
+		mask = nBuckets - 1;
+		buckets = new int32[nBuckets];
+		next = new int32[max_c(count, 1)];
+		for (uint32 i = 0; i < nBuckets; i++) buckets[i] = -1;
+	}
+
+	~__string_index__() {
+		delete[] buckets;
+		delete[] next;
+	}
+};
+
+
+static uint32 e_string_array_hash(const char *str, bool ignoreCase)
+{
+	// FNV-1a
+	uint32 hash = 2166136261U;
+
+	if (str == NULL) return hash;
+
+	if (ignoreCase) {
+		for (; *str; str++) hash = (hash ^ (uint32)tolower((uint8)*str)) * 16777619U;
+	} else {
+		for (; *str; str++) hash = (hash ^ (uint32)(uint8)*str) * 16777619U;
+	}
+
+	return hash;
+}
+
+
 BStringArray::BStringArray()
+	: fHashIndex(false), fIndex(NULL), fIIndex(NULL)
 {
 }
 
 
 BStringArray::BStringArray(const char *string, void *attach_data)
+	: fHashIndex(false), fIndex(NULL), fIIndex(NULL)
 {
 	AddItem(string, attach_data);
 }
 
 
 BStringArray::BStringArray(const BString &string, void *attach_data)
+	: fHashIndex(false), fIndex(NULL), fIIndex(NULL)
 {
 	AddItem(string, attach_data);
 }
 
 
 BStringArray::BStringArray(const char **array)
+	: fHashIndex(false), fIndex(NULL), fIIndex(NULL)
 {
 	operator=(array);
 }
 
 
 BStringArray::BStringArray(const BStringArray &array)
+	: fHashIndex(false), fIndex(NULL), fIIndex(NULL)
 {
 	operator=(array);
 }
@@ -80,9 +128,74 @@ BStringArray::~BStringArray()
 }
 
 
+void
+BStringArray::_InvalidateIndex()
+{
+	if (fIndex) delete fIndex;
+	if (fIIndex) delete fIIndex;
+	fIndex = fIIndex = NULL;
+}
+
+
+void
+BStringArray::SetHashIndex(bool state)
+{
+	fHashIndex = state;
+	if (!state) _InvalidateIndex();
+}
+
+
+bool
+BStringArray::HasHashIndex() const
+{
+	return fHashIndex;
+}
+
+
+int32
+BStringArray::_FindIndexed(const char *string, int32 startIndex, bool invert, bool ignoreCase) const
+{
+	__string_index__ *index = (ignoreCase ? fIIndex : fIndex);
+
+	if (index == NULL) {
+		int32 count = list.CountItems();
+		index = new __string_index__(count);
+
+		for (int32 i = count - 1; i >= 0; i--) {
+			uint32 hash = e_string_array_hash(ItemAt(i)->String(), ignoreCase) & index->mask;
+			index->next[i] = index->buckets[hash];
+			index->buckets[hash] = i;
+		}
+
+		if (ignoreCase) fIIndex = index;
+		else fIndex = index;
+	}
+
+	int32 found = -1;
+
+	for (int32 i = index->buckets[e_string_array_hash(string, ignoreCase) & index->mask]; i >= 0; i = index->next[i]) {
+		if (invert) {
+			if (i > startIndex) break;
+		} else if (i < startIndex) {
+			continue;
+		}
+
+		const BString *str = ItemAt(i);
+		if ((ignoreCase ? str->ICompare(string) : str->Compare(string)) != 0) continue;
+
+		if (!invert) return i;
+		found = i;
+	}
+
+	return found;
+}
+
+
 void
 BStringArray::MakeEmpty()
 {
+	_InvalidateIndex();
+
 	if (!list.IsEmpty()) {
 		for (int32 i = 0; i < list.CountItems(); i++) delete (__string_node__*)list.ItemAt(i);
 		list.MakeEmpty();
@@ -170,6 +283,8 @@ BStringArray::operator+=(const char **array)
 bool
 BStringArray::AddItem(const char *item, void *attach_data)
 {
+	_InvalidateIndex();
+
 	__string_node__ *data = new __string_node__;
 	if (!data || !data->str) {
 		if (data) delete data;
@@ -191,6 +306,8 @@ BStringArray::AddItem(const char *item, void *attach_data)
 bool
 BStringArray::AddItem(const char *item, int32 atIndex, void *attach_data)
 {
+	_InvalidateIndex();
+
 	__string_node__ *data = new __string_node__;
 	if (!data || !data->str) {
 		if (data) delete data;
@@ -235,6 +352,8 @@ BStringArray::AddArray(const BStringArray &array)
 		if (_array.AddItem(node->str->String(), node->data) == false) return false;
 	}
 
+	_InvalidateIndex();
+
 	if (list.AddList(&_array.list)) {
 		_array.list.MakeEmpty();
 		return true;
@@ -257,6 +376,8 @@ BStringArray::AddArray(const BStringArray &array, int32 atIndex)
 		if (_array.AddItem(node->str->String(), node->data) == false) return false;
 	}
 
+	_InvalidateIndex();
+
 	if (list.AddList(&_array.list, atIndex)) {
 		_array.list.MakeEmpty();
 		return true;
@@ -299,6 +420,8 @@ BStringArray::LastItem(void **attach_data) const
 bool
 BStringArray::RemoveItem(int32 index)
 {
+	_InvalidateIndex();
+
 	__string_node__ *node = (__string_node__*)list.RemoveItem(index);
 
 	if (node) {
@@ -313,6 +436,8 @@ BStringArray::RemoveItem(int32 index)
 bool
 BStringArray::RemoveItems(int32 index, int32 count)
 {
+	_InvalidateIndex();
+
 	if (index < 0 || index >= list.CountItems()) return false;
 
 	if (count < 0) count = list.CountItems() - index;
@@ -339,6 +464,8 @@ BStringArray::RemoveItems(int32 index, int32 count)
 bool
 BStringArray::ReplaceItem(int32 index, const char *string, void *attach_data)
 {
+	_InvalidateIndex();
+
 	__string_node__ *node = (__string_node__*)list.ItemAt(index);
 
 	if (node && node->str) {
@@ -354,6 +481,8 @@ BStringArray::ReplaceItem(int32 index, const char *string, void *attach_data)
 bool
 BStringArray::ReplaceItem(int32 index, const BString &string, void *attach_data)
 {
+	_InvalidateIndex();
+
 	__string_node__ *node = (__string_node__*)list.ItemAt(index);
 
 	if (node && node->str) {
@@ -369,6 +498,8 @@ BStringArray::ReplaceItem(int32 index, const BString &string, void *attach_data)
 BStringArray&
 BStringArray::SortItems(int (*cmp)(const BString**, const BString**))
 {
+	_InvalidateIndex();
+
 	list.SortItems((int (*)(const void*, const void*))cmp);
 
 	return *this;
@@ -378,6 +509,8 @@ BStringArray::SortItems(int (*cmp)(const BString**, const BString**))
 bool
 BStringArray::SwapItems(int32 indexA, int32 indexB)
 {
+	_InvalidateIndex();
+
 	if (indexA != indexB) return list.SwapItems(indexA, indexB);
 
 	return true;
@@ -387,6 +520,8 @@ BStringArray::SwapItems(int32 indexA, int32 indexB)
 bool
 BStringArray::MoveItem(int32 fromIndex, int32 toIndex)
 {
+	_InvalidateIndex();
+
 	if (fromIndex != toIndex) return list.MoveItem(fromIndex, toIndex);
 
 	return true;
@@ -398,6 +533,9 @@ BStringArray::FindString(const char *string, int32 startIndex, bool all_equal, b
 {
 	if (startIndex < 0 || startIndex >= list.CountItems()) return -1;
 
+	if (fHashIndex && all_equal && string != NULL && *string != 0)
+		return _FindIndexed(string, startIndex, invert, false);
+
 	int32 i = startIndex;
 
 	while (i >= 0 && i < list.CountItems()) {
@@ -434,6 +572,9 @@ BStringArray::IFindString(const char *string, int32 startIndex, bool all_equal,
 {
 	if (startIndex < 0 || startIndex >= list.CountItems()) return -1;
 
+	if (fHashIndex && all_equal && string != NULL && *string != 0)
+		return _FindIndexed(string, startIndex, invert, true);
+
 	int32 i = startIndex;
 
 	while (i >= 0 && i < list.CountItems()) {
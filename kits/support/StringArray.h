@@ -35,6 +35,8 @@
 
 #ifdef __cplusplus /* Just for C++ */
 
+struct __string_index__;
+
 class BStringArray
 {
 	public:
@@ -88,8 +90,21 @@ class BStringArray
 		int32		IFindString(const char *string, int32 startIndex = 0, bool all_equal = true, bool invert = false) const;
 		int32		IFindString(const BString &string, int32 startIndex = 0, bool all_equal = true, bool invert = false) const;
 
+		// SetHashIndex: when enabled, FindString()/IFindString() with "all_equal" use a hash index
+		//               that is built on the first lookup and dropped by any modification of the array,
+		//               so repeated exact lookups cost O(1) on average instead of a linear scan.
+		void		SetHashIndex(bool state);
+		bool		HasHashIndex() const;
+
 	private:
 		BList list;
+
+		bool fHashIndex;
+		mutable struct __string_index__ *fIndex;
+		mutable struct __string_index__ *fIIndex;
+
+		void _InvalidateIndex();
+		int32 _FindIndexed(const char *string, int32 startIndex, bool invert, bool ignoreCase) const;
 };
 
 #endif /* __cplusplus */
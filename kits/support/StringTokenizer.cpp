@@ -0,0 +1,345 @@
+/* --------------------------------------------------------------------------
+ *
+ * ETK++ --- The Easy Toolkit for C++ programing
+ * Copyright (C) 2004-2007, Anthony Lee, All Rights Reserved
+ *
+ * ETK++ library is a freeware; it may be used and distributed according to
+ * the terms of The MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+ * IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * File: StringTokenizer.cpp
+ * Description: BStringSlice, BStringTokenizer --- non-owning substrings and lazy splitting
+ *
+ * --------------------------------------------------------------------------*/
+
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+
+#include "StringTokenizer.h"
+
+
+static inline int32 e_utf8_char_length(uint8 c)
+{
+	if (c < 0xc0) return 1; // ASCII, or a stray continuation byte
+	if (c < 0xe0) return 2;
+	if (c < 0xf0) return 3;
+	return 4;
+}
+
+
+BStringSlice::BStringSlice()
+	: fData(NULL), fLength(0)
+{
+}
+
+
+BStringSlice::BStringSlice(const char *str, int32 length)
+	: fData(NULL), fLength(0)
+{
+	SetTo(str, length);
+}
+
+
+BStringSlice::BStringSlice(const BString &str)
+	: fData(str.String()), fLength(str.Length())
+{
+}
+
+
+BStringSlice&
+BStringSlice::SetTo(const char *str, int32 length)
+{
+	fData = str;
+	fLength = (str == NULL ? 0 : (length < 0 ? (int32)strlen(str) : length));
+	return *this;
+}
+
+
+const char*
+BStringSlice::Data() const
+{
+	return fData;
+}
+
+
+int32
+BStringSlice::Length() const
+{
+	return fLength;
+}
+
+
+int32
+BStringSlice::CountChars() const
+{
+	if (fLength <= 0) return 0;
+	return e_utf8_strlen_etc(fData, fLength);
+}
+
+
+bool
+BStringSlice::IsEmpty() const
+{
+	return(fLength <= 0);
+}
+
+
+char
+BStringSlice::operator[](int32 index) const
+{
+	if (index < 0 || index >= fLength) return 0;
+	return fData[index];
+}
+
+
+int
+BStringSlice::Compare(const char *str) const
+{
+	if (str == NULL) str = "";
+
+	int32 len = (int32)strlen(str);
+	int ret = (fLength > 0 ? memcmp(fData, str, (size_t)min_c(fLength, len)) : 0);
+
+	if (ret != 0 || fLength == len) return ret;
+	return(fLength < len ? -1 : 1);
+}
+
+
+int
+BStringSlice::ICompare(const char *str) const
+{
+	if (str == NULL) str = "";
+
+	int32 len = (int32)strlen(str);
+	int ret = (fLength > 0 ? strncasecmp(fData, str, (size_t)min_c(fLength, len)) : 0);
+
+	if (ret != 0 || fLength == len) return ret;
+	return(fLength < len ? -1 : 1);
+}
+
+
+bool
+BStringSlice::operator==(const char *str) const
+{
+	return(Compare(str) == 0);
+}
+
+
+bool
+BStringSlice::operator!=(const char *str) const
+{
+	return(Compare(str) != 0);
+}
+
+
+int32
+BStringSlice::FindFirst(const char *str, int32 fromOffset) const
+{
+	if (str == NULL || *str == 0 || fromOffset < 0 || fromOffset >= fLength) return -1;
+
+	const char *tmp = (const char*)memmem(fData + fromOffset, (size_t)(fLength - fromOffset), str, strlen(str));
+	if (tmp == NULL) return -1;
+
+	return((int32)(tmp - fData));
+}
+
+
+int32
+BStringSlice::FindFirst(char c, int32 fromOffset) const
+{
+	if (c == 0 || fromOffset < 0 || fromOffset >= fLength) return -1;
+
+	const char *tmp = (const char*)memchr(fData + fromOffset, c, (size_t)(fLength - fromOffset));
+	if (tmp == NULL) return -1;
+
+	return((int32)(tmp - fData));
+}
+
+
+BStringSlice
+BStringSlice::SubSlice(int32 fromOffset, int32 length) const
+{
+	if (fromOffset < 0 || fromOffset >= fLength) return BStringSlice();
+
+	if (length < 0 || length > fLength - fromOffset) length = fLength - fromOffset;
+	return BStringSlice(fData + fromOffset, length);
+}
+
+
+BStringSlice&
+BStringSlice::Trim()
+{
+	while (fLength > 0 && isspace((uint8)fData[0])) {
+		fData++;
+		fLength--;
+	}
+	while (fLength > 0 && isspace((uint8)fData[fLength - 1])) fLength--;
+
+	return *this;
+}
+
+
+BString&
+BStringSlice::CopyInto(BString &into) const
+{
+	if (fLength <= 0) into.MakeEmpty();
+	else into.SetTo(fData, fLength);
+
+	return into;
+}
+
+
+void
+BStringSlice::CopyInto(char *into, size_t into_size) const
+{
+	if (into == NULL || into_size == 0) return;
+
+	size_t len = min_c((size_t)max_c(fLength, 0), into_size - 1);
+	if (len > 0) memcpy(into, fData, len);
+	into[len] = 0;
+}
+
+
+BStringTokenizer::BStringTokenizer(const char *str, const char *delimiter, uint32 flags)
+{
+	_Init(str, -1, delimiter, flags);
+}
+
+
+BStringTokenizer::BStringTokenizer(const char *str, int32 length, const char *delimiter, uint32 flags)
+{
+	_Init(str, length, delimiter, flags);
+}
+
+
+BStringTokenizer::BStringTokenizer(const BString &str, const char *delimiter, uint32 flags)
+{
+	_Init(str.String(), str.Length(), delimiter, flags);
+}
+
+
+void
+BStringTokenizer::_Init(const char *str, int32 length, const char *delimiter, uint32 flags)
+{
+	if (str == NULL) length = 0;
+	else if (length < 0) length = (int32)strlen(str);
+
+	fString = fPos = str;
+	fEnd = str + length;
+	fDelimiter = (delimiter == NULL ? "" : delimiter);
+	fDelimiterLength = (int32)strlen(fDelimiter);
+	fFlags = flags;
+	fMultiByteSet = false;
+
+	bzero(fDelimiterSet, sizeof(fDelimiterSet));
+	if (fFlags & B_TOKENIZE_ANY_OF) {
+		for (const char *tmp = fDelimiter; *tmp; tmp++) {
+			uint8 c = (uint8)*tmp;
+			if (c < 0x80) fDelimiterSet[c >> 3] |= (uint8)(1 << (c & 7));
+			else fMultiByteSet = true;
+		}
+	}
+}
+
+
+const char*
+BStringTokenizer::_FindDelimiter(const char *from, int32 *delimiterLength) const
+{
+	if (!(fFlags & B_TOKENIZE_ANY_OF)) {
+		*delimiterLength = fDelimiterLength;
+		return (const char*)memmem(from, (size_t)(fEnd - from), fDelimiter, (size_t)fDelimiterLength);
+	}
+
+	while (from < fEnd) {
+		uint8 c = (uint8)*from;
+
+		if (c < 0x80) {
+			if (fDelimiterSet[c >> 3] & (1 << (c & 7))) {
+				*delimiterLength = 1;
+				return from;
+			}
+			from++;
+			continue;
+		}
+
+		// Multi-byte characters are matched as a whole, never byte by byte.
+		int32 len = min_c(e_utf8_char_length(c), (int32)(fEnd - from));
+		if (fMultiByteSet) {
+			for (const char *d = fDelimiter; *d; d += e_utf8_char_length((uint8)*d)) {
+				if (e_utf8_char_length((uint8)*d) == len && memcmp(d, from, (size_t)len) == 0) {
+					*delimiterLength = len;
+					return from;
+				}
+			}
+		}
+		from += len;
+	}
+
+	return NULL;
+}
+
+
+bool
+BStringTokenizer::GetNext(BStringSlice *token)
+{
+	if (fDelimiterLength == 0) return false;
+
+	while (fPos < fEnd) {
+		int32 delimiterLength = 0;
+		const char *found = _FindDelimiter(fPos, &delimiterLength);
+		const char *start = fPos;
+
+		if (found == NULL) {
+			found = fEnd;
+			fPos = fEnd;
+		} else {
+			fPos = found + delimiterLength;
+		}
+
+		if (found == start && (fFlags & B_TOKENIZE_SKIP_EMPTY)) continue;
+
+		if (token) token->SetTo(start, (int32)(found - start));
+		return true;
+	}
+
+	return false;
+}
+
+
+bool
+BStringTokenizer::HasMore() const
+{
+	BStringTokenizer tmp(*this);
+	return tmp.GetNext(NULL);
+}
+
+
+BStringSlice
+BStringTokenizer::Remainder() const
+{
+	return BStringSlice(fPos, (int32)(fEnd - fPos));
+}
+
+
+void
+BStringTokenizer::Rewind()
+{
+	fPos = fString;
+}
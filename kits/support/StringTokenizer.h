@@ -0,0 +1,116 @@
+/* --------------------------------------------------------------------------
+ *
+ * ETK++ --- The Easy Toolkit for C++ programing
+ * Copyright (C) 2004-2007, Anthony Lee, All Rights Reserved
+ *
+ * ETK++ library is a freeware; it may be used and distributed according to
+ * the terms of The MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+ * IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * File: StringTokenizer.h
+ * Description: BStringSlice, BStringTokenizer --- non-owning substrings and lazy splitting
+ *
+ * --------------------------------------------------------------------------*/
+
+#ifndef __ETK_STRING_TOKENIZER_H__
+#define __ETK_STRING_TOKENIZER_H__
+
+#include <support/String.h>
+
+#ifdef __cplusplus /* Just for C++ */
+
+// BStringSlice: a non-owning piece of a string, it's NOT null-terminated
+//               and it's valid only as long as the string it points into.
+class BStringSlice
+{
+	public:
+		BStringSlice();
+		BStringSlice(const char *str, int32 length = -1);
+		BStringSlice(const BString &str);
+
+		BStringSlice	&SetTo(const char *str, int32 length = -1);
+
+		const char	*Data() const;
+		int32		Length() const; // ASCII
+		int32		CountChars() const; // UTF-8
+		bool		IsEmpty() const;
+
+		char		operator[](int32 index) const;
+
+		int		Compare(const char *str) const;
+		int		ICompare(const char *str) const;
+		bool		operator==(const char *str) const;
+		bool		operator!=(const char *str) const;
+
+		int32		FindFirst(const char *str, int32 fromOffset = 0) const;
+		int32		FindFirst(char c, int32 fromOffset = 0) const;
+
+		BStringSlice	SubSlice(int32 fromOffset, int32 length = -1) const;
+		BStringSlice	&Trim(); // removes leading and trailing white spaces
+
+		BString		&CopyInto(BString &into) const;
+		void		CopyInto(char *into, size_t into_size) const;
+
+	private:
+		const char *fData;
+		int32 fLength;
+};
+
+
+enum {
+	B_TOKENIZE_ANY_OF	= 1,	// every UTF-8 character of the delimiter is a separator by itself
+	B_TOKENIZE_SKIP_EMPTY	= 1 << 1,	// don't return empty tokens
+};
+
+
+// BStringTokenizer: splits a string lazily, GetNext() returns the tokens one by one as
+//                   slices of the original string, so nothing is copied nor allocated.
+//                   Without flags it returns the same tokens as BString::Split().
+class BStringTokenizer
+{
+	public:
+		BStringTokenizer(const char *str, const char *delimiter, uint32 flags = 0);
+		BStringTokenizer(const char *str, int32 length, const char *delimiter, uint32 flags = 0);
+		BStringTokenizer(const BString &str, const char *delimiter, uint32 flags = 0);
+
+		bool		GetNext(BStringSlice *token);
+		bool		HasMore() const;
+
+		// Remainder: the part of the string not returned by GetNext() yet
+		BStringSlice	Remainder() const;
+
+		void		Rewind();
+
+	private:
+		const char *fString;
+		const char *fEnd;
+		const char *fPos;
+		const char *fDelimiter;
+		int32 fDelimiterLength;
+		uint32 fFlags;
+		uint8 fDelimiterSet[32];
+		bool fMultiByteSet;
+
+		void _Init(const char *str, int32 length, const char *delimiter, uint32 flags);
+		const char *_FindDelimiter(const char *from, int32 *delimiterLength) const;
+};
+
+#endif /* __cplusplus */
+
+#endif /* __ETK_STRING_TOKENIZER_H__ */
@@ -0,0 +1,199 @@
+/* --------------------------------------------------------------------------
+ *
+ * ETK++ --- The Easy Toolkit for C++ programing
+ * Copyright (C) 2004-2007, Anthony Lee, All Rights Reserved
+ *
+ * ETK++ library is a freeware; it may be used and distributed according to
+ * the terms of The MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+ * IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * File: flattened-message-test.cpp
+ *
+ * --------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <kernel/OS.h>
+#include <kernel/Debug.h>
+#include <app/Message.h>
+
+
+static void build_message(BMessage *msg, size_t bytes)
+{
+	msg->what = 'test';
+	msg->AddInt64("when", e_system_time());
+	msg->AddInt32("modifiers", 0);
+	msg->AddInt32("buttons", 1);
+
+	// "line ", the longest int, the rest of the line and the NUL
+	char text[5 + 11 + 51 + 1];
+	for (int32 i = 0; msg->FlattenedSize() < bytes; i++) {
+		snprintf(text, sizeof(text), "line %d of the text which fills the message up to the size", (int)i);
+		msg->AddString("text", text);
+	}
+}
+
+
+// what arrives at the other side of the port: a fresh buffer holding the flattened message
+static char* receive_buffer(const char *data, size_t size)
+{
+	char *buffer = (char*)malloc(size);
+	memcpy(buffer, data, size);
+	return buffer;
+}
+
+
+static bool check_message(const BMessage *msg, const BMessage *orig)
+{
+	int64 when = 0, origWhen = 1;
+	int32 count = msg->CountItems("text", B_STRING_TYPE);
+	const char *text = NULL, *origText = NULL;
+
+	msg->FindInt64("when", &when);
+	orig->FindInt64("when", &origWhen);
+	msg->FindString("text", count - 1, &text);
+	orig->FindString("text", count - 1, &origText);
+
+	return(msg->what == orig->what && when == origWhen &&
+	       count == orig->CountItems("text", B_STRING_TYPE) &&
+	       text != NULL && origText != NULL && strcmp(text, origText) == 0);
+}
+
+
+static bool run_test(size_t bytes, int32 rounds)
+{
+	BMessage msg;
+	build_message(&msg, bytes);
+
+	size_t size = msg.FlattenedSize();
+	char *data = (char*)malloc(size);
+	bool ok = msg.Flatten(data, size);
+
+	ETK_OUTPUT("%I64u bytes, %I32i items, %I32i messages:\n",
+	           (uint64)size, msg.CountItems("text", B_STRING_TYPE) + 3, rounds);
+
+	// Unflatten() copies every field out of the buffer
+	bigtime_t t = e_system_time();
+	for (int32 i = 0; i < rounds; i++) {
+		char *buffer = receive_buffer(data, size);
+		BMessage received;
+		ok = received.Unflatten(buffer, size) && ok;
+		free(buffer);
+		if (i == 0) ok = check_message(&received, &msg) && ok;
+	}
+	bigtime_t t1 = e_system_time() - t;
+
+	// AdoptFlattened() keeps the buffer and decodes the fields when they are accessed
+	t = e_system_time();
+	for (int32 i = 0; i < rounds; i++) {
+		char *buffer = receive_buffer(data, size);
+		BMessage received;
+		if (received.AdoptFlattened(buffer, size) == false) {
+			free(buffer);
+			ok = false;
+		}
+		if (i == 0) ok = check_message(&received, &msg) && ok;
+	}
+	bigtime_t t2 = e_system_time() - t;
+
+	// the first access decodes the fields
+	int64 when = 0;
+	t = e_system_time();
+	for (int32 i = 0; i < rounds; i++) {
+		char *buffer = receive_buffer(data, size);
+		BMessage received;
+		ok = received.Unflatten(buffer, size) && ok;
+		free(buffer);
+		received.FindInt64("when", &when);
+	}
+	bigtime_t t3 = e_system_time() - t;
+
+	t = e_system_time();
+	for (int32 i = 0; i < rounds; i++) {
+		char *buffer = receive_buffer(data, size);
+		BMessage received;
+		if (received.AdoptFlattened(buffer, size) == false) {
+			free(buffer);
+			ok = false;
+		}
+		received.FindInt64("when", &when);
+	}
+	bigtime_t t4 = e_system_time() - t;
+
+	ETK_OUTPUT("\tReceive:              %I64i ns with Unflatten(), %I64i ns with AdoptFlattened()\n",
+	           t1 * 1000 / rounds, t2 * 1000 / rounds);
+	ETK_OUTPUT("\tReceive + FindInt64:  %I64i ns with Unflatten(), %I64i ns with AdoptFlattened()\n",
+	           t3 * 1000 / rounds, t4 * 1000 / rounds);
+
+	// passing a received message on
+	BMessage copied, adopted;
+	copied.Unflatten(data, size);
+	adopted.AdoptFlattened(receive_buffer(data, size), size);
+
+	size_t sent = 0;
+	t = e_system_time();
+	for (int32 i = 0; i < rounds; i++) {
+		size_t flattenedSize = copied.FlattenedSize();
+		char *buffer = (char*)malloc(flattenedSize);
+		ok = copied.Flatten(buffer, flattenedSize) && ok;
+		sent += flattenedSize;
+		free(buffer);
+	}
+	t1 = e_system_time() - t;
+
+	t = e_system_time();
+	for (int32 i = 0; i < rounds; i++) {
+		size_t flattenedSize = 0;
+		const char *buffer = adopted.FlattenedData(&flattenedSize);
+		ok = (buffer != NULL) && ok;
+		sent -= flattenedSize;
+	}
+	t2 = e_system_time() - t;
+	ok = (sent == 0) && ok;
+
+	ETK_OUTPUT("\tSend again:           %I64i ns with Flatten(), %I64i ns with FlattenedData()\n",
+	           t1 * 1000 / rounds, t2 * 1000 / rounds);
+
+	// changing it drops the flattened form
+	adopted.AddInt32("changed", 1);
+	ok = (adopted.FlattenedData(NULL) == NULL) && ok;
+
+	BMessage changed;
+	size_t changedSize = adopted.FlattenedSize();
+	char *buffer = (char*)malloc(changedSize);
+	ok = adopted.Flatten(buffer, changedSize) && changed.Unflatten(buffer, changedSize) && ok;
+	ok = changed.HasInt32("changed") && check_message(&changed, &msg) && ok;
+	free(buffer);
+
+	free(data);
+	return ok;
+}
+
+
+int main(int argc, char **argv)
+{
+	bool ok = true;
+	ok = run_test(1024, 100000) && ok;
+	ok = run_test(65536, 2000) && ok;
+
+	ETK_OUTPUT("Results: %s\n", ok ? "OK" : "MISMATCH");
+	return(ok ? 0 : 1);
+}
@@ -0,0 +1,111 @@
+/* --------------------------------------------------------------------------
+ *
+ * ETK++ --- The Easy Toolkit for C++ programing
+ * Copyright (C) 2004-2007, Anthony Lee, All Rights Reserved
+ *
+ * ETK++ library is a freeware; it may be used and distributed according to
+ * the terms of The MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+ * IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * File: handler-tokens-test.cpp
+ *
+ * --------------------------------------------------------------------------*/
+
+#include <kernel/Kernel.h>
+#include <kernel/Debug.h>
+#include <app/Handler.h>
+#include <app/Looper.h>
+#include <app/AppDefs.h>
+#include <app/Message.h>
+
+#define NUM_HANDLERS	1000000
+#define NUM_VIEWS	1000
+
+
+class CountHandler : public BHandler {
+public:
+	CountHandler(uint64 *count)
+		: BHandler(), fCount(count)
+	{
+	}
+
+	virtual void MessageReceived(BMessage *msg)
+	{
+		(*fCount)++;
+	}
+
+private:
+	uint64 *fCount;
+};
+
+
+int main(int argc, char **argv)
+{
+	bool ok = true;
+
+	ETK_OUTPUT("Creating and destroying %I32i handlers\n", NUM_HANDLERS);
+
+	bigtime_t t = system_time();
+	for (int32 i = 0; i < NUM_HANDLERS; i++) {
+		BHandler *handler = new BHandler();
+		delete handler;
+	}
+	t = system_time() - t;
+	ETK_OUTPUT("\tone at a time:      %I64i ns per handler\n", t * 1000 / NUM_HANDLERS);
+
+	// like the views of the windows, many of them alive together
+	BHandler **handlers = new BHandler*[NUM_VIEWS];
+	t = system_time();
+	for (int32 k = 0; k < NUM_HANDLERS / NUM_VIEWS; k++) {
+		for (int32 i = 0; i < NUM_VIEWS; i++) handlers[i] = new BHandler();
+		for (int32 i = 0; i < NUM_VIEWS; i++) delete handlers[i];
+	}
+	t = system_time() - t;
+	ETK_OUTPUT("\t%I32i at a time:    %I64i ns per handler\n", NUM_VIEWS, t * 1000 / NUM_HANDLERS);
+
+	// the message for a deleted handler must not reach the one taking its place
+	BLooper *looper = new BLooper("tokens looper");
+	looper->Run();
+	looper->Lock();
+
+	BHandler *handler = new BHandler();
+	looper->AddHandler(handler);
+	uint64 count = 0;
+	looper->PostMessage(B_PULSE, handler);
+	looper->RemoveHandler(handler);
+	delete handler;
+
+	CountHandler *next = new CountHandler(&count);
+	looper->AddHandler(next);
+	looper->Unlock();
+
+	looper->PostMessage(B_PULSE, next);
+	snooze(100000);
+	ok = (count == 1) && ok;
+
+	looper->Lock();
+	looper->RemoveHandler(next);
+	delete next;
+	looper->Quit();
+
+	delete[] handlers;
+
+	ETK_OUTPUT("Results: %s\n", ok ? "OK" : "MISMATCH");
+	return(ok ? 0 : 1);
+}
@@ -0,0 +1,109 @@
+/* --------------------------------------------------------------------------
+ *
+ * ETK++ --- The Easy Toolkit for C++ programing
+ * Copyright (C) 2004-2007, Anthony Lee, All Rights Reserved
+ *
+ * ETK++ library is a freeware; it may be used and distributed according to
+ * the terms of The MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+ * IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * File: looper-dispatch-test.cpp
+ *
+ * --------------------------------------------------------------------------*/
+
+#include <kernel/Kernel.h>
+#include <kernel/Debug.h>
+#include <app/Looper.h>
+#include <app/Message.h>
+
+#define NUM_MESSAGES	200000
+#define MSG_DISPATCH	'disp'
+#define MSG_DONE	'done'
+
+
+class EmptyLooper : public BLooper {
+public:
+	EmptyLooper()
+		: BLooper("empty looper"), fDone(create_sem(0, NULL))
+	{
+	}
+
+	virtual ~EmptyLooper()
+	{
+		delete_sem(fDone);
+	}
+
+	virtual void MessageReceived(BMessage *msg)
+	{
+		if (msg->what == MSG_DONE) release_sem(fDone);
+	}
+
+	void WaitForAll()
+	{
+		acquire_sem(fDone);
+	}
+
+private:
+	void *fDone;
+};
+
+
+int main(int argc, char **argv)
+{
+	EmptyLooper *looper = new EmptyLooper();
+	looper->Run();
+
+	BMessage *msgs[1024];
+	int32 batches[2] = {1, looper->DispatchBatch()};
+
+	ETK_OUTPUT("Dispatching %I32i messages to an empty MessageReceived()\n", NUM_MESSAGES);
+
+	for (int32 round = 0; round < 4; round++) {
+		// the queue fills up while the looper is locked, so only the dispatching gets timed
+		looper->Lock();
+		looper->SetDispatchBatch(batches[round % 2]);
+		for (int32 i = 0; i < NUM_MESSAGES; i += 1024) {
+			int32 count = min_c(1024, NUM_MESSAGES - i);
+			for (int32 k = 0; k < count; k++) msgs[k] = new BMessage(MSG_DISPATCH);
+			for (int32 k = 0; k < count; k++) looper->PostAdoptedMessage(msgs[k]);
+		}
+		looper->PostMessage(MSG_DONE);
+
+		bigtime_t t = system_time();
+		looper->Unlock();
+
+		// another thread wants the looper while the queue is still full
+		snooze(10000);
+		bigtime_t lockTime = system_time();
+		looper->Lock();
+		lockTime = system_time() - lockTime;
+		looper->Unlock();
+
+		looper->WaitForAll();
+		t = system_time() - t - 10000;
+
+		ETK_OUTPUT("\tbatch of %I32i: %I64i ns per message, Lock() waited %I64i us\n",
+			   batches[round % 2], t * 1000 / NUM_MESSAGES, lockTime);
+	}
+
+	looper->Lock();
+	looper->Quit();
+
+	return 0;
+}
@@ -0,0 +1,209 @@
+/* --------------------------------------------------------------------------
+ *
+ * ETK++ --- The Easy Toolkit for C++ programing
+ * Copyright (C) 2004-2007, Anthony Lee, All Rights Reserved
+ *
+ * ETK++ library is a freeware; it may be used and distributed according to
+ * the terms of The MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+ * IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * File: looper-lanes-test.cpp
+ *
+ * --------------------------------------------------------------------------*/
+
+#include <kernel/Kernel.h>
+#include <kernel/Debug.h>
+#include <app/AppDefs.h>
+#include <app/Looper.h>
+#include <app/Message.h>
+
+#define NUM_BULK		20000
+#define BULK_TIME		50
+#define NUM_KEYS		100
+#define KEY_INTERVAL		5000
+#define MSG_BULK		'bulk'
+#define MSG_DONE		'done'
+
+
+class LanesLooper : public BLooper {
+public:
+	LanesLooper()
+		: BLooper("lanes looper"), fDone(create_sem(0, NULL))
+	{
+		Reset();
+	}
+
+	virtual ~LanesLooper()
+	{
+		delete_sem(fDone);
+	}
+
+	void Reset()
+	{
+		fBulks = fKeys = fBulksPending = 0;
+		fLatency = fMaxLatency = 0;
+		fRun = fMaxRun = 0;
+	}
+
+	virtual void MessageReceived(BMessage *msg)
+	{
+		bigtime_t when = 0;
+
+		switch (msg->what) {
+			case MSG_BULK: {
+				fBulks++;
+				fBulksPending--;
+				fRun = 0;
+
+				// a handler crunching data
+				bigtime_t t = system_time();
+				while (system_time() - t < BULK_TIME);
+			}
+			break;
+
+			case B_KEY_DOWN:
+				fKeys++;
+				if (fBulksPending > 0 && ++fRun > fMaxRun) fMaxRun = fRun;
+
+				msg->FindInt64("when", &when);
+				when = system_time() - when;
+				fLatency += when;
+				if (when > fMaxLatency) fMaxLatency = when;
+				break;
+
+			case MSG_DONE:
+				release_sem(fDone);
+				break;
+
+			default:
+				BLooper::MessageReceived(msg);
+		}
+	}
+
+	void WaitForAll()
+	{
+		acquire_sem(fDone);
+	}
+
+	int32 fBulks;
+	int32 fBulksPending;
+	int32 fKeys;
+	bigtime_t fLatency;
+	bigtime_t fMaxLatency;
+
+	// key events handled in a row while bulk messages wait
+	int32 fRun;
+	int32 fMaxRun;
+
+private:
+	void *fDone;
+};
+
+
+static void post_bulk(BLooper *looper, int32 count, e_message_lane lane)
+{
+	for (int32 i = 0; i < count; i++) {
+		BMessage *msg = new BMessage(MSG_BULK);
+		msg->AddInt32("index", i);
+		msg->SetLane(lane);
+		looper->PostAdoptedMessage(msg);
+	}
+}
+
+
+// behind all the bulk messages
+static void post_done(BLooper *looper, e_message_lane lane)
+{
+	BMessage *msg = new BMessage(MSG_DONE);
+	msg->SetLane(lane);
+	looper->PostAdoptedMessage(msg);
+}
+
+
+static void post_key(BLooper *looper, e_message_lane lane)
+{
+	BMessage *msg = new BMessage(B_KEY_DOWN);
+	msg->AddString("bytes", "a");
+	msg->AddInt64("when", system_time());
+	msg->SetLane(lane);
+	looper->PostAdoptedMessage(msg);
+}
+
+
+// typing while the looper has a backlog of bulk work
+static bool type_over_bulk(LanesLooper *looper, bool lanes)
+{
+	e_message_lane lane = (lanes ? B_BACKGROUND_LANE : B_NORMAL_LANE);
+
+	looper->Reset();
+
+	post_bulk(looper, NUM_BULK, lane);
+	for (int32 i = 0; i < NUM_KEYS; i++) {
+		post_key(looper, lanes ? B_DEFAULT_LANE : B_NORMAL_LANE);
+		snooze(KEY_INTERVAL);
+	}
+	post_done(looper, lane);
+	looper->WaitForAll();
+
+	ETK_OUTPUT("\tlanes %s: key latency %I64ius average, %I64ius max\n",
+	           lanes ? "on " : "off",
+	           looper->fLatency / max_c(looper->fKeys, 1), looper->fMaxLatency);
+
+	return(looper->fKeys == NUM_KEYS && looper->fBulks == NUM_BULK);
+}
+
+
+// the bulk messages still get their turns while keys keep coming
+static bool bulk_under_keys(LanesLooper *looper)
+{
+	looper->Reset();
+
+	looper->Lock();
+	looper->fBulksPending = 100;
+	post_bulk(looper, 100, B_BACKGROUND_LANE);
+	for (int32 i = 0; i < 2000; i++) post_key(looper, B_DEFAULT_LANE);
+	post_done(looper, B_BACKGROUND_LANE);
+	looper->Unlock();
+	looper->WaitForAll();
+
+	ETK_OUTPUT("\tbulk messages under a key flood: at most %I32i keys in a row\n", looper->fMaxRun);
+
+	return(looper->fMaxRun <= 16 && looper->fBulks == 100);
+}
+
+
+int main(int argc, char **argv)
+{
+	bool ok = true;
+
+	LanesLooper *looper = new LanesLooper();
+	looper->Run();
+
+	ETK_OUTPUT("Typing over %I32i bulk messages taking %I32ius each\n", NUM_BULK, BULK_TIME);
+
+	ok = type_over_bulk(looper, false) && ok;
+	ok = type_over_bulk(looper, true) && ok;
+	ok = bulk_under_keys(looper) && ok;
+
+	looper->Lock();
+	looper->Quit();
+
+	ETK_OUTPUT("Results: %s\n", ok ? "OK" : "MISMATCH");
+	return(ok ? 0 : 1);
+}
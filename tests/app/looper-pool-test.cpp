@@ -0,0 +1,161 @@
+/* --------------------------------------------------------------------------
+ *
+ * ETK++ --- The Easy Toolkit for C++ programing
+ * Copyright (C) 2004-2007, Anthony Lee, All Rights Reserved
+ *
+ * ETK++ library is a freeware; it may be used and distributed according to
+ * the terms of The MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+ * IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * File: looper-pool-test.cpp
+ *
+ * --------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+#include <kernel/Kernel.h>
+#include <kernel/Debug.h>
+#include <app/Looper.h>
+#include <app/Messenger.h>
+#include <app/Message.h>
+
+#define NUM_LOOPERS	1000
+#define NUM_MESSAGES	100
+#define MSG_UPDATE	'updt'
+
+
+// stands for a document, checks that its messages come in order
+class DocumentLooper : public BLooper {
+public:
+	DocumentLooper(void *done)
+		: BLooper("document looper"), fCount(0), fValue(0), fInOrder(true), fDone(done)
+	{
+	}
+
+	virtual void MessageReceived(BMessage *msg)
+	{
+		int32 seq = -1;
+		if (msg->what != MSG_UPDATE || msg->FindInt32("seq", &seq) == false) {
+			BLooper::MessageReceived(msg);
+			return;
+		}
+
+		if (seq != fCount || CurrentMessage() != msg || LooperForThread(Thread()) != this) fInOrder = false;
+		if (++fCount == NUM_MESSAGES) release_sem(fDone);
+	}
+
+	int32 fCount;
+	int32 fValue;
+	bool fInOrder;
+	void *fDone;
+};
+
+
+// the memory of the process in KB, 0 when unknown
+static int64 memory_size(bool resident)
+{
+	long pages = 0, residentPages = 0;
+	FILE *f = fopen("/proc/self/statm", "r");
+	if (f == NULL) return 0;
+	if (fscanf(f, "%ld %ld", &pages, &residentPages) != 2) pages = residentPages = 0;
+	fclose(f);
+	return((int64)(resident ? residentPages : pages) * 4);
+}
+
+
+static int64 context_switches()
+{
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+	return((int64)usage.ru_nvcsw + (int64)usage.ru_nivcsw);
+}
+
+
+static bool run_loopers(bool pooled)
+{
+	bool ok = true;
+	DocumentLooper **loopers = new DocumentLooper*[NUM_LOOPERS];
+	void *done = create_sem(0, NULL);
+
+	int64 vm = memory_size(false), rss = memory_size(true);
+	for (int32 i = 0; i < NUM_LOOPERS; i++) {
+		loopers[i] = new DocumentLooper(done);
+		if (pooled ? loopers[i]->RunPooled() == false : loopers[i]->Run() == NULL) ok = false;
+	}
+	vm = memory_size(false) - vm;
+	rss = memory_size(true) - rss;
+
+	int64 switches = context_switches();
+	bigtime_t t = system_time();
+
+	BMessage msg(MSG_UPDATE);
+	msg.AddInt32("seq", 0);
+	for (int32 k = 0; k < NUM_MESSAGES; k++) {
+		msg.ReplaceInt32("seq", k);
+		for (int32 i = 0; i < NUM_LOOPERS; i++) {
+			BMessenger msgr(loopers[i]);
+			if (msgr.SendMessage(&msg) != B_OK) ok = false;
+
+			// the lock keeps the pool off the looper
+			if ((k & 15) == 0 && loopers[i]->Lock()) {
+				int32 count = loopers[i]->fCount;
+				loopers[i]->fValue++;
+				if (loopers[i]->fCount != count) ok = false;
+				loopers[i]->Unlock();
+			}
+		}
+	}
+	for (int32 i = 0; i < NUM_LOOPERS; i++) acquire_sem(done);
+
+	t = system_time() - t;
+	switches = context_switches() - switches;
+
+	for (int32 i = 0; i < NUM_LOOPERS; i++) {
+		loopers[i]->Lock();
+		if (loopers[i]->fCount != NUM_MESSAGES || loopers[i]->fValue != (NUM_MESSAGES + 15) / 16 ||
+		        loopers[i]->fInOrder == false) ok = false;
+		loopers[i]->Quit();
+	}
+
+	ETK_OUTPUT("\t%s: %I64i KB virtual, %I64i KB resident, %I64i messages/s, %I64i context switches\n",
+	           pooled ? "pooled" : "own threads", vm, rss,
+	           (int64)NUM_LOOPERS * NUM_MESSAGES * 1000000 / max_c(t, 1), switches);
+
+	delete_sem(done);
+	delete[] loopers;
+
+	return ok;
+}
+
+
+int main(int argc, char **argv)
+{
+	bool ok = true;
+
+	ETK_OUTPUT("Running %I32i loopers\n", NUM_LOOPERS);
+
+	// the pooled ones first, the memory freed by the others would be reused
+	ok = run_loopers(true) && ok;
+	ok = run_loopers(false) && ok;
+
+	ETK_OUTPUT("Results: %s\n", ok ? "OK" : "MISMATCH");
+	return(ok ? 0 : 1);
+}
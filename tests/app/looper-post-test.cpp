@@ -0,0 +1,158 @@
+/* --------------------------------------------------------------------------
+ *
+ * ETK++ --- The Easy Toolkit for C++ programing
+ * Copyright (C) 2004-2007, Anthony Lee, All Rights Reserved
+ *
+ * ETK++ library is a freeware; it may be used and distributed according to
+ * the terms of The MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+ * IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * File: looper-post-test.cpp
+ *
+ * --------------------------------------------------------------------------*/
+
+#include <kernel/Kernel.h>
+#include <kernel/Debug.h>
+#include <app/Looper.h>
+#include <app/Message.h>
+
+#define NUM_MESSAGES	100000
+#define MSG_POST_TEST	'post'
+
+
+class PostLooper : public BLooper {
+public:
+	PostLooper()
+		: BLooper("post looper"), fCount(0), fSum(0), fDone(create_sem(0, NULL))
+	{
+	}
+
+	virtual ~PostLooper()
+	{
+		delete_sem(fDone);
+	}
+
+	virtual void MessageReceived(BMessage *msg)
+	{
+		if (msg->what != MSG_POST_TEST) {
+			BLooper::MessageReceived(msg);
+			return;
+		}
+
+		int32 index = 0;
+		msg->FindInt32("index", &index);
+		fSum += index;
+
+		if (++fCount == NUM_MESSAGES) {
+			fCount = 0;
+			release_sem(fDone);
+		}
+	}
+
+	int64 WaitForAll()
+	{
+		acquire_sem(fDone);
+		int64 sum = fSum;
+		fSum = 0;
+		return sum;
+	}
+
+private:
+	int32 fCount;
+	int64 fSum;
+	void *fDone;
+};
+
+
+// the ten fields of one message
+static void build_message(BMessage *msg, int32 index)
+{
+	msg->AddInt32("index", index);
+	msg->AddInt64("when", (int64)index * 1000);
+	msg->AddPoint("where", BPoint(index, 1));
+	msg->AddPoint("screen_where", BPoint(index, 2));
+	msg->AddInt32("buttons", 1);
+	msg->AddInt32("modifiers", 0);
+	msg->AddInt32("clicks", 1);
+	msg->AddFloat("pressure", 0.5f);
+	msg->AddString("source", "looper-post-test");
+	msg->AddBool("etk:msg_from_gui", true);
+}
+
+
+int main(int argc, char **argv)
+{
+	bool ok = true;
+	int64 expected = (int64)NUM_MESSAGES * (NUM_MESSAGES - 1) / 2;
+
+	PostLooper *looper = new PostLooper();
+	looper->Run();
+
+	ETK_OUTPUT("Posting %I32i messages of ten fields\n", NUM_MESSAGES);
+
+	bigtime_t t = system_time();
+	for (int32 i = 0; i < NUM_MESSAGES; i++) {
+		BMessage msg(MSG_POST_TEST);
+		build_message(&msg, i);
+		looper->PostMessage(&msg);
+	}
+	bigtime_t posted = system_time() - t;
+	ok = (looper->WaitForAll() == expected) && ok;
+	t = system_time() - t;
+	ETK_OUTPUT("\tPostMessage():        %I64i ns per post, %I64i messages/s delivered\n",
+	           posted * 1000 / NUM_MESSAGES, (int64)NUM_MESSAGES * 1000000 / max_c(t, 1));
+
+	t = system_time();
+	for (int32 i = 0; i < NUM_MESSAGES; i++) {
+		BMessage *msg = new BMessage(MSG_POST_TEST);
+		build_message(msg, i);
+		looper->PostAdoptedMessage(msg);
+	}
+	posted = system_time() - t;
+	ok = (looper->WaitForAll() == expected) && ok;
+	t = system_time() - t;
+	ETK_OUTPUT("\tPostAdoptedMessage(): %I64i ns per post, %I64i messages/s delivered\n",
+	           posted * 1000 / NUM_MESSAGES, (int64)NUM_MESSAGES * 1000000 / max_c(t, 1));
+
+	// the copies share the fields, only "index" gets replaced on the way
+	BMessage msg(MSG_POST_TEST);
+	build_message(&msg, 0);
+	t = system_time();
+	for (int32 i = 0; i < NUM_MESSAGES; i++) {
+		msg.ReplaceInt32("index", i);
+		looper->PostMessage(&msg);
+	}
+	posted = system_time() - t;
+	ok = (looper->WaitForAll() == expected) && ok;
+	t = system_time() - t;
+	ETK_OUTPUT("\tPostMessage(), reused: %I64i ns per post, %I64i messages/s delivered\n",
+	           posted * 1000 / NUM_MESSAGES, (int64)NUM_MESSAGES * 1000000 / max_c(t, 1));
+
+	BMessage copy(msg);
+	int32 a = 0, b = 0;
+	ok = (copy.ReplaceInt32("index", -1) &&
+	      msg.FindInt32("index", &a) && a == NUM_MESSAGES - 1 &&
+	      copy.FindInt32("index", &b) && b == -1) && ok;
+
+	looper->Lock();
+	looper->Quit();
+
+	ETK_OUTPUT("Results: %s\n", ok ? "OK" : "MISMATCH");
+	return(ok ? 0 : 1);
+}
@@ -0,0 +1,170 @@
+/* --------------------------------------------------------------------------
+ *
+ * ETK++ --- The Easy Toolkit for C++ programing
+ * Copyright (C) 2004-2007, Anthony Lee, All Rights Reserved
+ *
+ * ETK++ library is a freeware; it may be used and distributed according to
+ * the terms of The MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+ * IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * File: looper-producers-test.cpp
+ *
+ * --------------------------------------------------------------------------*/
+
+#include <kernel/Kernel.h>
+#include <kernel/Debug.h>
+#include <app/Looper.h>
+#include <app/Message.h>
+
+#define NUM_MESSAGES	160000
+#define MAX_PRODUCERS	16
+#define MSG_POST_TEST	'post'
+
+
+class CountLooper : public BLooper {
+public:
+	CountLooper()
+		: BLooper("count looper"), fCount(0), fTotal(0), fDisorders(0), fDone(create_sem(0, NULL))
+	{
+	}
+
+	virtual ~CountLooper()
+	{
+		delete_sem(fDone);
+	}
+
+	void Reset(int32 total)
+	{
+		for (int32 i = 0; i < MAX_PRODUCERS; i++) fNext[i] = 0;
+		fCount = 0;
+		fTotal = total;
+		fDisorders = 0;
+	}
+
+	virtual void MessageReceived(BMessage *msg)
+	{
+		if (msg->what != MSG_POST_TEST) {
+			BLooper::MessageReceived(msg);
+			return;
+		}
+
+		int32 producer = 0, seq = 0;
+		msg->FindInt32("producer", &producer);
+		msg->FindInt32("seq", &seq);
+
+		// each producer's messages come in the order they were posted
+		if (producer < 0 || producer >= MAX_PRODUCERS || seq != fNext[producer]) fDisorders++;
+		else fNext[producer]++;
+
+		if (++fCount == fTotal) release_sem(fDone);
+	}
+
+	int32 WaitForAll()
+	{
+		acquire_sem(fDone);
+		return fDisorders;
+	}
+
+private:
+	int32 fNext[MAX_PRODUCERS];
+	int32 fCount;
+	int32 fTotal;
+	int32 fDisorders;
+	void *fDone;
+};
+
+
+static CountLooper *looper = NULL;
+static int32 producersCount = 0;
+static void *startSem = NULL;
+
+
+static status_t producer_func(void *data)
+{
+	int32 producer = (int32)(long)data;
+	int32 count = NUM_MESSAGES / producersCount;
+
+	acquire_sem(startSem);
+
+	for (int32 i = 0; i < count; i++) {
+		BMessage *msg = new BMessage(MSG_POST_TEST);
+		msg->AddInt32("producer", producer);
+		msg->AddInt32("seq", i);
+		looper->PostAdoptedMessage(msg);
+	}
+
+	return B_OK;
+}
+
+
+static bool run_producers(int32 count)
+{
+	void *threads[MAX_PRODUCERS];
+
+	producersCount = count;
+	looper->Reset(NUM_MESSAGES);
+
+	for (int32 i = 0; i < count; i++) {
+		threads[i] = create_thread(producer_func, B_NORMAL_PRIORITY, (void*)(long)i, NULL);
+		resume_thread(threads[i]);
+	}
+
+	bigtime_t t = system_time();
+	release_sem_etc(startSem, count, 0);
+
+	for (int32 i = 0; i < count; i++) {
+		status_t status;
+		wait_for_thread(threads[i], &status);
+		delete_thread(threads[i]);
+	}
+	bigtime_t posted = system_time() - t;
+
+	int32 disorders = looper->WaitForAll();
+	t = system_time() - t;
+
+	ETK_OUTPUT("\t%I32i producer(s): %I64i posts/s, %I64i messages/s delivered, %I32i out of order\n",
+	           count, (int64)NUM_MESSAGES * 1000000 / max_c(posted, 1),
+	           (int64)NUM_MESSAGES * 1000000 / max_c(t, 1), disorders);
+
+	return(disorders == 0);
+}
+
+
+int main(int argc, char **argv)
+{
+	bool ok = true;
+
+	startSem = create_sem(0, NULL);
+	looper = new CountLooper();
+	looper->Run();
+
+	ETK_OUTPUT("Posting %I32i messages to one looper\n", NUM_MESSAGES);
+
+	ok = run_producers(1) && ok;
+	ok = run_producers(4) && ok;
+	ok = run_producers(16) && ok;
+
+	looper->Lock();
+	looper->Quit();
+
+	delete_sem(startSem);
+
+	ETK_OUTPUT("Results: %s\n", ok ? "OK" : "MISMATCH");
+	return(ok ? 0 : 1);
+}
@@ -0,0 +1,166 @@
+/* --------------------------------------------------------------------------
+ *
+ * ETK++ --- The Easy Toolkit for C++ programing
+ * Copyright (C) 2004-2007, Anthony Lee, All Rights Reserved
+ *
+ * ETK++ library is a freeware; it may be used and distributed according to
+ * the terms of The MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+ * IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * File: looper-windows-test.cpp
+ *
+ * --------------------------------------------------------------------------*/
+
+#include <kernel/Kernel.h>
+#include <kernel/Debug.h>
+#include <app/Looper.h>
+#include <app/Messenger.h>
+#include <app/Message.h>
+
+#define NUM_UPDATES	64000
+#define MAX_WINDOWS	32
+#define MSG_UPDATE	'updt'
+
+
+// stands for a window, one thread updates it from outside
+class WindowLooper : public BLooper {
+public:
+	WindowLooper()
+		: BLooper("window looper"), fCount(0), fTotal(0), fValue(0), fDone(create_sem(0, NULL))
+	{
+	}
+
+	virtual ~WindowLooper()
+	{
+		delete_sem(fDone);
+	}
+
+	void Reset(int32 total)
+	{
+		fCount = 0;
+		fTotal = total;
+	}
+
+	virtual void MessageReceived(BMessage *msg)
+	{
+		if (msg->what != MSG_UPDATE) {
+			BLooper::MessageReceived(msg);
+			return;
+		}
+
+		if (++fCount == fTotal) release_sem(fDone);
+	}
+
+	void WaitForAll()
+	{
+		acquire_sem(fDone);
+	}
+
+	int32 fCount;
+	int32 fTotal;
+	int32 fValue;
+	void *fDone;
+};
+
+
+static WindowLooper *windows[MAX_WINDOWS];
+static int32 windowsCount = 0;
+static void *startSem = NULL;
+
+
+// posts the updates through a messenger and changes the window under its lock now and then
+static status_t updater_func(void *data)
+{
+	WindowLooper *window = windows[(int32)(long)data];
+	BMessenger msgr(window, window);
+	int32 count = NUM_UPDATES / windowsCount;
+
+	acquire_sem(startSem);
+
+	BMessage msg(MSG_UPDATE);
+	for (int32 i = 0; i < count; i++) {
+		msgr.SendMessage(&msg);
+
+		if ((i & 7) == 0 && window->Lock()) {
+			window->fValue++;
+			window->Unlock();
+		}
+	}
+
+	return B_OK;
+}
+
+
+static bool run_windows(int32 count)
+{
+	void *threads[MAX_WINDOWS];
+
+	windowsCount = count;
+	for (int32 i = 0; i < count; i++) {
+		windows[i]->Reset(NUM_UPDATES / count);
+		windows[i]->fValue = 0;
+		threads[i] = create_thread(updater_func, B_NORMAL_PRIORITY, (void*)(long)i, NULL);
+		resume_thread(threads[i]);
+	}
+
+	bigtime_t t = system_time();
+	release_sem_etc(startSem, count, 0);
+
+	for (int32 i = 0; i < count; i++) {
+		status_t status;
+		wait_for_thread(threads[i], &status);
+		delete_thread(threads[i]);
+	}
+	for (int32 i = 0; i < count; i++) windows[i]->WaitForAll();
+	t = system_time() - t;
+
+	bool ok = true;
+	for (int32 i = 0; i < count; i++) {
+		int32 expected = (NUM_UPDATES / count + 7) / 8;
+		if (windows[i]->fCount != NUM_UPDATES / count || windows[i]->fValue != expected) ok = false;
+	}
+
+	ETK_OUTPUT("\t%I32i windows: %I64i updates/s\n", count, (int64)(NUM_UPDATES / count) * count * 1000000 / max_c(t, 1));
+	return ok;
+}
+
+
+int main(int argc, char **argv)
+{
+	bool ok = true;
+
+	startSem = create_sem(0, NULL);
+	for (int32 i = 0; i < MAX_WINDOWS; i++) {
+		windows[i] = new WindowLooper();
+		windows[i]->Run();
+	}
+
+	ETK_OUTPUT("Updating windows concurrently, one thread each\n");
+
+	for (int32 count = 1; count <= MAX_WINDOWS; count *= 2) ok = run_windows(count) && ok;
+
+	for (int32 i = 0; i < MAX_WINDOWS; i++) {
+		windows[i]->Lock();
+		windows[i]->Quit();
+	}
+	delete_sem(startSem);
+
+	ETK_OUTPUT("Results: %s\n", ok ? "OK" : "MISMATCH");
+	return(ok ? 0 : 1);
+}
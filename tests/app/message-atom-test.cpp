@@ -0,0 +1,123 @@
+/* --------------------------------------------------------------------------
+ *
+ * ETK++ --- The Easy Toolkit for C++ programing
+ * Copyright (C) 2004-2007, Anthony Lee, All Rights Reserved
+ *
+ * ETK++ library is a freeware; it may be used and distributed according to
+ * the terms of The MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+ * IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * File: message-atom-test.cpp
+ *
+ * --------------------------------------------------------------------------*/
+
+#include <string.h>
+
+#include <kernel/OS.h>
+#include <kernel/Debug.h>
+#include <app/Message.h>
+#include <app/AppDefs.h>
+
+#define NUM_ROUNDS	1000000
+
+
+static const BMessageAtom atomWhen("when");
+static const BMessageAtom atomWhere("where");
+static const BMessageAtom atomScreenWhere("screen_where");
+static const BMessageAtom atomButtons("buttons");
+static const BMessageAtom atomModifiers("modifiers");
+
+
+int main(int argc, char **argv)
+{
+	bool ok = true;
+	float sum = 0, sum2 = 0;
+
+	ETK_OUTPUT("Building and reading %I32i mouse-moved messages\n", NUM_ROUNDS);
+
+	bigtime_t t = e_system_time();
+	for (int32 i = 0; i < NUM_ROUNDS; i++) {
+		BMessage msg(B_MOUSE_MOVED);
+		msg.AddInt64("when", i);
+		msg.AddPoint("where", BPoint(i, 1));
+		msg.AddPoint("screen_where", BPoint(i, 2));
+		msg.AddInt32("buttons", 1);
+		msg.AddInt32("modifiers", 0);
+
+		BPoint where;
+		int32 buttons = 0;
+		bigtime_t when = 0;
+		msg.FindPoint("where", &where);
+		msg.FindInt32("buttons", &buttons);
+		msg.FindInt64("when", &when);
+		msg.ReplacePoint("where", where + BPoint(0, 1));
+		msg.FindPoint("where", &where);
+		sum += where.y + buttons + (float)(when & 1);
+	}
+	ETK_OUTPUT("\tnames: %I64i us\n", e_system_time() - t);
+
+	t = e_system_time();
+	for (int32 i = 0; i < NUM_ROUNDS; i++) {
+		BMessage msg(B_MOUSE_MOVED);
+		msg.AddInt64(atomWhen, i);
+		msg.AddPoint(atomWhere, BPoint(i, 1));
+		msg.AddPoint(atomScreenWhere, BPoint(i, 2));
+		msg.AddInt32(atomButtons, 1);
+		msg.AddInt32(atomModifiers, 0);
+
+		BPoint where;
+		int32 buttons = 0;
+		bigtime_t when = 0;
+		msg.FindPoint(atomWhere, &where);
+		msg.FindInt32(atomButtons, &buttons);
+		msg.FindInt64(atomWhen, &when);
+		msg.ReplacePoint(atomWhere, where + BPoint(0, 1));
+		msg.FindPoint(atomWhere, &where);
+		sum2 += where.y + buttons + (float)(when & 1);
+	}
+	ETK_OUTPUT("\tatoms: %I64i us\n", e_system_time() - t);
+
+	ok = (sum == sum2) && ok;
+
+	// the same names whichever way they got added or looked up
+	ok = (BMessageAtom("where") == atomWhere && strcmp(atomWhere.Name(), "where") == 0) && ok;
+	ok = (BMessageAtom() != atomWhere && BMessageAtom().IsValid() == false) && ok;
+
+	BMessage msg(B_MOUSE_DOWN);
+	msg.AddInt32(atomButtons, 2);
+	msg.AddInt32("clicks", 1);
+	msg.AddPoint("where", BPoint(3, 4));
+
+	int32 buttons = 0, clicks = 0;
+	BPoint where;
+	ok = msg.FindInt32("buttons", &buttons) && buttons == 2 && ok;
+	ok = msg.FindInt32(BMessageAtom("clicks"), &clicks) && clicks == 1 && ok;
+	ok = msg.FindPoint(atomWhere, &where) && where == BPoint(3, 4) && ok;
+	ok = (msg.AddInt32("buttons", 4) && msg.CountItems(atomButtons.Name(), B_INT32_TYPE) == 2) && ok;
+	ok = (msg.AddFloat(atomButtons, 1.f) == false) && ok;
+
+	BMessage copy(msg);
+	ok = copy.FindInt32(atomButtons, 1, &buttons) && buttons == 4 && ok;
+	ok = copy.Rename("buttons", "old_buttons") && copy.HasInt32("buttons") == false && ok;
+	ok = copy.FindInt32(BMessageAtom("old_buttons"), &buttons) && buttons == 2 && ok;
+	ok = (copy.FindInt32(atomButtons, &buttons) == false) && ok;
+
+	ETK_OUTPUT("Results: %s\n", ok ? "OK" : "MISMATCH");
+	return(ok ? 0 : 1);
+}
@@ -0,0 +1,194 @@
+/* --------------------------------------------------------------------------
+ *
+ * ETK++ --- The Easy Toolkit for C++ programing
+ * Copyright (C) 2004-2007, Anthony Lee, All Rights Reserved
+ *
+ * ETK++ library is a freeware; it may be used and distributed according to
+ * the terms of The MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+ * IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * File: message-coalescing-test.cpp
+ *
+ * --------------------------------------------------------------------------*/
+
+#include <kernel/Kernel.h>
+#include <kernel/Debug.h>
+#include <app/AppDefs.h>
+#include <app/Looper.h>
+#include <app/Message.h>
+
+#define NUM_MOVES		20000
+#define MOVES_PER_CLICK		1000
+#define HANDLING_TIME		50
+#define MSG_FLOOD_DONE		'done'
+
+
+class InputLooper : public BLooper {
+public:
+	InputLooper()
+		: BLooper("input looper"), fDone(create_sem(0, NULL))
+	{
+		Reset();
+	}
+
+	virtual ~InputLooper()
+	{
+		delete_sem(fDone);
+	}
+
+	void Reset()
+	{
+		fMoves = fClicks = fDisorders = 0;
+		fLastIndex = -1;
+		fButtons = 0;
+		fMaxDepth = 0;
+		fLatency = fMaxLatency = 0;
+	}
+
+	virtual void MessageReceived(BMessage *msg)
+	{
+		int32 index = -1, buttons = 0;
+		bigtime_t when = 0;
+
+		switch (msg->what) {
+			case B_MOUSE_MOVED:
+			case B_MOUSE_DOWN:
+			case B_MOUSE_UP:
+				break;
+
+			case MSG_FLOOD_DONE:
+				release_sem(fDone);
+				return;
+
+			default:
+				BLooper::MessageReceived(msg);
+				return;
+		}
+
+		msg->FindInt32("index", &index);
+		msg->FindInt32("buttons", &buttons);
+		msg->FindInt64("when", &when);
+
+		// nothing gets ahead of what was posted before it
+		if (index <= fLastIndex) fDisorders++;
+		fLastIndex = index;
+
+		if (msg->what == B_MOUSE_MOVED) {
+			fMoves++;
+			if (buttons != fButtons) fDisorders++;
+		} else {
+			fClicks++;
+			if ((msg->what == B_MOUSE_DOWN) != (fButtons == 0)) fDisorders++;
+			fButtons = (msg->what == B_MOUSE_DOWN ? 1 : 0);
+		}
+
+		bigtime_t latency = system_time() - when;
+		fLatency += latency;
+		if (latency > fMaxLatency) fMaxLatency = latency;
+
+		MessageQueue()->Lock();
+		int32 depth = MessageQueue()->CountMessages();
+		MessageQueue()->Unlock();
+		if (depth > fMaxDepth) fMaxDepth = depth;
+
+		// a handler drawing on every move
+		bigtime_t t = system_time();
+		while (system_time() - t < HANDLING_TIME);
+	}
+
+	void WaitForAll()
+	{
+		acquire_sem(fDone);
+	}
+
+	int32 fMoves;
+	int32 fClicks;
+	int32 fDisorders;
+	int32 fLastIndex;
+	int32 fButtons;
+	int32 fMaxDepth;
+	bigtime_t fLatency;
+	bigtime_t fMaxLatency;
+
+private:
+	void *fDone;
+};
+
+
+static void post_input(BLooper *looper, uint32 what, int32 index, int32 buttons)
+{
+	BMessage *msg = new BMessage(what);
+	msg->AddInt32("index", index);
+	msg->AddInt32("buttons", buttons);
+	msg->AddPoint("where", BPoint(index % 640, index % 480));
+	msg->AddInt64("when", system_time());
+	looper->PostAdoptedMessage(msg);
+}
+
+
+static bool flood(InputLooper *looper, bool coalescing)
+{
+	if (coalescing) looper->MessageQueue()->SetCoalescing(B_MOUSE_MOVED);
+	else looper->MessageQueue()->UnsetCoalescing(B_MOUSE_MOVED);
+
+	looper->Reset();
+
+	int32 index = 0, buttons = 0, clicks = 0;
+	for (int32 i = 0; i < NUM_MOVES; i++) {
+		if (i % MOVES_PER_CLICK == 0) {
+			post_input(looper, buttons == 0 ? B_MOUSE_DOWN : B_MOUSE_UP, index++, buttons);
+			buttons = (buttons == 0 ? 1 : 0);
+			clicks++;
+		}
+		post_input(looper, B_MOUSE_MOVED, index++, buttons);
+	}
+
+	// the moves are in the input lane, see BMessageQueue::SetLane()
+	BMessage *msg = new BMessage(MSG_FLOOD_DONE);
+	msg->SetLane(B_INPUT_LANE);
+	looper->PostAdoptedMessage(msg);
+	looper->WaitForAll();
+
+	int32 handled = looper->fMoves + looper->fClicks;
+	ETK_OUTPUT("\tcoalescing %s: %I32i of %I32i moves handled, max depth %I32i, latency %I64ius average %I64ius max\n",
+	           coalescing ? "on " : "off", looper->fMoves, NUM_MOVES, looper->fMaxDepth,
+	           looper->fLatency / max_c(handled, 1), looper->fMaxLatency);
+
+	return(looper->fDisorders == 0 && looper->fClicks == clicks && looper->fLastIndex == index - 1);
+}
+
+
+int main(int argc, char **argv)
+{
+	bool ok = true;
+
+	InputLooper *looper = new InputLooper();
+	looper->Run();
+
+	ETK_OUTPUT("Flooding a looper with %I32i mouse moves, %I32ius to handle each\n", NUM_MOVES, HANDLING_TIME);
+
+	ok = flood(looper, false) && ok;
+	ok = flood(looper, true) && ok;
+
+	looper->Lock();
+	looper->Quit();
+
+	ETK_OUTPUT("Results: %s\n", ok ? "OK" : "MISMATCH");
+	return(ok ? 0 : 1);
+}
@@ -0,0 +1,220 @@
+/* --------------------------------------------------------------------------
+ *
+ * ETK++ --- The Easy Toolkit for C++ programing
+ * Copyright (C) 2004-2007, Anthony Lee, All Rights Reserved
+ *
+ * ETK++ library is a freeware; it may be used and distributed according to
+ * the terms of The MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+ * IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * File: message-pool-test.cpp
+ *
+ * --------------------------------------------------------------------------*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include <kernel/Kernel.h>
+#include <kernel/Debug.h>
+#include <app/Message.h>
+#include <app/AppDefs.h>
+
+#define NUM_MESSAGES	100000
+#define BATCH_SIZE	100
+#define NUM_FOREIGN	200	// short-lived threads not spawned by the kit
+
+
+#if defined(__GLIBC__) && !defined(ETK_BUILD_WITH_MEMORY_TRACING)
+// counts the calls to malloc() of the whole process, and the blocks not freed
+static int32 malloc_calls = 0;
+static int32 live_blocks = 0;
+
+extern "C" {
+	extern void *__libc_malloc(size_t size);
+	extern void *__libc_calloc(size_t nmemb, size_t size);
+	extern void *__libc_realloc(void *ptr, size_t size);
+	extern void __libc_free(void *ptr);
+
+	void *malloc(size_t size) {__sync_fetch_and_add(&malloc_calls, 1); __sync_fetch_and_add(&live_blocks, 1); return __libc_malloc(size);}
+	void *calloc(size_t nmemb, size_t size) {__sync_fetch_and_add(&malloc_calls, 1); __sync_fetch_and_add(&live_blocks, 1); return __libc_calloc(nmemb, size);}
+	void *realloc(void *ptr, size_t size)
+	{
+		__sync_fetch_and_add(&malloc_calls, 1);
+		if (ptr == NULL) __sync_fetch_and_add(&live_blocks, 1);
+		return __libc_realloc(ptr, size);
+	}
+	void free(void *ptr) {if (ptr != NULL) __sync_fetch_and_sub(&live_blocks, 1); __libc_free(ptr);}
+}
+#define MALLOC_CALLS()	__sync_fetch_and_add(&malloc_calls, 0)
+#define LIVE_BLOCKS()	__sync_fetch_and_add(&live_blocks, 0)
+#else
+#define MALLOC_CALLS()	0
+#define LIVE_BLOCKS()	0
+#endif
+
+
+static BMessage* make_event(int32 i)
+{
+	BMessage *msg = new BMessage(B_MOUSE_MOVED);
+	msg->AddInt64("when", i);
+	msg->AddPoint("where", BPoint(i, 1));
+	msg->AddPoint("screen_where", BPoint(i, 2));
+	msg->AddInt32("buttons", 1);
+	msg->AddInt32("modifiers", 0);
+	return msg;
+}
+
+
+static bool check_event(const BMessage *msg, int32 i)
+{
+	int64 when = -1;
+	BPoint where;
+	return(msg->what == B_MOUSE_MOVED &&
+	       msg->FindInt64("when", &when) && when == i &&
+	       msg->FindPoint("screen_where", &where) && where == BPoint(i, 2));
+}
+
+
+static BMessage *batch[BATCH_SIZE];
+static void *batchFull = NULL;
+static void *batchEmpty = NULL;
+
+
+static status_t producer(void*)
+{
+	for (int32 i = 0; i < NUM_MESSAGES; i += BATCH_SIZE) {
+		acquire_sem(batchEmpty);
+		for (int32 k = 0; k < BATCH_SIZE; k++) batch[k] = make_event(i + k);
+		release_sem(batchFull);
+	}
+	return B_OK;
+}
+
+
+static void* foreign_thread(void *arg)
+{
+	bool *ok = (bool*)arg;
+	BMessage *msgs[BATCH_SIZE];
+
+	for (int32 k = 0; k < BATCH_SIZE; k++) msgs[k] = make_event(k);
+	for (int32 k = 0; k < BATCH_SIZE; k++) {
+		if (!check_event(msgs[k], k)) *ok = false;
+		delete msgs[k];
+	}
+	return NULL;
+}
+
+
+// the chunks cached by the threads not spawned by the kit must be given back on exit
+static int32 run_foreign_threads(int32 count, bool *ok)
+{
+	int32 blocks = LIVE_BLOCKS();
+
+	for (int32 i = 0; i < count; i++) {
+		pthread_t thread;
+		if (pthread_create(&thread, NULL, foreign_thread, ok) != 0) ETK_ERROR("Unable to create the thread!");
+		pthread_join(thread, NULL);
+	}
+
+	return(LIVE_BLOCKS() - blocks);
+}
+
+
+static void report(const char *what, int32 calls, bigtime_t t)
+{
+	ETK_OUTPUT("\t%s: %I32i malloc calls (%I64i per 1000 messages), %I64i messages/s\n",
+	           what, calls, (int64)calls * 1000 / NUM_MESSAGES, (int64)NUM_MESSAGES * 1000000 / max_c(t, 1));
+}
+
+
+int main(int argc, char **argv)
+{
+	bool ok = true;
+
+	ETK_OUTPUT("Churning %I32i mouse-moved messages\n", NUM_MESSAGES);
+
+	// fills the pools first
+	for (int32 i = 0; i < BATCH_SIZE; i++) delete make_event(i);
+
+	// created, posted as a copy and dispatched by the same thread
+	int32 calls = MALLOC_CALLS();
+	bigtime_t t = e_system_time();
+	for (int32 i = 0; i < NUM_MESSAGES; i++) {
+		BMessage *msg = make_event(i);
+		BMessage *posted = new BMessage(*msg);
+		delete msg;
+		ok = check_event(posted, i) && ok;
+		delete posted;
+	}
+	t = e_system_time() - t;
+	report("one thread", MALLOC_CALLS() - calls, t);
+
+	// sent through a port, the buffer gets unflattened by the receiver
+	calls = MALLOC_CALLS();
+	t = e_system_time();
+	for (int32 i = 0; i < NUM_MESSAGES; i++) {
+		char buffer[1024];
+		BMessage *msg = make_event(i);
+		size_t size = msg->FlattenedSize();
+		ok = (size <= sizeof(buffer) && msg->Flatten(buffer, size)) && ok;
+		delete msg;
+
+		BMessage *received = new BMessage();
+		ok = received->Unflatten(buffer, size) && check_event(received, i) && ok;
+		delete received;
+	}
+	t = e_system_time() - t;
+	report("flattened", MALLOC_CALLS() - calls, t);
+
+	// created by one thread and freed by another one
+	batchFull = create_sem(0, NULL);
+	batchEmpty = create_sem(1, NULL);
+	void *thread = create_thread(producer, B_NORMAL_PRIORITY, NULL, NULL);
+	if (batchFull == NULL || batchEmpty == NULL || thread == NULL) ETK_ERROR("Unable to create the producer!");
+
+	calls = MALLOC_CALLS();
+	t = e_system_time();
+	resume_thread(thread);
+	for (int32 i = 0; i < NUM_MESSAGES; i += BATCH_SIZE) {
+		acquire_sem(batchFull);
+		for (int32 k = 0; k < BATCH_SIZE; k++) {
+			ok = check_event(batch[k], i + k) && ok;
+			delete batch[k];
+		}
+		release_sem(batchEmpty);
+	}
+	t = e_system_time() - t;
+	report("two threads", MALLOC_CALLS() - calls, t);
+
+	status_t status;
+	wait_for_thread(thread, &status);
+	delete_thread(thread);
+	delete_sem(batchFull);
+	delete_sem(batchEmpty);
+
+	// the first ones fill the depot, the others mustn't keep anything more
+	run_foreign_threads(NUM_FOREIGN, &ok);
+	int32 kept = run_foreign_threads(NUM_FOREIGN, &ok);
+	ETK_OUTPUT("\t%I32i foreign threads: %I32i blocks kept\n", NUM_FOREIGN, kept);
+	ok = (kept < NUM_FOREIGN) && ok;
+
+	ETK_OUTPUT("Results: %s\n", ok ? "OK" : "MISMATCH");
+	return(ok ? 0 : 1);
+}
@@ -0,0 +1,271 @@
+/* --------------------------------------------------------------------------
+ *
+ * ETK++ --- The Easy Toolkit for C++ programing
+ * Copyright (C) 2004-2007, Anthony Lee, All Rights Reserved
+ *
+ * ETK++ library is a freeware; it may be used and distributed according to
+ * the terms of The MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+ * IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * File: message-runner-test.cpp
+ *
+ * --------------------------------------------------------------------------*/
+
+#include <stdlib.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+#include <kernel/Kernel.h>
+#include <kernel/Debug.h>
+#include <app/Application.h>
+#include <app/Looper.h>
+#include <app/MessageRunner.h>
+#include <app/Messenger.h>
+#include <app/Message.h>
+
+#define NUM_IDLE_RUNNERS	10000
+#define NUM_FAST_RUNNERS	10
+#define NUM_RUNNERS		(NUM_IDLE_RUNNERS + NUM_FAST_RUNNERS + 1)
+#define IDLE_INTERVAL		B_INT64_CONSTANT(100000000)
+#define FAST_INTERVAL		B_INT64_CONSTANT(20000)
+#define COUNT_INTERVAL		B_INT64_CONSTANT(10000)
+#define NUM_COUNTED		5
+#define PHASE_INTERVAL		B_INT64_CONSTANT(100000)
+#define MSG_TICK		'tick'
+
+
+// records when the messages of every runner arrive
+class Receiver : public BLooper {
+public:
+	Receiver()
+		: BLooper("receiver"), fTotal(0), fSamples(0), fLateness(0), fMaxLateness(0)
+	{
+		for (int32 i = 0; i < NUM_RUNNERS; i++) {
+			fPrev[i] = B_INT64_CONSTANT(-1);
+			fCount[i] = 0;
+		}
+	}
+
+	virtual void MessageReceived(BMessage *msg)
+	{
+		int32 id = -1;
+		int64 interval = 0;
+		if (msg->what != MSG_TICK || msg->FindInt32("id", &id) == false || msg->FindInt64("interval", &interval) == false ||
+		        id < 0 || id >= NUM_RUNNERS) {
+			BLooper::MessageReceived(msg);
+			return;
+		}
+
+		bigtime_t t = system_time();
+		fTotal++;
+		fCount[id]++;
+
+		bigtime_t prev = fPrev[id];
+		fPrev[id] = t;
+		if (prev < 0) return;
+
+		// how far the period is from the interval, skip the ticks that were missed
+		bigtime_t late = t - prev;
+		late = late - ((late + interval / 2) / interval) * interval;
+		if (late < 0) late = -late;
+
+		fSamples++;
+		fLateness += late;
+		if (late > fMaxLateness) fMaxLateness = late;
+	}
+
+	void ResetLateness()
+	{
+		fSamples = fLateness = fMaxLateness = 0;
+	}
+
+	int64 fTotal;
+	int64 fSamples;
+	bigtime_t fLateness;
+	bigtime_t fMaxLateness;
+	bigtime_t fPrev[NUM_RUNNERS];
+	int32 fCount[NUM_RUNNERS];
+};
+
+
+static bigtime_t cpu_time()
+{
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+	return((bigtime_t)(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * B_INT64_CONSTANT(1000000) +
+	       (bigtime_t)(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec));
+}
+
+
+static BMessageRunner* new_runner(const BMessenger &msgr, int32 id, bigtime_t interval, int32 count)
+{
+	BMessage msg(MSG_TICK);
+	msg.AddInt32("id", id);
+	msg.AddInt64("interval", interval);
+	return new BMessageRunner(msgr, &msg, interval, count);
+}
+
+
+static int64 received(Receiver *receiver)
+{
+	receiver->Lock();
+	int64 total = receiver->fTotal;
+	receiver->Unlock();
+	return total;
+}
+
+
+static int32 received(Receiver *receiver, int32 id)
+{
+	receiver->Lock();
+	int32 count = receiver->fCount[id];
+	receiver->Unlock();
+	return count;
+}
+
+
+// the setters keep the time of the next message, a new interval counts from the last one
+static bool keeps_phase(Receiver *receiver, const BMessenger &msgr)
+{
+	int32 id = NUM_RUNNERS - 1;
+
+	receiver->Lock();
+	receiver->fCount[id] = 0;
+	receiver->Unlock();
+
+	bool ok = true;
+	BMessageRunner *runner = new_runner(msgr, id, PHASE_INTERVAL, -1);
+
+	snooze(PHASE_INTERVAL / 2);
+	BMessage msg(MSG_TICK);
+	msg.AddInt32("id", id);
+	msg.AddInt64("interval", PHASE_INTERVAL);
+	runner->SetMessage(&msg);
+	runner->SetTarget(msgr);
+	runner->SetCount(-1);
+
+	snooze(PHASE_INTERVAL / 4);
+	ok = (received(receiver, id) == 1) && ok;
+
+	// the next one at 1.5 intervals after the first one
+	snooze(PHASE_INTERVAL / 10);
+	runner->SetInterval(PHASE_INTERVAL * 3 / 2);
+	snooze(PHASE_INTERVAL / 3);
+	ok = (received(receiver, id) == 1) && ok;
+
+	snooze(PHASE_INTERVAL / 2);
+	ok = (received(receiver, id) == 2) && ok;
+
+	delete runner;
+
+	ETK_OUTPUT("\tsetters keep the phase: %s\n", ok ? "yes" : "no");
+	return ok;
+}
+
+
+static status_t test_func(void *data)
+{
+	bool *ok = (bool*)data;
+	BMessageRunner **runners = (BMessageRunner**)malloc(sizeof(BMessageRunner*) * NUM_RUNNERS);
+
+	Receiver *receiver = new Receiver();
+	receiver->Run();
+	BMessenger msgr(receiver);
+
+	// the idle ones send once at the start, then wait for a long time
+	bigtime_t t = system_time();
+	for (int32 i = 0; i < NUM_IDLE_RUNNERS; i++) runners[i] = new_runner(msgr, i, IDLE_INTERVAL, -1);
+	t = system_time() - t;
+	ETK_OUTPUT("\t%I32i runners started in %I64i ms\n", NUM_IDLE_RUNNERS, t / 1000);
+
+	for (int32 i = 0; i < 200 && received(receiver) < NUM_IDLE_RUNNERS; i++) snooze(10000);
+
+	bigtime_t cpu = cpu_time();
+	t = system_time();
+	snooze(2000000);
+	cpu = cpu_time() - cpu;
+	t = system_time() - t;
+	ETK_OUTPUT("\tidle: %I64i.%I64i%% CPU\n", cpu * 100 / t, (cpu * 1000 / t) % 10);
+
+	// the fast ones beside the idle ones
+	for (int32 i = NUM_IDLE_RUNNERS; i < NUM_IDLE_RUNNERS + NUM_FAST_RUNNERS; i++)
+		runners[i] = new_runner(msgr, i, FAST_INTERVAL, -1);
+	runners[NUM_RUNNERS - 1] = new_runner(msgr, NUM_RUNNERS - 1, COUNT_INTERVAL, NUM_COUNTED);
+
+	snooze(100000);
+	receiver->Lock();
+	receiver->ResetLateness();
+	receiver->Unlock();
+
+	cpu = cpu_time();
+	t = system_time();
+	snooze(2000000);
+	cpu = cpu_time() - cpu;
+	t = system_time() - t;
+
+	for (int32 i = 0; i < NUM_RUNNERS; i++) delete runners[i];
+	free(runners);
+
+	receiver->Lock();
+	ETK_OUTPUT("\t%I32i runners every %I64i ms: %I64i.%I64i%% CPU, jitter %I64i us average, %I64i us at most\n",
+	           NUM_FAST_RUNNERS, FAST_INTERVAL / 1000, cpu * 100 / t, (cpu * 1000 / t) % 10,
+	           receiver->fLateness / max_c(receiver->fSamples, 1), receiver->fMaxLateness);
+
+	for (int32 i = 0; i < NUM_IDLE_RUNNERS; i++) {
+		if (receiver->fCount[i] != 1) *ok = false;
+	}
+	for (int32 i = NUM_IDLE_RUNNERS; i < NUM_IDLE_RUNNERS + NUM_FAST_RUNNERS; i++) {
+		// about 110 each, some may be missed when late
+		if (receiver->fCount[i] < 50) *ok = false;
+	}
+	if (receiver->fCount[NUM_RUNNERS - 1] != NUM_COUNTED) *ok = false;
+	receiver->Unlock();
+
+	if (keeps_phase(receiver, msgr) == false) *ok = false;
+
+	receiver->Lock();
+	receiver->Quit();
+
+	app->PostMessage(B_QUIT_REQUESTED);
+
+	return B_OK;
+}
+
+
+int main(int argc, char **argv)
+{
+	bool ok = true;
+
+	BApplication *runnerApp = new BApplication("application/x-vnd.etkxx-message_runner_test-app", false);
+
+	ETK_OUTPUT("Running message runners\n");
+
+	void *thread = create_thread(test_func, B_NORMAL_PRIORITY, &ok, NULL);
+	resume_thread(thread);
+
+	runnerApp->Run();
+	delete runnerApp;
+
+	status_t status;
+	wait_for_thread(thread, &status);
+	delete_thread(thread);
+
+	ETK_OUTPUT("Results: %s\n", ok ? "OK" : "MISMATCH");
+	return(ok ? 0 : 1);
+}
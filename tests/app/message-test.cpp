@@ -0,0 +1,133 @@
+/* --------------------------------------------------------------------------
+ *
+ * ETK++ --- The Easy Toolkit for C++ programing
+ * Copyright (C) 2004-2007, Anthony Lee, All Rights Reserved
+ *
+ * ETK++ library is a freeware; it may be used and distributed according to
+ * the terms of The MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+ * IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * File: message-test.cpp
+ *
+ * --------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <string.h>
+
+#include <kernel/OS.h>
+#include <kernel/Debug.h>
+#include <app/Message.h>
+
+#define NUM_ROUNDS	2000000
+
+static char field_names[200][32];
+
+
+static bool run_test(int32 fields)
+{
+	int32 rounds = NUM_ROUNDS / fields;
+	bool ok = true;
+
+	ETK_OUTPUT("%I32i fields, %I32i operations each:\n", fields, rounds * fields);
+
+	bigtime_t t = e_system_time();
+	for (int32 r = 0; r < rounds / 10; r++) {
+		BMessage msg('test');
+		for (int32 i = 0; i < fields; i++) msg.AddInt32(field_names[i], i);
+		if (r == 0) ok = (msg.CountNames(B_ANY_TYPE) == fields) && ok;
+	}
+	ETK_OUTPUT("\tAdd:     %I64i us (x10)\n", (e_system_time() - t) * 10);
+
+	BMessage msg('test');
+	for (int32 i = 0; i < fields; i++) {
+		msg.AddInt32(field_names[i], i);
+		msg.AddString(field_names[i] + 1, field_names[i]);
+	}
+
+	int32 sum = 0;
+	t = e_system_time();
+	for (int32 r = 0; r < rounds; r++) {
+		for (int32 i = 0; i < fields; i++) {
+			int32 value = -1;
+			msg.FindInt32(field_names[i], &value);
+			sum += value;
+		}
+	}
+	ETK_OUTPUT("\tFind:    %I64i us\n", e_system_time() - t);
+	ok = (sum == rounds * (fields * (fields - 1) / 2)) && ok;
+
+	t = e_system_time();
+	for (int32 r = 0; r < rounds; r++) {
+		for (int32 i = 0; i < fields; i++) msg.ReplaceInt32(field_names[i], r + i);
+	}
+	ETK_OUTPUT("\tReplace: %I64i us\n", e_system_time() - t);
+
+	for (int32 i = 0; i < fields; i++) {
+		int32 value = -1;
+		const char *str = NULL;
+		ok = msg.FindInt32(field_names[i], &value) && value == rounds - 1 + i && ok;
+		ok = msg.FindString(field_names[i] + 1, &str) && strcmp(str, field_names[i]) == 0 && ok;
+	}
+
+	// flattening round trip keeps the field order
+	size_t size = msg.FlattenedSize();
+	char *buffer = new char[size];
+	BMessage copy;
+	ok = msg.Flatten(buffer, size) && copy.Unflatten(buffer, size) && ok;
+	delete[] buffer;
+	ok = (copy.CountNames(B_ANY_TYPE) == fields * 2) && ok;
+	for (int32 i = 0; i < copy.CountNames(B_ANY_TYPE); i++) {
+		const char *name = copy.NameAt(i);
+		ok = name != NULL && strcmp(name, i % 2 == 0 ? field_names[i / 2] : field_names[i / 2] + 1) == 0 && ok;
+	}
+
+	// copies share their fields, the copied message keeps its own and each side changes alone
+	const char *before = NULL, *after = NULL;
+	msg.FindString(field_names[0] + 1, &before);
+	BMessage *shared = new BMessage(msg);
+	BMessage again(*shared);
+	msg.FindString(field_names[0] + 1, &after);
+	ok = (before != NULL && before == after) && ok;
+
+	msg.ReplaceInt32(field_names[0], -1);
+	shared->ReplaceInt32(field_names[0], -2);
+	delete shared;
+	for (int32 i = 0; i < fields; i++) {
+		int32 value = 0;
+		ok = again.FindInt32(field_names[i], &value) && value == rounds - 1 + i && ok;
+	}
+	int32 value = 0;
+	ok = msg.FindInt32(field_names[0], &value) && value == -1 && ok;
+
+	return ok;
+}
+
+
+int main(int argc, char **argv)
+{
+	for (int32 i = 0; i < 200; i++) sprintf(field_names[i], "be:field-%d", (int)i);
+
+	bool ok = true;
+	ok = run_test(1) && ok;
+	ok = run_test(10) && ok;
+	ok = run_test(200) && ok;
+
+	ETK_OUTPUT("Results: %s\n", ok ? "OK" : "MISMATCH");
+	return(ok ? 0 : 1);
+}
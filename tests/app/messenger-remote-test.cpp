@@ -0,0 +1,196 @@
+/* --------------------------------------------------------------------------
+ *
+ * ETK++ --- The Easy Toolkit for C++ programing
+ * Copyright (C) 2004-2007, Anthony Lee, All Rights Reserved
+ *
+ * ETK++ library is a freeware; it may be used and distributed according to
+ * the terms of The MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+ * IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * File: messenger-remote-test.cpp
+ *
+ * --------------------------------------------------------------------------*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include <kernel/Kernel.h>
+#include <kernel/Debug.h>
+#include <app/AppDefs.h>
+#include <app/Application.h>
+#include <app/Messenger.h>
+#include <app/Message.h>
+
+#define SIGNATURE		"application/x-vnd.etkxx-messenger_remote_test-app"
+#define NUM_PINGS		2000
+#define MSG_PING		'ping'
+#define MSG_PONG		'pong'
+#define MSG_DATA		'data'
+#define MSG_FETCH		'ftch'
+#define MSG_SYNC		'sync'
+
+
+// the target in the first team, the second one sends to it
+class ServerApp : public BApplication {
+public:
+	ServerApp()
+		: BApplication(SIGNATURE, false), fBytes(0)
+	{
+	}
+
+	virtual void MessageReceived(BMessage *msg)
+	{
+		const void *data = NULL;
+		ssize_t size = 0;
+
+		switch (msg->what) {
+			case MSG_PING:
+				msg->SendReply(MSG_PONG);
+				break;
+
+			case MSG_DATA:
+				if (msg->FindData("data", B_UINT8_TYPE, &data, &size) &&
+				        ((const uint8*)data)[size - 1] == (uint8)(size & 0xff)) fBytes += size;
+				break;
+
+			case MSG_SYNC: {
+				BMessage reply(MSG_SYNC);
+				reply.AddInt64("bytes", fBytes);
+				msg->SendReply(&reply);
+				fBytes = 0;
+			}
+			break;
+
+			case MSG_FETCH: {
+				int32 count = 0;
+				msg->FindInt32("size", &count);
+
+				char *buffer = (char*)malloc(count);
+				memset(buffer, count & 0xff, count);
+
+				BMessage reply(MSG_DATA);
+				reply.AddData("data", B_UINT8_TYPE, buffer, count);
+				msg->SendReply(&reply);
+
+				free(buffer);
+			}
+			break;
+
+			default:
+				BApplication::MessageReceived(msg);
+		}
+	}
+
+private:
+	int64 fBytes;
+};
+
+
+static bool run_client()
+{
+	bool ok = true;
+
+	status_t status = B_ERROR;
+	BMessenger msgr(SIGNATURE, 0, &status);
+	if (status != B_OK || msgr.IsTargetLocal()) {
+		ETK_OUTPUT("No messenger to the other team\n");
+		return false;
+	}
+
+	BMessage ping(MSG_PING), reply;
+	bigtime_t t = system_time();
+	for (int32 i = 0; i < NUM_PINGS; i++) {
+		if (msgr.SendMessage(&ping, &reply) != B_OK || reply.what != MSG_PONG) ok = false;
+	}
+	t = system_time() - t;
+	ETK_OUTPUT("\tround trip: %I64i us\n", t / NUM_PINGS);
+
+	int32 sizes[] = {1024, 16 * 1024, 256 * 1024, 4 * 1024 * 1024};
+	for (int32 k = 0; k < 4; k++) {
+		int32 size = sizes[k];
+		int32 count = (int32)max_c(16, (64 * 1024 * 1024) / size);
+		count = min_c(count, 4096);
+
+		char *buffer = (char*)malloc(size);
+		memset(buffer, size & 0xff, size);
+
+		BMessage data(MSG_DATA);
+		data.AddData("data", B_UINT8_TYPE, buffer, size);
+		free(buffer);
+
+		t = system_time();
+		for (int32 i = 0; i < count; i++) {
+			if (msgr.SendMessage(&data) != B_OK) ok = false;
+		}
+
+		BMessage sync(MSG_SYNC);
+		int64 bytes = 0;
+		if (msgr.SendMessage(&sync, &reply) != B_OK || reply.FindInt64("bytes", &bytes) == false) ok = false;
+		t = system_time() - t;
+
+		if (bytes != (int64)size * (int64)count) ok = false;
+		ETK_OUTPUT("\t%I32i bytes: %I64i MB/s to the other team", size, (int64)size * count / max_c(t, 1));
+
+		BMessage fetch(MSG_FETCH);
+		fetch.AddInt32("size", size);
+
+		const void *replyData = NULL;
+		ssize_t replySize = 0;
+		t = system_time();
+		for (int32 i = 0; i < 16; i++) {
+			if (msgr.SendMessage(&fetch, &reply) != B_OK ||
+			        reply.FindData("data", B_UINT8_TYPE, &replyData, &replySize) == false ||
+			        replySize != size || ((const uint8*)replyData)[size - 1] != (uint8)(size & 0xff)) ok = false;
+		}
+		t = system_time() - t;
+		ETK_OUTPUT(", %I64i MB/s in replies\n", (int64)size * 16 / max_c(t, 1));
+	}
+
+	msgr.SendMessage(B_QUIT_REQUESTED);
+
+	return ok;
+}
+
+
+int main(int argc, char **argv)
+{
+	if (argc > 1 && strcmp(argv[1], "--client") == 0) return(run_client() ? 0 : 1);
+
+	ServerApp *server = new ServerApp();
+
+	ETK_OUTPUT("Messaging between two teams\n");
+
+	pid_t pid = fork();
+	if (pid == 0) {
+		execl(argv[0], argv[0], "--client", (char*)NULL);
+		_exit(1);
+	}
+
+	server->Run();
+	delete server;
+
+	int status = 1;
+	if (pid > 0) waitpid(pid, &status, 0);
+
+	bool ok = (pid > 0 && WIFEXITED(status) && WEXITSTATUS(status) == 0);
+	ETK_OUTPUT("Results: %s\n", ok ? "OK" : "MISMATCH");
+	return(ok ? 0 : 1);
+}
@@ -0,0 +1,177 @@
+/* --------------------------------------------------------------------------
+ *
+ * ETK++ --- The Easy Toolkit for C++ programing
+ * Copyright (C) 2004-2007, Anthony Lee, All Rights Reserved
+ *
+ * ETK++ library is a freeware; it may be used and distributed according to
+ * the terms of The MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+ * IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * File: messenger-reply-test.cpp
+ *
+ * --------------------------------------------------------------------------*/
+
+#include <kernel/Kernel.h>
+#include <kernel/Debug.h>
+#include <app/AppDefs.h>
+#include <app/Looper.h>
+#include <app/Messenger.h>
+#include <app/Message.h>
+
+#define NUM_REQUESTS	20000
+#define NUM_CLIENTS	4
+#define MSG_ECHO	'echo'
+#define MSG_SLOW	'slow'
+#define MSG_IGNORE	'ignr'
+#define MSG_TWICE	'twic'
+
+
+class ReplyLooper : public BLooper {
+public:
+	ReplyLooper()
+		: BLooper("reply looper"), fDuplicated(false), fLateWaiting(true), fWaiting(false)
+	{
+	}
+
+	virtual void MessageReceived(BMessage *msg)
+	{
+		int32 id = 0;
+		msg->FindInt32("id", &id);
+
+		BMessage reply(MSG_ECHO);
+		reply.AddInt32("id", id);
+
+		switch (msg->what) {
+			case MSG_SLOW:
+				// the sender gave up before
+				snooze(50000);
+				fLateWaiting = msg->IsSourceWaiting();
+				msg->SendReply(&reply);
+				break;
+
+			case MSG_ECHO:
+				msg->SendReply(&reply);
+				break;
+
+			case MSG_TWICE:
+				fWaiting = msg->IsSourceWaiting();
+				msg->SendReply(&reply);
+				fDuplicated = (msg->SendReply(&reply) == B_DUPLICATE_REPLY);
+				break;
+
+			case MSG_IGNORE:
+				break;
+
+			default:
+				BLooper::MessageReceived(msg);
+		}
+	}
+
+	bool fDuplicated;
+	bool fLateWaiting;
+	bool fWaiting;
+};
+
+
+static BMessenger *msgr = NULL;
+static bool clientResults[NUM_CLIENTS];
+
+
+static bool request(uint32 what, int32 id, bigtime_t replyTimeout = B_INFINITE_TIMEOUT)
+{
+	BMessage msg(what), reply;
+	msg.AddInt32("id", id);
+
+	int32 replyId = -1;
+	return(msgr->SendMessage(&msg, &reply, B_INFINITE_TIMEOUT, replyTimeout) == B_OK &&
+	       reply.what == MSG_ECHO && reply.FindInt32("id", &replyId) && replyId == id);
+}
+
+
+static status_t client_func(void *data)
+{
+	int32 client = (int32)(long)data;
+
+	for (int32 i = 0; i < NUM_REQUESTS / NUM_CLIENTS; i++) {
+		if (request(MSG_ECHO, client * NUM_REQUESTS + i) == false) return B_ERROR;
+	}
+
+	clientResults[client] = true;
+	return B_OK;
+}
+
+
+int main(int argc, char **argv)
+{
+	bool ok = true;
+
+	ReplyLooper *looper = new ReplyLooper();
+	looper->Run();
+	msgr = new BMessenger(looper, looper);
+
+	ETK_OUTPUT("Synchronous requests with replies\n");
+
+	bigtime_t t = system_time();
+	for (int32 i = 0; i < NUM_REQUESTS; i++) ok = request(MSG_ECHO, i) && ok;
+	t = system_time() - t;
+	ETK_OUTPUT("\tround trip: %I64i ns\n", t * 1000 / NUM_REQUESTS);
+
+	void *threads[NUM_CLIENTS];
+	t = system_time();
+	for (int32 i = 0; i < NUM_CLIENTS; i++) {
+		threads[i] = create_thread(client_func, B_NORMAL_PRIORITY, (void*)(long)i, NULL);
+		resume_thread(threads[i]);
+	}
+	for (int32 i = 0; i < NUM_CLIENTS; i++) {
+		status_t status;
+		wait_for_thread(threads[i], &status);
+		delete_thread(threads[i]);
+		ok = clientResults[i] && ok;
+	}
+	t = system_time() - t;
+	ETK_OUTPUT("\tround trip from %d threads: %I64i ns\n", NUM_CLIENTS, t * 1000 / NUM_REQUESTS);
+
+	// the late reply must not be taken for the reply of the next request
+	BMessage slow(MSG_SLOW), reply;
+	slow.AddInt32("id", -1);
+	ok = (msgr->SendMessage(&slow, &reply, B_INFINITE_TIMEOUT, 10000) != B_OK) && ok;
+	for (int32 i = 0; i < 8; i++) ok = request(MSG_ECHO, i) && ok;
+	ok = (looper->fLateWaiting == false) && ok;
+	ETK_OUTPUT("\tlate reply skipped: %s\n", ok ? "yes" : "no");
+
+	// no reply at all, the sender gets told when the message is deleted
+	BMessage ignore(MSG_IGNORE);
+	t = system_time();
+	ok = (msgr->SendMessage(&ignore, &reply, B_INFINITE_TIMEOUT, 5000000) == B_OK && reply.what == B_NO_REPLY) && ok;
+	t = system_time() - t;
+	ok = (t < 1000000) && ok;
+	ETK_OUTPUT("\tno reply: %I64i us\n", t);
+
+	ok = request(MSG_TWICE, 1) && ok;
+	ok = request(MSG_ECHO, 2) && ok;
+	ok = looper->fDuplicated && looper->fWaiting && ok;
+
+	delete msgr;
+
+	looper->Lock();
+	looper->Quit();
+
+	ETK_OUTPUT("Results: %s\n", ok ? "OK" : "MISMATCH");
+	return(ok ? 0 : 1);
+}
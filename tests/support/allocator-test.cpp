@@ -0,0 +1,167 @@
+/* --------------------------------------------------------------------------
+ *
+ * ETK++ --- The Easy Toolkit for C++ programing
+ * Copyright (C) 2004-2007, Anthony Lee, All Rights Reserved
+ *
+ * ETK++ library is a freeware; it may be used and distributed according to
+ * the terms of The MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+ * IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * File: allocator-test.cpp
+ *
+ * --------------------------------------------------------------------------*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <kernel/OS.h>
+#include <kernel/Debug.h>
+#include <support/Allocator.h>
+#include <support/List.h>
+
+#define NUM_ROUNDS	2000
+#define NUM_OBJECTS	2000
+#define NUM_LISTS	200000
+#define LIST_SIZE	12
+
+// sizes of a BRect, a message field, a text line and an XML node
+static const size_t object_sizes[4] = {16, 40, 72, 120};
+
+
+static void run_malloc(void **objects)
+{
+	for (int32 round = 0; round < NUM_ROUNDS; round++) {
+		for (int32 i = 0; i < NUM_OBJECTS; i++) {
+			objects[i] = malloc(object_sizes[i & 3]);
+			*((int32*)objects[i]) = i;
+		}
+		for (int32 i = 0; i < NUM_OBJECTS; i++) free(objects[i]);
+	}
+}
+
+
+static void run_pool(void **objects, BPoolAllocator *pool)
+{
+	for (int32 round = 0; round < NUM_ROUNDS; round++) {
+		for (int32 i = 0; i < NUM_OBJECTS; i++) {
+			objects[i] = pool->Alloc(object_sizes[i & 3]);
+			*((int32*)objects[i]) = i;
+		}
+		for (int32 i = 0; i < NUM_OBJECTS; i++) pool->Free(objects[i], object_sizes[i & 3]);
+	}
+}
+
+
+static void run_arena(void **objects, BArenaAllocator *arena)
+{
+	for (int32 round = 0; round < NUM_ROUNDS; round++) {
+		for (int32 i = 0; i < NUM_OBJECTS; i++) {
+			objects[i] = arena->Alloc(object_sizes[i & 3]);
+			*((int32*)objects[i]) = i;
+		}
+		arena->Reset();
+	}
+}
+
+
+// every byte of every object must survive the allocation of the others
+static bool check(void **objects, BAllocator *allocator, BArenaAllocator *arena)
+{
+	for (int32 round = 0; round < 3; round++) {
+		for (int32 i = 0; i < NUM_OBJECTS; i++) {
+			size_t size = object_sizes[i & 3] + (round == 2 ? 900 : 0);
+			if ((objects[i] = allocator->Alloc(size)) == NULL) return false;
+			memset(objects[i], i & 0xff, size);
+		}
+		for (int32 i = 0; i < NUM_OBJECTS; i++) {
+			size_t size = object_sizes[i & 3] + (round == 2 ? 900 : 0);
+			for (size_t k = 0; k < size; k++)
+				if (((uint8*)objects[i])[k] != (uint8)(i & 0xff)) return false;
+			if (arena == NULL) allocator->Free(objects[i], size);
+		}
+		if (arena != NULL) arena->Reset();
+	}
+
+	return true;
+}
+
+
+// lots of small lists, like the children of views or the items of menus
+static bool run_lists(BAllocator *allocator, BArenaAllocator *arena)
+{
+	BList **lists = (BList**)malloc(NUM_LISTS * sizeof(BList*));
+	bool ok = true;
+
+	for (int32 i = 0; i < NUM_LISTS; i++) {
+		lists[i] = new BList();
+		lists[i]->SetAllocator(allocator);
+		for (int32 k = 0; k < LIST_SIZE; k++) lists[i]->AddItem((void*)(long)(k + 1));
+	}
+
+	for (int32 i = 0; i < NUM_LISTS; i++) {
+		if (lists[i]->CountItems() != LIST_SIZE || lists[i]->Items()[LIST_SIZE] != NULL ||
+		    lists[i]->ItemAt(LIST_SIZE - 1) != (void*)(long)LIST_SIZE) ok = false;
+		delete lists[i];
+	}
+
+	if (arena != NULL) arena->Reset();
+	free(lists);
+
+	return ok;
+}
+
+
+int main(int argc, char **argv)
+{
+	void **objects = (void**)malloc(NUM_OBJECTS * sizeof(void*));
+	BPoolAllocator pool;
+	BArenaAllocator arena;
+	bigtime_t t;
+
+	bool ok = check(objects, &pool, NULL) && check(objects, &arena, &arena);
+
+	t = e_system_time();
+	run_malloc(objects);
+	ETK_OUTPUT("%I32i small objects, malloc/free:      %I64i us\n", NUM_ROUNDS * NUM_OBJECTS, e_system_time() - t);
+
+	t = e_system_time();
+	run_pool(objects, &pool);
+	ETK_OUTPUT("%I32i small objects, BPoolAllocator:   %I64i us\n", NUM_ROUNDS * NUM_OBJECTS, e_system_time() - t);
+
+	t = e_system_time();
+	run_arena(objects, &arena);
+	ETK_OUTPUT("%I32i small objects, BArenaAllocator:  %I64i us\n", NUM_ROUNDS * NUM_OBJECTS, e_system_time() - t);
+
+	t = e_system_time();
+	ok = run_lists(NULL, NULL) && ok;
+	ETK_OUTPUT("%I32i lists of %I32i items, malloc():          %I64i us\n", NUM_LISTS, LIST_SIZE, e_system_time() - t);
+
+	t = e_system_time();
+	ok = run_lists(&pool, NULL) && ok;
+	ETK_OUTPUT("%I32i lists of %I32i items, BPoolAllocator:    %I64i us\n", NUM_LISTS, LIST_SIZE, e_system_time() - t);
+
+	t = e_system_time();
+	ok = run_lists(&arena, &arena) && ok;
+	ETK_OUTPUT("%I32i lists of %I32i items, BArenaAllocator:   %I64i us\n", NUM_LISTS, LIST_SIZE, e_system_time() - t);
+
+	free(objects);
+
+	ETK_OUTPUT("Results: %s\n", ok ? "OK" : "FAILED");
+	return(ok ? 0 : 1);
+}
@@ -0,0 +1,185 @@
+/* --------------------------------------------------------------------------
+ *
+ * ETK++ --- The Easy Toolkit for C++ programing
+ * Copyright (C) 2004-2007, Anthony Lee, All Rights Reserved
+ *
+ * ETK++ library is a freeware; it may be used and distributed according to
+ * the terms of The MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+ * IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * File: archive-test.cpp
+ *
+ * --------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <string.h>
+
+#include <kernel/OS.h>
+#include <kernel/Debug.h>
+#include <support/Archivable.h>
+#include <support/List.h>
+
+#define NUM_CLASSES	64
+#define NUM_OBJECTS	100000
+
+static char class_names[NUM_CLASSES][32];
+
+
+class TestItem : public BArchivable
+{
+	public:
+		TestItem(int32 kind, int32 value)
+			: BArchivable(), fKind(kind), fValue(value)
+		{
+		}
+
+		TestItem(const BMessage *from)
+			: BArchivable(from), fKind(-1), fValue(0)
+		{
+			from->FindInt32("kind", &fKind);
+			from->FindInt32("value", &fValue);
+		}
+
+		virtual status_t Archive(BMessage *into, bool deep = true) const
+		{
+			BArchivable::Archive(into, deep);
+			into->AddString("class", class_names[fKind]);
+			into->AddInt32("kind", fKind);
+			into->AddInt32("value", fValue);
+			return B_OK;
+		}
+
+		static BArchivable *Instantiate(const BMessage *from)
+		{
+			return new TestItem(from);
+		}
+
+		int32 fKind;
+		int32 fValue;
+};
+
+
+// known before main() runs, as the classes of the kits
+static e_instantiation_entry static_item_entry("StaticItem", TestItem::Instantiate);
+
+
+// what the callers had to write before: a chain of comparisons over the known classes
+static BArchivable* instantiate_by_switch(const BMessage *from)
+{
+	const char *class_name = NULL;
+	from->FindString("class", from->CountItems("class", B_STRING_TYPE) - 1, &class_name);
+	if (class_name == NULL) return NULL;
+
+	for (int32 i = 0; i < NUM_CLASSES; i++) {
+		if (strcmp(class_name, class_names[i]) == 0) return TestItem::Instantiate(from);
+	}
+	return NULL;
+}
+
+
+static bool check(BArchivable *obj, int32 index)
+{
+	TestItem *item = dynamic_cast<TestItem*>(obj);
+	bool ok = (item != NULL && item->fKind == index % NUM_CLASSES && item->fValue == index);
+	if (obj) delete obj;
+	return ok;
+}
+
+
+int main(int argc, char **argv)
+{
+	for (int32 i = 0; i < NUM_CLASSES; i++) {
+		sprintf(class_names[i], "TestItem%d", (int)i);
+		e_register_instantiation_func(class_names[i], TestItem::Instantiate);
+	}
+
+	BMessage *archives = new BMessage[NUM_OBJECTS];
+	for (int32 i = 0; i < NUM_OBJECTS; i++) {
+		TestItem item(i % NUM_CLASSES, i);
+		item.Archive(&archives[i]);
+	}
+
+	ETK_OUTPUT("Looking up %I32i class names among %I32i classes\n", NUM_OBJECTS * 10, NUM_CLASSES);
+
+	int32 found = 0;
+	bigtime_t t = e_system_time();
+	for (int32 i = 0; i < NUM_OBJECTS * 10; i++) {
+		const char *class_name = class_names[(i * 7) % NUM_CLASSES];
+		for (int32 k = 0; k < NUM_CLASSES; k++) {
+			if (strcmp(class_name, class_names[k]) == 0) {
+				found++;
+				break;
+			}
+		}
+	}
+	ETK_OUTPUT("strcmp over the classes:   %I64i us\n", e_system_time() - t);
+
+	t = e_system_time();
+	for (int32 i = 0; i < NUM_OBJECTS * 10; i++) {
+		if (e_find_instantiation_func(class_names[(i * 7) % NUM_CLASSES]) != NULL) found--;
+	}
+	ETK_OUTPUT("e_find_instantiation_func: %I64i us\n", e_system_time() - t);
+
+	bool ok = (found == 0);
+
+	ETK_OUTPUT("Unarchiving %I32i objects\n", NUM_OBJECTS);
+
+	t = e_system_time();
+	for (int32 i = 0; i < NUM_OBJECTS; i++) ok = check(instantiate_by_switch(&archives[i]), i) && ok;
+	ETK_OUTPUT("strcmp over the classes:   %I64i us\n", e_system_time() - t);
+
+	t = e_system_time();
+	for (int32 i = 0; i < NUM_OBJECTS; i++) ok = check(e_instantiate_object(&archives[i]), i) && ok;
+	ETK_OUTPUT("e_instantiate_object:      %I64i us\n", e_system_time() - t);
+
+	// "BArchivable" only as the base: unknown classes fail, signatures keep classes apart
+	BMessage unknown;
+	unknown.AddString("class", "BArchivable");
+	unknown.AddString("class", "NoSuchClass");
+	ok = ok && (e_instantiate_object(&unknown) == NULL);
+
+	// a known base doesn't stand in for an unknown derived class
+	BMessage derived;
+	TestItem(1, 1).Archive(&derived);
+	derived.AddString("class", "DerivedItem");
+	ok = ok && (e_instantiate_object(&derived) == NULL);
+
+	BMessage static_archive;
+	TestItem(3, 3).Archive(&static_archive);
+	static_archive.ReplaceString("class", 1, "StaticItem");
+	ok = ok && check(e_instantiate_object(&static_archive), 3);
+
+	BMessage signed_archive;
+	TestItem(7, 7).Archive(&signed_archive);
+	signed_archive.ReplaceString("class", 1, "SignedItem");
+	signed_archive.AddString("add_on", "application/x-vnd.etkxx-archive-test");
+
+	ok = ok && (e_find_instantiation_func("SignedItem") == NULL);
+	e_register_instantiation_func("SignedItem", TestItem::Instantiate, "application/x-vnd.etkxx-archive-test");
+	ok = ok && (e_find_instantiation_func("SignedItem") == NULL);
+	ok = ok && check(e_instantiate_object(&signed_archive), 7);
+
+	e_unregister_instantiation_func(class_names[0]);
+	ok = ok && (e_instantiate_object(&archives[0]) == NULL);
+
+	delete[] archives;
+
+	ETK_OUTPUT("Results: %s\n", ok ? "OK" : "MISMATCH");
+	return(ok ? 0 : 1);
+}
@@ -0,0 +1,192 @@
+/* --------------------------------------------------------------------------
+ *
+ * ETK++ --- The Easy Toolkit for C++ programing
+ * Copyright (C) 2004-2007, Anthony Lee, All Rights Reserved
+ *
+ * ETK++ library is a freeware; it may be used and distributed according to
+ * the terms of The MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+ * IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * File: buffered-io-test.cpp
+ *
+ * --------------------------------------------------------------------------*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <kernel/OS.h>
+#include <kernel/Debug.h>
+#include <support/DataIO.h>
+#include <storage/File.h>
+
+#define FILE_NAME	"/tmp/buffered-io-test.dat"
+#define NUM_BYTES	(1024 * 1024)
+#define NUM_RANDOM_OPS	200000
+#define MODEL_SIZE	(512 * 1024)
+
+
+// every call into a BFile is a system call
+class CountingFile : public BFile
+{
+	public:
+		CountingFile(const char *path, uint32 open_mode)
+			: BFile(path, open_mode), fCalls(0)
+		{
+		}
+
+		virtual ssize_t Read(void *buffer, size_t size) {fCalls++; return BFile::Read(buffer, size);}
+		virtual ssize_t Write(const void *buffer, size_t size) {fCalls++; return BFile::Write(buffer, size);}
+		virtual int64 Seek(int64 position, uint32 seek_mode) {fCalls++; return BFile::Seek(position, seek_mode);}
+		virtual int64 Position() const {fCalls++; return BFile::Position();}
+		virtual status_t SetSize(int64 size) {fCalls++; return BFile::SetSize(size);}
+
+		mutable int64 fCalls;
+};
+
+
+static void write_bytes(BDataIO *io)
+{
+	for (int32 i = 0; i < NUM_BYTES; i++) {
+		uint8 c = (uint8)(i * 7 + (i >> 8));
+		io->Write(&c, 1);
+	}
+}
+
+
+static bool read_bytes(BDataIO *io)
+{
+	bool ok = true;
+
+	for (int32 i = 0; i < NUM_BYTES; i++) {
+		uint8 c = 0;
+		if (io->Read(&c, 1) != 1 || c != (uint8)(i * 7 + (i >> 8))) ok = false;
+	}
+
+	return ok;
+}
+
+
+static void run(const char *name, CountingFile *file, BDataIO *io, bool reading)
+{
+	file->fCalls = 0;
+	bigtime_t t = e_system_time();
+	bool ok = true;
+
+	if (reading) ok = read_bytes(io);
+	else write_bytes(io);
+
+	BBufferedDataIO *bufferedIO = dynamic_cast<BBufferedDataIO*>(io);
+	BBufferedPositionIO *bufferedPositionIO = dynamic_cast<BBufferedPositionIO*>(io);
+	if (bufferedIO != NULL) bufferedIO->Flush();
+	if (bufferedPositionIO != NULL) bufferedPositionIO->Flush();
+
+	t = e_system_time() - t;
+	ETK_OUTPUT("%s %s %I32i bytes one at a time: %I64i calls into the file, %I64i us%s\n",
+		   name, reading ? "read" : "wrote", NUM_BYTES, file->fCalls, t, ok ? "" : " (MISMATCH)");
+}
+
+
+// mixed reads, writes and seeks must give the same content as a plain array
+static bool check_random_ops(CountingFile *file)
+{
+	static char model[MODEL_SIZE], content[MODEL_SIZE];
+	char buffer[10000];
+	int64 length = 0, position = 0;
+
+	BBufferedPositionIO io(file, 4096);
+	file->SetSize(0);
+	io.Seek(0, B_SEEK_SET);
+	bzero(model, sizeof(model));
+
+	srand(1);
+	for (int32 i = 0; i < NUM_RANDOM_OPS; i++) {
+		int64 pos = rand() % 300000;
+		size_t len = (rand() % 4 == 0 ? rand() % 10000 : rand() % 64);
+		int32 op = rand() % 4;
+
+		if (op == 3 && rand() % 100 == 0) {
+			if (io.SetSize(pos) != B_OK) return false;
+			if (pos < length) bzero(model + pos, length - pos);
+			length = pos;
+			continue;
+		}
+
+		position = (rand() % 8 == 0 ? length : pos);
+		if (position + (int64)len > MODEL_SIZE) len = (size_t)(MODEL_SIZE - position);
+		if (io.Seek(position == length ? 0 : position, position == length ? B_SEEK_END : B_SEEK_SET) != position) return false;
+
+		if (op == 0) {
+			for (size_t k = 0; k < len; k++) buffer[k] = (char)rand();
+			if (io.Write(buffer, len) != (ssize_t)len) return false;
+			memcpy(model + position, buffer, len);
+			position += len;
+			if (len > 0 && length < position) length = position;
+		} else {
+			ssize_t n = io.Read(buffer, len);
+			ssize_t expected = (ssize_t)min_c((int64)len, max_c(length - position, 0));
+			if (n != expected || (n > 0 && memcmp(buffer, model + position, n) != 0)) return false;
+			position += n;
+		}
+		if (io.Position() != position) return false;
+	}
+
+	if (io.Flush() != B_OK || file->Seek(0, B_SEEK_END) != length) return false;
+
+	file->Seek(0, B_SEEK_SET);
+	return(file->Read(content, (size_t)length) == (ssize_t)length && memcmp(content, model, (size_t)length) == 0);
+}
+
+
+int main(int argc, char **argv)
+{
+	CountingFile *file = new CountingFile(FILE_NAME, B_READ_WRITE | B_CREATE_FILE | B_ERASE_FILE);
+	if (file->InitCheck() != B_OK) {
+		ETK_OUTPUT("Unable to create %s\n", FILE_NAME);
+		delete file;
+		return 1;
+	}
+
+	file->Seek(0, B_SEEK_SET);
+	run("BFile:              ", file, file, false);
+	file->Seek(0, B_SEEK_SET);
+	run("BFile:              ", file, file, true);
+
+	BBufferedDataIO *bufferedIO = new BBufferedDataIO(file);
+	file->SetSize(0);
+	run("BBufferedDataIO:    ", file, bufferedIO, false);
+	file->Seek(0, B_SEEK_SET);
+	run("BBufferedDataIO:    ", file, bufferedIO, true);
+	delete bufferedIO;
+
+	file->SetSize(0);
+	BBufferedPositionIO *bufferedPositionIO = new BBufferedPositionIO(file);
+	run("BBufferedPositionIO:", file, bufferedPositionIO, false);
+	bufferedPositionIO->Seek(0, B_SEEK_SET);
+	run("BBufferedPositionIO:", file, bufferedPositionIO, true);
+	delete bufferedPositionIO;
+
+	bool ok = check_random_ops(file);
+	ETK_OUTPUT("Mixed reads, writes and seeks through BBufferedPositionIO: %s\n", ok ? "OK" : "MISMATCH");
+
+	delete file;
+	unlink(FILE_NAME);
+
+	return(ok ? 0 : 1);
+}
@@ -0,0 +1,144 @@
+/* --------------------------------------------------------------------------
+ *
+ * ETK++ --- The Easy Toolkit for C++ programing
+ * Copyright (C) 2004-2007, Anthony Lee, All Rights Reserved
+ *
+ * ETK++ library is a freeware; it may be used and distributed according to
+ * the terms of The MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+ * IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * File: hash-map-test.cpp
+ *
+ * --------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <unordered_map>
+
+#include <kernel/OS.h>
+#include <kernel/Debug.h>
+#include <support/List.h>
+#include <support/HashMap.h>
+
+#define NUM_ITEMS	10000
+#define NUM_LINEAR_LOOKUPS	20000
+#define NUM_LOOKUPS	5000000
+
+struct item_t {
+	char *name;
+	int32 value;
+};
+
+static char names[NUM_ITEMS][32];
+
+
+static int32 index_of(int32 i)
+{
+	return (int32)(((uint32)i * 2654435761U) % NUM_ITEMS);
+}
+
+
+static void report(const char *name, int32 lookups, bigtime_t t, int32 sum)
+{
+	ETK_OUTPUT("%s %I64i ns per lookup (%I32i)\n", name, t * 1000 / lookups, sum);
+}
+
+
+int main(int argc, char **argv)
+{
+	BList list;
+	BHashMap<const char*, int32> map;
+	BHashMap<BString, int32> stringMap;
+	std::unordered_map<std::string, int32> stdMap;
+	int32 sum, expected = 0;
+	bigtime_t t;
+
+	for (int32 i = 0; i < NUM_ITEMS; i++) {
+		sprintf(names[i], "font-family-%d", (int)i);
+
+		item_t *item = (item_t*)malloc(sizeof(item_t));
+		item->name = names[i];
+		item->value = i;
+		list.AddItem(item);
+
+		map.Put(names[i], i);
+		stringMap.Put(BString(names[i]), i);
+		stdMap[names[i]] = i;
+	}
+
+	ETK_OUTPUT("Looking up the keys of %I32i items\n", NUM_ITEMS);
+
+	t = e_system_time();
+	sum = 0;
+	for (int32 i = 0; i < NUM_LINEAR_LOOKUPS; i++) {
+		const char *key = names[index_of(i)];
+		for (int32 k = 0; k < list.CountItems(); k++) {
+			item_t *item = (item_t*)list.ItemAt(k);
+			if (strcmp(item->name, key) == 0) {
+				sum += item->value;
+				break;
+			}
+		}
+	}
+	report("BList + strcmp:               ", NUM_LINEAR_LOOKUPS, e_system_time() - t, sum);
+
+	// copies of the keys, so that equal pointers don't short-cut the comparison
+	static char copies[NUM_ITEMS][32];
+	for (int32 i = 0; i < NUM_ITEMS; i++) strcpy(copies[i], names[i]);
+
+	t = e_system_time();
+	sum = 0;
+	for (int32 i = 0; i < NUM_LOOKUPS; i++) {
+		int32 *value = map.Lookup(copies[index_of(i)]);
+		if (value) sum += *value;
+	}
+	report("BHashMap<const char*>:        ", NUM_LOOKUPS, e_system_time() - t, sum);
+	expected = sum;
+
+	t = e_system_time();
+	sum = 0;
+	for (int32 i = 0; i < NUM_LOOKUPS; i++) {
+		int32 *value = stringMap.Lookup(names[index_of(i)]);
+		if (value) sum += *value;
+	}
+	report("BHashMap<BString>:            ", NUM_LOOKUPS, e_system_time() - t, sum);
+	bool ok = (sum == expected);
+
+	t = e_system_time();
+	sum = 0;
+	for (int32 i = 0; i < NUM_LOOKUPS; i++) {
+		std::unordered_map<std::string, int32>::const_iterator it = stdMap.find(names[index_of(i)]);
+		if (it != stdMap.end()) sum += it->second;
+	}
+	report("std::unordered_map<std::string>:", NUM_LOOKUPS, e_system_time() - t, sum);
+	ok = ok && (sum == expected);
+
+	// every key removed must be gone, every other one still there
+	for (int32 i = 0; i < NUM_ITEMS; i += 3) ok = stringMap.Remove(names[i]) && ok;
+	for (int32 i = 0; i < NUM_ITEMS; i++) {
+		int32 *value = stringMap.Lookup(names[i]);
+		if ((i % 3 == 0) != (value == NULL) || (value != NULL && *value != i)) ok = false;
+	}
+
+	for (int32 i = 0; i < list.CountItems(); i++) free(list.ItemAt(i));
+
+	ETK_OUTPUT("Results: %s\n", ok ? "OK" : "MISMATCH");
+	return(ok ? 0 : 1);
+}
@@ -0,0 +1,124 @@
+/* --------------------------------------------------------------------------
+ *
+ * ETK++ --- The Easy Toolkit for C++ programing
+ * Copyright (C) 2004-2007, Anthony Lee, All Rights Reserved
+ *
+ * ETK++ library is a freeware; it may be used and distributed according to
+ * the terms of The MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+ * IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * File: mapped-file-io-test.cpp
+ *
+ * --------------------------------------------------------------------------*/
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <kernel/OS.h>
+#include <kernel/Debug.h>
+#include <support/DataIO.h>
+#include <storage/File.h>
+
+#define FILE_NAME	"/tmp/mapped-file-io-test.dat"
+#define FILE_SIZE	(128 * 1024 * 1024)
+#define CHUNK_SIZE	4096
+#define NUM_RANDOM_READS	1000000
+
+
+static uint32 read_sequential(BPositionIO *io)
+{
+	uint32 buffer[CHUNK_SIZE / sizeof(uint32)];
+	uint32 sum = 0;
+	ssize_t n;
+
+	io->Seek(0, B_SEEK_SET);
+	while ((n = io->Read(buffer, CHUNK_SIZE)) > 0) {
+		for (ssize_t i = 0; i < n / (ssize_t)sizeof(uint32); i++) sum += buffer[i];
+	}
+
+	return sum;
+}
+
+
+static uint32 read_random(BPositionIO *io)
+{
+	uint32 buffer[16];
+	uint32 sum = 0;
+
+	srand(1);
+	for (int32 i = 0; i < NUM_RANDOM_READS; i++) {
+		io->Seek((int64)(rand() % (FILE_SIZE / sizeof(buffer))) * sizeof(buffer), B_SEEK_SET);
+		if (io->Read(buffer, sizeof(buffer)) == (ssize_t)sizeof(buffer)) sum += buffer[0];
+	}
+
+	return sum;
+}
+
+
+int main(int argc, char **argv)
+{
+	bigtime_t t;
+	uint32 sum1, sum2;
+
+	BFile file(FILE_NAME, B_READ_WRITE | B_CREATE_FILE | B_ERASE_FILE);
+	if (file.InitCheck() != B_OK) {
+		ETK_OUTPUT("Failed to create %s\n", FILE_NAME);
+		exit(1);
+	}
+
+	t = e_system_time();
+	BMappedFileIO *writer = new BMappedFileIO(&file, true);
+	uint32 block[CHUNK_SIZE / sizeof(uint32)];
+	for (uint32 i = 0; i < FILE_SIZE / sizeof(uint32); i += CHUNK_SIZE / sizeof(uint32)) {
+		for (uint32 k = 0; k < CHUNK_SIZE / sizeof(uint32); k++) block[k] = (i + k) * 2654435761U;
+		writer->Write(block, CHUNK_SIZE);
+	}
+	delete writer;
+	ETK_OUTPUT("Write %d MB through BMappedFileIO: %I64i us\n", FILE_SIZE >> 20, e_system_time() - t);
+
+	// BFile + BMallocIO: the whole file gets copied into the heap first
+	t = e_system_time();
+	BMallocIO mallocIO;
+	ssize_t n;
+	file.Seek(0, B_SEEK_SET);
+	while ((n = file.Read(block, CHUNK_SIZE)) > 0) mallocIO.Write(block, (size_t)n);
+	sum1 = read_sequential(&mallocIO);
+	ETK_OUTPUT("Sequential, BFile + BMallocIO: %I64i us\n", e_system_time() - t);
+
+	t = e_system_time();
+	BMappedFileIO mappedIO(&file);
+	mappedIO.SetAdvice(B_MAPPED_IO_SEQUENTIAL);
+	sum2 = read_sequential(&mappedIO);
+	ETK_OUTPUT("Sequential, BMappedFileIO: %I64i us\n", e_system_time() - t);
+	if (sum1 != sum2) ETK_OUTPUT("Sequential checksums differ!\n");
+
+	t = e_system_time();
+	sum1 = read_random(&mallocIO);
+	ETK_OUTPUT("Random 64 bytes x %d, BMallocIO: %I64i us\n", NUM_RANDOM_READS, e_system_time() - t);
+
+	t = e_system_time();
+	mappedIO.SetAdvice(B_MAPPED_IO_RANDOM);
+	sum2 = read_random(&mappedIO);
+	ETK_OUTPUT("Random 64 bytes x %d, BMappedFileIO: %I64i us\n", NUM_RANDOM_READS, e_system_time() - t);
+	if (sum1 != sum2) ETK_OUTPUT("Random checksums differ!\n");
+
+	unlink(FILE_NAME);
+
+	return 0;
+}
@@ -0,0 +1,248 @@
+/* --------------------------------------------------------------------------
+ *
+ * ETK++ --- The Easy Toolkit for C++ programing
+ * Copyright (C) 2004-2007, Anthony Lee, All Rights Reserved
+ *
+ * ETK++ library is a freeware; it may be used and distributed according to
+ * the terms of The MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+ * IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * File: number-format-test.cpp
+ *
+ * --------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <locale.h>
+
+#include <kernel/OS.h>
+#include <kernel/Debug.h>
+#include <support/String.h>
+
+#define NUM_VALUES	10000000
+#define NUM_CHECKS	200000
+#define NUM_SLOW	(NUM_VALUES / 100) // the old "%g" takes microseconds for large exponents
+
+
+static double random_double(uint32 *seed)
+{
+	uint64 bits = 0;
+	for (int32 i = 0; i < 4; i++) {
+		*seed = *seed * 1103515245 + 12345;
+		bits = (bits << 16) | ((*seed >> 8) & 0xffff);
+	}
+
+	double value;
+	memcpy(&value, &bits, sizeof(value));
+	if (value != value || value - value != 0) value = (double)(int64)bits / 3.0; // nan or inf
+	return value;
+}
+
+
+static void report(const char *name, int32 count, bigtime_t t, int32 len)
+{
+	ETK_OUTPUT("%s %I64i ns per double (%I32i bytes)\n", name, t * 1000 / count, len);
+}
+
+
+// the least count of digits of "%.*e" reading back as value
+static int32 shortest_digits(double value)
+{
+	char buf[64];
+	for (int32 precision = 0; precision < 17; precision++) {
+		snprintf(buf, sizeof(buf), "%.*e", (int)precision, value);
+		if (strtod(buf, NULL) == value) return precision + 1;
+	}
+	return 17;
+}
+
+
+static int32 count_digits(const char *str)
+{
+	int32 count = 0, zeros = 0;
+	bool leading = true;
+	for (; *str != 0 && *str != 'e'; str++) {
+		if (*str < '0' || *str > '9') continue;
+		if (leading && *str == '0') continue;
+		leading = false;
+		if (*str == '0') zeros++;
+		else {
+			count += zeros + 1;
+			zeros = 0;
+		}
+	}
+	return count;
+}
+
+
+int main(int argc, char **argv)
+{
+	double *values = (double*)malloc(sizeof(double) * NUM_VALUES);
+	uint32 seed = 2010;
+	for (int32 i = 0; i < NUM_VALUES; i++) {
+		// half of them as the bit patterns, the others as the usual numbers
+		if (i % 2 == 0) values[i] = random_double(&seed);
+		else values[i] = (double)(int32)(seed = seed * 1103515245 + 12345) / 1000.0;
+	}
+
+	ETK_OUTPUT("Formatting %I32i doubles\n", NUM_VALUES);
+
+	BString str;
+	bigtime_t t;
+	int32 len = 0;
+
+	t = e_system_time();
+	for (int32 i = 0; i < NUM_VALUES; i++) {
+		str.Truncate(0);
+		str << values[i];
+		len += str.Length();
+	}
+	report("BString::operator<<:  ", NUM_VALUES, e_system_time() - t, len);
+
+	len = 0;
+	t = e_system_time();
+	for (int32 i = 0; i < NUM_SLOW; i++) {
+		str.Truncate(0);
+		str.AppendFormat("%g", values[i]);
+		len += str.Length();
+	}
+	report("BString::AppendFormat:", NUM_SLOW, e_system_time() - t, len);
+
+	char buf[64];
+	len = 0;
+	t = e_system_time();
+	for (int32 i = 0; i < NUM_VALUES; i++) len += snprintf(buf, sizeof(buf), "%.17g", values[i]);
+	report("snprintf(\"%.17g\"):   ", NUM_VALUES, e_system_time() - t, len);
+
+	len = 0;
+	t = e_system_time();
+	for (int32 i = 0; i < NUM_VALUES; i++) len += e_format_double(buf, values[i]);
+	report("e_format_double:      ", NUM_VALUES, e_system_time() - t, len);
+
+	// every output must read back as the same value, and be no longer than needed
+	bool ok = true;
+	int32 longer = 0;
+	for (int32 i = 0; i < NUM_VALUES; i++) {
+		e_format_double(buf, values[i]);
+
+		double v = 0;
+		if (e_parse_double(buf, -1, &v) != (int32)strlen(buf) || v != values[i] || strtod(buf, NULL) != values[i]) {
+			if (ok) ETK_OUTPUT("%s doesn't read back\n", buf);
+			ok = false;
+		}
+
+		if (i < NUM_CHECKS && count_digits(buf) > shortest_digits(values[i])) longer++;
+	}
+	ETK_OUTPUT("%I32i of %I32i longer than the shortest\n", longer, NUM_CHECKS);
+	ok = ok && (longer == 0);
+
+	for (int32 i = 0; i < NUM_CHECKS; i++) {
+		float f = (float)values[i];
+		e_format_float(buf, f);
+		if (strtof(buf, NULL) != f && f == f) {
+			if (ok) ETK_OUTPUT("%s doesn't read back as float\n", buf);
+			ok = false;
+		}
+	}
+
+	char text[NUM_CHECKS / 10][32];
+	for (int32 i = 0; i < NUM_CHECKS / 10; i++) sprintf(text[i], "%.6f", values[i * 2 + 1]);
+
+	double sum1 = 0, sum2 = 0;
+	t = e_system_time();
+	for (int32 k = 0; k < 50; k++)
+		for (int32 i = 0; i < NUM_CHECKS / 10; i++) sum1 += strtod(text[i], NULL);
+	ETK_OUTPUT("Parsing: strtod %I64i ns", (e_system_time() - t) * 1000 / (NUM_CHECKS * 5));
+
+	t = e_system_time();
+	for (int32 k = 0; k < 50; k++) {
+		for (int32 i = 0; i < NUM_CHECKS / 10; i++) {
+			double v = 0;
+			e_parse_double(text[i], -1, &v);
+			sum2 += v;
+		}
+	}
+	ETK_OUTPUT(", e_parse_double %I64i ns\n", (e_system_time() - t) * 1000 / (NUM_CHECKS * 5));
+	ok = ok && (sum1 == sum2);
+
+	const int64 ints[] = {0, 1, -1, 9, 10, 99, 100, B_MAXINT32, B_MININT32, B_MAXINT64, B_MININT64};
+	for (size_t i = 0; i < sizeof(ints) / sizeof(ints[0]); i++) {
+		str.Truncate(0);
+		str << ints[i];
+
+		int64 v = 0;
+		sprintf(buf, "%lld", (long long)ints[i]);
+		if (str != buf || !str.GetInteger(&v) || v != ints[i]) ok = false;
+	}
+
+	str.Truncate(0);
+	str << B_MAXUINT64 << ' ' << 0.1 << ' ' << 1e100 << ' ' << 100.0 << ' ' << -2.5e-5f;
+	ETK_OUTPUT("%s\n", str.String());
+	ok = ok && (str == "18446744073709551615 0.1 1e+100 100 -2.5e-05");
+
+	// the widest values and zero through the formatter, against the C library
+	struct {
+		const char *format;
+		const char *expected;
+		int64 value;
+	} formats[] = {
+		{"%25I64i", "%25lld", B_MININT64},
+		{"%.22I64i", "%.22lld", B_MININT64},
+		{"%25I64u", "%25llu", (int64)B_MAXUINT64},
+		{"%.24I64o", "%.24llo", (int64)B_MAXUINT64},
+		{"%30I64X", "%30llX", (int64)B_MAXUINT64},
+		{"%8I64i|%.0I64u|%.5I64x", "%8lld|%.0llu|%.5llx", 0},
+	};
+	for (size_t i = 0; i < sizeof(formats) / sizeof(formats[0]); i++) {
+		str.Truncate(0);
+		if (strchr(formats[i].format, '|') != strrchr(formats[i].format, '|')) {
+			str.AppendFormat(formats[i].format, formats[i].value, formats[i].value, formats[i].value);
+			snprintf(buf, sizeof(buf), formats[i].expected,
+				 (long long)formats[i].value, (unsigned long long)formats[i].value, (unsigned long long)formats[i].value);
+		} else {
+			str.AppendFormat(formats[i].format, formats[i].value);
+			snprintf(buf, sizeof(buf), formats[i].expected, (long long)formats[i].value);
+		}
+		if (str != buf) {
+			ETK_OUTPUT("\"%s\" gives \"%s\" instead of \"%s\"\n", formats[i].format, str.String(), buf);
+			ok = false;
+		}
+	}
+
+	// the parsing doesn't depend on the decimal point of the locale, where one can be set
+	const char *locales[] = {"de_DE.UTF-8", "fr_FR.UTF-8", "ps_AF.UTF-8", "ar_SA.UTF-8"};
+	for (size_t i = 0; i < sizeof(locales) / sizeof(locales[0]); i++) {
+		if (setlocale(LC_NUMERIC, locales[i]) == NULL) continue;
+
+		double v1 = 0, v2 = 0;
+		e_parse_double("1.5", -1, &v1);
+		e_parse_double("1.2345678901234567890123e-300", -1, &v2);
+		if (v1 != 1.5 || v2 != 1.2345678901234568e-300) {
+			ETK_OUTPUT("Parsing fails under %s\n", locales[i]);
+			ok = false;
+		}
+	}
+	setlocale(LC_NUMERIC, "C");
+
+	free(values);
+
+	ETK_OUTPUT("Results: %s\n", ok ? "OK" : "MISMATCH");
+	return(ok ? 0 : 1);
+}
@@ -0,0 +1,89 @@
+/* --------------------------------------------------------------------------
+ *
+ * ETK++ --- The Easy Toolkit for C++ programing
+ * Copyright (C) 2004-2007, Anthony Lee, All Rights Reserved
+ *
+ * ETK++ library is a freeware; it may be used and distributed according to
+ * the terms of The MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+ * IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * File: string-array-find-test.cpp
+ *
+ * --------------------------------------------------------------------------*/
+
+#include <kernel/OS.h>
+#include <kernel/Debug.h>
+#include <support/StringArray.h>
+
+#define NUM_ITEMS	10000
+#define NUM_LOOKUPS	20000
+
+
+static bigtime_t lookup(BStringArray &array, bool ignoreCase, int32 *mismatches)
+{
+	BString key;
+	bigtime_t t = e_system_time();
+
+	for (int32 i = 0; i < NUM_LOOKUPS; i++) {
+		int32 n = (int32)(((uint32)i * 2654435761U) % NUM_ITEMS);
+		key.SetTo(ignoreCase ? "ITEM-" : "item-");
+		key << n;
+
+		int32 found = (ignoreCase ? array.IFindString(key) : array.FindString(key));
+		if (found != n) (*mismatches)++;
+	}
+
+	return e_system_time() - t;
+}
+
+
+int main(int argc, char **argv)
+{
+	BStringArray array;
+	BString str;
+	int32 mismatches = 0;
+
+	for (int32 i = 0; i < NUM_ITEMS; i++) {
+		str.SetTo("item-");
+		str << i;
+		array.AddItem(str);
+	}
+
+	ETK_OUTPUT("%I32i lookups in %I32i items\n", NUM_LOOKUPS, NUM_ITEMS);
+
+	array.SetHashIndex(false);
+	ETK_OUTPUT("FindString (linear): %I64i us\n", lookup(array, false, &mismatches));
+	ETK_OUTPUT("IFindString (linear): %I64i us\n", lookup(array, true, &mismatches));
+
+	array.SetHashIndex(true);
+	ETK_OUTPUT("FindString (hashed): %I64i us\n", lookup(array, false, &mismatches));
+	ETK_OUTPUT("IFindString (hashed): %I64i us\n", lookup(array, true, &mismatches));
+
+	// the index must follow the modifications
+	array.SwapItems(0, NUM_ITEMS - 1);
+	array.AddItem("item-0", 10);
+	if (array.FindString("item-0") != 10 || array.FindString("item-0", 11) != NUM_ITEMS ||
+	    array.FindString("item-0", NUM_ITEMS - 1, true, true) != 10 || array.IFindString("ITEM-9999") != 0) mismatches++;
+	array.RemoveItem(10);
+	if (array.FindString("item-0") != NUM_ITEMS - 1) mismatches++;
+
+	ETK_OUTPUT("%I32i mismatches\n", mismatches);
+
+	return (mismatches == 0 ? 0 : 1);
+}
@@ -0,0 +1,199 @@
+/* --------------------------------------------------------------------------
+ *
+ * ETK++ --- The Easy Toolkit for C++ programing
+ * Copyright (C) 2004-2007, Anthony Lee, All Rights Reserved
+ *
+ * ETK++ library is a freeware; it may be used and distributed according to
+ * the terms of The MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+ * IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * File: string-find-test.cpp
+ *
+ * --------------------------------------------------------------------------*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <kernel/OS.h>
+#include <kernel/Debug.h>
+#include <support/String.h>
+
+#define BUFFER_SIZE	(100 * 1024 * 1024)
+
+static const char *text = "Lorem ipsum dolor sit amet, consectetur adipisicing elit; ";
+
+
+static bool same_char(char a, char b, bool ignoreCase)
+{
+	if (ignoreCase) {
+		if (a >= 'A' && a <= 'Z') a += 'a' - 'A';
+		if (b >= 'A' && b <= 'Z') b += 'a' - 'A';
+	}
+	return(a == b);
+}
+
+
+static bool match_at(const char *str, const char *pattern, int32 offset, bool ignoreCase)
+{
+	for (int32 i = 0; pattern[i] != 0; i++) {
+		if (!same_char(str[offset + i], pattern[i], ignoreCase)) return false;
+	}
+	return true;
+}
+
+
+// the naive searches the results are checked against
+static int32 naive_find_first(const char *str, const char *pattern, int32 fromOffset, bool ignoreCase)
+{
+	int32 len = (int32)strlen(str), patternLen = (int32)strlen(pattern);
+	if (patternLen == 0 || fromOffset < 0 || fromOffset >= len) return -1;
+
+	for (int32 i = fromOffset; i + patternLen <= len; i++) {
+		if (match_at(str, pattern, i, ignoreCase)) return i;
+	}
+	return -1;
+}
+
+
+static int32 naive_find_last(const char *str, const char *pattern, int32 beforeOffset, bool ignoreCase)
+{
+	int32 len = (int32)strlen(str), patternLen = (int32)strlen(pattern);
+	if (patternLen == 0 || beforeOffset < 0 || beforeOffset >= len) return -1;
+
+	for (int32 i = beforeOffset + 1 - patternLen; i >= 0; i--) {
+		if (match_at(str, pattern, i, ignoreCase)) return i;
+	}
+	return -1;
+}
+
+
+static bool check_find(const char *text, const char *pattern)
+{
+	BString str(text);
+	int32 len = (int32)strlen(text);
+
+	if (str.FindFirst(pattern) != naive_find_first(text, pattern, 0, false) ||
+	        str.IFindFirst(pattern) != naive_find_first(text, pattern, 0, true) ||
+	        str.FindLast(pattern) != naive_find_last(text, pattern, len - 1, false) ||
+	        str.IFindLast(pattern) != naive_find_last(text, pattern, len - 1, true)) return false;
+
+	for (int32 offset = -1; offset <= len; offset++) {
+		if (str.FindFirst(pattern, offset) != naive_find_first(text, pattern, offset, false) ||
+		        str.IFindFirst(pattern, offset) != naive_find_first(text, pattern, offset, true) ||
+		        str.FindLast(pattern, offset) != naive_find_last(text, pattern, offset, false) ||
+		        str.IFindLast(pattern, offset) != naive_find_last(text, pattern, offset, true)) return false;
+	}
+
+	return true;
+}
+
+
+static bool check_finds()
+{
+	const char *cases[][2] = {
+		{"", "a"}, {"abc", ""}, {"aaaaaa", "aa"}, {"aaaaaa", "aaaaaaa"}, {"abababab", "abab"},
+		{"Lorem ipsum", "xyz"}, {"Lorem ipsum", "LOREM"}, {"Lorem ipsum", "m"}, {"abcAbcABC", "aBc"}
+	};
+
+	for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+		if (!check_find(cases[i][0], cases[i][1])) {
+			ETK_OUTPUT("Mismatch searching \"%s\" in \"%s\"\n", cases[i][1], cases[i][0]);
+			return false;
+		}
+	}
+
+	// few letters make overlapping and repeated matches likely
+	const char letters[] = "abAB";
+	char text[301], pattern[41];
+	uint32 seed = 1;
+	for (int32 k = 0; k < 2000; k++) {
+		int32 textLen = 1 + (int32)(k % 300);
+		int32 patternLen = 1 + (int32)((k * 7) % 40);
+		for (int32 i = 0; i < textLen; i++) text[i] = letters[(seed = seed * 1103515245 + 12345) >> 30];
+		for (int32 i = 0; i < patternLen; i++) pattern[i] = letters[(seed = seed * 1103515245 + 12345) >> 30];
+		text[textLen] = pattern[patternLen] = 0;
+
+		// a pattern taken from the text is found at least once
+		if (k & 1) {
+			int32 from = (int32)((seed >> 8) % (uint32)textLen);
+			patternLen = min_c(patternLen, textLen - from);
+			memcpy(pattern, text + from, patternLen);
+			pattern[patternLen] = 0;
+		}
+
+		if (!check_find(text, pattern)) {
+			ETK_OUTPUT("Mismatch searching \"%s\" in \"%s\"\n", pattern, text);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+int main(int argc, char **argv)
+{
+	BString str;
+	int32 textLen = (int32)strlen(text);
+	int32 count;
+	bigtime_t t;
+
+	bool ok = check_finds();
+	ETK_OUTPUT("Results of the searches against the naive ones: %s\n", ok ? "OK" : "MISMATCH");
+
+	str.SetMinimumBufferSize(BUFFER_SIZE + textLen + 1);
+	while (str.Length() < BUFFER_SIZE) str.Append(text, textLen);
+	str.SetMinimumBufferSize(0);
+
+	ETK_OUTPUT("Buffer: %I32i bytes, %I32i copies of the text\n", str.Length(), str.Length() / textLen);
+
+	t = e_system_time();
+	count = 0;
+	for (int32 offset = 0; (offset = str.FindFirst("dolor", offset)) >= 0; offset++) count++;
+	ETK_OUTPUT("FindFirst(\"dolor\"): %I32i matches in %I64i us\n", count, e_system_time() - t);
+
+	t = e_system_time();
+	count = 0;
+	for (int32 offset = 0; (offset = str.FindFirst("consectetur adipisicing elit; Lorem", offset)) >= 0; offset++) count++;
+	ETK_OUTPUT("FindFirst(long needle): %I32i matches in %I64i us\n", count, e_system_time() - t);
+
+	t = e_system_time();
+	count = 0;
+	for (int32 offset = 0; (offset = str.IFindFirst("DOLOR", offset)) >= 0; offset++) count++;
+	ETK_OUTPUT("IFindFirst(\"DOLOR\"): %I32i matches in %I64i us\n", count, e_system_time() - t);
+
+	t = e_system_time();
+	count = 0;
+	for (int32 offset = str.Length() - 1; offset >= 0 && (offset = str.FindLast("amet", offset)) >= 0; offset--) count++;
+	ETK_OUTPUT("FindLast(\"amet\"): %I32i matches in %I64i us\n", count, e_system_time() - t);
+
+	t = e_system_time();
+	str.ReplaceAll("ipsum", "IPSUM-IPSUM");
+	ETK_OUTPUT("ReplaceAll(grow): %I32i bytes in %I64i us\n", str.Length(), e_system_time() - t);
+
+	t = e_system_time();
+	str.ReplaceAll("IPSUM-IPSUM", "ipsum");
+	ETK_OUTPUT("ReplaceAll(shrink): %I32i bytes in %I64i us\n", str.Length(), e_system_time() - t);
+
+	t = e_system_time();
+	str.IReplaceAll("lorem", "LOREM");
+	ETK_OUTPUT("IReplaceAll(same size): %I32i bytes in %I64i us\n", str.Length(), e_system_time() - t);
+
+	return(ok ? 0 : 1);
+}
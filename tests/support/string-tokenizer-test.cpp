@@ -0,0 +1,209 @@
+/* --------------------------------------------------------------------------
+ *
+ * ETK++ --- The Easy Toolkit for C++ programing
+ * Copyright (C) 2004-2007, Anthony Lee, All Rights Reserved
+ *
+ * ETK++ library is a freeware; it may be used and distributed according to
+ * the terms of The MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+ * IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * File: string-tokenizer-test.cpp
+ *
+ * --------------------------------------------------------------------------*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include <kernel/OS.h>
+#include <kernel/Debug.h>
+#include <support/String.h>
+#include <support/StringArray.h>
+#include <support/StringTokenizer.h>
+
+#define BUFFER_SIZE	(50 * 1024 * 1024)
+#define SPLIT_BLOCK_SIZE	(64 * 1024)
+
+extern "C" void *__libc_malloc(size_t size);
+extern "C" void *__libc_realloc(void *ptr, size_t size);
+extern "C" void *__libc_calloc(size_t nmemb, size_t size);
+
+static int64 allocations = 0;
+
+// count every allocation done by the process, libroot included
+extern "C" void *malloc(size_t size)
+{
+	allocations++;
+	return __libc_malloc(size);
+}
+
+
+extern "C" void *realloc(void *ptr, size_t size)
+{
+	allocations++;
+	return __libc_realloc(ptr, size);
+}
+
+
+extern "C" void *calloc(size_t nmemb, size_t size)
+{
+	allocations++;
+	return __libc_calloc(nmemb, size);
+}
+
+
+static bool check(const char *str, const char *delimiter, uint32 flags, const char **expected)
+{
+	BStringTokenizer tokenizer(str, delimiter, flags);
+	BStringSlice token;
+
+	for (; *expected != NULL; expected++) {
+		if (!tokenizer.GetNext(&token) || token != *expected) {
+			ETK_OUTPUT("\"%s\" split by \"%s\": expected \"%s\"\n", str, delimiter, *expected);
+			return false;
+		}
+	}
+
+	return !tokenizer.GetNext(&token);
+}
+
+
+// the input ends right before a page that can't be read, without any NUL
+static bool check_copy()
+{
+	const char text[] = "one,two,three";
+	const char *expected[] = {"one", "two", "three"};
+	size_t page = (size_t)sysconf(_SC_PAGESIZE);
+
+	char *pages = (char*)mmap(NULL, page * 2, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (pages == (char*)MAP_FAILED) return false;
+	mprotect(pages + page, page, PROT_NONE);
+
+	char *str = pages + page - (sizeof(text) - 1);
+	memcpy(str, text, sizeof(text) - 1);
+
+	BStringTokenizer tokenizer(str, (int32)(sizeof(text) - 1), ",");
+	BStringSlice token;
+	BString copy;
+	char buf[8];
+	bool ok = true;
+
+	for (int32 i = 0; i < 3; i++) {
+		if (!tokenizer.GetNext(&token)) {
+			ok = false;
+			break;
+		}
+		token.CopyInto(copy);
+		token.CopyInto(buf, sizeof(buf));
+		if (copy != expected[i] || copy.Length() != (int32)strlen(expected[i]) || strcmp(buf, expected[i]) != 0) {
+			ETK_OUTPUT("CopyInto: \"%s\" instead of \"%s\"\n", copy.String(), expected[i]);
+			ok = false;
+		}
+	}
+	if (tokenizer.GetNext(&token)) ok = false;
+
+	munmap(pages, page * 2);
+	return ok;
+}
+
+
+int main(int argc, char **argv)
+{
+	const char *csv[] = {"a", "", "b", "c", NULL};
+	const char *words[] = {"one", "two", "three", NULL};
+	const char *utf8[] = {"\xe4\xb8\x80", "\xe4\xba\x8c", "x", NULL};
+	bool ok = true;
+
+	ok &= check("a,,b,c,", ",", 0, csv);
+	ok &= check("a::::b::c", "::", 0, csv);
+	ok &= check("  one\ttwo \n three\n", " \t\n", B_TOKENIZE_ANY_OF | B_TOKENIZE_SKIP_EMPTY, words);
+	// "\xe3\x80\x81" is the ideographic comma; its bytes must never split other characters
+	ok &= check("\xe4\xb8\x80\xe3\x80\x81\xe4\xba\x8c;x", "\xe3\x80\x81;", B_TOKENIZE_ANY_OF, utf8);
+	ok &= check_copy();
+
+	BString str;
+	str.SetMinimumBufferSize(BUFFER_SIZE + 64);
+	for (int32 i = 0; str.Length() < BUFFER_SIZE; i++) {
+		str << "field" << i << ",";
+		if (i % 8 == 7) str << "\n";
+	}
+	str.SetMinimumBufferSize(0);
+
+	int64 count = 0, bytes = 0;
+	int64 allocs = allocations;
+	bigtime_t t = e_system_time();
+
+	// BStringArray grows by one item at a time, so Split() is fed with blocks
+	// of the input, just as a reader parsing the file block by block would do.
+	for (int32 offset = 0; offset < str.Length();) {
+		int32 end = str.FindFirst(',', min_c(offset + SPLIT_BLOCK_SIZE, str.Length() - 1));
+		end = (end < 0 ? str.Length() : end + 1);
+
+		BString block(str.String() + offset, end - offset);
+		BStringArray *array = block.Split(",");
+		for (int32 i = 0; array != NULL && i < array->CountItems(); i++) {
+			count++;
+			bytes += array->ItemAt(i)->Length();
+		}
+		delete array;
+
+		offset = end;
+	}
+
+	ETK_OUTPUT("Split: %I64i tokens, %I64i bytes, %I64i allocations, %I64i us\n",
+		   count, bytes, allocations - allocs, e_system_time() - t);
+
+	int64 count2 = 0, bytes2 = 0;
+	allocs = allocations;
+	t = e_system_time();
+
+	BStringTokenizer tokenizer(str, ",");
+	BStringSlice token;
+	while (tokenizer.GetNext(&token)) {
+		count2++;
+		bytes2 += token.Length();
+	}
+
+	ETK_OUTPUT("BStringTokenizer: %I64i tokens, %I64i bytes, %I64i allocations, %I64i us\n",
+		   count2, bytes2, allocations - allocs, e_system_time() - t);
+
+	if (count != count2 || bytes != bytes2) ok = false;
+
+	// copying every token costs the length of the token, not of the rest of the input
+	int64 count3 = 0, bytes3 = 0;
+	t = e_system_time();
+
+	BStringTokenizer copier(str, ",");
+	BString copy;
+	while (copier.GetNext(&token)) {
+		token.CopyInto(copy);
+		count3++;
+		bytes3 += copy.Length();
+	}
+
+	ETK_OUTPUT("BStringSlice::CopyInto: %I64i tokens, %I64i bytes, %I64i us\n",
+		   count3, bytes3, e_system_time() - t);
+
+	if (count != count3 || bytes != bytes3) ok = false;
+
+	ETK_OUTPUT("%s\n", ok ? "OK" : "FAILED");
+
+	return (ok ? 0 : 1);
+}
@@ -0,0 +1,133 @@
+/* --------------------------------------------------------------------------
+ *
+ * ETK++ --- The Easy Toolkit for C++ programing
+ * Copyright (C) 2004-2007, Anthony Lee, All Rights Reserved
+ *
+ * ETK++ library is a freeware; it may be used and distributed according to
+ * the terms of The MIT License.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+ * IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * File: swap-data-test.cpp
+ *
+ * --------------------------------------------------------------------------*/
+
+#include <stdlib.h>
+
+#include <kernel/OS.h>
+#include <kernel/Debug.h>
+#include <support/ByteOrder.h>
+
+#define BUFFER_SIZE	(64 * 1024 * 1024)
+#define NUM_ROUNDS	10
+#define NUM_CHECKS	100000
+
+
+// the element-at-a-time loops that e_swap_data() used to run
+static void swap_loop(int32 width, void *data, size_t len)
+{
+	if (width == 2) {
+		uint16 *p = (uint16*)data;
+		for (len /= 2; len > 0; len--, p++) *p = B_SWAP_INT16(*p);
+	} else if (width == 4) {
+		uint32 *p = (uint32*)data;
+		for (len /= 4; len > 0; len--, p++) *p = B_SWAP_INT32(*p);
+	} else {
+		uint64 *p = (uint64*)data;
+		for (len /= 8; len > 0; len--, p++) *p = B_SWAP_INT64(*p);
+	}
+}
+
+
+static type_code type_of(int32 width)
+{
+	return(width == 2 ? B_INT16_TYPE : (width == 4 ? B_FLOAT_TYPE : B_DOUBLE_TYPE));
+}
+
+
+static bool check(uint8 *a, uint8 *b, uint8 *c)
+{
+	srand(1);
+	for (int32 i = 0; i < NUM_CHECKS; i++) {
+		int32 width = 2 << (rand() % 3);
+		size_t len = ((size_t)rand() % 600) & ~((size_t)width - 1);
+		size_t offset = rand() % 8;
+		if (len == 0) continue;
+
+		for (size_t k = 0; k < len + 8; k++) a[k] = b[k] = (uint8)rand();
+
+		// the reference swaps aligned elements
+		memcpy(c, a + offset, len);
+		swap_loop(width, c, len);
+
+		if (e_swap_data(type_of(width), a + offset, len, B_SWAP_ALWAYS) != B_OK ||
+		    memcmp(a + offset, c, len) != 0) return false;
+		if (e_swap_data_copy(type_of(width), a + 8 - offset % 4, b + offset, len, B_SWAP_ALWAYS) != B_OK ||
+		    memcmp(a + 8 - offset % 4, c, len) != 0) return false;
+	}
+
+	return true;
+}
+
+
+static void report(const char *name, int32 width, bigtime_t t)
+{
+	ETK_OUTPUT("%s %I32i-bit: %I64i MB/s\n", name, width * 8,
+		   (int64)BUFFER_SIZE * NUM_ROUNDS / max_c(t, 1));
+}
+
+
+int main(int argc, char **argv)
+{
+	uint8 *a = (uint8*)malloc(BUFFER_SIZE + 16);
+	uint8 *b = (uint8*)malloc(BUFFER_SIZE + 16);
+	uint8 *c = (uint8*)malloc(BUFFER_SIZE + 16);
+	if (a == NULL || b == NULL || c == NULL) return 1;
+
+	bool ok = check(a, b, c);
+	ETK_OUTPUT("Results against the element loop: %s\n", ok ? "OK" : "MISMATCH");
+
+	for (int32 k = 0; k < BUFFER_SIZE; k++) a[k] = b[k] = (uint8)k;
+
+	for (int32 width = 2; width <= 8; width *= 2) {
+		bigtime_t t = e_system_time();
+		for (int32 i = 0; i < NUM_ROUNDS; i++) swap_loop(width, a, BUFFER_SIZE);
+		report("element loop:        ", width, e_system_time() - t);
+
+		t = e_system_time();
+		for (int32 i = 0; i < NUM_ROUNDS; i++) e_swap_data(type_of(width), a, BUFFER_SIZE, B_SWAP_ALWAYS);
+		report("e_swap_data:         ", width, e_system_time() - t);
+
+		t = e_system_time();
+		for (int32 i = 0; i < NUM_ROUNDS; i++) {
+			memcpy(c, b, BUFFER_SIZE);
+			e_swap_data(type_of(width), c, BUFFER_SIZE, B_SWAP_ALWAYS);
+		}
+		report("memcpy + e_swap_data:", width, e_system_time() - t);
+
+		t = e_system_time();
+		for (int32 i = 0; i < NUM_ROUNDS; i++) e_swap_data_copy(type_of(width), c, b, BUFFER_SIZE, B_SWAP_ALWAYS);
+		report("e_swap_data_copy:    ", width, e_system_time() - t);
+	}
+
+	free(a);
+	free(b);
+	free(c);
+
+	return(ok ? 0 : 1);
+}